@@ -1,56 +1,209 @@
 #include <iostream>
+#include <charconv>
 #include <string>
 #include <algorithm>
 #include <filesystem>
 #include <chrono>
 #include <fstream>
 #include <iomanip>
+#include <sstream>
+#include <memory>
+#include <functional>
+#include <optional>
+#include <csignal>
 
 #include "OpenixPacker.hpp"
 #include "OpenixUtils.hpp"
 #include "OpenixPartition.hpp"
 #include "OpenixIMGFile.hpp"
+#include "OpenixCFGDiff.hpp"
+#include "OpenixCFGJson.hpp"
+#include "OpenixMetrics.hpp"
+#include "OpenixPlanner.hpp"
+#include "OpenixBench.hpp"
+#include "OpenixFAT.hpp"
+#include "OpenixExt4.hpp"
+#include "OpenixTOC1.hpp"
+#include "OpenixUBootEnv.hpp"
+#include "OpenixFileIO.hpp"
+#include "OpenixFlasher.hpp"
+#include "OpenixCancellation.hpp"
+#include "OpenixValidator.hpp"
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
 
 
 // Define program version information
 #define VERSION "1.0.0"
 
+// Command line options
+struct CommandLineOptions {
+    std::string operation;
+    std::string input;
+    std::vector<std::string> inputs; //!< Every -i given, in order (validate operation)
+    std::string output;
+    std::string tarInput; //!< Tar stream to pack from ("-" for stdin)
+    std::string against; //!< New configuration file or directory to compare with
+    std::vector<std::string> groups; //!< Configuration groups to emit (json operation)
+    bool ndjson = false; //!< Emit one JSON object per line (json operation)
+    std::string diskSize; //!< Disk size for the gpt operation, with optional K/M/G suffix
+    std::string logicalOffset; //!< First sector of the partition area (gpt operation)
+    std::string metricsFile; //!< Prometheus textfile to export metrics to
+    unsigned metricsInterval = 0; //!< Seconds between metrics exports, 0 for only at exit
+    unsigned timeout = 0; //!< Seconds after which the operation is cancelled, 0 for no deadline
+    bool dryRun = false; //!< Print the I/O plan instead of running (pack and unpack)
+    bool json = false; //!< Print the plan as JSON (dry run only)
+    std::vector<std::string> hostClasses; //!< Host classes to estimate the plan for, empty for the defaults
+    std::string benchSize; //!< Synthetic image size for the bench operation, with optional K/M/G suffix
+    std::string sharedCache; //!< Shared-memory segment caching decrypted entries across processes
+    std::string sharedCacheSize = "256M"; //!< Capacity of the shared cache when it is created
+    std::vector<std::string> sparseEntries; //!< Entries to extract as Android sparse images (unpack operation)
+    bool sparseDisk = false; //!< Write the disk image as an Android sparse image (gpt operation)
+    bool dontCareZeros = false; //!< Emit zero blocks of sparse images as DONT_CARE
+    bool swapOutput = false; //!< Unpack beside the output directory and swap it in atomically (unpack operation)
+    OpenixIMG::Durability durability = OpenixIMG::Durability::NONE; //!< How pack and unpack outputs are synced
+    OpenixIMG::PayloadLayout layout = OpenixIMG::PayloadLayout::TABLE_ORDER; //!< Payload order (pack operation)
+    std::string payloadAlignment; //!< Boundary payloads start on, with optional K/M suffix (pack operation)
+    std::string entry; //!< Image entry holding a filesystem, package or environment (fat, ext4, toc1 and env operations)
+    std::string path = "/"; //!< Path inside the filesystem (fat and ext4 operations)
+    std::string item; //!< TOC1 item to extract or verify (toc1 operation)
+    bool verify = false; //!< Verify checksums (toc1 operation) or read partitions back (flash operation)
+    std::vector<std::string> setVariables; //!< name=value assignments (env operation)
+    std::vector<std::string> unsetVariables; //!< Variables to remove (env operation)
+    std::vector<std::string> partitions; //!< Partitions to write, empty for all (flash operation)
+    bool verbose = false;
+    bool noEncrypt = false;
+    OpenixIMG::OutputFormat outputFormat = OpenixIMG::OutputFormat::IMGREPACKER;
+};
+
+// Parse a whole decimal number of seconds; false for signs, trailing characters or values that do not fit
+bool parseSeconds(const std::string &text, unsigned &value) {
+    const auto *end = text.data() + text.size();
+    const auto [stop, error] = std::from_chars(text.data(), end, value);
+    return error == std::errc() && stop == end;
+}
+
 // Command line argument parsing function
-bool parseArguments(const int argc, char *argv[], std::string &operation,
-                    std::string &input, std::string &output,
-                    bool &verbose, bool &noEncrypt,
-                    OpenixIMG::OutputFormat &outputFormat) {
+bool parseArguments(const int argc, char *argv[], CommandLineOptions &options) {
     if (argc < 2) {
         return false;
     }
 
     // Standard operation handling
-    operation = argv[1];
+    options.operation = argv[1];
 
     // Convert to lowercase for case-insensitive comparison
-    std::transform(operation.begin(), operation.end(), operation.begin(),
+    std::transform(options.operation.begin(), options.operation.end(), options.operation.begin(),
                    [](const unsigned char c) { return std::tolower(c); });
 
     // Check if it's a valid operation
-    if (operation != "pack" && operation != "decrypt" && operation != "unpack" && operation != "partition") {
+    if (const auto &operation = options.operation;
+        operation != "pack" && operation != "decrypt" && operation != "unpack" && operation != "partition" &&
+        operation != "cfgdiff" && operation != "json" && operation != "gpt" && operation != "bench" &&
+        operation != "fat" && operation != "ext4" && operation != "toc1" && operation != "env" &&
+        operation != "flash" && operation != "validate") {
         return false;
     }
 
     // Parse remaining arguments
     for (int i = 2; i < argc; ++i) {
         if (std::string arg = argv[i]; arg == "-i" && i + 1 < argc) {
-            input = argv[++i];
+            options.input = argv[++i];
+            options.inputs.push_back(options.input);
         } else if (arg == "-o" && i + 1 < argc) {
-            output = argv[++i];
+            options.output = argv[++i];
         } else if (arg == "-v" || arg == "--verbose") {
-            verbose = true;
+            options.verbose = true;
         } else if (arg == "--no-encrypt") {
-            noEncrypt = true;
+            options.noEncrypt = true;
+        } else if (arg == "--tar" && i + 1 < argc) {
+            options.tarInput = argv[++i];
+        } else if (arg == "--against" && i + 1 < argc) {
+            options.against = argv[++i];
+        } else if (arg == "--group" && i + 1 < argc) {
+            options.groups.emplace_back(argv[++i]);
+        } else if (arg == "--ndjson") {
+            options.ndjson = true;
+        } else if (arg == "--disk-size" && i + 1 < argc) {
+            options.diskSize = argv[++i];
+        } else if (arg == "--logical-offset" && i + 1 < argc) {
+            options.logicalOffset = argv[++i];
+        } else if (arg == "--metrics" && i + 1 < argc) {
+            options.metricsFile = argv[++i];
+        } else if (arg == "--metrics-interval" && i + 1 < argc) {
+            if (!parseSeconds(argv[++i], options.metricsInterval)) {
+                std::cerr << "Invalid metrics interval: " << argv[i] << std::endl;
+                return false;
+            }
+        } else if (arg == "--timeout" && i + 1 < argc) {
+            if (!parseSeconds(argv[++i], options.timeout)) {
+                std::cerr << "Invalid timeout: " << argv[i] << std::endl;
+                return false;
+            }
+        } else if (arg == "--dry-run") {
+            options.dryRun = true;
+        } else if (arg == "--json") {
+            options.json = true;
+        } else if (arg == "--host-class" && i + 1 < argc) {
+            options.hostClasses.emplace_back(argv[++i]);
+        } else if (arg == "--bench-size" && i + 1 < argc) {
+            options.benchSize = argv[++i];
+        } else if (arg == "--shm-cache" && i + 1 < argc) {
+            options.sharedCache = argv[++i];
+        } else if (arg == "--shm-cache-size" && i + 1 < argc) {
+            options.sharedCacheSize = argv[++i];
+        } else if (arg == "--sparse" && i + 1 < argc) {
+            options.sparseEntries.emplace_back(argv[++i]);
+        } else if (arg == "--sparse-disk") {
+            options.sparseDisk = true;
+        } else if (arg == "--durability" && i + 1 < argc) {
+            if (std::string mode = argv[++i]; mode == "none") {
+                options.durability = OpenixIMG::Durability::NONE;
+            } else if (mode == "barrier") {
+                options.durability = OpenixIMG::Durability::BARRIER;
+            } else if (mode == "incremental") {
+                options.durability = OpenixIMG::Durability::INCREMENTAL;
+            } else {
+                std::cerr << "Unknown durability mode: " << mode << std::endl;
+                return false;
+            }
+        } else if (arg == "--layout" && i + 1 < argc) {
+            if (std::string layout = argv[++i]; layout == "table") {
+                options.layout = OpenixIMG::PayloadLayout::TABLE_ORDER;
+            } else if (layout == "metadata-first") {
+                options.layout = OpenixIMG::PayloadLayout::METADATA_FIRST;
+            } else {
+                std::cerr << "Unknown payload layout: " << layout << std::endl;
+                return false;
+            }
+        } else if (arg == "--align" && i + 1 < argc) {
+            options.payloadAlignment = argv[++i];
+        } else if (arg == "--swap") {
+            options.swapOutput = true;
+        } else if (arg == "--dont-care-zeros") {
+            options.dontCareZeros = true;
+        } else if (arg == "--entry" && i + 1 < argc) {
+            options.entry = argv[++i];
+        } else if (arg == "--path" && i + 1 < argc) {
+            options.path = argv[++i];
+        } else if (arg == "--item" && i + 1 < argc) {
+            options.item = argv[++i];
+        } else if (arg == "--verify") {
+            options.verify = true;
+        } else if (arg == "--set" && i + 1 < argc) {
+            options.setVariables.emplace_back(argv[++i]);
+        } else if (arg == "--unset" && i + 1 < argc) {
+            options.unsetVariables.emplace_back(argv[++i]);
+        } else if (arg == "--partition" && i + 1 < argc) {
+            options.partitions.emplace_back(argv[++i]);
         } else if (arg == "--format" && i + 1 < argc) {
             if (std::string formatArg = argv[++i]; formatArg == "unimg") {
-                outputFormat = OpenixIMG::OutputFormat::UNIMG;
+                options.outputFormat = OpenixIMG::OutputFormat::UNIMG;
             } else if (formatArg == "imgrepacker") {
-                outputFormat = OpenixIMG::OutputFormat::IMGREPACKER;
+                options.outputFormat = OpenixIMG::OutputFormat::IMGREPACKER;
             } else {
                 // 保留警告信息，但使用cout输出
                 std::cout << "Warning: Unknown output format: " << formatArg << ", using default (unimg)" << std::endl;
@@ -60,74 +213,372 @@ bool parseArguments(const int argc, char *argv[], std::string &operation,
         }
     }
 
+    // Packing from a tar stream may take image.cfg from the stream itself
+    if (options.operation == "pack" && !options.tarInput.empty()) {
+        return !options.output.empty();
+    }
+
+    // The benchmark has no input; -o optionally selects the directory to measure
+    if (options.operation == "bench") {
+        return true;
+    }
+
     // Validate required parameters (output is optional for partition operation)
-    if (input.empty()) {
+    if (options.operation == "cfgdiff" && options.against.empty()) {
+        return false;
+    }
+    if (options.input.empty()) {
         return false;
     }
 
     return true;
 }
 
+// Cancelled by SIGINT and SIGTERM while main runs
+OpenixIMG::OpenixCancellationToken *signalToken = nullptr;
+volatile std::sig_atomic_t receivedSignal = 0;
+
+// Asks the running operation to stop; a second signal terminates the process as usual
+extern "C" void handleSignal(const int sig) {
+    receivedSignal = sig;
+    signalToken->cancel();
+    std::signal(sig, SIG_DFL);
+}
+
+// Parse a byte count with an optional K, M or G suffix
+uint64_t parseSize(const std::string &text) {
+    size_t pos = 0;
+    const uint64_t value = std::stoull(text, &pos, 0);
+    const auto suffix = pos < text.size() ? std::toupper(static_cast<unsigned char>(text[pos])) : 0;
+    switch (suffix) {
+        case 0:
+            return value;
+        case 'K':
+            return value << 10;
+        case 'M':
+            return value << 20;
+        case 'G':
+            return value << 30;
+        default:
+            throw std::runtime_error("Invalid size: " + text);
+    }
+}
+
+// Describe a checksum verification result
+std::string checksumStatus(const OpenixIMG::Toc1Checksum &result) {
+    if (!result.present) {
+        return "none";
+    }
+    std::ostringstream status;
+    status << (result.valid ? "ok" : "BAD") << " (0x" << std::hex << std::setw(8) << std::setfill('0') << result.stored;
+    if (!result.valid) {
+        status << ", computed 0x" << std::setw(8) << result.computed;
+    }
+    status << ")";
+    return status.str();
+}
+
+// Load the input image and find the entry named by --entry
+size_t findEntry(OpenixIMG::OpenixIMGFile &imgFile, const CommandLineOptions &options) {
+    if (!imgFile.loadImage(options.input)) {
+        throw std::runtime_error("Failed to load image file!");
+    }
+    const auto &fileList = imgFile.getFileList();
+    const auto match = std::find_if(fileList.begin(), fileList.end(), [&options](const auto &fileInfo) {
+        return fileInfo.filename == options.entry;
+    });
+    if (match == fileList.end()) {
+        throw std::runtime_error("No entry named " + options.entry + " in the image!");
+    }
+    return static_cast<size_t>(match - fileList.begin());
+}
+
+// Range reader over an image entry or, without an entry name, over the input file itself
+OpenixIMG::OpenixFAT::RangeReader openVolume(OpenixIMG::OpenixIMGFile &imgFile, const CommandLineOptions &options) {
+    if (options.entry.empty()) {
+        auto file = std::make_shared<OpenixIMG::OpenixFileIO>(options.input);
+        return [file](const uint64_t offset, void *data, const size_t length) {
+            return file->readAt(offset, data, length);
+        };
+    }
+
+    const auto index = findEntry(imgFile, options);
+    return [&imgFile, index](const uint64_t offset, void *data, const size_t length) {
+        return imgFile.readEntryRange(index, offset, data, length);
+    };
+}
+
+// Write a file streamed from a filesystem reader
+void writeExtracted(const std::string &output, const std::function<uint64_t(const OpenixIMG::OpenixIMGFile::ChunkSink &)> &extract,
+                    const std::string &path) {
+    if (output.empty()) {
+        throw std::runtime_error(path + " is a file; specify an output file with -o!");
+    }
+    std::ofstream outFile(output, std::ios::binary);
+    if (!outFile.is_open()) {
+        throw std::runtime_error("Unable to create output file: " + output);
+    }
+    const auto written = extract([&outFile](const uint8_t *data, const size_t length) {
+        outFile.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(length));
+    });
+    std::cout << "Extracted " << written << " bytes of " << path << " to " << output << std::endl;
+}
+
 // Display help information
 void showHelp(const char *programName) {
     std::cout << "OpenixIMG v" << VERSION << std::endl;
     std::cout << "Usage: " << programName << " <operation> -i <input> -o <output> [options]" << std::endl;
     std::cout << "       " << programName << " partition -i <image_file> [-o <output_file>]" << std::endl;
+    std::cout << "       " << programName << " cfgdiff -i <old_cfg|old_dir> --against <new_cfg|new_dir> [-o <output_file>]"
+            << std::endl;
+    std::cout << "       " << programName << " json -i <cfg_file> [-o <output_file>] [--ndjson] [--group <name>]..."
+            << std::endl;
+    std::cout << "       " << programName << " gpt -i <image_file|sys_partition.fex> -o <disk_image> [--disk-size <size>]"
+            << std::endl;
+    std::cout << "       " << programName << " bench [-o <directory>] [--bench-size <size>]" << std::endl;
+    std::cout << "       " << programName << " fat -i <image_file|fat_image> [--entry <name>] [--path <path>] [-o <output_file>]"
+            << std::endl;
+    std::cout << "       " << programName << " ext4 -i <image_file|ext4_image> [--entry <name>] [--path <path>] [-o <output_file>]"
+            << std::endl;
+    std::cout << "       " << programName << " toc1 -i <image_file|boot_package> [--entry <name>] [--item <name>] [--verify]"
+            << " [-o <output_file>]" << std::endl;
+    std::cout << "       " << programName << " env -i <image_file|env_image> [--entry <name>] [--set <name=value>]..."
+            << " [--unset <name>]..." << std::endl;
+    std::cout << "       " << programName << " flash -i <image_file> -o <device|disk_image> [--partition <name>]... [--verify]"
+            << " [--disk-size <size>]" << std::endl;
     std::cout << std::endl;
     std::cout << "Operations:" << std::endl;
+    std::cout << "  pack       Build an image file from image.cfg (or a directory containing it)" << std::endl;
     std::cout << "  unpack     Extract files from an image file" << std::endl;
     std::cout << "  partition  Output partition table from an image file" << std::endl;
+    std::cout << "  cfgdiff    Semantic diff of two configuration files or directories of them" << std::endl;
+    std::cout << "  json       Convert a configuration file to JSON" << std::endl;
+    std::cout << "  gpt        Write a GPT matching sys_partition.fex into a raw disk image" << std::endl;
+    std::cout << "  fat        List a directory or extract a file of a FAT entry without unpacking the image" << std::endl;
+    std::cout << "  ext4       List a directory or extract a file of an ext2/3/4 entry without unpacking the image" << std::endl;
+    std::cout << "  toc1       List, extract or verify items of a TOC1 package such as boot_package.fex" << std::endl;
+    std::cout << "  env        Print or edit a u-boot environment such as env.fex in place" << std::endl;
+    std::cout << "  flash      Stream partition download files straight to a block device or disk image" << std::endl;
+    std::cout << "  validate   Check the headers of images for structural errors and report unreferenced gaps" << std::endl;
+    std::cout << "  bench      Measure cipher, disk and pack/unpack throughput of this host as JSON" << std::endl;
     std::cout << std::endl;
     std::cout << "Options:" << std::endl;
-    std::cout << "  -i <path>       Input file or directory" << std::endl;
+    std::cout << "  -i <path>       Input file or directory; may be repeated for validate" << std::endl;
     std::cout << "  -o <path>       Output file or directory" << std::endl;
     std::cout << "  -v, --verbose   Show detailed information" << std::endl;
     std::cout << "  --no-encrypt    Disable encryption (pack operation only)" << std::endl;
+    std::cout << "  --tar <path>    Pack from a tar stream ('-' for stdin); -i optionally names image.cfg" << std::endl;
+    std::cout << "  --against <p>   New configuration file or directory (cfgdiff operation only)" << std::endl;
+    std::cout << "  --ndjson        Emit one JSON object per group and line (json operation only)" << std::endl;
+    std::cout << "  --group <name>  Only emit this group; may be repeated (json operation only)" << std::endl;
+    std::cout << "  --disk-size <n> Disk size in bytes, K/M/G suffix allowed; defaults to the size of a block device"
+            << " (gpt and flash operations only)" << std::endl;
+    std::cout << "  --logical-offset <n>  First sector of the partition area, default 40960 (gpt and flash operations only)"
+            << std::endl;
+    std::cout << "  --entry <name>  Image entry holding the filesystem, package or environment; omit when -i is that"
+            << " file itself (fat, ext4, toc1 and env operations only)" << std::endl;
+    std::cout << "  --path <path>   Directory to list or file to extract, default / (fat and ext4 operations only)"
+            << std::endl;
+    std::cout << "  --item <name>   TOC1 item to extract with -o or to verify (toc1 operation only)" << std::endl;
+    std::cout << "  --verify        Verify item and package checksums (toc1 operation) or read written partitions back"
+            << " (flash operation)" << std::endl;
+    std::cout << "  --set <name=value>  Set an environment variable; may be repeated (env operation only)" << std::endl;
+    std::cout << "  --unset <name>  Remove an environment variable; may be repeated (env operation only)" << std::endl;
+    std::cout << "  --partition <name>  Only write this partition; may be repeated (flash operation only)" << std::endl;
     std::cout << "  --format <fmt>  Output format for unpack operation (unimg or imgrepacker)" << std::endl;
+    std::cout << "  --metrics <file.prom>   Export latency histograms as a Prometheus textfile" << std::endl;
+    std::cout << "  --metrics-interval <s>  Also export every <s> seconds while running" << std::endl;
+    std::cout << "  --timeout <s>   Cancel the operation after <s> seconds and remove its partial output (exit code 124)"
+            << std::endl;
+    std::cout << "  --bench-size <n> Payload size of the synthetic image, default 64M (bench operation only)" << std::endl;
+    std::cout << "  --shm-cache <name>       Share decrypted entries with other processes via this POSIX shm segment"
+            << std::endl;
+    std::cout << "  --shm-cache-size <size>  Capacity of the segment when it is created, default 256M" << std::endl;
+    std::cout << "  --sparse <entry>  Extract this entry as an Android sparse image <name>.simg; may be repeated"
+            << " (unpack operation only)" << std::endl;
+    std::cout << "  --sparse-disk     Write the disk image as an Android sparse image with the partition contents"
+            << " of the input image (gpt operation only)" << std::endl;
+    std::cout << "  --durability <mode>  none, barrier (one sync before image.cfg or the header table is written) or"
+            << " incremental (write-back while streaming, then the barrier); pack and unpack operations only"
+            << std::endl;
+    std::cout << "  --layout <name> table (default) or metadata-first to store the partition table, configuration"
+            << " and boot loaders right after the header table (pack operation only)" << std::endl;
+    std::cout << "  --align <size>  Start every payload on this boundary, e.g. 4K or 64K, default 512"
+            << " (pack operation only)" << std::endl;
+    std::cout << "  --swap          Unpack next to the output directory and swap it in atomically; the old tree is"
+            << " deleted after the swap and the command waits for that before exiting (unpack operation only)"
+            << std::endl;
+    std::cout << "  --dont-care-zeros Emit zero blocks of sparse images as DONT_CARE; only for erased targets"
+            << std::endl;
+    std::cout << "  --dry-run       Print the I/O plan of a pack or unpack instead of running it" << std::endl;
+    std::cout << "  --json          Print the dry-run plan or the validation reports as JSON" << std::endl;
+    std::cout << "  --host-class <name:read:write:crypt[:latency_us]>  Estimate the plan for this host (MB/s);"
+            << " may be repeated" << std::endl;
     std::cout << "  -h, --help      Show this help message" << std::endl;
     std::cout << std::endl;
     std::cout << "Examples:" << std::endl;
     std::cout << "  " << programName << " pack -i ./firmware_dir -o firmware.img" << std::endl;
+    std::cout << "  " << programName << " pack --tar - -o firmware.img < payload.tar" << std::endl;
+    std::cout << "  " << programName << " pack -i ./firmware_dir -o firmware.img --layout metadata-first" << std::endl;
+    std::cout << "  " << programName << " pack -i ./firmware_dir -o firmware.img --no-encrypt --align 64K" << std::endl;
     std::cout << "  " << programName << " decrypt -i encrypted.img -o decrypted.img" << std::endl;
     std::cout << "  " << programName << " unpack -i firmware.img -o ./extracted_files --format imgrepacker" <<
             std::endl;
+    std::cout << "  " << programName << " unpack -i firmware.img --dry-run --json" << std::endl;
+    std::cout << "  " << programName << " unpack -i firmware.img -o ./extracted_files --sparse rootfs" << std::endl;
+    std::cout << "  " << programName << " unpack -i firmware.img -o ./extracted_files --swap" << std::endl;
+    std::cout << "  " << programName << " unpack -i firmware.img -o /archive/firmware --durability incremental"
+            << std::endl;
     std::cout << "  " << programName << " partition -i firmware.img" << std::endl;
     std::cout << "  " << programName << " partition -i firmware.img -o partition_table.txt" << std::endl;
+    std::cout << "  " << programName << " cfgdiff -i ./board_a --against ./board_b" << std::endl;
+    std::cout << "  " << programName << " json -i sys_config.fex --ndjson --group target --group power_sply" << std::endl;
+    std::cout << "  " << programName << " gpt -i firmware.img -o disk.img --disk-size 4G" << std::endl;
+    std::cout << "  " << programName << " gpt -i firmware.img -o disk.simg --disk-size 4G --sparse-disk" << std::endl;
+    std::cout << "  " << programName << " fat -i firmware.img --entry boot-resource.fex --path /magic.bin -o magic.bin"
+            << std::endl;
+    std::cout << "  " << programName << " ext4 -i firmware.img --entry rootfs.fex --path /etc/build.prop -o build.prop"
+            << std::endl;
+    std::cout << "  " << programName << " toc1 -i firmware.img --entry boot_package.fex --verify" << std::endl;
+    std::cout << "  " << programName << " toc1 -i firmware.img --entry boot_package.fex --item u-boot -o u-boot.bin"
+            << std::endl;
+    std::cout << "  " << programName << " env -i firmware.img --entry env.fex --set bootdelay=0 --set \"bootargs=console=ttyS0\""
+            << std::endl;
+    std::cout << "  " << programName << " flash -i firmware.img -o /dev/mmcblk0 --verify" << std::endl;
+    std::cout << "  " << programName << " flash -i firmware.img -o disk.img --partition boot --partition rootfs" << std::endl;
+    std::cout << "  " << programName << " validate -i firmware.img" << std::endl;
+    std::cout << "  " << programName << " validate -i /srv/incoming --json" << std::endl;
+    std::cout << "  " << programName << " bench -o /srv/images" << std::endl;
 }
 
 int main(const int argc, char *argv[]) {
-    std::string operation;
-    std::string input;
-    std::string output;
-    bool verbose = false;
-    auto outputFormat = OpenixIMG::OutputFormat::IMGREPACKER;
+    CommandLineOptions options;
 
     // Parse command line arguments
-    if (bool noEncrypt = false; !
-        parseArguments(argc, argv, operation, input, output, verbose, noEncrypt, outputFormat)) {
+    if (!parseArguments(argc, argv, options)) {
         showHelp(argv[0]);
         return 1;
     }
 
+    const auto &operation = options.operation;
+    const auto &input = options.input;
+    const auto &output = options.output;
+    const auto &outputFormat = options.outputFormat;
+
+    // Exports once more when leaving main, whatever the outcome
+    std::unique_ptr<OpenixIMG::OpenixMetricsExporter> metricsExporter;
+    if (!options.metricsFile.empty()) {
+        metricsExporter = std::make_unique<OpenixIMG::OpenixMetricsExporter>(
+            options.metricsFile, std::chrono::seconds(options.metricsInterval));
+    }
+
+    // Ctrl-C, a service stop or the deadline stop the operation at the next chunk
+    const auto cancellation = std::make_shared<OpenixIMG::OpenixCancellationToken>();
+    if (options.timeout > 0) {
+        cancellation->setTimeout(std::chrono::seconds(options.timeout));
+    }
+    signalToken = cancellation.get();
+    std::signal(SIGINT, handleSignal);
+    std::signal(SIGTERM, handleSignal);
+
     try {
         // Create OpenixIMGFile instance
         OpenixIMG::OpenixIMGFile imgFile;
+        imgFile.setCancellationToken(cancellation);
 
         // Create OpenixPacker instance with OpenixIMGFile
         OpenixIMG::OpenixPacker packer(imgFile);
+        packer.setDurability(options.durability);
+        packer.setPayloadLayout(options.layout);
+        if (!options.payloadAlignment.empty()) {
+            packer.setPayloadAlignment(
+                static_cast<uint32_t>(std::min<uint64_t>(parseSize(options.payloadAlignment), UINT32_MAX)));
+        }
+
+        if (!options.sharedCache.empty()) {
+            imgFile.setSharedCache(std::make_shared<OpenixIMG::OpenixSharedCache>(
+                options.sharedCache, parseSize(options.sharedCacheSize)));
+        }
 
         // Set global verbose mode
-        OpenixIMG::OpenixUtils::setVerboseEnabled(verbose);
+        OpenixIMG::OpenixUtils::setVerboseEnabled(options.verbose);
 
-        std::cout << "OpenixIMG v" << VERSION << " started" << std::endl;
-        std::cout << "Operation: " << operation << std::endl;
-        std::cout << "Input: " << input << std::endl;
-        std::cout << "Output: " << output << std::endl;
+        // Keep stdout clean when it carries the JSON document
+        std::ostream &console = (operation == "json" && output.empty()) || options.json || operation == "bench"
+                                   ? std::cerr
+                                   : std::cout;
+        console << "OpenixIMG v" << VERSION << " started" << std::endl;
+        console << "Operation: " << operation << std::endl;
+        console << "Input: " << (options.tarInput.empty() ? input : "tar:" + options.tarInput) << std::endl;
+        console << "Output: " << output << std::endl;
 
         bool success = false;
 
         // Execute the specified operation
-        if (operation == "unpack") {
+        if (options.dryRun) {
+            if (operation != "pack" && operation != "unpack") {
+                throw std::runtime_error("Dry run is only supported for pack and unpack!");
+            }
+            if (!options.tarInput.empty()) {
+                throw std::runtime_error("Dry run needs image.cfg and its files, not a tar stream!");
+            }
+
+            std::vector<OpenixIMG::HostClass> hosts;
+            for (const auto &spec: options.hostClasses) {
+                hosts.push_back(OpenixIMG::OpenixPlanner::parseHostClass(spec));
+            }
+            if (hosts.empty()) {
+                hosts = OpenixIMG::OpenixPlanner::defaultHostClasses();
+            }
+
+            OpenixIMG::OperationPlan plan;
+            if (operation == "pack") {
+                imgFile.setEncryptionEnabled(!options.noEncrypt);
+                plan = packer.planPack(std::filesystem::is_directory(input)
+                                           ? (std::filesystem::path(input) / "image.cfg").string()
+                                           : input);
+            } else {
+                if (!imgFile.loadImage(input)) {
+                    std::cerr << "Failed to load image file!" << std::endl;
+                    return 1;
+                }
+                plan = packer.planUnpack(outputFormat);
+            }
+
+            std::cout << (options.json
+                              ? OpenixIMG::OpenixPlanner::dumpToJson(plan, hosts)
+                              : OpenixIMG::OpenixPlanner::dumpToString(plan, hosts));
+            return 0;
+        }
+
+        if (operation == "pack") {
+            if (output.empty()) {
+                throw std::runtime_error("No output image specified!");
+            }
+            imgFile.setEncryptionEnabled(!options.noEncrypt);
+
+            if (!options.tarInput.empty()) {
+                std::cout << "Packing image file from tar stream..." << std::endl;
+                if (options.tarInput == "-") {
+#ifdef _WIN32
+                    _setmode(_fileno(stdin), _O_BINARY);
+#endif
+                    success = packer.packImageFromTar(std::cin, input, output);
+                } else {
+                    std::ifstream tarFile(options.tarInput, std::ios::binary);
+                    if (!tarFile.is_open()) {
+                        throw std::runtime_error("Failed to open tar file: " + options.tarInput);
+                    }
+                    success = packer.packImageFromTar(tarFile, input, output);
+                }
+            } else {
+                std::cout << "Packing image file..." << std::endl;
+                const auto configPath = std::filesystem::is_directory(input)
+                                            ? (std::filesystem::path(input) / "image.cfg").string()
+                                            : input;
+                success = packer.packImage(configPath, output);
+            }
+        } else if (operation == "unpack") {
             std::cout << "Unpacking image file..." << std::endl;
             std::cout << "Output format: " <<
                     (outputFormat == OpenixIMG::OutputFormat::UNIMG ? "unimg" : "imgrepacker") << std::endl;
@@ -137,7 +588,12 @@ int main(const int argc, char *argv[]) {
                 std::cerr << "Failed to load image file!" << std::endl;
                 return 1;
             }
-            success = packer.unpackImage(output, outputFormat);
+            OpenixIMG::SparseOptions sparseOptions;
+            sparseOptions.entries = options.sparseEntries;
+            sparseOptions.zeroAsDontCare = options.dontCareZeros;
+            success = packer.unpackImage(output, outputFormat, sparseOptions,
+                                         options.swapOutput ? OpenixIMG::ReplaceMode::SWAP
+                                                            : OpenixIMG::ReplaceMode::REMOVE);
         } else if (operation == "partition") {
             // Handle partition operation: only read partition data
             std::cout << "Reading sys_partition.fex from image..." << std::endl;
@@ -180,6 +636,355 @@ int main(const int argc, char *argv[]) {
                 throw std::runtime_error("Failed to parse sys_partition.fex!");
             }
 
+            return 0;
+        } else if (operation == "cfgdiff") {
+            std::stringstream report;
+
+            if (std::filesystem::is_directory(input) && std::filesystem::is_directory(options.against)) {
+                for (const auto &file: OpenixIMG::OpenixCFGDiff::diffDirectories(input, options.against)) {
+                    switch (file.status) {
+                        case OpenixIMG::CfgFileDiff::Status::ADDED:
+                            report << "+++ " << file.path << std::endl;
+                            break;
+                        case OpenixIMG::CfgFileDiff::Status::REMOVED:
+                            report << "--- " << file.path << std::endl;
+                            break;
+                        case OpenixIMG::CfgFileDiff::Status::FAILED:
+                            report << "!!! " << file.path << ": " << file.error << std::endl;
+                            break;
+                        default:
+                            report << "*** " << file.path << std::endl;
+                            report << OpenixIMG::OpenixCFGDiff::dumpToString(file.changes);
+                            break;
+                    }
+                }
+            } else {
+                OpenixCFG oldCfg;
+                OpenixCFG newCfg;
+                if (!oldCfg.loadFromFile(input) || !newCfg.loadFromFile(options.against)) {
+                    throw std::runtime_error("Failed to load configuration files!");
+                }
+                report << OpenixIMG::OpenixCFGDiff::dumpToString(OpenixIMG::OpenixCFGDiff::diff(oldCfg, newCfg));
+            }
+
+            if (!output.empty()) {
+                if (std::ofstream outFile(output, std::ios::out | std::ios::binary); outFile.is_open()) {
+                    outFile << report.str();
+                    std::cout << "Configuration diff has been written to " << output << std::endl;
+                } else {
+                    throw std::runtime_error("Failed to open output file: " + output);
+                }
+            } else {
+                std::cout << report.str();
+            }
+
+            return 0;
+        } else if (operation == "gpt") {
+            if (output.empty()) {
+                throw std::runtime_error("No output disk image specified!");
+            }
+
+            // Take the partition table from a .fex file or from inside an image
+            OpenixIMG::OpenixPartition partitionParser;
+            const bool fromImage = std::filesystem::path(input).extension() != ".fex";
+            if (!fromImage) {
+                if (!partitionParser.parseFromFile(input)) {
+                    throw std::runtime_error("Failed to parse " + input);
+                }
+            } else {
+                if (!imgFile.loadImage(input)) {
+                    std::cerr << "Failed to load image file!" << std::endl;
+                    return 1;
+                }
+                const auto fileData = imgFile.getFileDataByFilename("sys_partition.fex");
+                if (!fileData || !partitionParser.parseFromData(fileData->data(), fileData->size())) {
+                    throw std::runtime_error("Failed to read sys_partition.fex from the image!");
+                }
+            }
+
+            OpenixIMG::GptOptions gptOptions;
+            if (!options.diskSize.empty()) {
+                gptOptions.diskSectors = parseSize(options.diskSize) / OpenixIMG::PARTITION_SECTOR_SIZE;
+            }
+            if (!options.logicalOffset.empty()) {
+                gptOptions.logicalOffset = std::stoull(options.logicalOffset, nullptr, 0);
+            }
+
+            if (options.sparseDisk) {
+                // Fill each partition with its download file when the table came from an image
+                OpenixIMG::PartitionContentSource source;
+                if (fromImage) {
+                    source = [&imgFile](const OpenixIMG::Partition &partition, const OpenixIMG::OpenixIMGFile::ChunkSink &sink) {
+                        const auto &fileList = imgFile.getFileList();
+                        for (size_t index = 0; index < fileList.size(); ++index) {
+                            if (!partition.downloadfile.empty() && fileList[index].filename == partition.downloadfile) {
+                                imgFile.readEntryChunks(index, sink);
+                                return;
+                            }
+                        }
+                    };
+                }
+                partitionParser.writeSparseDisk(output, gptOptions, source, options.dontCareZeros);
+            } else {
+                partitionParser.writeGpt(output, gptOptions);
+            }
+
+            std::cout << std::left << std::setw(20) << "Name" << std::setw(16) << "First LBA" << "Sectors" << std::endl;
+            for (const auto &extent: partitionParser.computeLayout(gptOptions)) {
+                std::cout << std::left << std::setw(20) << extent.name << std::setw(16) << extent.firstSector
+                        << extent.sectorCount << std::endl;
+            }
+            std::cout << "GPT has been written to " << output << std::endl;
+
+            return 0;
+        } else if (operation == "fat") {
+            // Either an entry of an image or a standalone volume; only the needed ranges are read
+            const OpenixIMG::OpenixFAT volume(openVolume(imgFile, options));
+            const auto entry = volume.find(options.path);
+            if (!entry) {
+                throw std::runtime_error("No such file or directory: " + options.path);
+            }
+
+            if (entry->isDirectory()) {
+                std::cout << std::left << std::setw(40) << "Name" << std::setw(14) << "Size" << "Short name" << std::endl;
+                for (const auto &child: volume.list(options.path)) {
+                    std::cout << std::left << std::setw(40) << (child.isDirectory() ? child.name + "/" : child.name)
+                            << std::setw(14) << child.size << child.shortName << std::endl;
+                }
+                return 0;
+            }
+
+            writeExtracted(output, [&](const OpenixIMG::OpenixIMGFile::ChunkSink &sink) {
+                return volume.extract(*entry, sink);
+            }, options.path);
+            return 0;
+        } else if (operation == "ext4") {
+            const OpenixIMG::OpenixExt4 volume(openVolume(imgFile, options));
+            const auto inode = volume.find(options.path);
+            if (!inode) {
+                throw std::runtime_error("No such file or directory: " + options.path);
+            }
+
+            if (inode->isDirectory()) {
+                std::cout << std::left << std::setw(8) << "Mode" << std::setw(14) << "Size" << "Name" << std::endl;
+                for (const auto &child: volume.list(options.path)) {
+                    const auto childInode = volume.readInode(child.inode);
+                    std::cout << std::left << std::setw(8) << std::oct << childInode.mode << std::dec
+                            << std::setw(14) << childInode.size << child.name;
+                    if (childInode.isSymlink()) {
+                        std::cout << " -> " << volume.readLink(childInode);
+                    } else if (childInode.isDirectory()) {
+                        std::cout << "/";
+                    }
+                    std::cout << std::endl;
+                }
+                return 0;
+            }
+
+            writeExtracted(output, [&](const OpenixIMG::OpenixIMGFile::ChunkSink &sink) {
+                return volume.extract(*inode, sink);
+            }, options.path);
+            return 0;
+        } else if (operation == "toc1") {
+            const OpenixIMG::OpenixTOC1 package(openVolume(imgFile, options));
+
+            if (!options.item.empty()) {
+                const auto item = package.find(options.item);
+                if (!item) {
+                    throw std::runtime_error("No item named " + options.item + " in the package!");
+                }
+                if (options.verify) {
+                    const auto result = package.verifyItem(*item);
+                    std::cout << item->name << ": checksum " << checksumStatus(result) << std::endl;
+                    if (result.present && !result.valid) {
+                        return 1;
+                    }
+                }
+                if (!output.empty() || !options.verify) {
+                    writeExtracted(output, [&](const OpenixIMG::OpenixIMGFile::ChunkSink &sink) {
+                        return package.extract(*item, sink);
+                    }, options.item);
+                }
+                return 0;
+            }
+
+            bool allValid = true;
+            std::cout << std::left << std::setw(16) << "Name" << std::setw(12) << "Offset" << std::setw(12) << "Length"
+                    << std::setw(8) << "Type" << std::setw(14) << "Run address";
+            std::cout << (options.verify ? "Checksum" : "") << std::endl;
+            for (const auto &item: package.items()) {
+                std::ostringstream address;
+                address << "0x" << std::hex << std::setw(8) << std::setfill('0') << item.runAddress;
+                std::cout << std::left << std::setw(16) << item.name << std::setw(12) << item.offset << std::setw(12)
+                        << item.length << std::setw(8) << item.type << std::setw(14) << address.str();
+                if (options.verify) {
+                    const auto result = package.verifyItem(item);
+                    allValid = allValid && (!result.present || result.valid);
+                    std::cout << checksumStatus(result);
+                }
+                std::cout << std::endl;
+            }
+            if (options.verify) {
+                const auto result = package.verifyPackage();
+                allValid = allValid && result.valid;
+                std::cout << "Package checksum: " << checksumStatus(result) << std::endl;
+            }
+
+            return allValid ? 0 : 1;
+        } else if (operation == "env") {
+            // Either an entry of an image or a standalone environment image, rewritten in place
+            std::optional<size_t> index;
+            std::vector<uint8_t> data;
+            if (options.entry.empty()) {
+                std::ifstream inFile(input, std::ios::binary);
+                if (!inFile.is_open()) {
+                    throw std::runtime_error("Unable to open " + input);
+                }
+                data.assign(std::istreambuf_iterator<char>(inFile), std::istreambuf_iterator<char>());
+            } else {
+                index = findEntry(imgFile, options);
+            }
+            OpenixIMG::OpenixUBootEnv env = index ? OpenixIMG::OpenixUBootEnv(imgFile, *index)
+                                                  : OpenixIMG::OpenixUBootEnv(std::move(data));
+
+            if (options.setVariables.empty() && options.unsetVariables.empty()) {
+                for (const auto &[name, value]: env.variables()) {
+                    std::cout << name << "=" << value << std::endl;
+                }
+                return 0;
+            }
+
+            for (const auto &assignment: options.setVariables) {
+                const auto equals = assignment.find('=');
+                if (equals == std::string::npos) {
+                    throw std::runtime_error("Expected name=value: " + assignment);
+                }
+                env.set(assignment.substr(0, equals), assignment.substr(equals + 1));
+            }
+            for (const auto &name: options.unsetVariables) {
+                if (!env.remove(name)) {
+                    std::cout << "Warning: " << name << " is not set" << std::endl;
+                }
+            }
+
+            uint64_t written;
+            if (index) {
+                written = env.commit(imgFile, *index);
+            } else {
+                const OpenixIMG::OpenixFileIO file(input, OpenixIMG::OpenixFileIO::Mode::UPDATE);
+                written = env.commit([&file](const uint64_t offset, const void *bytes, const size_t length) {
+                    file.writeAt(offset, bytes, length);
+                });
+            }
+            std::cout << "Rewrote " << written << " of " << env.size() << " bytes of "
+                    << (index ? options.entry : input) << " in place" << std::endl;
+            return 0;
+        } else if (operation == "flash") {
+            if (output.empty()) {
+                throw std::runtime_error("No target device or disk image specified!");
+            }
+            if (!imgFile.loadImage(input)) {
+                throw std::runtime_error("Failed to load image file!");
+            }
+            OpenixIMG::OpenixPartition partitionParser;
+            const auto fileData = imgFile.getFileDataByFilename("sys_partition.fex");
+            if (!fileData || !partitionParser.parseFromData(fileData->data(), fileData->size())) {
+                throw std::runtime_error("Failed to read sys_partition.fex from the image!");
+            }
+
+            OpenixIMG::FlashOptions flashOptions;
+            flashOptions.partitions = options.partitions;
+            flashOptions.verify = options.verify;
+            if (!options.diskSize.empty()) {
+                flashOptions.layout.diskSectors = parseSize(options.diskSize) / OpenixIMG::PARTITION_SECTOR_SIZE;
+            } else if (std::filesystem::is_block_file(output)) {
+                flashOptions.layout.diskSectors = OpenixIMG::OpenixFileIO(output).size() / OpenixIMG::PARTITION_SECTOR_SIZE;
+            }
+            if (!options.logicalOffset.empty()) {
+                flashOptions.layout.logicalOffset = std::stoull(options.logicalOffset, nullptr, 0);
+            }
+
+            const OpenixIMG::OpenixFlasher flasher(imgFile, partitionParser);
+            const auto results = flasher.flash(output, flashOptions);
+
+            bool allVerified = true;
+            std::cout << std::left << std::setw(20) << "Partition" << std::setw(24) << "File" << std::setw(16) << "Offset"
+                    << std::setw(14) << "Bytes" << std::setw(12) << "CRC32" << (options.verify ? "Verify" : "") << std::endl;
+            for (const auto &result: results) {
+                std::ostringstream crc;
+                crc << std::hex << std::setw(8) << std::setfill('0') << result.crc;
+                std::cout << std::left << std::setw(20) << result.partition << std::setw(24) << result.file
+                        << std::setw(16) << result.offset << std::setw(14) << result.length << std::setw(12) << crc.str();
+                if (options.verify) {
+                    std::cout << (result.verified ? "ok" : "MISMATCH");
+                    allVerified = allVerified && result.verified;
+                }
+                std::cout << std::endl;
+            }
+            std::cout << "Flashed " << results.size() << " partitions to " << output << std::endl;
+
+            return allVerified ? 0 : 1;
+        } else if (operation == "validate") {
+            // Directories contribute every .img file directly inside them
+            std::vector<std::string> images;
+            for (const auto &path: options.inputs) {
+                if (!std::filesystem::is_directory(path)) {
+                    images.push_back(path);
+                    continue;
+                }
+                std::vector<std::string> found;
+                for (const auto &file: std::filesystem::directory_iterator(path)) {
+                    auto extension = file.path().extension().string();
+                    std::transform(extension.begin(), extension.end(), extension.begin(),
+                                   [](const unsigned char c) { return std::tolower(c); });
+                    if (file.is_regular_file() && extension == ".img") {
+                        found.push_back(file.path().string());
+                    }
+                }
+                std::sort(found.begin(), found.end());
+                images.insert(images.end(), found.begin(), found.end());
+            }
+
+            const auto reports = OpenixIMG::OpenixValidator::validateAll(images);
+            std::cout << (options.json ? OpenixIMG::OpenixValidator::dumpToJson(reports)
+                                       : OpenixIMG::OpenixValidator::dumpToString(reports));
+            const bool valid = std::all_of(reports.begin(), reports.end(), [](const OpenixIMG::ValidationReport &report) {
+                return report.valid();
+            });
+            return valid ? 0 : 1;
+        } else if (operation == "bench") {
+            OpenixIMG::BenchOptions benchOptions;
+            benchOptions.directory = output;
+            if (!options.benchSize.empty()) {
+                benchOptions.imageSize = parseSize(options.benchSize);
+                benchOptions.ioSize = benchOptions.imageSize * 4;
+            }
+
+            console << "Running benchmark..." << std::endl;
+            std::cout << OpenixIMG::OpenixBench::dumpToJson(OpenixIMG::OpenixBench::run(benchOptions));
+
+            return 0;
+        } else if (operation == "json") {
+            OpenixCFG cfg;
+            if (!cfg.loadFromFile(input)) {
+                throw std::runtime_error("Failed to load configuration file: " + input);
+            }
+
+            OpenixIMG::CfgJsonOptions jsonOptions;
+            jsonOptions.mode = options.ndjson ? OpenixIMG::JsonMode::NDJSON : OpenixIMG::JsonMode::DOCUMENT;
+            jsonOptions.groups = options.groups;
+
+            if (!output.empty()) {
+                std::ofstream outFile(output, std::ios::out | std::ios::binary);
+                if (!outFile.is_open()) {
+                    throw std::runtime_error("Failed to open output file: " + output);
+                }
+                OpenixIMG::OpenixCFGJson::write(cfg, outFile, jsonOptions);
+                std::cout << "JSON has been written to " << output << std::endl;
+            } else {
+                OpenixIMG::OpenixCFGJson::write(cfg, std::cout, jsonOptions);
+            }
+
             return 0;
         }
         // Default return operation success/failure status
@@ -188,6 +993,12 @@ int main(const int argc, char *argv[]) {
             return 0;
         }
         throw std::runtime_error("Operation failed!");
+    } catch (const OpenixIMG::OperationCancelled &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        if (e.reason() == OpenixIMG::OperationCancelled::Reason::DEADLINE) {
+            return 124;
+        }
+        return 128 + (receivedSignal ? receivedSignal : SIGINT);
     } catch (const std::exception &e) {
         std::cerr << "Error: " << e.what() << std::endl;
         return 1;
@@ -0,0 +1,95 @@
+/**
+ * @file OpenixBench.hpp
+ * @brief Host capability benchmark for image operations
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#ifndef OPENIXIMG_OPENIXBENCH_HPP
+#define OPENIXIMG_OPENIXBENCH_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace OpenixIMG {
+    /**
+     * @struct BenchOptions
+     * @brief Parameters of a benchmark run
+     */
+    struct BenchOptions {
+        std::string directory; //!< Directory to benchmark, the system temporary directory if empty
+        uint64_t ioSize = 256ULL * 1024 * 1024; //!< Size of the file used for the sequential I/O test
+        uint64_t imageSize = 64ULL * 1024 * 1024; //!< Total payload size of the synthetic image
+        std::vector<unsigned> threadCounts; //!< Thread counts for the cipher tests, powers of two up to the core count if empty
+        std::chrono::milliseconds cryptDuration{500}; //!< Run time of each cipher test
+    };
+
+    /**
+     * @struct BenchCryptResult
+     * @brief Throughput of one cipher kernel at one thread count
+     */
+    struct BenchCryptResult {
+        std::string kernel; //!< Kernel name ("rc6-encrypt", "rc6-decrypt" or "twofish-decrypt")
+        unsigned threads = 0; //!< Number of threads
+        double bytesPerSecond = 0; //!< Aggregate throughput
+    };
+
+    /**
+     * @struct BenchReport
+     * @brief Results of a benchmark run
+     */
+    struct BenchReport {
+        std::string directory; //!< Benchmarked directory
+        unsigned hardwareThreads = 0; //!< Hardware threads reported by the OS
+        std::vector<BenchCryptResult> crypt; //!< Cipher results
+        double writeBandwidth = 0; //!< Sequential write bandwidth including the final sync, bytes per second
+        double readBandwidth = 0; //!< Sequential read bandwidth, bytes per second
+        bool cacheEvicted = false; //!< Whether the page cache was dropped before the read test
+        double packRate = 0; //!< Encrypted pack rate of the synthetic image, image file bytes per second
+        double unpackRate = 0; //!< Unpack rate of the synthetic image, image file bytes per second
+        bool imageCacheEvicted = false; //!< Whether the page cache of the image was dropped before the unpack test
+
+        /**
+         * @brief Combined score
+         *
+         * Geometric mean of single-thread RC6 decryption, sequential read and write, pack and
+         * unpack rates, each relative to a reference host (100 MB/s RC6, 200 MB/s disk,
+         * 50 MB/s pack and unpack), times 100. The reference host scores 100; a host scoring
+         * twice as much finishes a typical unpack or pack in about half the time.
+         *
+         * @return The score
+         */
+        [[nodiscard]] double score() const;
+    };
+
+    /**
+     * @class OpenixBench
+     * @brief Measures how fast a host runs the building blocks of image operations
+     *
+     * The run creates a scratch directory inside the benchmarked directory, writes a
+     * synthetic encrypted IMAGEWTY image there with the regular packer, unpacks it again and
+     * removes everything when it finishes.
+     */
+    class OpenixBench {
+    public:
+        /**
+         * @brief Run all measurements
+         *
+         * @param options Benchmark parameters
+         * @return The results
+         * @throw std::runtime_error if the scratch files cannot be created
+         */
+        static BenchReport run(const BenchOptions &options);
+
+        /**
+         * @brief Render a report as a JSON document
+         *
+         * @param report Report to render
+         * @return The JSON text
+         */
+        static std::string dumpToJson(const BenchReport &report);
+    };
+} // namespace OpenixIMG
+
+#endif // OPENIXIMG_OPENIXBENCH_HPP
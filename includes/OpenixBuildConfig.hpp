@@ -0,0 +1,39 @@
+/**
+ * @file OpenixBuildConfig.hpp
+ * @brief Build profile settings shared by the library, the tool and the tests
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#ifndef OPENIXIMG_OPENIXBUILDCONFIG_HPP
+#define OPENIXIMG_OPENIXBUILDCONFIG_HPP
+
+#include <cstddef>
+
+/**
+ * @def OPENIXIMG_IO_BUFFER_SIZE
+ * @brief Size of the buffers entries are streamed through
+ *
+ * Set by the OPENIXIMG_IO_BUFFER_SIZE CMake cache variable. The low-footprint profile
+ * (OPENIXIMG_LOW_FOOTPRINT) defaults it to 256 KiB for boards with little RAM; other
+ * builds use 1 MiB.
+ */
+#ifndef OPENIXIMG_IO_BUFFER_SIZE
+#ifdef OPENIXIMG_LOW_FOOTPRINT
+#define OPENIXIMG_IO_BUFFER_SIZE (256 * 1024)
+#else
+#define OPENIXIMG_IO_BUFFER_SIZE (1024 * 1024)
+#endif
+#endif
+
+namespace OpenixIMG {
+    /**
+     * @brief Bytes read, decrypted or written per call when streaming entries
+     */
+    constexpr size_t IO_BUFFER_SIZE = OPENIXIMG_IO_BUFFER_SIZE;
+
+    // Payloads are padded to 512 bytes and decrypted in whole 16-byte blocks
+    static_assert(IO_BUFFER_SIZE >= 4096 && IO_BUFFER_SIZE % 512 == 0,
+                  "OPENIXIMG_IO_BUFFER_SIZE must be a multiple of 512 and at least 4096");
+} // namespace OpenixIMG
+
+#endif // OPENIXIMG_OPENIXBUILDCONFIG_HPP
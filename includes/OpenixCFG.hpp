@@ -13,7 +13,7 @@
 #include <unordered_map>
 #include <filesystem>
 #include <optional>
-#include <iostream>
+#include <istream>
 #include <variant>
 
 namespace fs = std::filesystem;
@@ -299,6 +299,15 @@ public:
      */
     std::optional<std::string> getString(const std::string &name, const std::string &groupName) const;
 
+    /**
+     * @brief Get the first group of the configuration
+     *
+     * Groups are kept in file order; use Group::getNext() to walk the rest.
+     *
+     * @return A shared pointer to the first group, or nullptr if no configuration is loaded
+     */
+    [[nodiscard]] std::shared_ptr<Group> getFirstGroup() const;
+
     /**
      * @brief Count the number of variables in a specific group
      *
@@ -313,6 +322,16 @@ public:
      */
     void addGroup(const std::shared_ptr<Group> &group);
 
+    /**
+     * @brief Make the named variables of a group reachable through findVariable(name)
+     *
+     * Parsing indexes variables as it reads them; configurations assembled with addGroup()
+     * call this to get the same lookups. Later calls win for repeated names, as in a file.
+     *
+     * @param group The group whose variables to index
+     */
+    void indexVariables(const Group &group);
+
     /**
      * @brief Free all resources used by the parser
      */
@@ -0,0 +1,131 @@
+/**
+ * @file OpenixCFGDiff.hpp
+ * @brief Semantic diff between two parsed configurations
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#ifndef OPENIXIMG_OPENIXCFGDIFF_HPP
+#define OPENIXIMG_OPENIXCFGDIFF_HPP
+
+#include <string>
+#include <vector>
+
+#include "OpenixCFG.hpp"
+
+namespace OpenixIMG {
+    /**
+     * @brief Kind of a single configuration change
+     */
+    enum class CfgChangeType {
+        GROUP_ADDED, //!< Group only present in the new configuration
+        GROUP_REMOVED, //!< Group only present in the old configuration
+        VARIABLE_ADDED, //!< Variable only present in the new configuration
+        VARIABLE_REMOVED, //!< Variable only present in the old configuration
+        VARIABLE_CHANGED, //!< Variable present in both with a different type or value
+        ITEM_ADDED, //!< List item only present in the new configuration
+        ITEM_REMOVED, //!< List item only present in the old configuration
+        ITEM_CHANGED, //!< List item present in both with different fields
+    };
+
+    /**
+     * @struct CfgChange
+     * @brief One entry of a structured changeset
+     */
+    struct CfgChange {
+        CfgChangeType type; //!< Kind of change
+        std::string group; //!< Group key (name, disambiguated for repeated groups)
+        std::string key; //!< Variable or list item key, empty for group changes
+        std::string oldValue; //!< Formatted old value, empty if added
+        std::string newValue; //!< Formatted new value, empty if removed
+    };
+
+    /**
+     * @struct CfgFileDiff
+     * @brief Changeset of one file in a batch directory diff
+     */
+    struct CfgFileDiff {
+        /**
+         * @brief Status of the file pair
+         */
+        enum class Status {
+            UNCHANGED, //!< Both files parse to the same configuration
+            MODIFIED, //!< Both files exist and differ
+            ADDED, //!< File only exists in the new directory
+            REMOVED, //!< File only exists in the old directory
+            FAILED, //!< One of the files could not be read or parsed
+        };
+
+        std::string path; //!< Path relative to the compared directories
+        Status status = Status::UNCHANGED; //!< Status of the pair
+        std::vector<CfgChange> changes; //!< Changes, for modified files
+        std::string error; //!< Error message, for failed files
+    };
+
+    /**
+     * @class OpenixCFGDiff
+     * @brief Compares OpenixCFG trees by structure and typed values instead of text
+     *
+     * Groups, variables and list items are hash-joined on their keys, so formatting, comments
+     * and ordering do not show up as changes and a diff runs in time linear in the size of
+     * both configurations. Repeated groups (such as [partition]) are keyed by their "name"
+     * variable, and anonymous list items (such as FILELIST entries) by their "filename" field,
+     * falling back to their first field, or to their position if they have no fields at all.
+     * Keys that repeat get a "#n" suffix. Added and removed groups list all their variables.
+     */
+    class OpenixCFGDiff {
+    public:
+        /**
+         * @brief Compute the changeset between two configurations
+         *
+         * @param oldCfg Old configuration
+         * @param newCfg New configuration
+         * @return Changes in file order of the new configuration, removals last
+         */
+        static std::vector<CfgChange> diff(const OpenixCFG &oldCfg, const OpenixCFG &newCfg);
+
+        /**
+         * @brief Diff all configuration files found in two directory trees
+         *
+         * Files are paired by relative path and compared in parallel. Binary files carrying a
+         * matching extension (e.g. payload .fex files) are skipped.
+         *
+         * @param oldDir Old directory
+         * @param newDir New directory
+         * @param extensions File extensions to consider
+         * @return One result per file that is not unchanged, sorted by path
+         */
+        static std::vector<CfgFileDiff> diffDirectories(const std::string &oldDir, const std::string &newDir,
+                                                        const std::vector<std::string> &extensions = {
+                                                            ".cfg", ".fex"
+                                                        });
+
+        /**
+         * @brief Compare two variables by type and value
+         *
+         * List items are equal if they have the same fields, in any order.
+         *
+         * @param a First variable
+         * @param b Second variable
+         * @return True if both carry the same value
+         */
+        static bool sameValue(const Variable &a, const Variable &b);
+
+        /**
+         * @brief Format a variable value for display
+         *
+         * @param var Variable to format
+         * @return The formatted value
+         */
+        static std::string formatValue(const Variable &var);
+
+        /**
+         * @brief Dump a changeset to a human-readable string
+         *
+         * @param changes Changes to format
+         * @return One line per change, prefixed with +, - or ~
+         */
+        static std::string dumpToString(const std::vector<CfgChange> &changes);
+    };
+} // namespace OpenixIMG
+
+#endif // OPENIXIMG_OPENIXCFGDIFF_HPP
@@ -0,0 +1,93 @@
+/**
+ * @file OpenixCFGJson.hpp
+ * @brief Streaming JSON serialization of parsed configurations
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#ifndef OPENIXIMG_OPENIXCFGJSON_HPP
+#define OPENIXIMG_OPENIXCFGJSON_HPP
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "OpenixCFG.hpp"
+
+namespace OpenixIMG {
+    /**
+     * @brief Layout of the JSON output
+     */
+    enum class JsonMode {
+        DOCUMENT, //!< A single JSON array holding one object per group
+        NDJSON, //!< One group object per line (newline-delimited JSON)
+    };
+
+    /**
+     * @struct CfgJsonOptions
+     * @brief Options for OpenixCFGJson
+     */
+    struct CfgJsonOptions {
+        JsonMode mode = JsonMode::DOCUMENT; //!< Output layout
+        std::vector<std::string> groups; //!< Names of the groups to emit, empty for all
+    };
+
+    /**
+     * @class OpenixCFGJson
+     * @brief Writes OpenixCFG trees as JSON directly to a sink
+     *
+     * Groups are emitted in file order as objects of the form
+     * {"name": ..., "variables": [{"name": ..., "type": ..., "value"|"items": ...}, ...]}.
+     * Output goes through a small fixed buffer to the sink, so the full document is never
+     * held in memory. Numbers are formatted with std::to_chars; strings are escaped, and bytes
+     * that are not valid UTF-8 are emitted as \\u00XX (Latin-1) so the output is always valid JSON.
+     */
+    class OpenixCFGJson {
+    public:
+        /**
+         * @brief Receives consecutive chunks of output
+         */
+        using Sink = std::function<void(std::string_view)>;
+
+        /**
+         * @brief Serialize a configuration to a sink
+         *
+         * In NDJSON mode the sink is flushed after every group, so each line can be consumed
+         * as soon as it is complete.
+         *
+         * @param cfg Configuration to serialize
+         * @param sink Output sink
+         * @param options Output options
+         */
+        static void write(const OpenixCFG &cfg, const Sink &sink, const CfgJsonOptions &options = {});
+
+        /**
+         * @brief Serialize a configuration to an output stream
+         *
+         * @param cfg Configuration to serialize
+         * @param stream Output stream
+         * @param options Output options
+         */
+        static void write(const OpenixCFG &cfg, std::ostream &stream, const CfgJsonOptions &options = {});
+
+        /**
+         * @brief Serialize a configuration to a string
+         *
+         * @param cfg Configuration to serialize
+         * @param options Output options
+         * @return The JSON text
+         */
+        static std::string dumpToString(const OpenixCFG &cfg, const CfgJsonOptions &options = {});
+
+        /**
+         * @brief Escape a string for use inside a JSON string literal
+         *
+         * @param value String to escape
+         * @return The escaped string, without surrounding quotes
+         */
+        static std::string escape(std::string_view value);
+    };
+} // namespace OpenixIMG
+
+#endif // OPENIXIMG_OPENIXCFGJSON_HPP
@@ -0,0 +1,225 @@
+/**
+ * @file OpenixCFGOverlay.hpp
+ * @brief Copy-on-write configuration variant layered over a shared base
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#ifndef OPENIXIMG_OPENIXCFGOVERLAY_HPP
+#define OPENIXIMG_OPENIXCFGOVERLAY_HPP
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "OpenixCFG.hpp"
+#include "OpenixCFGDiff.hpp"
+
+namespace OpenixIMG {
+    /**
+     * @class OpenixCFGOverlay
+     * @brief Configuration variant that stores only its differences from an immutable base
+     *
+     * Many board variants share one base configuration and differ in a handful of keys. An
+     * overlay references the base and keeps only changed variables, removed variables and
+     * groups, and whole replacement groups; lookups fall through to the base for everything
+     * else. Memory therefore grows with the size of the delta, not of the configuration.
+     *
+     * Variables are shared between the base, the overlay and materialized configurations and
+     * must be treated as read-only; use the setters of the overlay to change values.
+     */
+    class OpenixCFGOverlay {
+    public:
+        /**
+         * @brief Constructor
+         *
+         * @param base Base configuration, shared by all variants and never modified
+         */
+        explicit OpenixCFGOverlay(std::shared_ptr<const OpenixCFG> base);
+
+        /**
+         * @brief Build an overlay holding the differences between a base and a full variant
+         *
+         * Groups with unique names are compared key by key. Groups whose name repeats, and
+         * groups whose anonymous list items changed, are stored as whole replacements.
+         *
+         * @param base Base configuration
+         * @param variant Fully parsed variant configuration; may be discarded afterwards
+         * @return The overlay
+         */
+        static OpenixCFGOverlay fromVariant(std::shared_ptr<const OpenixCFG> base, const OpenixCFG &variant);
+
+        /**
+         * @brief Get the base configuration
+         *
+         * @return The base configuration
+         */
+        [[nodiscard]] const std::shared_ptr<const OpenixCFG> &getBase() const;
+
+        /**
+         * @brief Set or add a variable
+         *
+         * Adding to a group that does not exist creates it after the base groups.
+         *
+         * @param groupName Name of the group
+         * @param var Variable to store; must be named
+         * @throw std::runtime_error if the variable has no name
+         */
+        void setVariable(const std::string &groupName, const std::shared_ptr<Variable> &var);
+
+        /**
+         * @brief Set a numeric variable
+         *
+         * @param groupName Name of the group
+         * @param name Name of the variable
+         * @param value Value to set
+         */
+        void setNumber(const std::string &groupName, const std::string &name, uint32_t value);
+
+        /**
+         * @brief Set a string variable
+         *
+         * @param groupName Name of the group
+         * @param name Name of the variable
+         * @param value Value to set
+         */
+        void setString(const std::string &groupName, const std::string &name, const std::string &value);
+
+        /**
+         * @brief Hide a variable of the base configuration
+         *
+         * @param groupName Name of the group
+         * @param name Name of the variable
+         */
+        void removeVariable(const std::string &groupName, const std::string &name);
+
+        /**
+         * @brief Replace all groups of a name with the given groups
+         *
+         * The groups are copied, their variables are shared.
+         *
+         * @param groupName Name of the groups to replace
+         * @param groups Replacement groups, emitted where the first base group of that name was
+         */
+        void replaceGroup(const std::string &groupName, const std::vector<std::shared_ptr<Group> > &groups);
+
+        /**
+         * @brief Hide all groups of a name
+         *
+         * @param groupName Name of the groups to remove
+         */
+        void removeGroup(const std::string &groupName);
+
+        /**
+         * @brief Drop all changes to a group, restoring the base version
+         *
+         * @param groupName Name of the group
+         */
+        void revertGroup(const std::string &groupName);
+
+        /**
+         * @brief Check whether a group exists in the variant
+         *
+         * @param groupName Name of the group
+         * @return True if the group exists
+         */
+        [[nodiscard]] bool hasGroup(const std::string &groupName) const;
+
+        /**
+         * @brief Find a variable within a group, falling through to the base
+         *
+         * @param name Name of the variable
+         * @param groupName Name of the group
+         * @return The variable, or nullptr if it does not exist in the variant
+         */
+        [[nodiscard]] std::shared_ptr<Variable> findVariable(const std::string &name,
+                                                             const std::string &groupName) const;
+
+        /**
+         * @brief Get a numeric value within a group
+         *
+         * @param name Name of the variable
+         * @param groupName Name of the group
+         * @return The value, or std::nullopt if missing or not a number
+         */
+        [[nodiscard]] std::optional<uint32_t> getNumber(const std::string &name, const std::string &groupName) const;
+
+        /**
+         * @brief Get a string value within a group
+         *
+         * @param name Name of the variable
+         * @param groupName Name of the group
+         * @return The value, or std::nullopt if missing or not a string
+         */
+        [[nodiscard]] std::optional<std::string> getString(const std::string &name,
+                                                           const std::string &groupName) const;
+
+        /**
+         * @brief Number of variables and groups the overlay stores itself
+         *
+         * @return Size of the delta
+         */
+        [[nodiscard]] size_t deltaSize() const;
+
+        /**
+         * @brief Build a standalone configuration for the variant
+         *
+         * New groups are created; variables are shared with the base and the overlay.
+         *
+         * @return The materialized configuration
+         */
+        [[nodiscard]] std::shared_ptr<OpenixCFG> materialize() const;
+
+        /**
+         * @brief Compute the changes of the variant relative to its base
+         *
+         * @return The changeset, in the format of OpenixCFGDiff
+         */
+        [[nodiscard]] std::vector<CfgChange> diff() const;
+
+        /**
+         * @brief Serialize the full variant
+         *
+         * @return The variant in configuration file syntax
+         */
+        [[nodiscard]] std::string dumpToString() const;
+
+    private:
+        /**
+         * @struct GroupDelta
+         * @brief Changes of one group name
+         */
+        struct GroupDelta {
+            bool removed = false; //!< All groups of this name are hidden
+            bool replaced = false; //!< The groups below replace the base groups
+            std::vector<std::shared_ptr<Group> > groups; //!< Replacement groups
+            std::unordered_map<std::string, std::shared_ptr<Variable> > variables;
+            //!< Overridden variables, nullptr for removed ones
+            std::vector<std::string> appended; //!< Names of variables absent from the base, in insertion order
+        };
+
+        /**
+         * @brief Get or create the delta of a group
+         *
+         * @param groupName Name of the group
+         * @return The delta
+         */
+        GroupDelta &deltaFor(const std::string &groupName);
+
+        /**
+         * @brief Copy a group without its list link
+         *
+         * @param group Group to copy
+         * @param delta Variable overrides to apply, or nullptr
+         * @return The copy
+         */
+        static std::shared_ptr<Group> copyGroup(const Group &group, const GroupDelta *delta);
+
+        std::shared_ptr<const OpenixCFG> base_; //!< Shared base configuration
+        std::unordered_map<std::string, GroupDelta> deltas_; //!< Changes by group name
+        std::vector<std::string> addedGroups_; //!< Names of groups absent from the base, in insertion order
+    };
+} // namespace OpenixIMG
+
+#endif // OPENIXIMG_OPENIXCFGOVERLAY_HPP
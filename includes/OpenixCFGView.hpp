@@ -0,0 +1,180 @@
+/**
+ * @file OpenixCFGView.hpp
+ * @brief Typed view of the well-known keys of an image.cfg
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#ifndef OPENIXIMG_OPENIXCFGVIEW_HPP
+#define OPENIXIMG_OPENIXCFGVIEW_HPP
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "OpenixCFG.hpp"
+
+namespace OpenixIMG {
+    /**
+     * @struct ImageCfgView
+     * @brief Fixed set of image.cfg fields resolved in a single pass over a parsed configuration
+     *
+     * Group and key names are matched through a perfect hash computed at compile time over the
+     * known name set, so resolving costs one hash and at most one string compare per variable,
+     * and consumers afterwards read plain fields instead of doing string-keyed lookups.
+     */
+    struct ImageCfgView {
+        /**
+         * @brief Names the view knows about
+         */
+        enum class Key : uint8_t {
+            IMAGE_CFG, //!< [IMAGE_CFG] group
+            FILELIST, //!< [FILELIST] group
+            VERSION, //!< IMAGE_CFG.version
+            PID, //!< IMAGE_CFG.pid
+            VID, //!< IMAGE_CFG.vid
+            HARDWAREID, //!< IMAGE_CFG.hardwareid
+            FIRMWAREID, //!< IMAGE_CFG.firmwareid
+            IMAGENAME, //!< IMAGE_CFG.imagename
+            FILELIST_REF, //!< IMAGE_CFG.filelist
+            ENCRYPT, //!< IMAGE_CFG.encrypt
+            COUNT
+        };
+
+        /**
+         * @struct FileEntry
+         * @brief One entry of the file list group
+         */
+        struct FileEntry {
+            std::string filename; //!< File name
+            std::string maintype; //!< Main type identifier
+            std::string subtype; //!< Subtype identifier
+        };
+
+        std::optional<uint32_t> version; //!< Image format version
+        std::optional<uint32_t> pid; //!< USB product ID
+        std::optional<uint32_t> vid; //!< USB vendor ID
+        std::optional<uint32_t> hardwareId; //!< Hardware ID
+        std::optional<uint32_t> firmwareId; //!< Firmware ID
+        std::optional<uint32_t> encrypt; //!< Encryption switch
+        std::string imageName; //!< Output image name
+        std::string fileListName = "FILELIST"; //!< Name of the group holding the file list
+        std::vector<FileEntry> fileList; //!< Entries of the file list group, in order
+
+        /**
+         * @brief Resolve all known fields of a parsed image.cfg
+         *
+         * @param cfg Parsed configuration
+         * @return The populated view
+         */
+        static ImageCfgView resolve(const OpenixCFG &cfg);
+
+        /**
+         * @brief Map a group or variable name to its key
+         *
+         * @param name Name to look up
+         * @return The key, or Key::COUNT if the name is not a known key
+         */
+        static constexpr Key lookup(std::string_view name);
+    };
+
+    namespace detail {
+        /**
+         * @brief Known image.cfg names, indexed by ImageCfgView::Key
+         */
+        constexpr std::array<std::string_view, static_cast<size_t>(ImageCfgView::Key::COUNT)> CFG_VIEW_NAMES = {
+            "IMAGE_CFG", "FILELIST", "version", "pid", "vid", "hardwareid", "firmwareid", "imagename", "filelist",
+            "encrypt"
+        };
+
+        /**
+         * @brief Number of slots of the name hash table (power of two)
+         */
+        constexpr uint32_t CFG_VIEW_TABLE_SIZE = 32;
+
+        /**
+         * @brief Seeded FNV-1a hash
+         *
+         * @param name String to hash
+         * @param seed Seed mixed into the offset basis
+         * @return 32-bit hash value
+         */
+        constexpr uint32_t cfgViewHash(const std::string_view name, const uint32_t seed) {
+            uint32_t value = 2166136261U ^ seed;
+            for (const char c: name) {
+                value = (value ^ static_cast<uint8_t>(c)) * 16777619U;
+            }
+            // Fold the high bits down: the low bits of FNV-1a barely depend on the seed
+            return value ^ (value >> 16);
+        }
+
+        /**
+         * @brief Check whether a seed maps every known name to a distinct slot
+         *
+         * @param seed Seed to test
+         * @return True if the seed yields a perfect hash
+         */
+        constexpr bool isPerfectCfgViewSeed(const uint32_t seed) {
+            std::array<bool, CFG_VIEW_TABLE_SIZE> used{};
+            for (const auto name: CFG_VIEW_NAMES) {
+                const auto slot = cfgViewHash(name, seed) & (CFG_VIEW_TABLE_SIZE - 1);
+                if (used[slot]) {
+                    return false;
+                }
+                used[slot] = true;
+            }
+            return true;
+        }
+
+        /**
+         * @brief Search for the smallest seed producing a perfect hash
+         *
+         * @return The seed
+         */
+        constexpr uint32_t findCfgViewSeed() {
+            uint32_t seed = 0;
+            while (!isPerfectCfgViewSeed(seed)) {
+                ++seed;
+            }
+            return seed;
+        }
+
+        constexpr uint32_t CFG_VIEW_SEED = findCfgViewSeed(); //!< Perfect hash seed
+
+        /**
+         * @brief Build the slot table mapping hash slots to keys
+         *
+         * @return Table of keys, Key::COUNT for empty slots
+         */
+        constexpr std::array<ImageCfgView::Key, CFG_VIEW_TABLE_SIZE> buildCfgViewTable() {
+            std::array<ImageCfgView::Key, CFG_VIEW_TABLE_SIZE> table{};
+            for (auto &slot: table) {
+                slot = ImageCfgView::Key::COUNT;
+            }
+            for (size_t i = 0; i < CFG_VIEW_NAMES.size(); ++i) {
+                table[cfgViewHash(CFG_VIEW_NAMES[i], CFG_VIEW_SEED) & (CFG_VIEW_TABLE_SIZE - 1)] =
+                        static_cast<ImageCfgView::Key>(i);
+            }
+            return table;
+        }
+
+        constexpr auto CFG_VIEW_TABLE = buildCfgViewTable(); //!< Slot table
+    } // namespace detail
+
+    constexpr ImageCfgView::Key ImageCfgView::lookup(const std::string_view name) {
+        const auto key = detail::CFG_VIEW_TABLE[detail::cfgViewHash(name, detail::CFG_VIEW_SEED) &
+                                                (detail::CFG_VIEW_TABLE_SIZE - 1)];
+        if (key != Key::COUNT && detail::CFG_VIEW_NAMES[static_cast<size_t>(key)] == name) {
+            return key;
+        }
+        return Key::COUNT;
+    }
+
+    static_assert(ImageCfgView::lookup("pid") == ImageCfgView::Key::PID, "perfect hash broken");
+    static_assert(ImageCfgView::lookup("filelist") == ImageCfgView::Key::FILELIST_REF, "perfect hash broken");
+    static_assert(ImageCfgView::lookup("unknown") == ImageCfgView::Key::COUNT, "perfect hash broken");
+} // namespace OpenixIMG
+
+#endif // OPENIXIMG_OPENIXCFGVIEW_HPP
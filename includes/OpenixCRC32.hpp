@@ -0,0 +1,35 @@
+/**
+ * @file OpenixCRC32.hpp
+ * @brief Slicing-by-8 CRC-32 (IEEE 802.3) checksum
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#ifndef OPENIXIMG_OPENIXCRC32_HPP
+#define OPENIXIMG_OPENIXCRC32_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace OpenixIMG {
+    /**
+     * @class OpenixCRC32
+     * @brief CRC-32 with the reflected polynomial 0xEDB88320, as used by GPT, zlib and u-boot
+     *
+     * Eight bytes are folded per step (slicing-by-8), several times faster than the
+     * classic byte-at-a-time table.
+     */
+    class OpenixCRC32 {
+    public:
+        /**
+         * @brief Compute or continue a CRC-32
+         *
+         * @param data Data to checksum
+         * @param length Number of bytes
+         * @param crc Result of a previous call to continue a running checksum, 0 to start
+         * @return The CRC-32 of all data processed so far
+         */
+        static uint32_t compute(const void *data, size_t length, uint32_t crc = 0);
+    };
+} // namespace OpenixIMG
+
+#endif // OPENIXIMG_OPENIXCRC32_HPP
@@ -0,0 +1,97 @@
+/**
+ * @file OpenixCancellation.hpp
+ * @brief Cooperative cancellation and deadlines for long-running operations
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#ifndef OPENIXIMG_OPENIXCANCELLATION_HPP
+#define OPENIXIMG_OPENIXCANCELLATION_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+
+namespace OpenixIMG {
+    /**
+     * @class OperationCancelled
+     * @brief Thrown by an operation that stopped because its token was cancelled or its deadline passed
+     */
+    class OperationCancelled : public std::runtime_error {
+    public:
+        /**
+         * @brief Why the operation stopped
+         */
+        enum class Reason {
+            CANCELLED, //!< OpenixCancellationToken::cancel() was called
+            DEADLINE, //!< The deadline passed
+        };
+
+        explicit OperationCancelled(Reason reason);
+
+        /**
+         * @brief Why the operation stopped
+         *
+         * @return The reason
+         */
+        [[nodiscard]] Reason reason() const;
+
+    private:
+        Reason reason_; //!< Why the operation stopped
+    };
+
+    /**
+     * @class OpenixCancellationToken
+     * @brief Lets another thread, a signal handler or a deadline stop an operation
+     *
+     * Operations poll the token between chunks of work, so they stop within one chunk of
+     * I/O or decryption. Workers stop taking new work, the operation removes the output it
+     * had only partly written, and OperationCancelled is thrown from the calling thread.
+     * A token cannot be reset; use a new one for the next operation.
+     */
+    class OpenixCancellationToken {
+    public:
+        /**
+         * @brief Request cancellation
+         *
+         * Only stores to a lock-free atomic, so it is safe to call from a signal handler.
+         */
+        void cancel();
+
+        /**
+         * @brief Stop operations once a point in time has passed
+         *
+         * @param deadline Time after which checks fail
+         */
+        void setDeadline(std::chrono::steady_clock::time_point deadline);
+
+        /**
+         * @brief Stop operations once a duration from now has passed
+         *
+         * @param timeout Time from now after which checks fail
+         */
+        void setTimeout(std::chrono::steady_clock::duration timeout);
+
+        /**
+         * @brief Check whether operations should stop
+         *
+         * @return True if cancelled or past the deadline
+         */
+        [[nodiscard]] bool isCancelled() const;
+
+        /**
+         * @brief Throw if operations should stop
+         *
+         * @throw OperationCancelled if cancelled or past the deadline
+         */
+        void check() const;
+
+    private:
+        static_assert(std::atomic<bool>::is_always_lock_free, "cancel() must be async-signal-safe");
+
+        std::atomic<bool> cancelled_{false}; //!< Set by cancel()
+        std::atomic<int64_t> deadline_{INT64_MAX}; //!< Deadline in steady_clock ticks, INT64_MAX for none
+    };
+} // namespace OpenixIMG
+
+#endif // OPENIXIMG_OPENIXCANCELLATION_HPP
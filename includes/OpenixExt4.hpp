@@ -0,0 +1,338 @@
+/**
+ * @file OpenixExt4.hpp
+ * @brief Read-only ext2/3/4 reader working on ranges of an image entry
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#ifndef OPENIXIMG_OPENIXEXT4_HPP
+#define OPENIXIMG_OPENIXEXT4_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "OpenixIMGFile.hpp"
+
+namespace OpenixIMG {
+    /**
+     * @struct Ext4Inode
+     * @brief An inode as read from the inode table
+     */
+    struct Ext4Inode {
+        uint32_t number = 0; //!< Inode number
+        uint16_t mode = 0; //!< File type and permission bits
+        uint32_t uid = 0; //!< Owner
+        uint32_t gid = 0; //!< Group
+        uint64_t size = 0; //!< Size in bytes
+        uint32_t mtime = 0; //!< Modification time, seconds since the epoch
+        uint32_t flags = 0; //!< EXT4_*_FL inode flags
+        std::vector<uint8_t> raw; //!< On-disk inode, needed to map its blocks
+
+        /**
+         * @brief Whether the inode is a directory
+         *
+         * @return True for directories
+         */
+        [[nodiscard]] bool isDirectory() const;
+
+        /**
+         * @brief Whether the inode is a regular file
+         *
+         * @return True for regular files
+         */
+        [[nodiscard]] bool isRegular() const;
+
+        /**
+         * @brief Whether the inode is a symbolic link
+         *
+         * @return True for symbolic links
+         */
+        [[nodiscard]] bool isSymlink() const;
+    };
+
+    /**
+     * @struct Ext4Entry
+     * @brief One directory entry
+     */
+    struct Ext4Entry {
+        std::string name; //!< Entry name
+        uint32_t inode = 0; //!< Inode number
+        uint8_t fileType = 0; //!< Directory entry file type, 0 if the filesystem does not record it
+    };
+
+    /**
+     * @class OpenixExt4
+     * @brief Resolves paths and streams files of an ext2/3/4 image without extracting it
+     *
+     * Only the superblock, the group descriptors and inode table blocks of visited inodes,
+     * the directory blocks on the way to a path and the data blocks of the extracted file
+     * are read. Extent trees and legacy block maps are supported, as are inline data and
+     * hashed (htree) directories, whose lookups read one leaf block instead of the whole
+     * directory; three-level trees are followed on volumes with the largedir feature.
+     * Metadata blocks go through a small LRU cache; file data is read in runs of
+     * consecutive blocks and bypasses it. The journal is not replayed.
+     *
+     * The cache makes the reader unsuitable for concurrent use from several threads.
+     */
+    class OpenixExt4 {
+    public:
+        /**
+         * @brief Reads bytes of the volume: (offset, destination, length) -> bytes read
+         */
+        using RangeReader = std::function<size_t(uint64_t offset, void *data, size_t length)>;
+
+        /**
+         * @brief Number of metadata blocks cached by default
+         */
+        static constexpr size_t DEFAULT_CACHE_BLOCKS = 64;
+
+        /**
+         * @brief Open a volume through a range reader
+         *
+         * @param reader Reads bytes of the volume
+         * @param cacheBlocks Number of metadata blocks to cache
+         * @throw std::runtime_error if the superblock does not describe a supported volume
+         */
+        explicit OpenixExt4(RangeReader reader, size_t cacheBlocks = DEFAULT_CACHE_BLOCKS);
+
+        /**
+         * @brief Open a volume stored in an image entry
+         *
+         * The image must stay loaded while the reader is used; its file is opened once and kept open.
+         *
+         * @param image Loaded image
+         * @param index Index into getFileList() of the entry holding the volume
+         * @param cacheBlocks Number of metadata blocks to cache
+         * @throw std::runtime_error if the entry does not hold a supported volume
+         */
+        OpenixExt4(const OpenixIMGFile &image, size_t index, size_t cacheBlocks = DEFAULT_CACHE_BLOCKS);
+
+        /**
+         * @brief Block size of the volume
+         *
+         * @return Block size in bytes
+         */
+        [[nodiscard]] uint32_t blockSize() const;
+
+        /**
+         * @brief Read an inode
+         *
+         * @param number Inode number
+         * @return The inode
+         * @throw std::runtime_error if the number is out of range
+         */
+        [[nodiscard]] Ext4Inode readInode(uint32_t number) const;
+
+        /**
+         * @brief Resolve a path, following symbolic links
+         *
+         * Absolute link targets are resolved from the root of the volume, not of the host.
+         *
+         * @param path Slash-separated path; "/" or "" is the root directory
+         * @param followLast Whether to follow a symbolic link in the last component
+         * @return The inode, or std::nullopt if the path does not exist
+         * @throw std::runtime_error on symbolic link loops
+         */
+        [[nodiscard]] std::optional<Ext4Inode> find(const std::string &path, bool followLast = true) const;
+
+        /**
+         * @brief List a directory
+         *
+         * "." and ".." are not included.
+         *
+         * @param path Directory path
+         * @return The directory entries in on-disk order
+         * @throw std::runtime_error if the path does not exist or is not a directory
+         */
+        [[nodiscard]] std::vector<Ext4Entry> list(const std::string &path) const;
+
+        /**
+         * @brief Target of a symbolic link
+         *
+         * @param inode Symbolic link inode
+         * @return The link target
+         */
+        [[nodiscard]] std::string readLink(const Ext4Inode &inode) const;
+
+        /**
+         * @brief Stream the contents of an inode
+         *
+         * Holes and uninitialized extents are delivered as zeros.
+         *
+         * @param inode Inode from find() or readInode()
+         * @param sink Receives the data in order
+         * @return Number of bytes delivered
+         */
+        uint64_t extract(const Ext4Inode &inode, const OpenixIMGFile::ChunkSink &sink) const;
+
+        /**
+         * @brief Read a whole file
+         *
+         * @param path File path
+         * @return The file contents
+         * @throw std::runtime_error if the path does not exist or is a directory
+         */
+        [[nodiscard]] std::vector<uint8_t> readFile(const std::string &path) const;
+
+    private:
+        /**
+         * @struct Run
+         * @brief Consecutive logical blocks mapped to consecutive physical blocks
+         */
+        struct Run {
+            uint64_t logical; //!< First logical block
+            uint64_t physical; //!< First physical block
+            uint64_t count; //!< Number of blocks
+            bool initialized; //!< False for uninitialized extents, which read as zeros
+        };
+
+        using Block = std::shared_ptr<const std::vector<uint8_t> >;
+        using BlockCache = std::list<std::pair<uint64_t, Block> >;
+
+        /**
+         * @brief Append blocks to a block map, merging them into the last run when contiguous
+         *
+         * @param runs Block map
+         * @param logical First logical block
+         * @param physical First physical block
+         * @param count Number of blocks
+         * @param initialized False for uninitialized extents
+         */
+        static void addRun(std::vector<Run> &runs, uint64_t logical, uint64_t physical, uint64_t count,
+                           bool initialized);
+
+        /**
+         * @brief Look up a logical block in a block map
+         *
+         * @param runs Block map
+         * @param logical Logical block
+         * @return The physical block, or std::nullopt for a hole
+         */
+        static std::optional<uint64_t> physicalBlock(const std::vector<Run> &runs, uint64_t logical);
+
+        /**
+         * @brief Read bytes of the volume, failing on short reads
+         *
+         * @param offset Volume offset
+         * @param data Destination
+         * @param length Number of bytes
+         */
+        void readExact(uint64_t offset, void *data, size_t length) const;
+
+        /**
+         * @brief Read a metadata block through the cache
+         *
+         * @param block Physical block number
+         * @return The block contents
+         */
+        [[nodiscard]] Block readBlock(uint64_t block) const;
+
+        /**
+         * @brief Map the blocks of an inode that hold data
+         *
+         * @param inode Inode using extents or a block map
+         * @return Runs in logical order; unmapped blocks are holes
+         */
+        [[nodiscard]] std::vector<Run> mapBlocks(const Ext4Inode &inode) const;
+
+        /**
+         * @brief Collect the runs of an extent tree node
+         *
+         * @param node Node starting with an extent header
+         * @param length Bytes available in the node
+         * @param depth Levels visited so far
+         * @param runs Receives the runs
+         */
+        void mapExtents(const uint8_t *node, size_t length, int depth, std::vector<Run> &runs) const;
+
+        /**
+         * @brief Collect the runs of a legacy indirect block
+         *
+         * @param block Indirect block, 0 for a hole
+         * @param level 1 for single, 2 for double and 3 for triple indirection
+         * @param logical First logical block the indirect block covers
+         * @param limit Number of logical blocks of the file
+         * @param runs Receives the runs
+         */
+        void mapIndirect(uint32_t block, int level, uint64_t logical, uint64_t limit, std::vector<Run> &runs) const;
+
+        /**
+         * @brief Inline data of an inode: i_block followed by the system.data attribute
+         *
+         * @param inode Inode with the inline data flag
+         * @return The inline data
+         */
+        [[nodiscard]] std::vector<uint8_t> inlineData(const Ext4Inode &inode) const;
+
+        /**
+         * @brief Decode directory entries
+         *
+         * @param data Directory block or inline directory data
+         * @param length Number of bytes
+         * @param entries Receives the entries
+         */
+        void parseEntries(const uint8_t *data, size_t length, std::vector<Ext4Entry> &entries) const;
+
+        /**
+         * @brief Read all entries of a directory
+         *
+         * @param directory Directory inode
+         * @return The entries, including "." and ".."
+         */
+        [[nodiscard]] std::vector<Ext4Entry> readDirectory(const Ext4Inode &directory) const;
+
+        /**
+         * @brief Find a name in a directory, using the hash tree when there is one
+         *
+         * @param directory Directory inode
+         * @param name Entry name
+         * @return The inode number, or std::nullopt if the name does not exist
+         */
+        [[nodiscard]] std::optional<uint32_t> lookup(const Ext4Inode &directory, const std::string &name) const;
+
+        /**
+         * @brief Find a name through the directory's hash tree
+         *
+         * @param runs Block map of the indexed directory
+         * @param name Entry name
+         * @param indexed Cleared when the tree cannot be used and the directory must be scanned
+         * @return The inode number, if found
+         * @throw std::runtime_error if the tree is deeper than the volume's features allow
+         */
+        [[nodiscard]] std::optional<uint32_t> lookupHashed(const std::vector<Run> &runs, const std::string &name,
+                                                           bool &indexed) const;
+
+        /**
+         * @brief Hash of a name as used by the directory hash tree
+         *
+         * @param name Entry name
+         * @param version DX_HASH_* hash version
+         * @param hash Receives the hash
+         * @return False for hash versions that are not supported
+         */
+        [[nodiscard]] bool nameHash(const std::string &name, int version, uint32_t &hash) const;
+
+        RangeReader reader_; //!< Reads bytes of the volume
+        uint32_t blockSize_ = 0; //!< Block size in bytes
+        uint32_t inodeSize_ = 0; //!< On-disk inode size
+        uint32_t inodesPerGroup_ = 0; //!< Inodes per block group
+        uint32_t inodeCount_ = 0; //!< Total number of inodes
+        uint32_t descriptorSize_ = 0; //!< Group descriptor size
+        uint64_t firstDescriptorBlock_ = 0; //!< Block holding the first group descriptor
+        uint32_t incompat_ = 0; //!< Incompatible feature flags
+        uint32_t hashSeed_[4] = {}; //!< Directory hash seed
+        bool dirIndex_ = false; //!< Whether the volume has hashed directories
+        bool unsignedHash_ = false; //!< Whether the volume hashes names as unsigned chars
+        size_t cacheBlocks_; //!< Capacity of the block cache
+        mutable BlockCache cache_; //!< Cached blocks, most recently used first
+        mutable std::unordered_map<uint64_t, BlockCache::iterator> cacheIndex_; //!< Cache position by block number
+    };
+} // namespace OpenixIMG
+
+#endif // OPENIXIMG_OPENIXEXT4_HPP
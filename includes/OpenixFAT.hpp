@@ -0,0 +1,184 @@
+/**
+ * @file OpenixFAT.hpp
+ * @brief Read-only FAT12/16/32 reader working on ranges of an image entry
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#ifndef OPENIXIMG_OPENIXFAT_HPP
+#define OPENIXIMG_OPENIXFAT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "OpenixIMGFile.hpp"
+
+namespace OpenixIMG {
+    /**
+     * @brief FAT variants, determined by the cluster count as the specification requires
+     */
+    enum class FatType {
+        FAT12,
+        FAT16,
+        FAT32,
+    };
+
+    /**
+     * @struct FatEntry
+     * @brief One directory entry
+     */
+    struct FatEntry {
+        std::string name; //!< Long file name if present, otherwise the short name
+        std::string shortName; //!< 8.3 name as stored
+        uint8_t attributes = 0; //!< FAT attribute bits
+        uint32_t firstCluster = 0; //!< First cluster, 0 for empty files and the root directory
+        uint32_t size = 0; //!< File size in bytes, 0 for directories
+
+        /**
+         * @brief Whether the entry is a directory
+         *
+         * @return True for directories
+         */
+        [[nodiscard]] bool isDirectory() const;
+    };
+
+    /**
+     * @class OpenixFAT
+     * @brief Lists and extracts files of a FAT image without extracting the image
+     *
+     * Only the boot sector, the first FAT, the clusters of the directories on the way to a
+     * path and the clusters of the extracted file are read. Runs of consecutive clusters are
+     * fetched with one read each. Long file names (VFAT) are supported and path lookups
+     * ignore ASCII case, as FAT does.
+     */
+    class OpenixFAT {
+    public:
+        /**
+         * @brief Reads bytes of the volume: (offset, destination, length) -> bytes read
+         */
+        using RangeReader = std::function<size_t(uint64_t offset, void *data, size_t length)>;
+
+        /**
+         * @brief Open a volume through a range reader
+         *
+         * @param reader Reads bytes of the volume
+         * @throw std::runtime_error if the boot sector does not describe a FAT volume
+         */
+        explicit OpenixFAT(RangeReader reader);
+
+        /**
+         * @brief Open a volume stored in an image entry
+         *
+         * The image must stay loaded while the reader is used; its file is opened once and kept open.
+         *
+         * @param image Loaded image
+         * @param index Index into getFileList() of the entry holding the volume
+         * @throw std::runtime_error if the entry does not hold a FAT volume
+         */
+        OpenixFAT(const OpenixIMGFile &image, size_t index);
+
+        /**
+         * @brief FAT variant of the volume
+         *
+         * @return The FAT type
+         */
+        [[nodiscard]] FatType type() const;
+
+        /**
+         * @brief Look up a path
+         *
+         * @param path Slash-separated path; "/" or "" is the root directory
+         * @return The entry, or std::nullopt if the path does not exist
+         */
+        [[nodiscard]] std::optional<FatEntry> find(const std::string &path) const;
+
+        /**
+         * @brief List a directory
+         *
+         * "." and ".." are not included.
+         *
+         * @param path Directory path
+         * @return The directory entries in on-disk order
+         * @throw std::runtime_error if the path does not exist or is not a directory
+         */
+        [[nodiscard]] std::vector<FatEntry> list(const std::string &path) const;
+
+        /**
+         * @brief Stream the contents of a file
+         *
+         * @param entry File entry from find() or list()
+         * @param sink Receives the file data in order
+         * @return Number of bytes delivered
+         * @throw std::runtime_error if the cluster chain is shorter than the file
+         */
+        uint64_t extract(const FatEntry &entry, const OpenixIMGFile::ChunkSink &sink) const;
+
+        /**
+         * @brief Read a whole file
+         *
+         * @param path File path
+         * @return The file contents
+         * @throw std::runtime_error if the path does not exist or is a directory
+         */
+        [[nodiscard]] std::vector<uint8_t> readFile(const std::string &path) const;
+
+    private:
+        /**
+         * @brief Read bytes of the volume, failing on short reads
+         *
+         * @param offset Volume offset
+         * @param data Destination
+         * @param length Number of bytes
+         */
+        void readExact(uint64_t offset, void *data, size_t length) const;
+
+        /**
+         * @brief Follow the FAT from a cluster
+         *
+         * @param cluster Current cluster
+         * @return The next cluster, or 0 at the end of the chain
+         */
+        [[nodiscard]] uint32_t nextCluster(uint32_t cluster) const;
+
+        /**
+         * @brief Collect a cluster chain as runs of consecutive clusters
+         *
+         * @param first First cluster
+         * @param maxClusters Stop after this many clusters
+         * @return (first cluster, cluster count) per run
+         */
+        [[nodiscard]] std::vector<std::pair<uint32_t, uint32_t> > clusterRuns(uint32_t first, uint64_t maxClusters) const;
+
+        /**
+         * @brief Read and decode a directory
+         *
+         * @param firstCluster First cluster of the directory, 0 for the root directory
+         * @return The directory entries, without "." and ".."
+         */
+        [[nodiscard]] std::vector<FatEntry> readDirectory(uint32_t firstCluster) const;
+
+        /**
+         * @brief Volume offset of a data cluster
+         *
+         * @param cluster Cluster number, at least 2
+         * @return Byte offset
+         */
+        [[nodiscard]] uint64_t clusterOffset(uint32_t cluster) const;
+
+        RangeReader reader_; //!< Reads bytes of the volume
+        FatType type_ = FatType::FAT12; //!< FAT variant
+        uint32_t clusterSize_ = 0; //!< Bytes per cluster
+        uint32_t clusterCount_ = 0; //!< Number of data clusters
+        uint64_t rootOffset_ = 0; //!< Offset of the fixed root directory (FAT12/16)
+        uint32_t rootEntries_ = 0; //!< Entries in the fixed root directory (FAT12/16)
+        uint32_t rootCluster_ = 0; //!< First cluster of the root directory (FAT32)
+        uint64_t dataOffset_ = 0; //!< Offset of cluster 2
+        std::vector<uint8_t> fat_; //!< First FAT
+    };
+} // namespace OpenixIMG
+
+#endif // OPENIXIMG_OPENIXFAT_HPP
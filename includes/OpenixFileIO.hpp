@@ -0,0 +1,173 @@
+/**
+ * @file OpenixFileIO.hpp
+ * @brief Thin positional file I/O wrapper used by the image readers
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#ifndef OPENIXIMG_OPENIXFILEIO_HPP
+#define OPENIXIMG_OPENIXFILEIO_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace OpenixIMG {
+    /**
+     * @class OpenixFileIO
+     * @brief RAII handle providing positional (pread/preadv style) access to a file
+     *
+     * Positional reads do not move a shared file cursor, so a single handle can be
+     * used to service many entries without reopening the image for each of them.
+     */
+    class OpenixFileIO {
+    public:
+        /**
+         * @brief Access mode of the handle
+         */
+        enum class Mode {
+            READ, //!< Open an existing file read-only
+            WRITE, //!< Create or truncate a file for writing
+            UPDATE, //!< Open a file for reading and writing, creating it if needed, keeping its contents
+            DIRECT, //!< Like UPDATE, bypassing the page cache where the file system allows it
+        };
+
+        /**
+         * @brief Offset, length and address alignment direct transfers must respect
+         *
+         * Covers both 512-byte and 4K-native logical sectors.
+         */
+        static constexpr size_t DIRECT_ALIGNMENT = 4096;
+
+        /**
+         * @struct Slice
+         * @brief Destination buffer for one part of a vectored read
+         */
+        struct Slice {
+            void *data; //!< Destination buffer
+            size_t length; //!< Number of bytes to read into the buffer
+        };
+
+        /**
+         * @brief Open a file
+         *
+         * @param path Path to the file to open
+         * @param mode Access mode, reading by default
+         * @throw std::runtime_error if the file cannot be opened
+         */
+        explicit OpenixFileIO(const std::string &path, Mode mode = Mode::READ);
+
+        ~OpenixFileIO();
+
+        OpenixFileIO(const OpenixFileIO &) = delete;
+
+        OpenixFileIO &operator=(const OpenixFileIO &) = delete;
+
+        /**
+         * @brief Read bytes at an absolute offset
+         *
+         * @param offset Offset in the file to read from
+         * @param data Destination buffer
+         * @param length Number of bytes to read
+         * @return Number of bytes actually read (short only at end of file)
+         */
+        size_t readAt(uint64_t offset, void *data, size_t length) const;
+
+        /**
+         * @brief Read a contiguous file range into several buffers with as few syscalls as possible
+         *
+         * Uses preadv where available and falls back to one positional read per slice.
+         *
+         * @param offset Offset in the file where the first slice starts
+         * @param slices Destination buffers, filled in order
+         * @return Number of bytes actually read (short only at end of file)
+         */
+        size_t readVectorAt(uint64_t offset, const std::vector<Slice> &slices) const;
+
+        /**
+         * @brief Write bytes at an absolute offset
+         *
+         * @param offset Offset in the file to write to
+         * @param data Source buffer
+         * @param length Number of bytes to write
+         * @throw std::runtime_error if not all bytes could be written
+         */
+        void writeAt(uint64_t offset, const void *data, size_t length) const;
+
+        /**
+         * @brief Get the current size of the file
+         *
+         * Block devices report their capacity.
+         *
+         * @return File size in bytes
+         */
+        [[nodiscard]] uint64_t size() const;
+
+        /**
+         * @brief Grow or shrink the file
+         *
+         * Growing leaves a hole on file systems that support sparse files.
+         *
+         * @param length New file size in bytes
+         * @throw std::runtime_error if the size cannot be changed
+         */
+        void resize(uint64_t length) const;
+
+        /**
+         * @brief Flush written data to the storage device
+         *
+         * @throw std::runtime_error if the data cannot be flushed
+         */
+        void sync() const;
+
+        /**
+         * @brief Start writing back a range of dirty pages without waiting for the device
+         *
+         * Lets the kernel stream data out while more is written, so that a later sync has
+         * little left to do. Best effort, and not a durability guarantee on its own.
+         *
+         * @param offset First byte of the range
+         * @param length Number of bytes
+         * @param wait Also wait until the range has been written back
+         * @return True if the request was made, false where it is unsupported
+         */
+        bool writeback(uint64_t offset, uint64_t length, bool wait) const;
+
+        /**
+         * @brief Flush every file of the file system holding this file, including directories
+         *
+         * One call replaces an fsync per file when many files were written.
+         *
+         * @return True if the file system was synced, false where it is unsupported
+         * @throw std::runtime_error if the sync fails
+         */
+        bool syncFileSystem() const;
+
+        /**
+         * @brief Ask the OS to drop cached pages of the file
+         *
+         * Best effort; data that has not been synced may stay cached.
+         *
+         * @return True if the request was made, false where it is unsupported
+         */
+        bool evict() const;
+
+        /**
+         * @brief Check whether transfers bypass the page cache
+         *
+         * Only handles opened with Mode::DIRECT can be direct, and only where the OS and file
+         * system support it; otherwise they silently behave like Mode::UPDATE. While direct,
+         * offsets, lengths and buffer addresses must be multiples of DIRECT_ALIGNMENT.
+         *
+         * @return True if the handle performs direct I/O
+         */
+        [[nodiscard]] bool isDirect() const;
+
+    private:
+        int fd_; //!< Underlying file descriptor
+        bool direct_ = false; //!< Whether the page cache is bypassed
+        std::string path_; //!< Path of the opened file, for error messages
+    };
+} // namespace OpenixIMG
+
+#endif // OPENIXIMG_OPENIXFILEIO_HPP
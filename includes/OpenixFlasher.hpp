@@ -0,0 +1,114 @@
+/**
+ * @file OpenixFlasher.hpp
+ * @brief Streams image entries straight to their partitions on a block device or disk image
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#ifndef OPENIXIMG_OPENIXFLASHER_HPP
+#define OPENIXIMG_OPENIXFLASHER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "OpenixIMGFile.hpp"
+#include "OpenixPartition.hpp"
+
+namespace OpenixIMG {
+    /**
+     * @struct FlashOptions
+     * @brief Parameters of a flash run
+     */
+    struct FlashOptions {
+        GptOptions layout; //!< Disk the partition offsets are computed for; without diskSectors a trailing size-0 partition is unbounded
+        std::vector<std::string> partitions; //!< Partitions to write, empty for every partition whose download file is in the image
+        bool verify = false; //!< Read each partition back and compare it with what was written
+        bool direct = true; //!< Bypass the page cache where the target allows it
+        unsigned threads = 0; //!< Partitions written at the same time, 0 for one per hardware thread
+    };
+
+    /**
+     * @struct FlashResult
+     * @brief Outcome of writing one partition
+     */
+    struct FlashResult {
+        std::string partition; //!< Partition name
+        std::string file; //!< Image entry written to it
+        uint64_t offset = 0; //!< Byte offset of the partition on the target
+        uint64_t length = 0; //!< Bytes written
+        uint32_t crc = 0; //!< CRC-32 of the bytes written
+        bool verified = false; //!< Whether the read-back matched; always false without FlashOptions::verify
+    };
+
+    /**
+     * @class OpenixFlasher
+     * @brief Writes the download file of each partition to its place on a target
+     *
+     * Entries are decrypted chunk by chunk into one aligned buffer per worker and written at
+     * the partition offsets computed by OpenixPartition::computeLayout, so nothing is unpacked
+     * to disk first. The target is a block device or a regular file standing in for one.
+     *
+     * Where the target allows it, transfers bypass the page cache: every chunk but the last
+     * is a multiple of OpenixFileIO::DIRECT_ALIGNMENT, and the unaligned tail of an entry
+     * (or a partition that does not start on that alignment) goes through a buffered handle
+     * instead. Partitions do not overlap, so several are written in parallel.
+     *
+     * Verification reads each partition back through the same buffer after it has been
+     * synced and compares CRC-32s, so it needs no extra memory.
+     */
+    class OpenixFlasher {
+    public:
+        /**
+         * @brief Create a flasher
+         *
+         * @param image Loaded image holding the download files
+         * @param table Partition table, usually sys_partition.fex of the same image
+         */
+        OpenixFlasher(const OpenixIMGFile &image, const OpenixPartition &table);
+
+        /**
+         * @brief Work out what would be written where, without touching the target
+         *
+         * @param options Flash parameters
+         * @return One result per partition to write, in table order, with crc and verified unset
+         * @throw std::runtime_error if a requested partition is unknown or has no download
+         *        file in the image, or if an entry is larger than its partition
+         */
+        [[nodiscard]] std::vector<FlashResult> plan(const FlashOptions &options) const;
+
+        /**
+         * @brief Write the partitions to a target
+         *
+         * Nothing is written unless the whole plan is valid. The target is created if it does
+         * not exist and synced before returning.
+         *
+         * @param target Block device or disk image file
+         * @param options Flash parameters
+         * @return One result per partition written, in table order
+         * @throw std::runtime_error if planning fails or the target cannot be written
+         * @throw OperationCancelled if the image's cancellation token stops the flash; partitions
+         *        already written are left in place
+         */
+        std::vector<FlashResult> flash(const std::string &target, const FlashOptions &options) const;
+
+        /**
+         * @brief Read partitions back from a target and compare them with what a flash wrote
+         *
+         * Partitions are read one after another through a single aligned buffer.
+         *
+         * @param target Block device or disk image file
+         * @param results Results of flash(); verified is updated on each
+         * @param direct Bypass the page cache where the target allows it
+         * @throw std::runtime_error if the target ends inside a partition
+         * @throw OperationCancelled if the image's cancellation token stops the read-back
+         */
+        void verify(const std::string &target, std::vector<FlashResult> &results, bool direct = true) const;
+
+    private:
+        const OpenixIMGFile &image_; //!< Image the entries are read from
+        const OpenixPartition &table_; //!< Partition table the offsets come from
+    };
+} // namespace OpenixIMG
+
+#endif // OPENIXIMG_OPENIXFLASHER_HPP
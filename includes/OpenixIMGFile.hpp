@@ -16,11 +16,17 @@ typedef SSIZE_T ssize_t;
 #include <string>
 #include <vector>
 #include <optional>
+#include <memory>
+#include <functional>
 
 #include "rc6.hpp"
 #include "twofish.hpp"
 
+#include "OpenixBuildConfig.hpp"
+#include "OpenixCancellation.hpp"
+#include "OpenixFileIO.hpp"
 #include "OpenixIMGWTY.hpp"
+#include "OpenixSharedCache.hpp"
 
 /**
  * @namespace OpenixIMG
@@ -46,6 +52,15 @@ namespace OpenixIMG {
             uint32_t offset;
         };
 
+        /**
+         * @brief Cipher contexts used for the different regions of an image
+         */
+        enum class CryptoContext {
+            HEADER, //!< Image header (first 1024 bytes)
+            FILE_HEADERS, //!< File header table
+            FILE_CONTENT, //!< Entry payloads
+        };
+
         /**
          * @brief Default constructor
          * 
@@ -82,6 +97,44 @@ namespace OpenixIMG {
          */
         void setEncryptionEnabled(bool enabled);
 
+        /**
+         * @brief Check if encryption is enabled
+         *
+         * @return True if encryption is enabled, false otherwise
+         */
+        [[nodiscard]] bool isEncryptionEnabled() const;
+
+        /**
+         * @brief Encrypt a buffer in place with one of the image cipher contexts
+         *
+         * Used when building images. The length should be a multiple of the 16-byte block size;
+         * a trailing partial block is left untouched.
+         *
+         * @param data Pointer to data to encrypt
+         * @param length Length of data to encrypt
+         * @param context Image region the data belongs to
+         */
+        void encryptData(void *data, size_t length, CryptoContext context) const;
+
+        /**
+         * @brief Decrypt a buffer in place with one of the image cipher contexts
+         *
+         * The counterpart of encryptData; a trailing partial block is left untouched.
+         *
+         * @param data Pointer to data to decrypt
+         * @param length Length of data to decrypt
+         * @param context Image region the data belongs to
+         */
+        void decryptData(void *data, size_t length, CryptoContext context) const;
+
+        /**
+         * @brief Decrypt a buffer in place with the Twofish context
+         *
+         * @param data Pointer to data to decrypt
+         * @param length Length of data to decrypt, a trailing partial block is left untouched
+         */
+        void twofishDecryptData(void *data, size_t length) const;
+
 
         /**
          * @brief Initialize cryptographic contexts
@@ -209,6 +262,83 @@ namespace OpenixIMG {
         [[nodiscard]] std::vector<std::pair<std::string, std::vector<uint8_t> > > getFileDataBySubtype(
             const std::string &subtype) const;
 
+        /**
+         * @brief Read several entries from the loaded image in one batch
+         *
+         * The requested entries are sorted by offset and coalesced into as few vectored
+         * reads as possible over a single file handle; decryption then runs in parallel.
+         *
+         * @param indices Indices into getFileList() of the entries to read (duplicates allowed)
+         * @return File data for each requested index, in request order
+         */
+        [[nodiscard]] std::vector<std::vector<uint8_t> > readEntries(const std::vector<size_t> &indices) const;
+
+        /**
+         * @brief Receives consecutive chunks of an entry
+         */
+        using ChunkSink = std::function<void(const uint8_t *data, size_t length)>;
+
+        /**
+         * @brief Stream one entry through a sink without holding it in memory
+         *
+         * The entry is read and decrypted one chunk at a time, so memory use is bounded by
+         * the chunk size whatever the size of the entry. Padding past the original length is
+         * not delivered. The shared cache is not consulted, since a hit would copy the whole
+         * entry out of it.
+         *
+         * @param index Index into getFileList() of the entry to read
+         * @param sink Receives the entry data in order
+         * @param chunkSize Bytes per chunk, rounded down to the 16-byte cipher block (at least one block)
+         * @return Number of bytes delivered
+         */
+        uint64_t readEntryChunks(size_t index, const ChunkSink &sink, size_t chunkSize = IO_BUFFER_SIZE) const;
+
+        /**
+         * @brief Read part of an entry, decrypting only the cipher blocks it covers
+         *
+         * Payloads are encrypted block by block, so a range can be decrypted on its own once
+         * it is widened to 16-byte boundaries. Filesystem readers use this to fetch metadata
+         * and file data without reading the whole entry.
+         *
+         * @param index Index into getFileList() of the entry to read
+         * @param offset Offset into the entry
+         * @param data Receives the bytes
+         * @param length Number of bytes to read
+         * @return Number of bytes read, short only at the end of the entry
+         */
+        size_t readEntryRange(size_t index, uint64_t offset, void *data, size_t length) const;
+
+        /**
+         * @brief Read part of an entry through an already open image file
+         *
+         * Same as readEntryRange above; readers that issue many small reads keep one handle
+         * instead of opening the image on every call.
+         *
+         * @param file Image file opened for reading
+         * @param index Index into getFileList() of the entry to read
+         * @param offset Offset into the entry
+         * @param data Receives the bytes
+         * @param length Number of bytes to read
+         * @return Number of bytes read, short only at the end of the entry
+         */
+        size_t readEntryRange(const OpenixFileIO &file, size_t index, uint64_t offset, void *data, size_t length) const;
+
+        /**
+         * @brief Overwrite part of an entry in place, re-encrypting only the cipher blocks it covers
+         *
+         * The counterpart of readEntryRange: the blocks covering the range are read, decrypted,
+         * patched, encrypted again and written back to the image file, so the rest of the image
+         * is left untouched. The entry cannot grow, and the fingerprint is refreshed afterwards
+         * so stale shared cache contents are not used.
+         *
+         * @param index Index into getFileList() of the entry to modify
+         * @param offset Offset into the entry
+         * @param data New bytes
+         * @param length Number of bytes to write
+         * @throw std::runtime_error if the range extends past the end of the entry
+         */
+        void writeEntryRange(size_t index, uint64_t offset, const void *data, size_t length);
+
         /**
          * @brief Get the loaded image data
          * 
@@ -237,6 +367,46 @@ namespace OpenixIMG {
          */
         [[nodiscard]] bool isEncrypted() const;
 
+        /**
+         * @brief Share decrypted entries with other processes
+         *
+         * Entries read from an encrypted image are looked up in the cache before they are
+         * read and decrypted, and stored in it afterwards.
+         *
+         * @param cache Cache to use, or nullptr to stop using one
+         */
+        void setSharedCache(std::shared_ptr<OpenixSharedCache> cache);
+
+        /**
+         * @brief Make reads, and the packer and flasher working on this image, stoppable
+         *
+         * The token is checked once per chunk or decrypt slice; a cancelled read throws
+         * OperationCancelled.
+         *
+         * @param token Token to check, or nullptr to run to completion
+         */
+        void setCancellationToken(std::shared_ptr<OpenixCancellationToken> token);
+
+        /**
+         * @brief Throw if the cancellation token has been cancelled or its deadline has passed
+         *
+         * For code that loops over this image's data outside of its own read methods.
+         *
+         * @throw OperationCancelled if the operation should stop
+         */
+        void checkCancelled() const;
+
+        /**
+         * @brief Identity of the loaded image contents
+         *
+         * Derived from the decrypted header table, the file size and the modification time,
+         * so it is the same in every process that loads the same file and changes when the
+         * file is rewritten.
+         *
+         * @return The fingerprint
+         */
+        [[nodiscard]] uint64_t getFingerprint() const;
+
     private:
         /**
          * @brief RC6 encrypt data in place
@@ -296,6 +466,18 @@ namespace OpenixIMG {
           */
         [[nodiscard]] std::vector<uint8_t> readFileDataFromDisk(uint32_t offset, uint32_t storedLength, uint32_t originalLength) const;
 
+        /**
+         * @brief Check whether entries go through the shared cache
+         *
+         * @return True if a cache is set and entries are decrypted
+         */
+        [[nodiscard]] bool usesSharedCache() const;
+
+        /**
+         * @brief Derive the fingerprint from the header table and the image file's size and modification time
+         */
+        void updateFingerprint();
+
         // Member variables
         bool encryptionEnabled_; //!< Flag indicating if encryption is enabled
         bool imageLoaded_; //!< Flag indicating if an image file is loaded
@@ -305,6 +487,9 @@ namespace OpenixIMG {
         ImageHeader imageHeader_; //!< Parsed image header
         bool isEncrypted_{}; //!< Flag indicating if the image is encrypted
         std::vector<FileInfo> fileList_; //!< List of files in the image
+        uint64_t fingerprint_{}; //!< Identity of the loaded image contents
+        std::shared_ptr<OpenixSharedCache> sharedCache_; //!< Cross-process cache of decrypted entries, may be null
+        std::shared_ptr<OpenixCancellationToken> cancellation_; //!< Checked between chunks of work, may be null
 
         // Image metadata
         uint32_t pid_{}; //!< Product ID
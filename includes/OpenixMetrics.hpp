@@ -0,0 +1,269 @@
+/**
+ * @file OpenixMetrics.hpp
+ * @brief Latency and throughput histograms exported in the Prometheus text format
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#ifndef OPENIXIMG_OPENIXMETRICS_HPP
+#define OPENIXIMG_OPENIXMETRICS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace OpenixIMG {
+    /**
+     * @brief Measurements collected by OpenixMetrics
+     */
+    enum class Metric : uint8_t {
+        READ, //!< Positional read of entry data (one call may serve several coalesced entries)
+        DECRYPT, //!< Decryption of entry data (per entry, or per slice for batched reads)
+        ENCRYPT, //!< Encryption of one packed entry
+        WRITE, //!< Writing one entry to the output (unpacked file or packed payload)
+        PACK_PLAN, //!< Packer stage: load configuration and plan the payload layout
+        PACK_TABLE, //!< Packer stage: write the header table
+        PACK_PAYLOAD, //!< Packer stage: write all payloads
+        PACK_THROUGHPUT, //!< Bytes per second of a complete pack
+        UNPACK_THROUGHPUT, //!< Bytes per second of a complete unpack
+        INTERACTIVE_WAIT, //!< Scheduler: time an interactive task waited for a slot
+        BULK_WAIT, //!< Scheduler: time a bulk task waited for a slot
+        INTERACTIVE_LATENCY, //!< Scheduler: queueing plus run time of an interactive task
+        BULK_LATENCY, //!< Scheduler: queueing plus run time of a bulk task
+        INTERACTIVE_THROUGHPUT, //!< Scheduler: bytes per second of running interactive tasks
+        BULK_THROUGHPUT, //!< Scheduler: bytes per second of running bulk tasks
+        COUNT
+    };
+
+    /**
+     * @class OpenixHistogram
+     * @brief Log-linear (HDR-style) histogram that can be updated concurrently without locks
+     *
+     * Each power of two is split into 8 linear sub-buckets, so any recorded value is known to
+     * within 12.5% over the whole 64-bit range. Like Prometheus "le" buckets, each bucket
+     * includes its upper bound: it holds the values above the previous bound up to and
+     * including its own. Recording is a handful of relaxed atomic increments.
+     */
+    class OpenixHistogram {
+    public:
+        /**
+         * @brief Number of linear sub-buckets per power of two (as a bit count)
+         */
+        static constexpr unsigned SUB_BUCKET_BITS = 3;
+
+        /**
+         * @brief Total number of buckets covering the 64-bit range
+         */
+        static constexpr size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS;
+
+        /**
+         * @brief Record a value
+         *
+         * @param value Value in the histogram's base unit
+         */
+        void record(uint64_t value);
+
+        /**
+         * @brief Number of recorded values
+         *
+         * @return The count
+         */
+        [[nodiscard]] uint64_t count() const;
+
+        /**
+         * @brief Sum of recorded values
+         *
+         * @return The sum in base units
+         */
+        [[nodiscard]] uint64_t sum() const;
+
+        /**
+         * @brief Number of recorded values less than or equal to a bound
+         *
+         * @param bound Inclusive upper bound, rounded down to a bucket boundary
+         * @return The cumulative count
+         */
+        [[nodiscard]] uint64_t countAtMost(uint64_t bound) const;
+
+        /**
+         * @brief Estimate a quantile
+         *
+         * @param quantile Quantile in [0, 1]
+         * @return Upper bound of the bucket holding the quantile, 0 if empty
+         */
+        [[nodiscard]] uint64_t quantile(double quantile) const;
+
+        /**
+         * @brief Clear all recorded values
+         */
+        void reset();
+
+        /**
+         * @brief Bucket a value falls into
+         *
+         * @param value Value to classify
+         * @return Bucket index
+         */
+        static size_t bucketIndex(uint64_t value);
+
+        /**
+         * @brief Largest value of a bucket
+         *
+         * @param index Bucket index
+         * @return Inclusive upper bound of the bucket
+         */
+        static uint64_t bucketUpperBound(size_t index);
+
+    private:
+        std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets_{}; //!< Per-bucket counts
+        std::atomic<uint64_t> count_{0}; //!< Number of values
+        std::atomic<uint64_t> sum_{0}; //!< Sum of values
+    };
+
+    /**
+     * @class OpenixMetrics
+     * @brief Process-wide metric registry, disabled until setEnabled(true)
+     *
+     * Durations are recorded in nanoseconds and exported in seconds; throughputs are recorded
+     * and exported in bytes per second. The export is a node_exporter textfile: it is written
+     * to a temporary file next to the target and renamed over it, so readers never see a
+     * partial file.
+     */
+    class OpenixMetrics {
+    public:
+        /**
+         * @class Timer
+         * @brief Records the lifetime of a scope into a duration metric
+         */
+        class Timer {
+        public:
+            /**
+             * @brief Start timing if metrics are enabled
+             *
+             * @param metric Duration metric to record into
+             */
+            explicit Timer(Metric metric);
+
+            ~Timer();
+
+            Timer(const Timer &) = delete;
+
+            Timer &operator=(const Timer &) = delete;
+
+        private:
+            Metric metric_; //!< Metric to record into
+            bool active_; //!< Whether metrics were enabled at construction
+            std::chrono::steady_clock::time_point start_; //!< Start time
+        };
+
+        /**
+         * @brief Enable or disable collection
+         *
+         * @param enabled Whether to collect metrics
+         */
+        static void setEnabled(bool enabled);
+
+        /**
+         * @brief Check whether collection is enabled
+         *
+         * @return True if enabled
+         */
+        static bool isEnabled();
+
+        /**
+         * @brief Record a value if collection is enabled
+         *
+         * @param metric Metric to record into
+         * @param value Value in the metric's base unit (nanoseconds or bytes per second)
+         */
+        static void record(Metric metric, uint64_t value);
+
+        /**
+         * @brief Record a duration if collection is enabled
+         *
+         * @param metric Duration metric to record into
+         * @param duration Duration to record
+         */
+        static void recordDuration(Metric metric, std::chrono::steady_clock::duration duration);
+
+        /**
+         * @brief Record the throughput of an operation if collection is enabled
+         *
+         * @param metric Throughput metric to record into
+         * @param bytes Number of bytes processed
+         * @param duration Duration of the operation
+         */
+        static void recordThroughput(Metric metric, uint64_t bytes, std::chrono::steady_clock::duration duration);
+
+        /**
+         * @brief Access the histogram of a metric
+         *
+         * @param metric Metric to access
+         * @return The histogram
+         */
+        static const OpenixHistogram &histogram(Metric metric);
+
+        /**
+         * @brief Clear all metrics
+         */
+        static void reset();
+
+        /**
+         * @brief Render all metrics in the Prometheus text exposition format
+         *
+         * @return The exposition text
+         */
+        static std::string dumpToString();
+
+        /**
+         * @brief Atomically replace a textfile with the current metrics
+         *
+         * @param path Target .prom file
+         * @throw std::runtime_error if the file cannot be written
+         */
+        static void writeTextfile(const std::string &path);
+    };
+
+    /**
+     * @class OpenixMetricsExporter
+     * @brief Writes the metrics textfile periodically and once more on destruction
+     */
+    class OpenixMetricsExporter {
+    public:
+        /**
+         * @brief Enable metrics and start exporting
+         *
+         * @param path Target .prom file
+         * @param interval Time between exports, zero to only export on destruction
+         */
+        OpenixMetricsExporter(std::string path, std::chrono::milliseconds interval);
+
+        /**
+         * @brief Stop the periodic export and write the final metrics
+         */
+        ~OpenixMetricsExporter();
+
+        OpenixMetricsExporter(const OpenixMetricsExporter &) = delete;
+
+        OpenixMetricsExporter &operator=(const OpenixMetricsExporter &) = delete;
+
+    private:
+        /**
+         * @brief Write the textfile, reporting failures on stderr instead of throwing
+         */
+        void exportNow() const;
+
+        std::string path_; //!< Target .prom file
+        std::chrono::milliseconds interval_; //!< Export interval
+        std::mutex mutex_; //!< Guards stop_
+        std::condition_variable wake_; //!< Signals stop_
+        bool stop_; //!< Set when the exporter is destroyed
+        std::thread thread_; //!< Periodic export thread
+    };
+} // namespace OpenixIMG
+
+#endif // OPENIXIMG_OPENIXMETRICS_HPP
@@ -7,16 +7,62 @@
 #pragma once
 
 #include <string>
+#include <istream>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "OpenixIMGWTY.hpp"
 #include "OpenixIMGFile.hpp"
+#include "OpenixFileIO.hpp"
+#include "OpenixPlanner.hpp"
 
 namespace OpenixIMG {
+    struct ImageCfgView;
+
     enum class OutputFormat {
         UNIMG,
         IMGREPACKER
     };
 
+    /**
+     * @struct SparseOptions
+     * @brief Entries to extract as Android sparse images
+     */
+    struct SparseOptions {
+        std::vector<std::string> entries; //!< Entry file names, output names or file name stems (e.g. "rootfs")
+        bool zeroAsDontCare = false; //!< Emit zero blocks as DONT_CARE; only safe for erased targets
+    };
+
+    /**
+     * @brief How unpackImage replaces an existing output directory
+     */
+    enum class ReplaceMode {
+        REMOVE, //!< Delete the existing tree, then unpack in place
+        SWAP, //!< Unpack beside it, swap the two atomically and delete the old tree in the background
+    };
+
+    /**
+     * @brief How hard the packer works to make its outputs survive a crash or power loss
+     */
+    enum class Durability {
+        NONE, //!< Leave write-back to the OS
+        BARRIER, //!< One file system sync after the payloads, before the files describing them are written
+        INCREMENTAL, //!< Like BARRIER, but write-back starts while streaming so the final sync is short
+    };
+
+    /**
+     * @brief Order of the payloads in a packed image
+     *
+     * The header table always lists the entries in file list order; only where their payloads
+     * are stored changes.
+     */
+    enum class PayloadLayout {
+        TABLE_ORDER, //!< Payloads in file list order
+        METADATA_FIRST, //!< Partition table, configuration, MBR, boot loaders and other small entries first
+    };
+
     /**
      * @brief The OpenixPacker class provides high-level image packing, unpacking and decryption operations.
      * It uses OpenixIMGFile for low-level image operations and structure management.
@@ -25,15 +71,242 @@ namespace OpenixIMG {
     public:
         explicit OpenixPacker(OpenixIMGFile &imgFile);
 
+        /**
+         * @brief Wait for the background removal of replaced output trees
+         */
         ~OpenixPacker();
 
-        [[nodiscard]] bool unpackImage(const std::string &outputDir, const OutputFormat &outputFormat) const;
+        /**
+         * @brief Set the durability of the outputs of later unpacks and packs
+         *
+         * Unpacks sync the extracted entries with one barrier (syncfs where available, one
+         * fsync per file elsewhere), then write and sync image.cfg and only then swap the
+         * output into place, so a crash never leaves an image.cfg describing missing data.
+         * Packs sync the payloads before the header table that points at them is written,
+         * then sync the image again.
+         *
+         * @param durability Durability mode, NONE by default
+         */
+        void setDurability(Durability durability);
+
+        /**
+         * @brief Set where packImage stores the payloads
+         *
+         * With PayloadLayout::METADATA_FIRST, the entries a flasher or validator reads first
+         * (sys_partition.fex, sys_config.fex, sunxi_mbr.fex, boot0, u-boot, boot_package and
+         * any entry of at most 256 KiB) are stored in one contiguous region right after the
+         * header table, so the first few hundred KiB of the image answer most queries.
+         * packImageFromTar stores payloads in stream order regardless.
+         *
+         * @param layout Payload layout, TABLE_ORDER by default
+         */
+        void setPayloadLayout(PayloadLayout layout);
+
+        /**
+         * @brief Set the boundary every payload of later packs starts on
+         *
+         * Stored lengths stay rounded to 512 bytes; the gaps up to the next boundary are left
+         * as holes between payloads. With 4 KiB or 64 KiB, payloads start on file system
+         * blocks or extents, so plaintext payloads can be cloned (FICLONERANGE, copy_file_range)
+         * and read with direct I/O.
+         *
+         * @param alignment Power of two from 512 bytes to 1 MiB, 512 by default
+         * @throw std::runtime_error if the alignment is not supported
+         */
+        void setPayloadAlignment(uint32_t alignment);
+
+        /**
+         * @brief Extract all entries of the loaded image into a directory
+         *
+         * Every entry is streamed through a single IO_BUFFER_SIZE buffer, so memory use does
+         * not depend on the size of the entries. Entries selected by the sparse options are
+         * written as "<name>.simg" Android sparse images instead of raw files, streamed chunk
+         * by chunk; image.cfg still lists the raw names, so such a directory is meant for
+         * flashing rather than repacking.
+         *
+         * The image's cancellation token is checked for every chunk. If the unpack fails or is
+         * cancelled, the output directory is removed.
+         *
+         * With ReplaceMode::SWAP the entries are extracted into a hidden sibling directory,
+         * which then takes the place of outputDir in a single rename (RENAME_EXCHANGE on
+         * Linux, RENAME_SWAP on macOS). Readers see either the old tree or the complete new
+         * one, a failed or cancelled unpack leaves the old tree untouched, and the old tree is
+         * deleted by a background thread that waitForCleanup() and the destructor join.
+         *
+         * @param outputDir Directory to create, replacing an existing one
+         * @param outputFormat Naming scheme of the extracted files
+         * @param sparse Entries to extract as sparse images
+         * @param replace How an existing outputDir is replaced
+         * @return True on success
+         * @throw std::runtime_error if the image cannot be read or an output file cannot be written
+         * @throw OperationCancelled if the image's cancellation token stops the unpack
+         */
+        [[nodiscard]] bool unpackImage(const std::string &outputDir, const OutputFormat &outputFormat,
+                                       const SparseOptions &sparse = {},
+                                       ReplaceMode replace = ReplaceMode::REMOVE) const;
+
+        /**
+         * @brief Wait until the trees replaced by swapped unpacks have been deleted
+         */
+        void waitForCleanup() const;
+
+        /**
+         * @brief Build an image from an image.cfg and the files it lists
+         *
+         * Files named in the FILELIST group are resolved relative to the directory of the configuration.
+         * The image's cancellation token is checked for every chunk; a partly written image is
+         * removed when packing fails or is cancelled.
+         *
+         * @param configPath Path to image.cfg
+         * @param outputFile Path of the image to create
+         * @return True on success
+         * @throw OperationCancelled if the image's cancellation token stops the pack
+         */
+        [[nodiscard]] bool packImage(const std::string &configPath, const std::string &outputFile) const;
+
+        /**
+         * @brief Build an image from a tar stream of payload files
+         *
+         * Each member is encrypted and written to the next free payload region as it arrives,
+         * so no staging directory is needed and memory use is bounded by one I/O buffer.
+         * The header table is written once the stream ends. The configuration is taken from
+         * configPath or, when that is empty, from an "image.cfg" member which must precede
+         * the payload members. A listed file that appears twice in the stream is an error.
+         * Cancellation and clean-up work as for packImage().
+         *
+         * @param tarStream Input stream containing the tar archive
+         * @param configPath Path to image.cfg, or empty to read it from the stream
+         * @param outputFile Path of the image to create
+         * @return True on success
+         */
+        [[nodiscard]] bool packImageFromTar(std::istream &tarStream, const std::string &configPath,
+                                            const std::string &outputFile) const;
+
+        /**
+         * @brief Plan an unpack of the loaded image without reading any payload
+         *
+         * Only the headers read by loadImage are used; the plan lists the reads, decryption
+         * and writes unpackImage would perform for every entry.
+         *
+         * @param outputFormat Output format, which decides the output file names
+         * @return The plan
+         * @throw std::runtime_error if no image is loaded
+         */
+        [[nodiscard]] OperationPlan planUnpack(const OutputFormat &outputFormat) const;
+
+        /**
+         * @brief Plan a pack from an image.cfg without reading any payload
+         *
+         * Payload sizes are taken from the file system, so every listed file must exist. Payload
+         * steps follow the layout and alignment packImage would use, one per file in image order,
+         * and their writes include the alignment gaps, so the planned writes add up to the image size.
+         *
+         * @param configPath Path to image.cfg
+         * @return The plan
+         * @throw std::runtime_error if the configuration or an input file is invalid
+         */
+        [[nodiscard]] OperationPlan planPack(const std::string &configPath) const;
 
     private:
+        /**
+         * @brief One FILELIST entry of an image being built
+         */
+        struct PackEntry {
+            std::string filename; //!< File name as listed in image.cfg
+            std::string maintype; //!< Main type identifier
+            std::string subtype; //!< Subtype identifier
+            uint32_t length = 0; //!< Payload length in bytes
+            uint32_t offset = 0; //!< Payload offset in the image
+            bool present = false; //!< Whether the payload has been written
+        };
+
+        /**
+         * @brief Collect the FILELIST entries of an image configuration
+         *
+         * @param view Resolved image.cfg fields
+         * @return Entries in table order
+         */
+        static std::vector<PackEntry> collectPackEntries(const ImageCfgView &view);
+
+        /**
+         * @brief Assign payload offsets from the sizes of the input files
+         *
+         * Entries naming the same file share one payload region, placed where the first of them
+         * would be.
+         *
+         * @param entries Entries to lay out; length and offset are filled in
+         * @param inputDir Directory the file names are relative to
+         * @param layout Order of the payloads
+         * @param alignment Boundary every payload starts on
+         * @return Total size of the image
+         * @throw std::runtime_error if a file is missing or the image exceeds 4 GiB
+         */
+        static uint64_t layoutPayloads(std::vector<PackEntry> &entries, const std::string &inputDir,
+                                       PayloadLayout layout, uint32_t alignment);
+
+        /**
+         * @brief Check whether an entry is selected for sparse output
+         *
+         * @param sparse Sparse options
+         * @param filename Entry file name
+         * @param outputName Name the entry is extracted under
+         * @return True if the entry is written as a sparse image
+         */
+        static bool isSparseEntry(const SparseOptions &sparse, const std::string &filename,
+                                  const std::string &outputName);
+
+        /**
+         * @brief Check whether an image.cfg asks for an encrypted image
+         *
+         * @param view Resolved image.cfg fields
+         * @return True if payloads and headers should be encrypted
+         */
+        [[nodiscard]] bool shouldEncrypt(const ImageCfgView &view) const;
+
+        /**
+         * @brief Write the image header and file header table
+         *
+         * @param out Output image
+         * @param view Resolved image.cfg fields
+         * @param entries Entries with final offsets and lengths
+         * @param imageSize Total size of the image
+         * @param encrypt Whether to encrypt the headers
+         */
+        void writeImageTable(const OpenixFileIO &out, const ImageCfgView &view, const std::vector<PackEntry> &entries,
+                             uint32_t imageSize, bool encrypt) const;
+
+        /**
+         * @brief Stream one payload into the image, padding it to its stored length
+         *
+         * @param out Output image
+         * @param offset Offset of the payload region
+         * @param length Payload length in bytes
+         * @param source Callback filling a buffer with the next payload bytes, returning the count
+         * @param encrypt Whether to encrypt the payload
+         * @param progress Called with the image offset written up to after each chunk, if set
+         * @return Stored length of the payload
+         */
+        uint32_t writePayload(const OpenixFileIO &out, uint64_t offset, uint64_t length,
+                              const std::function<size_t(uint8_t *, size_t)> &source, bool encrypt,
+                              const std::function<void(uint64_t)> &progress = {}) const;
+
+
         [[nodiscard]] bool genImageCfgFromFileList(const std::vector<OpenixIMGFile::FileInfo> &fileList,
                                                    const std::string &outputDir,
                                                    const OutputFormat &outputFormat) const;
+
+        /**
+         * @brief Delete a replaced output tree on a background thread
+         *
+         * @param path Tree to delete
+         */
+        void removeInBackground(const std::string &path) const;
 private:
         OpenixIMGFile &imgFile_; //!< Reference to IMG file handler
+        Durability durability_ = Durability::NONE; //!< How outputs are synced
+        PayloadLayout layout_ = PayloadLayout::TABLE_ORDER; //!< Where packImage stores the payloads
+        uint32_t payloadAlignment_ = 512; //!< Boundary every payload starts on
+        mutable std::mutex cleanupMutex_; //!< Guards cleanups_
+        mutable std::vector<std::thread> cleanups_; //!< Threads deleting replaced output trees
     };
 } // namespace OpenixIMG
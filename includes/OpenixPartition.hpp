@@ -12,10 +12,23 @@
 #include <vector>
 #include <memory>
 #include <filesystem>
+#include <functional>
 
 namespace fs = std::filesystem;
 
 namespace OpenixIMG {
+    class OpenixFileIO;
+
+    /**
+     * @brief Size of a partition table sector in bytes.
+     */
+    constexpr uint64_t PARTITION_SECTOR_SIZE = 512;
+
+    /**
+     * @brief Sector where Allwinner places the logical partition area on eMMC and SD cards (20 MiB).
+     */
+    constexpr uint64_t SUNXI_LOGICAL_OFFSET = 40960;
+
     /**
      * @struct Partition
      * @brief Structure to store partition information.
@@ -38,6 +51,33 @@ namespace OpenixIMG {
         }
     };
 
+    /**
+     * @struct PartitionExtent
+     * @brief Placement of a partition on a disk.
+     */
+    struct PartitionExtent {
+        std::string name; ///< Partition name
+        uint64_t firstSector; ///< First sector (LBA) of the partition
+        uint64_t sectorCount; ///< Number of sectors
+    };
+
+    /**
+     * @struct GptOptions
+     * @brief Parameters of the disk a GPT is generated for.
+     */
+    struct GptOptions {
+        uint64_t logicalOffset = SUNXI_LOGICAL_OFFSET; ///< Sector where the MBR region and partitions begin
+        uint64_t diskSectors = 0; ///< Disk size in sectors, 0 to end the disk right after the last partition
+    };
+
+    /**
+     * @brief Streams the contents of a partition into a sink.
+     *
+     * Called once per partition; partitions without contents simply return without calling the sink.
+     */
+    using PartitionContentSource = std::function<void(const Partition &partition,
+                                                      const std::function<void(const uint8_t *, size_t)> &sink)>;
+
     /**
      * @class OpenixPartition
      * @brief Class to parse and manage partition table information from sys_partition.fex files.
@@ -113,7 +153,66 @@ namespace OpenixIMG {
          */
         [[nodiscard]] std::string dumpToJson() const;
 
+        /**
+         * @brief Compute where each partition lives on a disk.
+         *
+         * The first partition starts mbrSize KB after the logical offset and the others follow
+         * back to back. A trailing partition of size 0 (such as UDISK) takes the rest of the disk.
+         *
+         * @param options Disk parameters.
+         * @return One extent per partition, in table order.
+         * @throw std::runtime_error if the partitions do not fit the disk or overlap the GPT.
+         */
+        [[nodiscard]] std::vector<PartitionExtent> computeLayout(const GptOptions &options = {}) const;
+
+        /**
+         * @brief Write a GPT describing the partition table into a raw disk image.
+         *
+         * Writes the protective MBR, the primary header and entry array at the start of the image
+         * and the backup copies at its end, resizing the image to the disk size. Other regions of
+         * the image are left untouched.
+         *
+         * @param image Image opened for writing.
+         * @param options Disk parameters.
+         * @throw std::runtime_error if the layout is invalid or writing fails.
+         */
+        void writeGpt(const OpenixFileIO &image, const GptOptions &options = {}) const;
+
+        /**
+         * @brief Write a GPT into a raw disk image file, creating it if needed.
+         * @param imagePath Path to the disk image.
+         * @param options Disk parameters.
+         * @throw std::runtime_error if the layout is invalid or writing fails.
+         */
+        void writeGpt(const std::string &imagePath, const GptOptions &options = {}) const;
+
+        /**
+         * @brief Render the flash layout of a disk as an Android sparse image.
+         *
+         * The image holds the GPT and the contents of every partition at its place on the disk.
+         * Regions no partition content covers are DONT_CARE, so the image is roughly as large as
+         * the data it carries.
+         *
+         * @param imagePath Path of the sparse image to create.
+         * @param options Disk parameters.
+         * @param source Provides partition contents, or empty for a GPT-only image.
+         * @param zeroAsDontCare Also emit zero blocks inside partition contents as DONT_CARE.
+         * @throw std::runtime_error if the layout is invalid, contents exceed a partition or writing fails.
+         */
+        void writeSparseDisk(const std::string &imagePath, const GptOptions &options = {},
+                             const PartitionContentSource &source = {}, bool zeroAsDontCare = false) const;
+
     private:
+        /**
+         * @brief Build the GPT structures for a disk.
+         * @param options Disk parameters.
+         * @param head Receives the protective MBR, primary header and entry array (start of the disk).
+         * @param tail Receives the backup entry array and header (end of the disk).
+         * @return Disk size in sectors.
+         * @throw std::runtime_error if the layout is invalid.
+         */
+        uint64_t buildGpt(const GptOptions &options, std::vector<uint8_t> &head, std::vector<uint8_t> &tail) const;
+
         uint32_t mbrSize; ///< MBR size in KB
         std::vector<Partition> partitions; ///< List of partitions
 
@@ -0,0 +1,119 @@
+/**
+ * @file OpenixPlanner.hpp
+ * @brief I/O and compute plans of image operations, built without touching payload data
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#ifndef OPENIXIMG_OPENIXPLANNER_HPP
+#define OPENIXIMG_OPENIXPLANNER_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace OpenixIMG {
+    /**
+     * @struct PlanStep
+     * @brief Work of one step of an operation (one entry, or one fixed stage such as the header table)
+     */
+    struct PlanStep {
+        std::string name; //!< Entry file name or stage name
+        uint64_t readBytes = 0; //!< Bytes read from storage
+        uint64_t writeBytes = 0; //!< Bytes written to storage
+        uint64_t decryptBytes = 0; //!< Bytes passed through RC6 decryption
+        uint64_t encryptBytes = 0; //!< Bytes passed through RC6 encryption
+        uint64_t readOps = 0; //!< Number of read calls
+        uint64_t writeOps = 0; //!< Number of write calls
+        uint64_t bufferBytes = 0; //!< Largest buffer held while the step runs
+    };
+
+    /**
+     * @struct OperationPlan
+     * @brief Steps an operation would execute, in execution order
+     */
+    struct OperationPlan {
+        std::string operation; //!< Operation name ("unpack" or "pack")
+        std::string source; //!< Input image or configuration
+        bool encrypted = false; //!< Whether payloads are decrypted or encrypted
+        std::vector<PlanStep> steps; //!< Steps in execution order
+
+        /**
+         * @brief Sum the steps of the plan
+         *
+         * @return A step named "total" holding the summed counters and the largest buffer
+         */
+        [[nodiscard]] PlanStep total() const;
+    };
+
+    /**
+     * @struct HostClass
+     * @brief Throughput model of a class of machines used for time estimates
+     */
+    struct HostClass {
+        std::string name; //!< Class name
+        double readBandwidth = 0; //!< Sequential read bandwidth in bytes per second
+        double writeBandwidth = 0; //!< Sequential write bandwidth in bytes per second
+        double cryptBandwidth = 0; //!< Single-core RC6 bandwidth in bytes per second
+        double opLatency = 0; //!< Fixed cost of one I/O call in seconds
+    };
+
+    /**
+     * @class OpenixPlanner
+     * @brief Estimates and renders operation plans
+     *
+     * Plans themselves are produced by OpenixPacker::planUnpack and OpenixPacker::planPack,
+     * next to the code they describe. The time model follows the current implementation:
+     * entries are processed one after another and each is read, transformed and written in
+     * turn, so the costs of a step add up rather than overlap.
+     */
+    class OpenixPlanner {
+    public:
+        /**
+         * @brief Built-in host classes
+         *
+         * The figures are conservative ballpark values for a desktop SSD, an NVMe server,
+         * a single spinning disk and a gigabit network share.
+         *
+         * @return The host classes
+         */
+        static const std::vector<HostClass> &defaultHostClasses();
+
+        /**
+         * @brief Parse a host class from "name:readMB/s:writeMB/s:cryptMB/s[:latency_us]"
+         *
+         * @param spec Host class description
+         * @return The parsed host class
+         * @throw std::runtime_error if the description is malformed
+         */
+        static HostClass parseHostClass(const std::string &spec);
+
+        /**
+         * @brief Estimate the wall-clock time of a plan on a host class
+         *
+         * @param plan Plan to estimate
+         * @param host Host class to run it on
+         * @return Estimated seconds
+         */
+        static double estimateSeconds(const OperationPlan &plan, const HostClass &host);
+
+        /**
+         * @brief Render a plan as a human-readable report
+         *
+         * @param plan Plan to render
+         * @param hosts Host classes to estimate the run time for
+         * @return The report
+         */
+        static std::string dumpToString(const OperationPlan &plan, const std::vector<HostClass> &hosts);
+
+        /**
+         * @brief Render a plan as a JSON document
+         *
+         * @param plan Plan to render
+         * @param hosts Host classes to estimate the run time for
+         * @return The JSON text
+         */
+        static std::string dumpToJson(const OperationPlan &plan, const std::vector<HostClass> &hosts);
+    };
+} // namespace OpenixIMG
+
+#endif // OPENIXIMG_OPENIXPLANNER_HPP
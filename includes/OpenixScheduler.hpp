@@ -0,0 +1,163 @@
+/**
+ * @file OpenixScheduler.hpp
+ * @brief Priority classes for the chunk-sized I/O and cipher tasks of the library
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#ifndef OPENIXIMG_OPENIXSCHEDULER_HPP
+#define OPENIXIMG_OPENIXSCHEDULER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace OpenixIMG {
+    /**
+     * @brief Scheduling class of a task
+     */
+    enum class Priority : uint8_t {
+        INTERACTIVE, //!< Small latency-sensitive reads, such as sys_partition.fex or a file of a filesystem entry
+        BULK, //!< Streaming whole entries: unpack, pack, flash
+    };
+
+    /**
+     * @struct SchedulerStats
+     * @brief Totals of one priority class since the last reset
+     */
+    struct SchedulerStats {
+        uint64_t tasks = 0; //!< Completed tasks
+        uint64_t bytes = 0; //!< Bytes processed by them
+        uint64_t waitNanoseconds = 0; //!< Time spent waiting for a slot
+        uint64_t runNanoseconds = 0; //!< Time spent holding a slot
+        uint64_t maxWaitNanoseconds = 0; //!< Longest single wait
+    };
+
+    /**
+     * @class OpenixScheduler
+     * @brief Process-wide admission control for reads, cipher work and writes
+     *
+     * Every chunk read, decrypted, encrypted or written by the library runs as a task that
+     * holds one of a fixed number of slots (by default one per hardware thread plus one). Bulk
+     * operations are split into chunk-sized tasks, so they give way between chunks:
+     * bulk tasks are never admitted while an interactive task is waiting, and they leave
+     * one slot free for interactive tasks. An interactive read therefore waits for at most
+     * one chunk, however many bulk jobs are running.
+     *
+     * Library calls that stream whole entries run as BULK and the small reads (whole entries,
+     * byte ranges) run as INTERACTIVE, unless a PriorityScope on the calling thread says
+     * otherwise. Per-class waits, latencies and throughput are kept in stats() and, when
+     * metrics are enabled, in OpenixMetrics.
+     */
+    class OpenixScheduler {
+    public:
+        /**
+         * @class Task
+         * @brief Holds a slot for the lifetime of a scope
+         *
+         * Tasks must not nest on one thread: release the slot before calling out to code that
+         * may start another task.
+         */
+        class Task {
+        public:
+            /**
+             * @brief Wait for a slot
+             *
+             * @param priority Class of the task
+             */
+            explicit Task(Priority priority);
+
+            /**
+             * @brief Release the slot and account the task to its class
+             */
+            ~Task();
+
+            Task(const Task &) = delete;
+
+            Task &operator=(const Task &) = delete;
+
+            /**
+             * @brief Count bytes processed by the task, for throughput
+             *
+             * @param bytes Number of bytes
+             */
+            void addBytes(uint64_t bytes);
+
+        private:
+            Priority priority_; //!< Class of the task
+            uint64_t bytes_ = 0; //!< Bytes processed
+            std::chrono::steady_clock::time_point queued_; //!< When the task started waiting
+            std::chrono::steady_clock::time_point admitted_; //!< When the task got its slot
+        };
+
+        /**
+         * @class PriorityScope
+         * @brief Overrides the class of the library calls made by this thread for a scope
+         */
+        class PriorityScope {
+        public:
+            /**
+             * @brief Run this thread's library calls with a priority
+             *
+             * @param priority Class to use
+             */
+            explicit PriorityScope(Priority priority);
+
+            /**
+             * @brief Restore the previous class
+             */
+            ~PriorityScope();
+
+            PriorityScope(const PriorityScope &) = delete;
+
+            PriorityScope &operator=(const PriorityScope &) = delete;
+
+        private:
+            std::optional<Priority> previous_; //!< Override in effect before this scope
+        };
+
+        /**
+         * @brief Class for a library call made by this thread
+         *
+         * @param fallback Class of the call when no PriorityScope is active
+         * @return The class of the innermost PriorityScope, or the fallback
+         */
+        static Priority currentPriority(Priority fallback);
+
+        /**
+         * @brief Set the number of tasks that may run at the same time
+         *
+         * @param slots Slot count, 0 for one per hardware thread plus one
+         */
+        static void setSlots(unsigned slots);
+
+        /**
+         * @brief Number of tasks that may run at the same time
+         *
+         * @return The slot count
+         */
+        static unsigned slots();
+
+        /**
+         * @brief Totals of a class
+         *
+         * @param priority Class to report
+         * @return Snapshot of its totals
+         */
+        static SchedulerStats stats(Priority priority);
+
+        /**
+         * @brief Clear the totals of all classes
+         */
+        static void resetStats();
+
+        /**
+         * @brief Summarize the totals of all classes, one line per class
+         *
+         * @return Tasks, bytes, throughput and mean and maximum waits of each class
+         */
+        static std::string dumpToString();
+    };
+} // namespace OpenixIMG
+
+#endif // OPENIXIMG_OPENIXSCHEDULER_HPP
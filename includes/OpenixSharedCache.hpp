@@ -0,0 +1,128 @@
+/**
+ * @file OpenixSharedCache.hpp
+ * @brief Cross-process cache of decrypted entries in POSIX shared memory
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#ifndef OPENIXIMG_OPENIXSHAREDCACHE_HPP
+#define OPENIXIMG_OPENIXSHAREDCACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace OpenixIMG {
+    /**
+     * @struct SharedCacheStats
+     * @brief Counters kept in the shared segment, summed over all attached processes
+     */
+    struct SharedCacheStats {
+        uint64_t hits = 0; //!< Successful lookups
+        uint64_t misses = 0; //!< Failed lookups
+        uint64_t insertions = 0; //!< Entries stored
+        uint64_t evictions = 0; //!< Entries dropped to make room
+        uint32_t entries = 0; //!< Entries currently stored
+        uint64_t usedBytes = 0; //!< Payload bytes currently stored
+    };
+
+    /**
+     * @class OpenixSharedCache
+     * @brief Decrypted entries shared by all processes that attach to the same named segment
+     *
+     * Entries are keyed by the image fingerprint (see OpenixIMGFile::getFingerprint) and the
+     * entry index. The segment holds a fixed slot table and a data area of fixed size; when
+     * an entry does not fit, the least recently used entries are evicted until it does.
+     *
+     * All access goes through a process-shared mutex that lives in the segment. On Linux the
+     * mutex is robust: if a process dies while holding it, the next process to lock it takes
+     * over. Entries are copied in and out while the lock is held and only published once
+     * complete, so a crash never leaves a partially written entry visible.
+     *
+     * Only POSIX systems are supported; elsewhere the constructor throws.
+     */
+    class OpenixSharedCache {
+    public:
+        /**
+         * @brief Name of the segment used when none is given
+         */
+        static constexpr const char *DEFAULT_NAME = "/openiximg-cache";
+
+        /**
+         * @brief Attach to a segment, creating it if it does not exist
+         *
+         * The capacity only applies when the segment is created; an existing segment keeps
+         * its size.
+         *
+         * @param name Segment name, starting with '/'
+         * @param capacity Size of the data area in bytes
+         * @throw std::runtime_error if the segment cannot be created or attached
+         */
+        OpenixSharedCache(const std::string &name, uint64_t capacity);
+
+        /**
+         * @brief Detach from the segment; the segment itself persists until unlinked
+         */
+        ~OpenixSharedCache();
+
+        OpenixSharedCache(const OpenixSharedCache &) = delete;
+
+        OpenixSharedCache &operator=(const OpenixSharedCache &) = delete;
+
+        /**
+         * @brief Copy a cached entry
+         *
+         * @param fingerprint Image fingerprint
+         * @param index Entry index in the image
+         * @param data Receives the entry data on success
+         * @return True if the entry was cached
+         */
+        bool lookup(uint64_t fingerprint, uint32_t index, std::vector<uint8_t> &data) const;
+
+        /**
+         * @brief Store an entry, evicting least recently used entries as needed
+         *
+         * @param fingerprint Image fingerprint
+         * @param index Entry index in the image
+         * @param data Entry data
+         * @param length Entry length in bytes
+         * @return True if the entry is cached afterwards, false if it cannot fit
+         */
+        bool insert(uint64_t fingerprint, uint32_t index, const void *data, size_t length);
+
+        /**
+         * @brief Size of the data area
+         *
+         * @return Capacity in bytes
+         */
+        [[nodiscard]] uint64_t capacity() const;
+
+        /**
+         * @brief Read the shared counters
+         *
+         * @return A snapshot of the counters
+         */
+        [[nodiscard]] SharedCacheStats stats() const;
+
+        /**
+         * @brief Remove a segment name; attached processes keep their mapping
+         *
+         * @param name Segment name
+         * @return True if the name existed
+         */
+        static bool unlink(const std::string &name);
+
+    private:
+        struct Segment;
+
+        /**
+         * @brief RAII lock of the segment mutex, recovering it from dead owners
+         */
+        class Lock;
+
+        Segment *segment_; //!< Mapped segment
+        size_t mappedSize_; //!< Size of the mapping
+    };
+} // namespace OpenixIMG
+
+#endif // OPENIXIMG_OPENIXSHAREDCACHE_HPP
@@ -0,0 +1,138 @@
+/**
+ * @file OpenixSparseWriter.hpp
+ * @brief Streaming writer for Android sparse images
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#ifndef OPENIXIMG_OPENIXSPARSEWRITER_HPP
+#define OPENIXIMG_OPENIXSPARSEWRITER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "OpenixFileIO.hpp"
+
+namespace OpenixIMG {
+    /**
+     * @class OpenixSparseWriter
+     * @brief Converts a byte stream into an Android sparse image as it arrives
+     *
+     * Data is split into blocks. Runs of blocks that repeat one 32-bit value become FILL
+     * chunks, other runs become RAW chunks written straight from the caller's buffer, and
+     * regions passed to skip() become DONT_CARE chunks. Chunk headers are patched in place
+     * once a run ends, so nothing beyond one partial block is buffered.
+     *
+     * The output can be flashed with fastboot or expanded with simg2img.
+     */
+    class OpenixSparseWriter {
+    public:
+        /**
+         * @brief Block size used by fastboot and img2simg
+         */
+        static constexpr uint32_t DEFAULT_BLOCK_SIZE = 4096;
+
+        /**
+         * @brief Create a sparse image
+         *
+         * @param path Output file, truncated if it exists
+         * @param blockSize Block size, a multiple of 4
+         * @param zeroAsDontCare Emit zero blocks as DONT_CARE instead of FILL; only safe when the target is erased
+         * @throw std::runtime_error if the file cannot be created or the block size is invalid
+         */
+        explicit OpenixSparseWriter(const std::string &path, uint32_t blockSize = DEFAULT_BLOCK_SIZE,
+                                    bool zeroAsDontCare = false);
+
+        OpenixSparseWriter(const OpenixSparseWriter &) = delete;
+
+        OpenixSparseWriter &operator=(const OpenixSparseWriter &) = delete;
+
+        /**
+         * @brief Append data
+         *
+         * @param data Data to append
+         * @param length Number of bytes
+         */
+        void write(const void *data, size_t length);
+
+        /**
+         * @brief Append a region whose contents do not matter
+         *
+         * A partial block at either end of the region is written as zeros.
+         *
+         * @param length Number of bytes
+         */
+        void skip(uint64_t length);
+
+        /**
+         * @brief Pad the last block with zeros and write the file header
+         *
+         * Must be called once all data has been appended; an unfinished file is not a valid image.
+         */
+        void finish();
+
+        /**
+         * @brief Number of bytes appended so far
+         *
+         * @return The expanded size of the image
+         */
+        [[nodiscard]] uint64_t size() const;
+
+        /**
+         * @brief Number of chunks emitted so far
+         *
+         * @return The chunk count
+         */
+        [[nodiscard]] uint32_t chunkCount() const;
+
+    private:
+        /**
+         * @brief Android sparse chunk types
+         */
+        enum class ChunkType : uint16_t {
+            RAW = 0xCAC1,
+            FILL = 0xCAC2,
+            DONT_CARE = 0xCAC3,
+        };
+
+        /**
+         * @brief Append whole blocks, classifying each one
+         *
+         * @param data First block
+         * @param blocks Number of blocks
+         */
+        void addBlocks(const uint8_t *data, uint64_t blocks);
+
+        /**
+         * @brief Extend the open chunk or start a new one
+         *
+         * @param type Chunk type
+         * @param fillValue Fill value for FILL chunks
+         * @param data Block data for RAW chunks
+         * @param blocks Number of blocks
+         */
+        void appendRun(ChunkType type, uint32_t fillValue, const uint8_t *data, uint64_t blocks);
+
+        /**
+         * @brief Write the header of the open chunk
+         */
+        void closeChunk();
+
+        OpenixFileIO file_; //!< Output file
+        uint32_t blockSize_; //!< Block size in bytes
+        bool zeroAsDontCare_; //!< Whether zero blocks become DONT_CARE
+        std::vector<uint8_t> pending_; //!< Partial block awaiting more data
+        uint64_t totalBlocks_ = 0; //!< Blocks in closed and open chunks
+        uint32_t totalChunks_ = 0; //!< Closed chunks
+        uint64_t writeOffset_; //!< Next free file offset
+        bool chunkOpen_ = false; //!< Whether a chunk is open
+        ChunkType chunkType_ = ChunkType::RAW; //!< Type of the open chunk
+        uint32_t chunkFill_ = 0; //!< Fill value of the open chunk
+        uint64_t chunkBlocks_ = 0; //!< Blocks in the open chunk
+        uint64_t chunkOffset_ = 0; //!< File offset of the open chunk's header
+        bool finished_ = false; //!< Whether finish() has run
+    };
+} // namespace OpenixIMG
+
+#endif // OPENIXIMG_OPENIXSPARSEWRITER_HPP
@@ -0,0 +1,157 @@
+/**
+ * @file OpenixTOC1.hpp
+ * @brief Parser for Allwinner TOC1 containers such as boot_package.fex
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#ifndef OPENIXIMG_OPENIXTOC1_HPP
+#define OPENIXIMG_OPENIXTOC1_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "OpenixIMGFile.hpp"
+
+namespace OpenixIMG {
+    /**
+     * @struct Toc1Item
+     * @brief One item of the TOC1 item table
+     */
+    struct Toc1Item {
+        std::string name; //!< Item name, e.g. "u-boot", "monitor", "scp", "optee" or "dtb"
+        uint32_t offset = 0; //!< Offset of the item data in the package
+        uint32_t length = 0; //!< Length of the item data
+        uint32_t encrypt = 0; //!< Non-zero if the item is encrypted by the boot ROM tooling
+        uint32_t type = 0; //!< Item type
+        uint32_t runAddress = 0; //!< Load address
+        uint32_t index = 0; //!< Item index as stored
+    };
+
+    /**
+     * @struct Toc1Checksum
+     * @brief Result of a checksum verification
+     */
+    struct Toc1Checksum {
+        bool present = false; //!< Whether the data carries a checksum this parser understands
+        bool valid = false; //!< Whether the stored checksum matches
+        uint32_t stored = 0; //!< Checksum stored in the data
+        uint32_t computed = 0; //!< Checksum computed over the data
+    };
+
+    /**
+     * @class OpenixTOC1
+     * @brief Lists, extracts and verifies the items of a TOC1 package
+     *
+     * Only the 64-byte package header and the item table are read when the package is
+     * opened; item data is read on demand, so extracting or verifying one item never
+     * touches the others.
+     *
+     * Checksums use the Allwinner scheme: the 32-bit little-endian words of the data are
+     * summed with the checksum word itself replaced by the stamp value 0x5F0A6C39. The
+     * package checksum covers the whole package; items carry their own checksum only when
+     * they start with a u-boot or eGON boot header.
+     */
+    class OpenixTOC1 {
+    public:
+        /**
+         * @brief Reads bytes of the package: (offset, destination, length) -> bytes read
+         */
+        using RangeReader = std::function<size_t(uint64_t offset, void *data, size_t length)>;
+
+        /**
+         * @brief Open a package through a range reader
+         *
+         * @param reader Reads bytes of the package
+         * @throw std::runtime_error if the header or the item table is invalid
+         */
+        explicit OpenixTOC1(RangeReader reader);
+
+        /**
+         * @brief Open a package stored in an image entry
+         *
+         * The image must stay loaded while the parser is used; its file is opened once and kept open.
+         *
+         * @param image Loaded image
+         * @param index Index into getFileList() of the entry holding the package
+         * @throw std::runtime_error if the entry does not hold a TOC1 package
+         */
+        OpenixTOC1(const OpenixIMGFile &image, size_t index);
+
+        /**
+         * @brief Items of the package in table order
+         *
+         * @return The item table
+         */
+        [[nodiscard]] const std::vector<Toc1Item> &items() const;
+
+        /**
+         * @brief Find an item by name
+         *
+         * @param name Item name
+         * @return The first item with this name, or std::nullopt
+         */
+        [[nodiscard]] std::optional<Toc1Item> find(const std::string &name) const;
+
+        /**
+         * @brief Length of the package covered by the package checksum
+         *
+         * @return Length in bytes
+         */
+        [[nodiscard]] uint32_t validLength() const;
+
+        /**
+         * @brief Stream the data of an item
+         *
+         * @param item Item from items() or find()
+         * @param sink Receives the item data in order
+         * @return Number of bytes delivered
+         */
+        uint64_t extract(const Toc1Item &item, const OpenixIMGFile::ChunkSink &sink) const;
+
+        /**
+         * @brief Verify the checksum of the whole package
+         *
+         * @return The verification result; the package checksum is always present
+         */
+        [[nodiscard]] Toc1Checksum verifyPackage() const;
+
+        /**
+         * @brief Verify the checksum of an item's own boot header
+         *
+         * @param item Item from items() or find()
+         * @return The verification result, with present cleared for items without a boot header
+         */
+        [[nodiscard]] Toc1Checksum verifyItem(const Toc1Item &item) const;
+
+    private:
+        /**
+         * @brief Read bytes of the package, failing on short reads
+         *
+         * @param offset Package offset
+         * @param data Destination
+         * @param length Number of bytes
+         */
+        void readExact(uint64_t offset, void *data, size_t length) const;
+
+        /**
+         * @brief Sum the words of a range with the checksum word replaced by the stamp
+         *
+         * @param offset Start of the range
+         * @param length Length of the range
+         * @param checksumOffset Offset of the checksum word in the range
+         * @return The checksum
+         */
+        [[nodiscard]] uint32_t checksum(uint64_t offset, uint32_t length, uint32_t checksumOffset) const;
+
+        RangeReader reader_; //!< Reads bytes of the package
+        uint32_t storedChecksum_ = 0; //!< Package checksum from the header
+        uint32_t validLength_ = 0; //!< Length covered by the package checksum
+        std::vector<Toc1Item> items_; //!< Item table
+    };
+} // namespace OpenixIMG
+
+#endif // OPENIXIMG_OPENIXTOC1_HPP
@@ -0,0 +1,92 @@
+/**
+ * @file OpenixTarReader.hpp
+ * @brief Forward-only reader for tar streams used as packing input
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#ifndef OPENIXIMG_OPENIXTARREADER_HPP
+#define OPENIXIMG_OPENIXTARREADER_HPP
+
+#include <cstdint>
+#include <istream>
+#include <string>
+
+namespace OpenixIMG {
+    /**
+     * @class OpenixTarReader
+     * @brief Reads regular file members from a (possibly non-seekable) tar stream
+     *
+     * Understands ustar, GNU long names and base-256 sizes, and PAX path/size records.
+     * Only the current member's data is ever buffered by the caller, so arbitrarily large
+     * archives can be consumed from a pipe.
+     */
+    class OpenixTarReader {
+    public:
+        /**
+         * @struct Member
+         * @brief Description of a regular file member in the archive
+         */
+        struct Member {
+            std::string name; //!< Member path with leading "./" and "/" removed
+            uint64_t size; //!< Size of the member data in bytes
+        };
+
+        /**
+         * @brief Constructor
+         *
+         * @param stream Input stream positioned at the start of the archive
+         */
+        explicit OpenixTarReader(std::istream &stream);
+
+        /**
+         * @brief Advance to the next regular file member
+         *
+         * Any unread data of the current member is skipped.
+         *
+         * @param member Receives the description of the next member
+         * @return True if a member was found, false at the end of the archive
+         * @throw std::runtime_error on a malformed or truncated archive
+         */
+        bool next(Member &member);
+
+        /**
+         * @brief Read data of the current member
+         *
+         * @param data Destination buffer
+         * @param length Maximum number of bytes to read
+         * @return Number of bytes read, 0 once the member is exhausted
+         * @throw std::runtime_error if the stream ends inside the member
+         */
+        size_t read(uint8_t *data, size_t length);
+
+    private:
+        /**
+         * @brief Read and discard bytes from the stream
+         *
+         * @param length Number of bytes to skip
+         */
+        void skip(uint64_t length);
+
+        /**
+         * @brief Read the full data of the current member as a string (for metadata records)
+         *
+         * @return The member data
+         */
+        std::string readAll();
+
+        /**
+         * @brief Parse an octal or base-256 numeric header field
+         *
+         * @param field Pointer to the field
+         * @param length Length of the field
+         * @return The parsed value
+         */
+        static uint64_t parseNumber(const char *field, size_t length);
+
+        std::istream &stream_; //!< Underlying archive stream
+        uint64_t remaining_; //!< Unread data bytes of the current member
+        uint64_t padding_; //!< Padding after the current member's data
+    };
+} // namespace OpenixIMG
+
+#endif // OPENIXIMG_OPENIXTARREADER_HPP
@@ -0,0 +1,160 @@
+/**
+ * @file OpenixUBootEnv.hpp
+ * @brief Parser and in-place editor for u-boot environment images such as env.fex
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#ifndef OPENIXIMG_OPENIXUBOOTENV_HPP
+#define OPENIXIMG_OPENIXUBOOTENV_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "OpenixIMGFile.hpp"
+
+namespace OpenixIMG {
+    /**
+     * @class OpenixUBootEnv
+     * @brief Reads, modifies and writes back the variables of a u-boot environment
+     *
+     * An environment image is a little-endian CRC-32 of the data area, an optional flags
+     * byte for redundant environments, and the data area: NUL-terminated "name=value"
+     * strings ending with an empty string, padded to the size of the image. The layout is
+     * detected from which data area the stored CRC matches.
+     *
+     * Changes are written back by comparing the new image with the one that was loaded, so
+     * only the CRC and the spans that actually differ are rewritten. Variables keep their
+     * order; new variables are appended.
+     */
+    class OpenixUBootEnv {
+    public:
+        /**
+         * @brief Writes bytes of the environment: (offset, source, length)
+         */
+        using RangeWriter = std::function<void(uint64_t offset, const void *data, size_t length)>;
+
+        /**
+         * @brief Parse an environment image
+         *
+         * @param image The whole environment image
+         * @throw std::runtime_error if the CRC matches neither layout
+         */
+        explicit OpenixUBootEnv(std::vector<uint8_t> image);
+
+        /**
+         * @brief Parse the environment stored in an image entry
+         *
+         * @param image Loaded image
+         * @param index Index into getFileList() of the entry holding the environment
+         * @throw std::runtime_error if the entry does not hold an environment
+         */
+        OpenixUBootEnv(const OpenixIMGFile &image, size_t index);
+
+        /**
+         * @brief Whether the image has the flags byte of a redundant environment
+         *
+         * @return True for redundant environments
+         */
+        [[nodiscard]] bool isRedundant() const;
+
+        /**
+         * @brief Size of the environment image
+         *
+         * @return Size in bytes, including the header
+         */
+        [[nodiscard]] size_t size() const;
+
+        /**
+         * @brief Variables in environment order
+         *
+         * @return Name and value pairs
+         */
+        [[nodiscard]] const std::vector<std::pair<std::string, std::string> > &variables() const;
+
+        /**
+         * @brief Value of a variable
+         *
+         * @param name Variable name
+         * @return The value, or std::nullopt if the variable is not set
+         */
+        [[nodiscard]] std::optional<std::string> get(const std::string &name) const;
+
+        /**
+         * @brief Set a variable, appending it if it is not set yet
+         *
+         * @param name Variable name, without '=' or NUL
+         * @param value New value, without NUL
+         * @throw std::runtime_error if the name or value cannot be stored
+         */
+        void set(const std::string &name, const std::string &value);
+
+        /**
+         * @brief Remove a variable
+         *
+         * @param name Variable name
+         * @return True if the variable was set
+         */
+        bool remove(const std::string &name);
+
+        /**
+         * @brief Build the environment image with the current variables and a fresh CRC
+         *
+         * Bytes past the new end of the variables keep their loaded values where the old
+         * variables did not reach, and are filled with the padding byte elsewhere.
+         *
+         * @return The environment image, as large as the loaded one
+         * @throw std::runtime_error if the variables do not fit
+         */
+        [[nodiscard]] std::vector<uint8_t> serialize() const;
+
+        /**
+         * @brief Write the changes since loading or the last commit
+         *
+         * The target must still hold the image this environment was loaded from.
+         *
+         * @param writer Writes bytes of the environment image
+         * @return Number of bytes written
+         * @throw std::runtime_error if the variables do not fit
+         */
+        uint64_t commit(const RangeWriter &writer);
+
+        /**
+         * @brief Write the changes back to the image entry the environment was read from
+         *
+         * @param image Loaded image
+         * @param index Index into getFileList() of the entry
+         * @return Number of bytes written
+         * @throw std::runtime_error if the variables do not fit
+         */
+        uint64_t commit(OpenixIMGFile &image, size_t index);
+
+    private:
+        /**
+         * @brief Check the stored CRC against a data area
+         *
+         * @param dataOffset Offset of the data area
+         * @return True if the CRC matches
+         */
+        [[nodiscard]] bool crcMatches(size_t dataOffset) const;
+
+        /**
+         * @brief Bytes the current variables take in the data area
+         *
+         * @return Length of all "name=value" strings plus the terminating empty string
+         */
+        [[nodiscard]] size_t contentLength() const;
+
+        std::vector<uint8_t> image_; //!< Environment image as last loaded or committed
+        size_t dataOffset_ = 0; //!< Offset of the data area: 4, or 5 with a flags byte
+        size_t usedEnd_ = 0; //!< End of the loaded variables, including the terminating empty string
+        uint8_t padding_ = 0; //!< Byte filling the data area after the variables
+        std::vector<std::pair<std::string, std::string> > variables_; //!< Variables in order
+    };
+} // namespace OpenixIMG
+
+#endif // OPENIXIMG_OPENIXUBOOTENV_HPP
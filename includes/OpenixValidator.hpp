@@ -0,0 +1,115 @@
+/**
+ * @file OpenixValidator.hpp
+ * @brief Header-only structural validation of IMAGEWTY images
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#ifndef OPENIXIMG_OPENIXVALIDATOR_HPP
+#define OPENIXIMG_OPENIXVALIDATOR_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace OpenixIMG {
+    /**
+     * @struct ValidationIssue
+     * @brief One structural problem of an image
+     */
+    struct ValidationIssue {
+        std::string entry; //!< File name of the entry concerned, empty for the image as a whole
+        std::string message; //!< What is wrong
+    };
+
+    /**
+     * @struct PayloadGap
+     * @brief Byte range after the header table that no entry references
+     */
+    struct PayloadGap {
+        uint64_t offset = 0; //!< First unreferenced byte
+        uint64_t length = 0; //!< Number of bytes
+    };
+
+    /**
+     * @struct ValidationReport
+     * @brief Result of validating one image
+     */
+    struct ValidationReport {
+        std::string path; //!< Image file
+        uint64_t fileSize = 0; //!< Size of the file
+        bool encrypted = false; //!< Whether the headers were encrypted
+        uint32_t headerVersion = 0; //!< header_version of the image header
+        uint32_t numFiles = 0; //!< num_files of the image header
+        std::vector<ValidationIssue> errors; //!< Problems that make the image unusable
+        std::vector<PayloadGap> gaps; //!< Unreferenced ranges in offset order, including padding between payloads
+
+        /**
+         * @brief Check whether the image passed every check
+         *
+         * Gaps alone do not make an image invalid; aligned payloads leave some by design.
+         *
+         * @return True if there are no errors
+         */
+        [[nodiscard]] bool valid() const;
+
+        /**
+         * @brief Total size of the gaps
+         *
+         * @return Unreferenced bytes
+         */
+        [[nodiscard]] uint64_t gapBytes() const;
+    };
+
+    /**
+     * @class OpenixValidator
+     * @brief Checks that an image is well formed without reading any payload
+     *
+     * Only the image header and the file header table are read and, for encrypted images,
+     * decrypted, so an image of any size is checked in a few milliseconds. The checks are:
+     * the header decrypts to the IMAGEWTY magic, header_version is known and header_size
+     * matches it, num_files is plausible and the table fits the file, every file name is
+     * terminated and unique, original_length does not exceed stored_length, and every
+     * payload lies after the table, within the file and clear of every other payload.
+     * Unreferenced ranges are reported as gaps.
+     *
+     * Errors are collected rather than thrown, so one pass reports everything wrong with an
+     * image, and a damaged image never causes a large allocation.
+     */
+    class OpenixValidator {
+    public:
+        /**
+         * @brief Validate one image
+         *
+         * @param path Image file
+         * @return The report; a missing or unreadable file is reported as an error
+         */
+        static ValidationReport validate(const std::string &path);
+
+        /**
+         * @brief Validate many images in parallel
+         *
+         * @param paths Image files
+         * @param threads Images validated at the same time, 0 for one per hardware thread
+         * @return One report per image, in the order of paths
+         */
+        static std::vector<ValidationReport> validateAll(const std::vector<std::string> &paths, unsigned threads = 0);
+
+        /**
+         * @brief Render reports as text, one summary line per image followed by its errors and gaps
+         *
+         * @param reports Reports to render
+         * @return The text
+         */
+        static std::string dumpToString(const std::vector<ValidationReport> &reports);
+
+        /**
+         * @brief Render reports as a JSON array
+         *
+         * @param reports Reports to render
+         * @return The JSON text
+         */
+        static std::string dumpToJson(const std::vector<ValidationReport> &reports);
+    };
+} // namespace OpenixIMG
+
+#endif // OPENIXIMG_OPENIXVALIDATOR_HPP
@@ -0,0 +1,308 @@
+/**
+ * @file OpenixBench.cpp
+ * @brief Implementation of OpenixBench class methods
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "OpenixBench.hpp"
+#include "OpenixCFGJson.hpp"
+#include "OpenixFileIO.hpp"
+#include "OpenixIMGFile.hpp"
+#include "OpenixPacker.hpp"
+
+using namespace OpenixIMG;
+namespace fs = std::filesystem;
+
+namespace {
+    // Buffer size of the I/O test and per-thread buffer of the cipher tests
+    constexpr size_t BENCH_BUFFER_SIZE = 1024 * 1024;
+
+    // Number of payload files of the synthetic image
+    constexpr unsigned BENCH_IMAGE_ENTRIES = 4;
+
+    // Reference host of BenchReport::score, in bytes per second
+    constexpr double REFERENCE_CRYPT = 100e6;
+    constexpr double REFERENCE_DISK = 200e6;
+    constexpr double REFERENCE_IMAGE = 50e6;
+
+    enum class Kernel {
+        RC6_ENCRYPT,
+        RC6_DECRYPT,
+        TWOFISH_DECRYPT,
+    };
+
+    const char *kernelName(const Kernel kernel) {
+        switch (kernel) {
+            case Kernel::RC6_ENCRYPT:
+                return "rc6-encrypt";
+            case Kernel::RC6_DECRYPT:
+                return "rc6-decrypt";
+            case Kernel::TWOFISH_DECRYPT:
+                return "twofish-decrypt";
+        }
+        return "unknown";
+    }
+
+    // Removes the scratch directory however the run ends
+    class ScratchDirectory {
+    public:
+        explicit ScratchDirectory(const fs::path &parent) {
+            const auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+            path_ = parent / ("openiximg-bench-" + std::to_string(stamp));
+            fs::create_directories(path_);
+        }
+
+        ~ScratchDirectory() {
+            std::error_code error;
+            fs::remove_all(path_, error);
+        }
+
+        ScratchDirectory(const ScratchDirectory &) = delete;
+
+        ScratchDirectory &operator=(const ScratchDirectory &) = delete;
+
+        [[nodiscard]] const fs::path &path() const {
+            return path_;
+        }
+
+    private:
+        fs::path path_;
+    };
+
+    // Incompressible filler so neither the disk nor the file system can shortcut the writes
+    void fillPseudoRandom(std::vector<uint8_t> &buffer, uint64_t seed) {
+        seed = seed * 0x9E3779B97F4A7C15ULL + 1;
+        for (size_t i = 0; i + 8 <= buffer.size(); i += 8) {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            std::memcpy(buffer.data() + i, &seed, 8);
+        }
+    }
+
+    double rate(const uint64_t bytes, const std::chrono::steady_clock::duration duration) {
+        const auto seconds = std::chrono::duration<double>(duration).count();
+        return seconds > 0 ? static_cast<double>(bytes) / seconds : 0;
+    }
+
+    double measureKernel(const OpenixIMGFile &imgFile, const Kernel kernel, const unsigned threads,
+                         const std::chrono::milliseconds duration) {
+        std::atomic<bool> stop{false};
+        std::atomic<uint64_t> processed{0};
+
+        std::vector<std::thread> workers;
+        workers.reserve(threads);
+        const auto started = std::chrono::steady_clock::now();
+        for (unsigned t = 0; t < threads; ++t) {
+            workers.emplace_back([&imgFile, kernel, &stop, &processed, t]() {
+                std::vector<uint8_t> buffer(BENCH_BUFFER_SIZE);
+                fillPseudoRandom(buffer, t);
+                uint64_t done = 0;
+                while (!stop.load(std::memory_order_relaxed)) {
+                    switch (kernel) {
+                        case Kernel::RC6_ENCRYPT:
+                            imgFile.encryptData(buffer.data(), buffer.size(), OpenixIMGFile::CryptoContext::FILE_CONTENT);
+                            break;
+                        case Kernel::RC6_DECRYPT:
+                            imgFile.decryptData(buffer.data(), buffer.size(), OpenixIMGFile::CryptoContext::FILE_CONTENT);
+                            break;
+                        case Kernel::TWOFISH_DECRYPT:
+                            imgFile.twofishDecryptData(buffer.data(), buffer.size());
+                            break;
+                    }
+                    done += buffer.size();
+                }
+                processed.fetch_add(done, std::memory_order_relaxed);
+            });
+        }
+
+        std::this_thread::sleep_for(duration);
+        stop.store(true, std::memory_order_relaxed);
+        for (auto &worker: workers) {
+            worker.join();
+        }
+        return rate(processed.load(), std::chrono::steady_clock::now() - started);
+    }
+
+    void measureDisk(const fs::path &scratch, const uint64_t ioSize, BenchReport &report) {
+        const auto path = (scratch / "sequential.bin").string();
+        std::vector<uint8_t> buffer(BENCH_BUFFER_SIZE);
+        fillPseudoRandom(buffer, ioSize);
+
+        {
+            const OpenixFileIO out(path, OpenixFileIO::Mode::WRITE);
+            const auto started = std::chrono::steady_clock::now();
+            for (uint64_t offset = 0; offset < ioSize; offset += buffer.size()) {
+                out.writeAt(offset, buffer.data(), static_cast<size_t>(std::min<uint64_t>(buffer.size(), ioSize - offset)));
+            }
+            out.sync();
+            report.writeBandwidth = rate(ioSize, std::chrono::steady_clock::now() - started);
+        }
+
+        const OpenixFileIO in(path);
+        report.cacheEvicted = in.evict();
+        const auto started = std::chrono::steady_clock::now();
+        uint64_t total = 0;
+        for (size_t got; (got = in.readAt(total, buffer.data(), buffer.size())) > 0;) {
+            total += got;
+        }
+        report.readBandwidth = rate(total, std::chrono::steady_clock::now() - started);
+    }
+
+    void measureImage(const fs::path &scratch, const uint64_t imageSize, BenchReport &report) {
+        const auto payloadDir = scratch / "payload";
+        fs::create_directories(payloadDir);
+
+        // Synthetic payloads and the image.cfg listing them
+        std::ofstream config(payloadDir / "image.cfg", std::ios::out | std::ios::binary);
+        config << "[DIR_DEF]\nINPUT_DIR = \"../\"\n\n[FILELIST]\n";
+        std::vector<uint8_t> buffer(BENCH_BUFFER_SIZE);
+        const auto entrySize = std::max<uint64_t>(imageSize / BENCH_IMAGE_ENTRIES, 1);
+        for (unsigned i = 0; i < BENCH_IMAGE_ENTRIES; ++i) {
+            const auto name = "payload" + std::to_string(i) + ".fex";
+            config << "{ filename = \"" << name << "\", maintype = \"BENCH\", subtype = \"PAYLOAD" << i << "\", },\n";
+
+            const OpenixFileIO out((payloadDir / name).string(), OpenixFileIO::Mode::WRITE);
+            for (uint64_t offset = 0; offset < entrySize; offset += buffer.size()) {
+                fillPseudoRandom(buffer, offset + i);
+                out.writeAt(offset, buffer.data(), static_cast<size_t>(std::min<uint64_t>(buffer.size(), entrySize - offset)));
+            }
+        }
+        config << "\n[IMAGE_CFG]\npid = 0x1\nvid = 0x1\nhardwareid = 0x100\nfirmwareid = 0x100\n"
+                "imagename = bench.img\nfilelist = FILELIST\nencrypt = 1\n";
+        config.close();
+        if (!config) {
+            throw std::runtime_error("Failed to write benchmark configuration in " + payloadDir.string());
+        }
+
+        // Both rates are taken over the image file, so they compare directly
+        const auto imagePath = (scratch / "bench.img").string();
+        uint64_t imageBytes = 0;
+        {
+            OpenixIMGFile imgFile;
+            const OpenixPacker packer(imgFile);
+            const auto started = std::chrono::steady_clock::now();
+            if (!packer.packImage((payloadDir / "image.cfg").string(), imagePath)) {
+                throw std::runtime_error("Failed to pack the benchmark image");
+            }
+            const auto elapsed = std::chrono::steady_clock::now() - started;
+            imageBytes = fs::file_size(imagePath);
+            report.packRate = rate(imageBytes, elapsed);
+        }
+
+        // Unpack from disk, not from the pages the pack just wrote; dirty pages cannot be dropped before the sync
+        {
+            const OpenixFileIO image(imagePath);
+            image.sync();
+            report.imageCacheEvicted = image.evict();
+        }
+
+        OpenixIMGFile imgFile;
+        const OpenixPacker packer(imgFile);
+        const auto started = std::chrono::steady_clock::now();
+        if (!imgFile.loadImage(imagePath) || !packer.unpackImage((scratch / "unpacked").string(),
+                                                                  OutputFormat::IMGREPACKER)) {
+            throw std::runtime_error("Failed to unpack the benchmark image");
+        }
+        report.unpackRate = rate(imageBytes, std::chrono::steady_clock::now() - started);
+    }
+
+    std::string formatNumber(const double value) {
+        std::ostringstream ss;
+        ss << std::fixed << std::setprecision(0) << value;
+        return ss.str();
+    }
+}
+
+double BenchReport::score() const {
+    double singleThreadDecrypt = 0;
+    for (const auto &result: crypt) {
+        if (result.kernel == "rc6-decrypt" && result.threads == 1) {
+            singleThreadDecrypt = result.bytesPerSecond;
+        }
+    }
+
+    const double ratios[] = {
+        singleThreadDecrypt / REFERENCE_CRYPT, readBandwidth / REFERENCE_DISK, writeBandwidth / REFERENCE_DISK,
+        packRate / REFERENCE_IMAGE, unpackRate / REFERENCE_IMAGE
+    };
+
+    double logSum = 0;
+    for (const auto ratio: ratios) {
+        if (ratio <= 0) {
+            return 0;
+        }
+        logSum += std::log(ratio);
+    }
+    return 100.0 * std::exp(logSum / static_cast<double>(std::size(ratios)));
+}
+
+BenchReport OpenixBench::run(const BenchOptions &options) {
+    BenchReport report;
+    report.directory = options.directory.empty() ? fs::temp_directory_path().string() : options.directory;
+    report.hardwareThreads = std::max(1U, std::thread::hardware_concurrency());
+
+    auto threadCounts = options.threadCounts;
+    if (threadCounts.empty()) {
+        for (unsigned threads = 1; threads < report.hardwareThreads; threads *= 2) {
+            threadCounts.push_back(threads);
+        }
+        threadCounts.push_back(report.hardwareThreads);
+    }
+
+    // Single-thread RC6 decryption is always measured: the score depends on it
+    if (std::find(threadCounts.begin(), threadCounts.end(), 1U) == threadCounts.end()) {
+        threadCounts.insert(threadCounts.begin(), 1U);
+    }
+
+    const OpenixIMGFile imgFile;
+    for (const auto kernel: {Kernel::RC6_ENCRYPT, Kernel::RC6_DECRYPT, Kernel::TWOFISH_DECRYPT}) {
+        for (const auto threads: threadCounts) {
+            if (threads == 0) {
+                continue;
+            }
+            report.crypt.push_back({kernelName(kernel), threads,
+                                    measureKernel(imgFile, kernel, threads, options.cryptDuration)});
+        }
+    }
+
+    const ScratchDirectory scratch(report.directory);
+    measureDisk(scratch.path(), options.ioSize, report);
+    measureImage(scratch.path(), options.imageSize, report);
+
+    return report;
+}
+
+std::string OpenixBench::dumpToJson(const BenchReport &report) {
+    std::ostringstream ss;
+    ss << "{\"directory\":\"" << OpenixCFGJson::escape(report.directory) << "\""
+            << ",\"hardware_threads\":" << report.hardwareThreads
+            << ",\"score\":" << std::fixed << std::setprecision(1) << report.score();
+
+    ss << ",\"crypt\":[";
+    for (size_t i = 0; i < report.crypt.size(); ++i) {
+        const auto &result = report.crypt[i];
+        ss << (i ? "," : "") << "\n{\"kernel\":\"" << result.kernel << "\",\"threads\":" << result.threads
+                << ",\"bytes_per_second\":" << formatNumber(result.bytesPerSecond) << "}";
+    }
+
+    ss << "],\n\"disk\":{\"write_bytes_per_second\":" << formatNumber(report.writeBandwidth)
+            << ",\"read_bytes_per_second\":" << formatNumber(report.readBandwidth)
+            << ",\"cache_evicted\":" << (report.cacheEvicted ? "true" : "false") << "}"
+            << ",\n\"image\":{\"pack_bytes_per_second\":" << formatNumber(report.packRate)
+            << ",\"unpack_bytes_per_second\":" << formatNumber(report.unpackRate)
+            << ",\"cache_evicted\":" << (report.imageCacheEvicted ? "true" : "false") << "}}" << std::endl;
+
+    return ss.str();
+}
@@ -6,6 +6,9 @@
 
 #include <fstream>
 #include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
 #include <utility>
 #include <sstream>
 
@@ -141,7 +144,7 @@ OpenixCFG::~OpenixCFG() {
 bool OpenixCFG::loadFromFile(const fs::path &filepath) {
     std::ifstream file(filepath);
     if (!file.is_open()) {
-        std::cerr << "Failed to open file: " << filepath << std::endl;
+        std::fprintf(stderr, "Failed to open file: %s\n", filepath.string().c_str());
         return false;
     }
     return loadFromStream(file);
@@ -270,6 +273,10 @@ std::optional<std::string> OpenixCFG::getString(const std::string &name, const s
     return std::nullopt;
 }
 
+std::shared_ptr<Group> OpenixCFG::getFirstGroup() const {
+    return headGroup_;
+}
+
 size_t OpenixCFG::countVariables(const std::string &groupName) const {
     const std::shared_ptr<Group> group = findGroup(groupName);
     if (!group) {
@@ -292,6 +299,14 @@ void OpenixCFG::addGroup(const std::shared_ptr<Group> &group) {
     groupMap_[group->getName()] = group;
 }
 
+void OpenixCFG::indexVariables(const Group &group) {
+    for (const auto &var: group.getVariables()) {
+        if (var && !var->getName().empty()) {
+            variableMap_[var->getName()] = var;
+        }
+    }
+}
+
 void OpenixCFG::freeAll() {
     headGroup_ = nullptr;
     groupMap_.clear();
@@ -299,7 +314,7 @@ void OpenixCFG::freeAll() {
 }
 
 void OpenixCFG::dump() const {
-    std::cout << dumpToString() << std::endl;
+    std::printf("%s\n", dumpToString().c_str());
 }
 
 std::string OpenixCFG::dumpToString() const {
@@ -437,17 +452,16 @@ std::shared_ptr<Variable> OpenixCFG::parseExpression(std::string &line) const {
 
     // Check if it's a number
     if (std::isdigit(static_cast<unsigned char>(line[0])) || line[0] == '-') {
-        size_t endPos = 0;
-        try {
-            number = std::stol(line, &endPos, 0);
-            if (endPos > 0) {
-                line = line.substr(endPos);
-                auto var = std::make_shared<Variable>("", ValueType::NUMBER);
-                var->setNumber(number);
-                return var;
-            }
-        } catch (...) {
-            // Not a valid number, try to process as string
+        // strtol rather than std::stol: text that is not a number falls through to the string parser without throwing
+        const char *begin = line.c_str();
+        char *end = nullptr;
+        errno = 0;
+        number = std::strtol(begin, &end, 0);
+        if (end != begin && errno != ERANGE) {
+            line = line.substr(static_cast<size_t>(end - begin));
+            auto var = std::make_shared<Variable>("", ValueType::NUMBER);
+            var->setNumber(number);
+            return var;
         }
     }
 
@@ -0,0 +1,382 @@
+/**
+ * @file OpenixCFGDiff.cpp
+ * @brief Implementation of OpenixCFGDiff class methods
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <atomic>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+#include "OpenixCFGDiff.hpp"
+
+using namespace OpenixIMG;
+
+namespace {
+    // Something with a stable key to join on
+    template<typename T>
+    struct Keyed {
+        std::string key;
+        const T *node;
+    };
+
+    // Append "#n" to keys that were already handed out
+    std::string uniqueKey(std::unordered_map<std::string, size_t> &seen, const std::string &candidate) {
+        const auto count = ++seen[candidate];
+        return count == 1 ? candidate : candidate + "#" + std::to_string(count);
+    }
+
+    // Plain text of a scalar variable, used to build keys
+    std::string scalarText(const Variable &var) {
+        switch (var.getType()) {
+            case ValueType::NUMBER:
+                return std::to_string(var.getNumber());
+            case ValueType::STRING:
+                return var.getString();
+            case ValueType::REFERENCE:
+                return var.getReference();
+            default:
+                return {};
+        }
+    }
+
+    std::vector<Keyed<Group> > keyGroups(const OpenixCFG &cfg) {
+        std::unordered_map<std::string, size_t> occurrences;
+        for (auto group = cfg.getFirstGroup(); group; group = group->getNext()) {
+            ++occurrences[group->getName()];
+        }
+
+        std::vector<Keyed<Group> > result;
+        std::unordered_map<std::string, size_t> seen;
+        for (auto group = cfg.getFirstGroup(); group; group = group->getNext()) {
+            std::string key = group->getName();
+            if (occurrences[key] > 1) {
+                // Repeated sections such as [partition] are identified by their name variable
+                for (const auto &var: group->getVariables()) {
+                    if (var->getName() == "name") {
+                        key += "[" + scalarText(*var) + "]";
+                        break;
+                    }
+                }
+            }
+            result.push_back({uniqueKey(seen, key), group.get()});
+        }
+        return result;
+    }
+
+    std::vector<Keyed<Variable> > keyVariables(const Group &group) {
+        std::vector<Keyed<Variable> > result;
+        std::unordered_map<std::string, size_t> seen;
+        size_t itemIndex = 0;
+
+        for (const auto &var: group.getVariables()) {
+            if (!var) {
+                continue;
+            }
+
+            std::string key = var->getName();
+            if (key.empty() && var->getType() == ValueType::LIST_ITEM) {
+                // Anonymous list items: prefer the filename field, then the first field
+                const auto &items = var->getItems();
+                const auto it = std::find_if(items.begin(), items.end(), [](const std::shared_ptr<Variable> &item) {
+                    return item->getName() == "filename";
+                });
+                if (it != items.end()) {
+                    key = "{" + scalarText(**it) + "}";
+                } else if (!items.empty()) {
+                    key = "{" + scalarText(*items.front()) + "}";
+                } else {
+                    key = "{#" + std::to_string(itemIndex) + "}";
+                }
+                ++itemIndex;
+            }
+            result.push_back({uniqueKey(seen, key), var.get()});
+        }
+        return result;
+    }
+
+    bool isAnonymousItem(const Variable &var) {
+        return var.getName().empty() && var.getType() == ValueType::LIST_ITEM;
+    }
+
+    // Every variable of a group that only exists on one side
+    void listGroup(const std::string &groupKey, const Group &group, const bool added,
+                   std::vector<CfgChange> &changes) {
+        for (const auto &var: keyVariables(group)) {
+            const auto value = OpenixCFGDiff::formatValue(*var.node);
+            if (isAnonymousItem(*var.node)) {
+                changes.push_back({
+                    added ? CfgChangeType::ITEM_ADDED : CfgChangeType::ITEM_REMOVED, groupKey, var.key,
+                    added ? "" : value, added ? value : ""
+                });
+            } else {
+                changes.push_back({
+                    added ? CfgChangeType::VARIABLE_ADDED : CfgChangeType::VARIABLE_REMOVED, groupKey, var.key,
+                    added ? "" : value, added ? value : ""
+                });
+            }
+        }
+    }
+
+    void diffGroup(const std::string &groupKey, const Group &oldGroup, const Group &newGroup,
+                   std::vector<CfgChange> &changes) {
+        const auto oldVars = keyVariables(oldGroup);
+        const auto newVars = keyVariables(newGroup);
+
+        std::unordered_map<std::string, const Variable *> oldIndex;
+        oldIndex.reserve(oldVars.size());
+        for (const auto &entry: oldVars) {
+            oldIndex.emplace(entry.key, entry.node);
+        }
+
+        std::unordered_map<std::string, bool> matched;
+        matched.reserve(newVars.size());
+        for (const auto &entry: newVars) {
+            const bool item = isAnonymousItem(*entry.node);
+            const auto it = oldIndex.find(entry.key);
+            if (it == oldIndex.end()) {
+                changes.push_back({
+                    item ? CfgChangeType::ITEM_ADDED : CfgChangeType::VARIABLE_ADDED, groupKey, entry.key, "",
+                    OpenixCFGDiff::formatValue(*entry.node)
+                });
+                continue;
+            }
+
+            matched[entry.key] = true;
+            if (!OpenixCFGDiff::sameValue(*it->second, *entry.node)) {
+                changes.push_back({
+                    item ? CfgChangeType::ITEM_CHANGED : CfgChangeType::VARIABLE_CHANGED, groupKey, entry.key,
+                    OpenixCFGDiff::formatValue(*it->second), OpenixCFGDiff::formatValue(*entry.node)
+                });
+            }
+        }
+
+        for (const auto &entry: oldVars) {
+            if (!matched.count(entry.key)) {
+                changes.push_back({
+                    isAnonymousItem(*entry.node) ? CfgChangeType::ITEM_REMOVED : CfgChangeType::VARIABLE_REMOVED,
+                    groupKey, entry.key, OpenixCFGDiff::formatValue(*entry.node), ""
+                });
+            }
+        }
+    }
+
+    // Text configs never contain NUL bytes in their first block; payload images usually do
+    bool looksLikeText(const std::filesystem::path &path) {
+        std::ifstream file(path, std::ios::binary);
+        char buffer[4096];
+        file.read(buffer, sizeof(buffer));
+        return std::find(buffer, buffer + file.gcount(), '\0') == buffer + file.gcount();
+    }
+
+    std::set<std::string> collectConfigFiles(const std::string &dir, const std::vector<std::string> &extensions) {
+        std::set<std::string> files;
+        if (!std::filesystem::is_directory(dir)) {
+            return files;
+        }
+
+        for (const auto &entry: std::filesystem::recursive_directory_iterator(dir)) {
+            if (!entry.is_regular_file()) {
+                continue;
+            }
+            const auto extension = entry.path().extension().string();
+            if (std::find(extensions.begin(), extensions.end(), extension) != extensions.end()) {
+                files.insert(std::filesystem::relative(entry.path(), dir).generic_string());
+            }
+        }
+        return files;
+    }
+}
+
+bool OpenixCFGDiff::sameValue(const Variable &a, const Variable &b) {
+    if (a.getType() != b.getType()) {
+        return false;
+    }
+
+    if (a.getType() != ValueType::LIST_ITEM) {
+        return scalarText(a) == scalarText(b);
+    }
+
+    // List fields are compared by name, independent of their order
+    const auto &itemsA = a.getItems();
+    const auto &itemsB = b.getItems();
+    if (itemsA.size() != itemsB.size()) {
+        return false;
+    }
+
+    std::unordered_map<std::string, const Variable *> fields;
+    for (const auto &item: itemsA) {
+        fields.emplace(item->getName(), item.get());
+    }
+    return std::all_of(itemsB.begin(), itemsB.end(), [&fields](const std::shared_ptr<Variable> &item) {
+        const auto it = fields.find(item->getName());
+        return it != fields.end() && sameValue(*it->second, *item);
+    });
+}
+
+std::vector<CfgChange> OpenixCFGDiff::diff(const OpenixCFG &oldCfg, const OpenixCFG &newCfg) {
+    const auto oldGroups = keyGroups(oldCfg);
+    const auto newGroups = keyGroups(newCfg);
+
+    std::unordered_map<std::string, const Group *> oldIndex;
+    oldIndex.reserve(oldGroups.size());
+    for (const auto &entry: oldGroups) {
+        oldIndex.emplace(entry.key, entry.node);
+    }
+
+    std::vector<CfgChange> changes;
+    std::unordered_map<std::string, bool> matched;
+    matched.reserve(newGroups.size());
+
+    for (const auto &entry: newGroups) {
+        const auto it = oldIndex.find(entry.key);
+        if (it == oldIndex.end()) {
+            changes.push_back({CfgChangeType::GROUP_ADDED, entry.key, "", "", ""});
+            listGroup(entry.key, *entry.node, true, changes);
+            continue;
+        }
+
+        matched[entry.key] = true;
+        diffGroup(entry.key, *it->second, *entry.node, changes);
+    }
+
+    for (const auto &entry: oldGroups) {
+        if (!matched.count(entry.key)) {
+            changes.push_back({CfgChangeType::GROUP_REMOVED, entry.key, "", "", ""});
+            listGroup(entry.key, *entry.node, false, changes);
+        }
+    }
+
+    return changes;
+}
+
+std::vector<CfgFileDiff> OpenixCFGDiff::diffDirectories(const std::string &oldDir, const std::string &newDir,
+                                                        const std::vector<std::string> &extensions) {
+    const auto oldFiles = collectConfigFiles(oldDir, extensions);
+    const auto newFiles = collectConfigFiles(newDir, extensions);
+
+    std::vector<std::string> paths(oldFiles.begin(), oldFiles.end());
+    paths.insert(paths.end(), newFiles.begin(), newFiles.end());
+    std::sort(paths.begin(), paths.end());
+    paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+
+    std::vector<CfgFileDiff> results(paths.size());
+    std::atomic<size_t> next{0};
+
+    auto worker = [&]() {
+        for (size_t i = next++; i < paths.size(); i = next++) {
+            auto &result = results[i];
+            result.path = paths[i];
+
+            const auto oldPath = std::filesystem::path(oldDir) / paths[i];
+            const auto newPath = std::filesystem::path(newDir) / paths[i];
+            const bool inOld = oldFiles.count(paths[i]) && looksLikeText(oldPath);
+            const bool inNew = newFiles.count(paths[i]) && looksLikeText(newPath);
+
+            if (!inOld && !inNew) {
+                // Binary payload on both sides: not a configuration
+                continue;
+            }
+            if (!inOld || !inNew) {
+                result.status = inNew ? CfgFileDiff::Status::ADDED : CfgFileDiff::Status::REMOVED;
+                continue;
+            }
+
+            try {
+                OpenixCFG oldCfg;
+                OpenixCFG newCfg;
+                std::ifstream oldStream(oldPath);
+                std::ifstream newStream(newPath);
+                if (!oldCfg.loadFromStream(oldStream)) {
+                    throw std::runtime_error("Failed to parse " + oldPath.string());
+                }
+                if (!newCfg.loadFromStream(newStream)) {
+                    throw std::runtime_error("Failed to parse " + newPath.string());
+                }
+
+                result.changes = diff(oldCfg, newCfg);
+                result.status = result.changes.empty()
+                                    ? CfgFileDiff::Status::UNCHANGED
+                                    : CfgFileDiff::Status::MODIFIED;
+            } catch (const std::exception &e) {
+                result.status = CfgFileDiff::Status::FAILED;
+                result.error = e.what();
+            }
+        }
+    };
+
+    const size_t threadCount = std::min<size_t>(std::max(1U, std::thread::hardware_concurrency()), paths.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < threadCount; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread: threads) {
+        thread.join();
+    }
+
+    results.erase(std::remove_if(results.begin(), results.end(), [](const CfgFileDiff &result) {
+        return result.status == CfgFileDiff::Status::UNCHANGED;
+    }), results.end());
+
+    return results;
+}
+
+std::string OpenixCFGDiff::formatValue(const Variable &var) {
+    switch (var.getType()) {
+        case ValueType::NUMBER:
+            // Large values are IDs and versions, which are written in hex
+            if (var.getNumber() > 0xFFFF) {
+                char buffer[16];
+                snprintf(buffer, sizeof(buffer), "0x%x", var.getNumber());
+                return buffer;
+            }
+            return std::to_string(var.getNumber());
+        case ValueType::STRING:
+            return "\"" + var.getString() + "\"";
+        case ValueType::REFERENCE:
+            return var.getReference();
+        case ValueType::LIST_ITEM: {
+            std::string result = "{ ";
+            for (const auto &item: var.getItems()) {
+                result += item->getName() + " = " + formatValue(*item) + ", ";
+            }
+            return result + "}";
+        }
+    }
+    return {};
+}
+
+std::string OpenixCFGDiff::dumpToString(const std::vector<CfgChange> &changes) {
+    std::stringstream ss;
+    for (const auto &change: changes) {
+        switch (change.type) {
+            case CfgChangeType::GROUP_ADDED:
+                ss << "+ [" << change.group << "]" << std::endl;
+                break;
+            case CfgChangeType::GROUP_REMOVED:
+                ss << "- [" << change.group << "]" << std::endl;
+                break;
+            case CfgChangeType::VARIABLE_ADDED:
+            case CfgChangeType::ITEM_ADDED:
+                ss << "+ [" << change.group << "] " << change.key << " = " << change.newValue << std::endl;
+                break;
+            case CfgChangeType::VARIABLE_REMOVED:
+            case CfgChangeType::ITEM_REMOVED:
+                ss << "- [" << change.group << "] " << change.key << " = " << change.oldValue << std::endl;
+                break;
+            case CfgChangeType::VARIABLE_CHANGED:
+            case CfgChangeType::ITEM_CHANGED:
+                ss << "~ [" << change.group << "] " << change.key << ": " << change.oldValue << " -> "
+                        << change.newValue << std::endl;
+                break;
+        }
+    }
+    return ss.str();
+}
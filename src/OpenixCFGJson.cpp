@@ -0,0 +1,281 @@
+/**
+ * @file OpenixCFGJson.cpp
+ * @brief Implementation of OpenixCFGJson class methods
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#include <charconv>
+#include <unordered_set>
+
+#include "OpenixCFGJson.hpp"
+
+using namespace OpenixIMG;
+
+namespace {
+    // Output is collected in chunks of this size before it is handed to the sink
+    constexpr size_t JSON_BUFFER_SIZE = 16 * 1024;
+
+    // Length of the valid UTF-8 sequence starting at data[0], or 0 if it is invalid
+    size_t utf8SequenceLength(const unsigned char *data, const size_t available) {
+        const unsigned char lead = data[0];
+        size_t length;
+        unsigned char min = 0x80;
+        unsigned char max = 0xBF;
+
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            length = 2;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+            length = 3;
+            // Reject overlong forms and UTF-16 surrogates
+            if (lead == 0xE0) {
+                min = 0xA0;
+            } else if (lead == 0xED) {
+                max = 0x9F;
+            }
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+            length = 4;
+            if (lead == 0xF0) {
+                min = 0x90;
+            } else if (lead == 0xF4) {
+                max = 0x8F;
+            }
+        } else {
+            return 0;
+        }
+
+        if (length > available || data[1] < min || data[1] > max) {
+            return 0;
+        }
+        for (size_t i = 2; i < length; ++i) {
+            if (data[i] < 0x80 || data[i] > 0xBF) {
+                return 0;
+            }
+        }
+        return length;
+    }
+
+    void appendEscaped(std::string &out, const std::string_view value) {
+        static constexpr char HEX[] = "0123456789abcdef";
+        const auto *data = reinterpret_cast<const unsigned char *>(value.data());
+
+        size_t i = 0;
+        while (i < value.size()) {
+            const unsigned char c = data[i];
+            if (c >= 0x80) {
+                if (const auto length = utf8SequenceLength(data + i, value.size() - i); length > 0) {
+                    out.append(value.data() + i, length);
+                    i += length;
+                } else {
+                    // Not UTF-8 (e.g. a GBK comment): keep the byte as a Latin-1 code point
+                    out += "\\u00";
+                    out += HEX[c >> 4];
+                    out += HEX[c & 0xF];
+                    ++i;
+                }
+                continue;
+            }
+
+            switch (c) {
+                case '"':
+                    out += "\\\"";
+                    break;
+                case '\\':
+                    out += "\\\\";
+                    break;
+                case '\b':
+                    out += "\\b";
+                    break;
+                case '\f':
+                    out += "\\f";
+                    break;
+                case '\n':
+                    out += "\\n";
+                    break;
+                case '\r':
+                    out += "\\r";
+                    break;
+                case '\t':
+                    out += "\\t";
+                    break;
+                default:
+                    if (c < 0x20) {
+                        out += "\\u00";
+                        out += HEX[c >> 4];
+                        out += HEX[c & 0xF];
+                    } else {
+                        out += static_cast<char>(c);
+                    }
+                    break;
+            }
+            ++i;
+        }
+    }
+
+    // Buffered writer in front of the user's sink
+    class JsonWriter {
+    public:
+        explicit JsonWriter(const OpenixCFGJson::Sink &sink) : sink_(sink) {
+            buffer_.reserve(JSON_BUFFER_SIZE + 256);
+        }
+
+        void raw(const std::string_view text) {
+            buffer_.append(text);
+            flushIfFull();
+        }
+
+        void string(const std::string_view text) {
+            buffer_ += '"';
+            appendEscaped(buffer_, text);
+            buffer_ += '"';
+            flushIfFull();
+        }
+
+        void number(const uint32_t value) {
+            char digits[16];
+            const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+            buffer_.append(digits, result.ptr);
+            flushIfFull();
+        }
+
+        void flush() {
+            if (!buffer_.empty()) {
+                sink_(buffer_);
+                buffer_.clear();
+            }
+        }
+
+    private:
+        void flushIfFull() {
+            if (buffer_.size() >= JSON_BUFFER_SIZE) {
+                flush();
+            }
+        }
+
+        const OpenixCFGJson::Sink &sink_;
+        std::string buffer_;
+    };
+
+    const char *typeName(const ValueType type) {
+        switch (type) {
+            case ValueType::NUMBER:
+                return "number";
+            case ValueType::STRING:
+                return "string";
+            case ValueType::REFERENCE:
+                return "reference";
+            case ValueType::LIST_ITEM:
+                return "list";
+        }
+        return "unknown";
+    }
+
+    void writeVariable(JsonWriter &writer, const Variable &var) {
+        writer.raw("{\"name\":");
+        writer.string(var.getName());
+        writer.raw(",\"type\":\"");
+        writer.raw(typeName(var.getType()));
+
+        switch (var.getType()) {
+            case ValueType::NUMBER:
+                writer.raw("\",\"value\":");
+                writer.number(var.getNumber());
+                break;
+            case ValueType::STRING:
+                writer.raw("\",\"value\":");
+                writer.string(var.getString());
+                break;
+            case ValueType::REFERENCE:
+                writer.raw("\",\"value\":");
+                writer.string(var.getReference());
+                break;
+            case ValueType::LIST_ITEM: {
+                writer.raw("\",\"items\":[");
+                bool first = true;
+                for (const auto &item: var.getItems()) {
+                    if (!item) {
+                        continue;
+                    }
+                    if (!first) {
+                        writer.raw(",");
+                    }
+                    first = false;
+                    writeVariable(writer, *item);
+                }
+                writer.raw("]");
+                break;
+            }
+        }
+        writer.raw("}");
+    }
+
+    void writeGroup(JsonWriter &writer, const Group &group) {
+        writer.raw("{\"name\":");
+        writer.string(group.getName());
+        writer.raw(",\"variables\":[");
+        bool first = true;
+        for (const auto &var: group.getVariables()) {
+            if (!var) {
+                continue;
+            }
+            if (!first) {
+                writer.raw(",");
+            }
+            first = false;
+            writeVariable(writer, *var);
+        }
+        writer.raw("]}");
+    }
+}
+
+void OpenixCFGJson::write(const OpenixCFG &cfg, const Sink &sink, const CfgJsonOptions &options) {
+    const std::unordered_set<std::string> selected(options.groups.begin(), options.groups.end());
+    const bool ndjson = options.mode == JsonMode::NDJSON;
+
+    JsonWriter writer(sink);
+    if (!ndjson) {
+        writer.raw("[");
+    }
+
+    bool first = true;
+    for (auto group = cfg.getFirstGroup(); group; group = group->getNext()) {
+        if (!selected.empty() && !selected.count(group->getName())) {
+            continue;
+        }
+
+        if (ndjson) {
+            writeGroup(writer, *group);
+            writer.raw("\n");
+            writer.flush();
+        } else {
+            if (!first) {
+                writer.raw(",\n");
+            }
+            writeGroup(writer, *group);
+        }
+        first = false;
+    }
+
+    if (!ndjson) {
+        writer.raw("]\n");
+    }
+    writer.flush();
+}
+
+void OpenixCFGJson::write(const OpenixCFG &cfg, std::ostream &stream, const CfgJsonOptions &options) {
+    write(cfg, [&stream](const std::string_view chunk) {
+        stream.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+    }, options);
+}
+
+std::string OpenixCFGJson::dumpToString(const OpenixCFG &cfg, const CfgJsonOptions &options) {
+    std::string result;
+    write(cfg, [&result](const std::string_view chunk) { result.append(chunk); }, options);
+    return result;
+}
+
+std::string OpenixCFGJson::escape(const std::string_view value) {
+    std::string result;
+    result.reserve(value.size());
+    appendEscaped(result, value);
+    return result;
+}
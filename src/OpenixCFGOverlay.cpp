@@ -0,0 +1,359 @@
+/**
+ * @file OpenixCFGOverlay.cpp
+ * @brief Implementation of OpenixCFGOverlay class methods
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_set>
+
+#include "OpenixCFGOverlay.hpp"
+
+using namespace OpenixIMG;
+
+namespace {
+    // All groups of a configuration by name, in file order
+    std::unordered_map<std::string, std::vector<std::shared_ptr<Group> > > groupsByName(const OpenixCFG &cfg) {
+        std::unordered_map<std::string, std::vector<std::shared_ptr<Group> > > result;
+        for (auto group = cfg.getFirstGroup(); group; group = group->getNext()) {
+            result[group->getName()].push_back(group);
+        }
+        return result;
+    }
+
+    // Groups that cannot be described by per-key changes
+    bool needsWholeGroup(const Group &group) {
+        std::unordered_set<std::string> names;
+        for (const auto &var: group.getVariables()) {
+            if (!var || var->getName().empty() || !names.insert(var->getName()).second) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool sameGroups(const std::vector<std::shared_ptr<Group> > &a, const std::vector<std::shared_ptr<Group> > &b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); ++i) {
+            const auto &varsA = a[i]->getVariables();
+            const auto &varsB = b[i]->getVariables();
+            if (varsA.size() != varsB.size()) {
+                return false;
+            }
+            for (size_t j = 0; j < varsA.size(); ++j) {
+                if (varsA[j]->getName() != varsB[j]->getName() || !OpenixCFGDiff::sameValue(*varsA[j], *varsB[j])) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+}
+
+OpenixCFGOverlay::OpenixCFGOverlay(std::shared_ptr<const OpenixCFG> base) : base_(std::move(base)) {
+    if (!base_) {
+        throw std::runtime_error("Overlay requires a base configuration");
+    }
+}
+
+OpenixCFGOverlay OpenixCFGOverlay::fromVariant(std::shared_ptr<const OpenixCFG> base, const OpenixCFG &variant) {
+    OpenixCFGOverlay overlay(std::move(base));
+
+    const auto baseGroups = groupsByName(*overlay.base_);
+    const auto variantGroups = groupsByName(variant);
+
+    for (auto group = variant.getFirstGroup(); group; group = group->getNext()) {
+        const auto &name = group->getName();
+        const auto &newGroups = variantGroups.at(name);
+        if (newGroups.front() != group) {
+            // Repeated name, already handled at its first occurrence
+            continue;
+        }
+
+        const auto it = baseGroups.find(name);
+        if (it == baseGroups.end()) {
+            overlay.replaceGroup(name, newGroups);
+            continue;
+        }
+
+        const auto &oldGroups = it->second;
+        if (oldGroups.size() != 1 || newGroups.size() != 1 || needsWholeGroup(*oldGroups.front()) ||
+            needsWholeGroup(*group)) {
+            if (!sameGroups(oldGroups, newGroups)) {
+                overlay.replaceGroup(name, newGroups);
+            }
+            continue;
+        }
+
+        std::unordered_map<std::string, const Variable *> oldVars;
+        for (const auto &var: oldGroups.front()->getVariables()) {
+            oldVars.emplace(var->getName(), var.get());
+        }
+        for (const auto &var: group->getVariables()) {
+            const auto old = oldVars.find(var->getName());
+            if (old == oldVars.end() || !OpenixCFGDiff::sameValue(*old->second, *var)) {
+                overlay.setVariable(name, var);
+            }
+            if (old != oldVars.end()) {
+                oldVars.erase(old);
+            }
+        }
+        for (const auto &[varName, var]: oldVars) {
+            overlay.removeVariable(name, varName);
+        }
+    }
+
+    for (const auto &[name, groups]: baseGroups) {
+        if (!variantGroups.count(name)) {
+            overlay.removeGroup(name);
+        }
+    }
+
+    return overlay;
+}
+
+const std::shared_ptr<const OpenixCFG> &OpenixCFGOverlay::getBase() const {
+    return base_;
+}
+
+void OpenixCFGOverlay::setVariable(const std::string &groupName, const std::shared_ptr<Variable> &var) {
+    if (!var || var->getName().empty()) {
+        throw std::runtime_error("Overlay variables must be named");
+    }
+    const auto &name = var->getName();
+
+    auto &delta = deltaFor(groupName);
+    if (delta.removed) {
+        // Re-creating a removed group starts from scratch
+        delta = GroupDelta();
+        delta.replaced = true;
+        delta.groups.push_back(std::make_shared<Group>(groupName));
+    }
+
+    if (delta.replaced) {
+        if (delta.groups.empty()) {
+            delta.groups.push_back(std::make_shared<Group>(groupName));
+        }
+        auto &target = delta.groups.back();
+        GroupDelta change;
+        change.variables[name] = var;
+        if (std::none_of(target->getVariables().begin(), target->getVariables().end(),
+                         [&name](const std::shared_ptr<Variable> &v) { return v->getName() == name; })) {
+            change.appended.push_back(name);
+        }
+        target = copyGroup(*target, &change);
+        return;
+    }
+
+    if (!delta.variables.count(name) && !base_->findVariable(name, groupName)) {
+        delta.appended.push_back(name);
+    }
+    delta.variables[name] = var;
+}
+
+void OpenixCFGOverlay::setNumber(const std::string &groupName, const std::string &name, const uint32_t value) {
+    const auto var = std::make_shared<Variable>(name, ValueType::NUMBER);
+    var->setNumber(value);
+    setVariable(groupName, var);
+}
+
+void OpenixCFGOverlay::setString(const std::string &groupName, const std::string &name, const std::string &value) {
+    const auto var = std::make_shared<Variable>(name, ValueType::STRING);
+    var->setString(value);
+    setVariable(groupName, var);
+}
+
+void OpenixCFGOverlay::removeVariable(const std::string &groupName, const std::string &name) {
+    if (!hasGroup(groupName)) {
+        return;
+    }
+
+    auto &delta = deltaFor(groupName);
+    if (delta.replaced) {
+        GroupDelta change;
+        change.variables[name] = nullptr;
+        for (auto &group: delta.groups) {
+            group = copyGroup(*group, &change);
+        }
+        return;
+    }
+
+    if (base_->findVariable(name, groupName)) {
+        delta.variables[name] = nullptr;
+    } else {
+        delta.variables.erase(name);
+        delta.appended.erase(std::remove(delta.appended.begin(), delta.appended.end(), name), delta.appended.end());
+    }
+}
+
+void OpenixCFGOverlay::replaceGroup(const std::string &groupName, const std::vector<std::shared_ptr<Group> > &groups) {
+    auto &delta = deltaFor(groupName);
+    delta = GroupDelta();
+    delta.replaced = true;
+    for (const auto &group: groups) {
+        delta.groups.push_back(copyGroup(*group, nullptr));
+    }
+}
+
+void OpenixCFGOverlay::removeGroup(const std::string &groupName) {
+    auto &delta = deltaFor(groupName);
+    delta = GroupDelta();
+    delta.removed = true;
+}
+
+void OpenixCFGOverlay::revertGroup(const std::string &groupName) {
+    deltas_.erase(groupName);
+    addedGroups_.erase(std::remove(addedGroups_.begin(), addedGroups_.end(), groupName), addedGroups_.end());
+}
+
+bool OpenixCFGOverlay::hasGroup(const std::string &groupName) const {
+    if (const auto it = deltas_.find(groupName); it != deltas_.end()) {
+        return !it->second.removed && (!it->second.replaced || !it->second.groups.empty());
+    }
+    return base_->findGroup(groupName) != nullptr;
+}
+
+std::shared_ptr<Variable> OpenixCFGOverlay::findVariable(const std::string &name,
+                                                         const std::string &groupName) const {
+    if (const auto it = deltas_.find(groupName); it != deltas_.end()) {
+        const auto &delta = it->second;
+        if (delta.removed) {
+            return nullptr;
+        }
+
+        if (delta.replaced) {
+            // Like OpenixCFG::findGroup, the last group of a repeated name wins
+            if (delta.groups.empty()) {
+                return nullptr;
+            }
+            for (const auto &var: delta.groups.back()->getVariables()) {
+                if (var->getName() == name) {
+                    return var;
+                }
+            }
+            return nullptr;
+        }
+
+        if (const auto var = delta.variables.find(name); var != delta.variables.end()) {
+            return var->second;
+        }
+    }
+
+    return base_->findVariable(name, groupName);
+}
+
+std::optional<uint32_t> OpenixCFGOverlay::getNumber(const std::string &name, const std::string &groupName) const {
+    if (const auto var = findVariable(name, groupName); var && var->getType() == ValueType::NUMBER) {
+        return var->getNumber();
+    }
+    return std::nullopt;
+}
+
+std::optional<std::string> OpenixCFGOverlay::getString(const std::string &name, const std::string &groupName) const {
+    if (const auto var = findVariable(name, groupName); var && var->getType() == ValueType::STRING) {
+        return var->getString();
+    }
+    return std::nullopt;
+}
+
+size_t OpenixCFGOverlay::deltaSize() const {
+    size_t size = 0;
+    for (const auto &[name, delta]: deltas_) {
+        if (delta.removed) {
+            size += 1;
+        } else if (delta.replaced) {
+            for (const auto &group: delta.groups) {
+                size += 1 + group->getVariables().size();
+            }
+        } else {
+            size += delta.variables.size();
+        }
+    }
+    return size;
+}
+
+std::shared_ptr<OpenixCFG> OpenixCFGOverlay::materialize() const {
+    auto cfg = std::make_shared<OpenixCFG>();
+    std::unordered_set<std::string> emitted;
+
+    // Indexed like a parsed file, so findVariable(name) works on the result
+    auto emit = [&cfg](const std::shared_ptr<Group> &group) {
+        cfg->addGroup(group);
+        cfg->indexVariables(*group);
+    };
+
+    auto emitReplacement = [&emit, &emitted](const std::string &name, const GroupDelta &delta) {
+        if (emitted.insert(name).second) {
+            for (const auto &group: delta.groups) {
+                emit(copyGroup(*group, nullptr));
+            }
+        }
+    };
+
+    for (auto group = base_->getFirstGroup(); group; group = group->getNext()) {
+        const auto it = deltas_.find(group->getName());
+        if (it == deltas_.end()) {
+            emit(copyGroup(*group, nullptr));
+        } else if (it->second.replaced) {
+            emitReplacement(group->getName(), it->second);
+        } else if (!it->second.removed) {
+            emit(copyGroup(*group, &it->second));
+        }
+    }
+
+    for (const auto &name: addedGroups_) {
+        if (const auto &delta = deltas_.at(name); delta.replaced) {
+            emitReplacement(name, delta);
+        }
+    }
+
+    return cfg;
+}
+
+std::vector<CfgChange> OpenixCFGOverlay::diff() const {
+    return OpenixCFGDiff::diff(*base_, *materialize());
+}
+
+std::string OpenixCFGOverlay::dumpToString() const {
+    return materialize()->dumpToString();
+}
+
+OpenixCFGOverlay::GroupDelta &OpenixCFGOverlay::deltaFor(const std::string &groupName) {
+    auto [it, inserted] = deltas_.try_emplace(groupName);
+    if (inserted && !base_->findGroup(groupName)) {
+        // New groups are replacements without a position in the base
+        it->second.replaced = true;
+        it->second.groups.push_back(std::make_shared<Group>(groupName));
+        addedGroups_.push_back(groupName);
+    }
+    return it->second;
+}
+
+std::shared_ptr<Group> OpenixCFGOverlay::copyGroup(const Group &group, const GroupDelta *delta) {
+    auto copy = std::make_shared<Group>(group.getName());
+
+    for (const auto &var: group.getVariables()) {
+        if (delta && var && !var->getName().empty()) {
+            if (const auto it = delta->variables.find(var->getName()); it != delta->variables.end()) {
+                if (it->second) {
+                    copy->addVariable(it->second);
+                }
+                continue;
+            }
+        }
+        copy->addVariable(var);
+    }
+
+    if (delta) {
+        for (const auto &name: delta->appended) {
+            if (const auto it = delta->variables.find(name); it != delta->variables.end() && it->second) {
+                copy->addVariable(it->second);
+            }
+        }
+    }
+
+    return copy;
+}
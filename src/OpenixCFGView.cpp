@@ -0,0 +1,103 @@
+/**
+ * @file OpenixCFGView.cpp
+ * @brief Implementation of ImageCfgView
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#include "OpenixCFGView.hpp"
+
+using namespace OpenixIMG;
+
+namespace {
+    // Text of a string or reference variable
+    const std::string &textValue(const Variable &var) {
+        return var.getType() == ValueType::REFERENCE ? var.getReference() : var.getString();
+    }
+
+    // Numeric value of a variable, if it holds one
+    std::optional<uint32_t> numberValue(const Variable &var) {
+        if (var.getType() == ValueType::NUMBER) {
+            return var.getNumber();
+        }
+        return std::nullopt;
+    }
+
+    // Append the list items of a file list group
+    void collectFileList(const Group &group, std::vector<ImageCfgView::FileEntry> &fileList) {
+        for (const auto &var: group.getVariables()) {
+            if (var->getType() != ValueType::LIST_ITEM) {
+                continue;
+            }
+
+            ImageCfgView::FileEntry entry;
+            for (const auto &item: var->getItems()) {
+                if (const auto &name = item->getName(); name == "filename") {
+                    entry.filename = textValue(*item);
+                } else if (name == "maintype") {
+                    entry.maintype = textValue(*item);
+                } else if (name == "subtype") {
+                    entry.subtype = textValue(*item);
+                }
+            }
+            fileList.push_back(std::move(entry));
+        }
+    }
+}
+
+ImageCfgView ImageCfgView::resolve(const OpenixCFG &cfg) {
+    ImageCfgView view;
+
+    for (auto group = cfg.getFirstGroup(); group; group = group->getNext()) {
+        switch (lookup(group->getName())) {
+            case Key::IMAGE_CFG:
+                for (const auto &var: group->getVariables()) {
+                    switch (lookup(var->getName())) {
+                        case Key::VERSION:
+                            view.version = numberValue(*var);
+                            break;
+                        case Key::PID:
+                            view.pid = numberValue(*var);
+                            break;
+                        case Key::VID:
+                            view.vid = numberValue(*var);
+                            break;
+                        case Key::HARDWAREID:
+                            view.hardwareId = numberValue(*var);
+                            break;
+                        case Key::FIRMWAREID:
+                            view.firmwareId = numberValue(*var);
+                            break;
+                        case Key::ENCRYPT:
+                            view.encrypt = numberValue(*var);
+                            break;
+                        case Key::IMAGENAME:
+                            view.imageName = textValue(*var);
+                            break;
+                        case Key::FILELIST_REF:
+                            if (!textValue(*var).empty()) {
+                                view.fileListName = textValue(*var);
+                            }
+                            break;
+                        default:
+                            break;
+                    }
+                }
+                break;
+            case Key::FILELIST:
+                collectFileList(*group, view.fileList);
+                break;
+            default:
+                break;
+        }
+    }
+
+    // IMAGE_CFG.filelist may point at a differently named group
+    if (view.fileListName != "FILELIST") {
+        view.fileList.clear();
+        if (const auto group = cfg.findGroup(view.fileListName)) {
+            collectFileList(*group, view.fileList);
+        }
+    }
+
+    return view;
+}
@@ -0,0 +1,54 @@
+/**
+ * @file OpenixCRC32.cpp
+ * @brief Implementation of OpenixCRC32 class methods
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#include <array>
+
+#include "OpenixCRC32.hpp"
+
+using namespace OpenixIMG;
+
+namespace {
+    constexpr uint32_t CRC32_POLYNOMIAL = 0xEDB88320;
+
+    using Crc32Tables = std::array<std::array<uint32_t, 256>, 8>;
+
+    // Table k advances a byte through k further zero bytes, so eight bytes fold in one step
+    constexpr Crc32Tables buildCrc32Tables() {
+        Crc32Tables tables{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                value = (value & 1) ? (value >> 1) ^ CRC32_POLYNOMIAL : value >> 1;
+            }
+            tables[0][i] = value;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (size_t k = 1; k < tables.size(); ++k) {
+                tables[k][i] = (tables[k - 1][i] >> 8) ^ tables[0][tables[k - 1][i] & 0xFF];
+            }
+        }
+        return tables;
+    }
+
+    constexpr auto CRC32_TABLES = buildCrc32Tables();
+}
+
+uint32_t OpenixCRC32::compute(const void *data, size_t length, const uint32_t crc) {
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    const auto &t = CRC32_TABLES;
+    uint32_t value = ~crc;
+
+    // Slicing-by-8; words are assembled byte by byte so the result does not depend on host endianness
+    for (; length >= 8; length -= 8, bytes += 8) {
+        const uint32_t low = value ^ (bytes[0] | bytes[1] << 8 | bytes[2] << 16 | static_cast<uint32_t>(bytes[3]) << 24);
+        value = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^ t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24] ^
+                t[3][bytes[4]] ^ t[2][bytes[5]] ^ t[1][bytes[6]] ^ t[0][bytes[7]];
+    }
+    for (; length > 0; --length) {
+        value = t[0][(value ^ *bytes++) & 0xFF] ^ (value >> 8);
+    }
+    return ~value;
+}
@@ -0,0 +1,44 @@
+/**
+ * @file OpenixCancellation.cpp
+ * @brief Implementation of OpenixCancellationToken class methods
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#include "OpenixCancellation.hpp"
+
+using namespace OpenixIMG;
+
+OperationCancelled::OperationCancelled(const Reason reason)
+    : std::runtime_error(reason == Reason::DEADLINE ? "Operation deadline exceeded" : "Operation cancelled"),
+      reason_(reason) {
+}
+
+OperationCancelled::Reason OperationCancelled::reason() const {
+    return reason_;
+}
+
+void OpenixCancellationToken::cancel() {
+    cancelled_.store(true, std::memory_order_relaxed);
+}
+
+void OpenixCancellationToken::setDeadline(const std::chrono::steady_clock::time_point deadline) {
+    deadline_.store(deadline.time_since_epoch().count(), std::memory_order_relaxed);
+}
+
+void OpenixCancellationToken::setTimeout(const std::chrono::steady_clock::duration timeout) {
+    setDeadline(std::chrono::steady_clock::now() + timeout);
+}
+
+bool OpenixCancellationToken::isCancelled() const {
+    return cancelled_.load(std::memory_order_relaxed) ||
+           std::chrono::steady_clock::now().time_since_epoch().count() >= deadline_.load(std::memory_order_relaxed);
+}
+
+void OpenixCancellationToken::check() const {
+    if (cancelled_.load(std::memory_order_relaxed)) {
+        throw OperationCancelled(OperationCancelled::Reason::CANCELLED);
+    }
+    if (std::chrono::steady_clock::now().time_since_epoch().count() >= deadline_.load(std::memory_order_relaxed)) {
+        throw OperationCancelled(OperationCancelled::Reason::DEADLINE);
+    }
+}
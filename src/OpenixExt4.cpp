@@ -0,0 +1,813 @@
+/**
+ * @file OpenixExt4.cpp
+ * @brief Implementation of OpenixExt4 class methods
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+
+#include "OpenixExt4.hpp"
+
+using namespace OpenixIMG;
+
+namespace {
+    constexpr uint16_t EXT4_SUPER_MAGIC = 0xEF53;
+    constexpr uint32_t EXT4_ROOT_INODE = 2;
+
+    constexpr uint32_t EXT4_FEATURE_COMPAT_DIR_INDEX = 0x0020;
+    constexpr uint32_t EXT4_FEATURE_INCOMPAT_COMPRESSION = 0x0001;
+    constexpr uint32_t EXT4_FEATURE_INCOMPAT_FILETYPE = 0x0002;
+    constexpr uint32_t EXT4_FEATURE_INCOMPAT_META_BG = 0x0010;
+    constexpr uint32_t EXT4_FEATURE_INCOMPAT_64BIT = 0x0080;
+    constexpr uint32_t EXT4_FEATURE_INCOMPAT_LARGEDIR = 0x4000;
+
+    constexpr uint32_t EXT4_INDEX_FL = 0x00001000;
+    constexpr uint32_t EXT4_EXTENTS_FL = 0x00080000;
+    constexpr uint32_t EXT4_INLINE_DATA_FL = 0x10000000;
+
+    constexpr uint16_t EXT4_EXTENT_MAGIC = 0xF30A;
+    constexpr int EXT4_EXTENT_MAX_DEPTH = 5;
+    constexpr uint16_t EXT4_EXTENT_INIT_MAX_LEN = 32768;
+
+    // Index levels of an htree, counting the root: two, or three with largedir
+    constexpr uint8_t EXT4_HTREE_LEVEL_COMPAT = 2;
+    constexpr uint8_t EXT4_HTREE_LEVEL = 3;
+
+    constexpr size_t EXT4_I_BLOCK_OFFSET = 40;
+    constexpr size_t EXT4_I_BLOCK_SIZE = 60;
+    constexpr uint32_t EXT4_XATTR_MAGIC = 0xEA020000;
+    constexpr uint8_t EXT4_XATTR_INDEX_SYSTEM = 7;
+
+    constexpr int EXT4_MAX_SYMLINKS = 40;
+    constexpr size_t EXT4_READ_CHUNK = IO_BUFFER_SIZE;
+
+    // Directory hash versions as stored in the htree root
+    enum DxHash {
+        DX_HASH_LEGACY = 0,
+        DX_HASH_HALF_MD4 = 1,
+        DX_HASH_TEA = 2,
+        DX_HASH_LEGACY_UNSIGNED = 3,
+        DX_HASH_HALF_MD4_UNSIGNED = 4,
+        DX_HASH_TEA_UNSIGNED = 5,
+    };
+
+    uint16_t getLE16(const uint8_t *in) {
+        return static_cast<uint16_t>(in[0] | in[1] << 8);
+    }
+
+    uint32_t getLE32(const uint8_t *in) {
+        return static_cast<uint32_t>(in[0]) | static_cast<uint32_t>(in[1]) << 8 |
+               static_cast<uint32_t>(in[2]) << 16 | static_cast<uint32_t>(in[3]) << 24;
+    }
+
+    uint32_t rotateLeft(const uint32_t value, const int shift) {
+        return value << shift | value >> (32 - shift);
+    }
+
+    // The hash functions below follow fs/ext4/hash.c, including its signed-char variants
+    void teaTransform(uint32_t buf[4], const uint32_t in[4]) {
+        uint32_t sum = 0;
+        uint32_t b0 = buf[0];
+        uint32_t b1 = buf[1];
+        for (int n = 0; n < 16; ++n) {
+            sum += 0x9E3779B9;
+            b0 += ((b1 << 4) + in[0]) ^ (b1 + sum) ^ ((b1 >> 5) + in[1]);
+            b1 += ((b0 << 4) + in[2]) ^ (b0 + sum) ^ ((b0 >> 5) + in[3]);
+        }
+        buf[0] += b0;
+        buf[1] += b1;
+    }
+
+    void halfMd4Transform(uint32_t buf[4], const uint32_t in[8]) {
+        auto f = [](const uint32_t x, const uint32_t y, const uint32_t z) { return z ^ (x & (y ^ z)); };
+        auto g = [](const uint32_t x, const uint32_t y, const uint32_t z) { return (x & y) + ((x ^ y) & z); };
+        auto h = [](const uint32_t x, const uint32_t y, const uint32_t z) { return x ^ y ^ z; };
+        constexpr uint32_t k2 = 013240474631U;
+        constexpr uint32_t k3 = 015666365641U;
+
+        uint32_t a = buf[0], b = buf[1], c = buf[2], d = buf[3];
+        auto round = [](auto fn, uint32_t &w, const uint32_t x, const uint32_t y, const uint32_t z,
+                        const uint32_t value, const int shift) {
+            w = rotateLeft(w + fn(x, y, z) + value, shift);
+        };
+
+        round(f, a, b, c, d, in[0], 3);
+        round(f, d, a, b, c, in[1], 7);
+        round(f, c, d, a, b, in[2], 11);
+        round(f, b, c, d, a, in[3], 19);
+        round(f, a, b, c, d, in[4], 3);
+        round(f, d, a, b, c, in[5], 7);
+        round(f, c, d, a, b, in[6], 11);
+        round(f, b, c, d, a, in[7], 19);
+
+        round(g, a, b, c, d, in[1] + k2, 3);
+        round(g, d, a, b, c, in[3] + k2, 5);
+        round(g, c, d, a, b, in[5] + k2, 9);
+        round(g, b, c, d, a, in[7] + k2, 13);
+        round(g, a, b, c, d, in[0] + k2, 3);
+        round(g, d, a, b, c, in[2] + k2, 5);
+        round(g, c, d, a, b, in[4] + k2, 9);
+        round(g, b, c, d, a, in[6] + k2, 13);
+
+        round(h, a, b, c, d, in[3] + k3, 3);
+        round(h, d, a, b, c, in[7] + k3, 9);
+        round(h, c, d, a, b, in[2] + k3, 11);
+        round(h, b, c, d, a, in[6] + k3, 15);
+        round(h, a, b, c, d, in[1] + k3, 3);
+        round(h, d, a, b, c, in[5] + k3, 9);
+        round(h, c, d, a, b, in[0] + k3, 11);
+        round(h, b, c, d, a, in[4] + k3, 15);
+
+        buf[0] += a;
+        buf[1] += b;
+        buf[2] += c;
+        buf[3] += d;
+    }
+
+    int charValue(const char c, const bool isUnsigned) {
+        return isUnsigned ? static_cast<unsigned char>(c) : static_cast<signed char>(c);
+    }
+
+    uint32_t legacyHash(const std::string &name, const bool isUnsigned) {
+        uint32_t hash0 = 0x12A3FE2D;
+        uint32_t hash1 = 0x37ABE8F9;
+        for (const auto c: name) {
+            uint32_t hash = hash1 + (hash0 ^ static_cast<uint32_t>(charValue(c, isUnsigned) * 7152373));
+            if (hash & 0x80000000) {
+                hash -= 0x7FFFFFFF;
+            }
+            hash1 = hash0;
+            hash0 = hash;
+        }
+        return hash0 << 1;
+    }
+
+    void stringToHashBuffer(const char *message, size_t length, uint32_t *buf, int words, const bool isUnsigned) {
+        uint32_t pad = static_cast<uint32_t>(length) | static_cast<uint32_t>(length) << 8;
+        pad |= pad << 16;
+
+        uint32_t value = pad;
+        length = std::min(length, static_cast<size_t>(words) * 4);
+        for (size_t i = 0; i < length; ++i) {
+            value = static_cast<uint32_t>(charValue(message[i], isUnsigned)) + (value << 8);
+            if (i % 4 == 3) {
+                *buf++ = value;
+                value = pad;
+                --words;
+            }
+        }
+        if (--words >= 0) {
+            *buf++ = value;
+        }
+        while (--words >= 0) {
+            *buf++ = pad;
+        }
+    }
+
+    bool isDotEntry(const std::string &name) {
+        return name == "." || name == "..";
+    }
+
+    std::vector<std::string> splitPath(const std::string &path) {
+        std::vector<std::string> parts;
+        size_t start = 0;
+        while (start <= path.size()) {
+            const auto end = std::min(path.find('/', start), path.size());
+            if (end > start) {
+                parts.push_back(path.substr(start, end - start));
+            }
+            start = end + 1;
+        }
+        return parts;
+    }
+
+    // Targets shorter than i_block are stored in it instead of in a data block
+    bool isFastSymlink(const Ext4Inode &inode) {
+        return inode.isSymlink() && !(inode.flags & EXT4_INLINE_DATA_FL) && inode.size < EXT4_I_BLOCK_SIZE;
+    }
+}
+
+bool Ext4Inode::isDirectory() const {
+    return (mode & 0xF000) == 0x4000;
+}
+
+bool Ext4Inode::isRegular() const {
+    return (mode & 0xF000) == 0x8000;
+}
+
+bool Ext4Inode::isSymlink() const {
+    return (mode & 0xF000) == 0xA000;
+}
+
+OpenixExt4::OpenixExt4(RangeReader reader, const size_t cacheBlocks)
+    : reader_(std::move(reader)), cacheBlocks_(std::max<size_t>(cacheBlocks, 1)) {
+    uint8_t super[1024];
+    readExact(1024, super, sizeof(super));
+    if (getLE16(super + 56) != EXT4_SUPER_MAGIC) {
+        throw std::runtime_error("Not an ext2/3/4 volume: bad superblock magic");
+    }
+
+    const auto logBlockSize = getLE32(super + 24);
+    if (logBlockSize > 6) {
+        throw std::runtime_error("Unsupported ext4 block size");
+    }
+    blockSize_ = 1024U << logBlockSize;
+    inodeCount_ = getLE32(super + 0);
+    inodesPerGroup_ = getLE32(super + 40);
+    inodeSize_ = getLE32(super + 76) == 0 ? 128 : getLE16(super + 88);
+    incompat_ = getLE32(super + 96);
+    descriptorSize_ = incompat_ & EXT4_FEATURE_INCOMPAT_64BIT ? std::max<uint32_t>(getLE16(super + 254), 32) : 32;
+    firstDescriptorBlock_ = static_cast<uint64_t>(getLE32(super + 20)) + 1;
+
+    if (inodesPerGroup_ == 0 || inodeSize_ < 128 || inodeSize_ > blockSize_ || (inodeSize_ & (inodeSize_ - 1)) != 0 ||
+        descriptorSize_ > blockSize_) {
+        throw std::runtime_error("Not an ext2/3/4 volume: invalid superblock");
+    }
+    if (incompat_ & (EXT4_FEATURE_INCOMPAT_COMPRESSION | EXT4_FEATURE_INCOMPAT_META_BG)) {
+        throw std::runtime_error("Unsupported ext4 features: compression or meta_bg");
+    }
+
+    // Hashed lookups are only used when the volume advertises directory indexes
+    if (getLE32(super + 92) & EXT4_FEATURE_COMPAT_DIR_INDEX) {
+        for (int i = 0; i < 4; ++i) {
+            hashSeed_[i] = getLE32(super + 236 + i * 4);
+        }
+        unsignedHash_ = (getLE32(super + 352) & 0x2) != 0;
+        dirIndex_ = true;
+    }
+}
+
+OpenixExt4::OpenixExt4(const OpenixIMGFile &image, const size_t index, const size_t cacheBlocks)
+    : OpenixExt4([&image, index, file = std::make_shared<OpenixFileIO>(image.getImageFilePath())](
+                     const uint64_t offset, void *data, const size_t length) {
+        return image.readEntryRange(*file, index, offset, data, length);
+    }, cacheBlocks) {
+}
+
+uint32_t OpenixExt4::blockSize() const {
+    return blockSize_;
+}
+
+Ext4Inode OpenixExt4::readInode(const uint32_t number) const {
+    if (number == 0 || number > inodeCount_) {
+        throw std::runtime_error("Inode number out of range: " + std::to_string(number));
+    }
+
+    const auto group = (number - 1) / inodesPerGroup_;
+    const auto slot = (number - 1) % inodesPerGroup_;
+
+    const uint64_t descriptorOffset = static_cast<uint64_t>(group) * descriptorSize_;
+    const auto descriptors = readBlock(firstDescriptorBlock_ + descriptorOffset / blockSize_);
+    const uint8_t *descriptor = descriptors->data() + descriptorOffset % blockSize_;
+    uint64_t inodeTable = getLE32(descriptor + 8);
+    if (descriptorSize_ >= 64) {
+        inodeTable |= static_cast<uint64_t>(getLE32(descriptor + 0x28)) << 32;
+    }
+
+    const uint64_t inodeOffset = static_cast<uint64_t>(slot) * inodeSize_;
+    const auto table = readBlock(inodeTable + inodeOffset / blockSize_);
+    const uint8_t *raw = table->data() + inodeOffset % blockSize_;
+
+    Ext4Inode inode;
+    inode.number = number;
+    inode.raw.assign(raw, raw + inodeSize_);
+    inode.mode = getLE16(raw);
+    inode.uid = getLE16(raw + 2) | static_cast<uint32_t>(getLE16(raw + 120)) << 16;
+    inode.gid = getLE16(raw + 24) | static_cast<uint32_t>(getLE16(raw + 122)) << 16;
+    inode.size = getLE32(raw + 4) | static_cast<uint64_t>(getLE32(raw + 108)) << 32;
+    inode.mtime = getLE32(raw + 16);
+    inode.flags = getLE32(raw + 32);
+    return inode;
+}
+
+std::optional<Ext4Inode> OpenixExt4::find(const std::string &path, const bool followLast) const {
+    // Inodes from the root to the current directory, so ".." never needs a lookup
+    std::vector<uint32_t> stack{EXT4_ROOT_INODE};
+    const auto parts = splitPath(path);
+    std::deque<std::string> pending(parts.begin(), parts.end());
+    int links = 0;
+
+    while (!pending.empty()) {
+        const auto name = pending.front();
+        pending.pop_front();
+        if (name == ".") {
+            continue;
+        }
+        if (name == "..") {
+            if (stack.size() > 1) {
+                stack.pop_back();
+            }
+            continue;
+        }
+
+        const auto directory = readInode(stack.back());
+        if (!directory.isDirectory()) {
+            return std::nullopt;
+        }
+        const auto child = lookup(directory, name);
+        if (!child) {
+            return std::nullopt;
+        }
+
+        const auto inode = readInode(*child);
+        if (inode.isSymlink() && (followLast || !pending.empty())) {
+            if (++links > EXT4_MAX_SYMLINKS) {
+                throw std::runtime_error("Too many levels of symbolic links: " + path);
+            }
+            const auto target = readLink(inode);
+            const auto targetParts = splitPath(target);
+            pending.insert(pending.begin(), targetParts.begin(), targetParts.end());
+            if (!target.empty() && target.front() == '/') {
+                stack.resize(1);
+            }
+            continue;
+        }
+        stack.push_back(*child);
+    }
+
+    return readInode(stack.back());
+}
+
+std::vector<Ext4Entry> OpenixExt4::list(const std::string &path) const {
+    const auto directory = find(path);
+    if (!directory) {
+        throw std::runtime_error("No such file or directory: " + path);
+    }
+    if (!directory->isDirectory()) {
+        throw std::runtime_error("Not a directory: " + path);
+    }
+
+    auto entries = readDirectory(*directory);
+    entries.erase(std::remove_if(entries.begin(), entries.end(), [](const Ext4Entry &entry) {
+        return isDotEntry(entry.name);
+    }), entries.end());
+    return entries;
+}
+
+std::string OpenixExt4::readLink(const Ext4Inode &inode) const {
+    if (!inode.isSymlink()) {
+        throw std::runtime_error("Not a symbolic link: inode " + std::to_string(inode.number));
+    }
+
+    std::string target;
+    extract(inode, [&target](const uint8_t *chunk, const size_t length) {
+        target.append(reinterpret_cast<const char *>(chunk), length);
+    });
+    return target;
+}
+
+uint64_t OpenixExt4::extract(const Ext4Inode &inode, const OpenixIMGFile::ChunkSink &sink) const {
+    if (isFastSymlink(inode)) {
+        sink(inode.raw.data() + EXT4_I_BLOCK_OFFSET, static_cast<size_t>(inode.size));
+        return inode.size;
+    }
+    if (inode.flags & EXT4_INLINE_DATA_FL) {
+        const auto data = inlineData(inode);
+        sink(data.data(), data.size());
+        return data.size();
+    }
+
+    const uint64_t size = inode.size;
+    std::vector<uint8_t> buffer(static_cast<size_t>(std::min<uint64_t>(
+        std::max<uint64_t>(EXT4_READ_CHUNK / blockSize_, 1) * blockSize_, std::max<uint64_t>(size, 1))));
+    uint64_t delivered = 0;
+
+    const auto emitZeros = [&](const uint64_t length) {
+        std::fill(buffer.begin(), buffer.end(), 0);
+        for (uint64_t left = length; left > 0;) {
+            const auto piece = static_cast<size_t>(std::min<uint64_t>(left, buffer.size()));
+            sink(buffer.data(), piece);
+            left -= piece;
+        }
+        delivered += length;
+    };
+
+    for (const auto &run: mapBlocks(inode)) {
+        const uint64_t runStart = run.logical * blockSize_;
+        if (runStart >= size) {
+            break;
+        }
+        if (runStart + run.count * blockSize_ <= delivered) {
+            continue;
+        }
+
+        // Holes between runs
+        if (runStart > delivered) {
+            emitZeros(runStart - delivered);
+        }
+
+        const uint64_t skip = delivered - runStart;
+        const uint64_t end = std::min(runStart + run.count * blockSize_, size);
+        if (!run.initialized) {
+            emitZeros(end - delivered);
+            continue;
+        }
+
+        uint64_t offset = run.physical * blockSize_ + skip;
+        while (delivered < end) {
+            const auto piece = static_cast<size_t>(std::min<uint64_t>(end - delivered, buffer.size()));
+            readExact(offset, buffer.data(), piece);
+            sink(buffer.data(), piece);
+            offset += piece;
+            delivered += piece;
+        }
+    }
+
+    // Trailing hole
+    if (delivered < size) {
+        emitZeros(size - delivered);
+    }
+    return delivered;
+}
+
+std::vector<uint8_t> OpenixExt4::readFile(const std::string &path) const {
+    const auto inode = find(path);
+    if (!inode) {
+        throw std::runtime_error("No such file or directory: " + path);
+    }
+    if (inode->isDirectory()) {
+        throw std::runtime_error("Is a directory: " + path);
+    }
+
+    std::vector<uint8_t> data;
+    data.reserve(static_cast<size_t>(inode->size));
+    extract(*inode, [&data](const uint8_t *chunk, const size_t length) {
+        data.insert(data.end(), chunk, chunk + length);
+    });
+    return data;
+}
+
+void OpenixExt4::readExact(const uint64_t offset, void *data, const size_t length) const {
+    if (reader_(offset, data, length) != length) {
+        throw std::runtime_error("ext4 volume truncated at offset " + std::to_string(offset));
+    }
+}
+
+OpenixExt4::Block OpenixExt4::readBlock(const uint64_t block) const {
+    if (const auto cached = cacheIndex_.find(block); cached != cacheIndex_.end()) {
+        cache_.splice(cache_.begin(), cache_, cached->second);
+        return cached->second->second;
+    }
+
+    auto data = std::make_shared<std::vector<uint8_t> >(blockSize_);
+    readExact(block * blockSize_, data->data(), data->size());
+
+    cache_.emplace_front(block, data);
+    cacheIndex_[block] = cache_.begin();
+    if (cache_.size() > cacheBlocks_) {
+        cacheIndex_.erase(cache_.back().first);
+        cache_.pop_back();
+    }
+    return data;
+}
+
+std::vector<OpenixExt4::Run> OpenixExt4::mapBlocks(const Ext4Inode &inode) const {
+    std::vector<Run> runs;
+    const uint8_t *blocks = inode.raw.data() + EXT4_I_BLOCK_OFFSET;
+
+    if (inode.flags & EXT4_EXTENTS_FL) {
+        mapExtents(blocks, EXT4_I_BLOCK_SIZE, 0, runs);
+        return runs;
+    }
+
+    // Legacy block map: 12 direct blocks, then single, double and triple indirect blocks
+    const uint64_t limit = (inode.size + blockSize_ - 1) / blockSize_;
+    for (uint64_t i = 0; i < 12 && i < limit; ++i) {
+        if (const auto block = getLE32(blocks + i * 4); block != 0) {
+            addRun(runs, i, block, 1, true);
+        }
+    }
+
+    const uint64_t perBlock = blockSize_ / 4;
+    mapIndirect(getLE32(blocks + 48), 1, 12, limit, runs);
+    mapIndirect(getLE32(blocks + 52), 2, 12 + perBlock, limit, runs);
+    mapIndirect(getLE32(blocks + 56), 3, 12 + perBlock + perBlock * perBlock, limit, runs);
+    return runs;
+}
+
+void OpenixExt4::mapExtents(const uint8_t *node, const size_t length, const int depth, std::vector<Run> &runs) const {
+    if (length < 12 || getLE16(node) != EXT4_EXTENT_MAGIC || depth > EXT4_EXTENT_MAX_DEPTH) {
+        throw std::runtime_error("Corrupt extent tree");
+    }
+    const auto entries = getLE16(node + 2);
+    const auto treeDepth = getLE16(node + 6);
+    if (12 + static_cast<size_t>(entries) * 12 > length) {
+        throw std::runtime_error("Corrupt extent tree");
+    }
+
+    for (uint16_t i = 0; i < entries; ++i) {
+        const uint8_t *entry = node + 12 + i * 12;
+        if (treeDepth == 0) {
+            uint32_t count = getLE16(entry + 4);
+            const bool initialized = count <= EXT4_EXTENT_INIT_MAX_LEN;
+            if (!initialized) {
+                count -= EXT4_EXTENT_INIT_MAX_LEN;
+            }
+            const uint64_t start = static_cast<uint64_t>(getLE16(entry + 6)) << 32 | getLE32(entry + 8);
+            addRun(runs, getLE32(entry), start, count, initialized);
+        } else {
+            const uint64_t leaf = getLE32(entry + 4) | static_cast<uint64_t>(getLE16(entry + 8)) << 32;
+            const auto child = readBlock(leaf);
+            mapExtents(child->data(), child->size(), depth + 1, runs);
+        }
+    }
+}
+
+void OpenixExt4::mapIndirect(const uint32_t block, const int level, const uint64_t logical, const uint64_t limit,
+                             std::vector<Run> &runs) const {
+    if (block == 0 || logical >= limit) {
+        return;
+    }
+
+    const auto data = readBlock(block);
+    const uint64_t perBlock = blockSize_ / 4;
+    uint64_t span = 1;
+    for (int i = 1; i < level; ++i) {
+        span *= perBlock;
+    }
+
+    for (uint64_t i = 0; i < perBlock; ++i) {
+        const uint64_t first = logical + i * span;
+        if (first >= limit) {
+            break;
+        }
+        const auto target = getLE32(data->data() + i * 4);
+        if (target == 0) {
+            continue;
+        }
+        if (level == 1) {
+            addRun(runs, first, target, 1, true);
+        } else {
+            mapIndirect(target, level - 1, first, limit, runs);
+        }
+    }
+}
+
+std::vector<uint8_t> OpenixExt4::inlineData(const Ext4Inode &inode) const {
+    const uint8_t *raw = inode.raw.data();
+    const auto head = static_cast<size_t>(std::min<uint64_t>(inode.size, EXT4_I_BLOCK_SIZE));
+    std::vector<uint8_t> data(raw + EXT4_I_BLOCK_OFFSET, raw + EXT4_I_BLOCK_OFFSET + head);
+    if (inode.size <= EXT4_I_BLOCK_SIZE || inode.raw.size() <= 132) {
+        return data;
+    }
+
+    // The rest is the value of the system.data attribute stored after the inode's extra fields
+    const size_t start = 128 + getLE16(raw + 128);
+    if (start + 4 > inode.raw.size() || getLE32(raw + start) != EXT4_XATTR_MAGIC) {
+        return data;
+    }
+
+    const size_t entries = start + 4;
+    for (size_t pos = entries; pos + 16 <= inode.raw.size() && getLE32(raw + pos) != 0;) {
+        const auto nameLength = raw[pos];
+        const auto nameIndex = raw[pos + 1];
+        const auto valueOffset = getLE16(raw + pos + 2);
+        const auto valueSize = getLE32(raw + pos + 8);
+        if (pos + 16 + nameLength > inode.raw.size()) {
+            break;
+        }
+
+        const std::string name(reinterpret_cast<const char *>(raw + pos + 16), nameLength);
+        if (nameIndex == EXT4_XATTR_INDEX_SYSTEM && name == "data") {
+            const auto wanted = static_cast<size_t>(std::min<uint64_t>(valueSize, inode.size - head));
+            if (entries + valueOffset + wanted > inode.raw.size()) {
+                throw std::runtime_error("Corrupt inline data in inode " + std::to_string(inode.number));
+            }
+            data.insert(data.end(), raw + entries + valueOffset, raw + entries + valueOffset + wanted);
+            break;
+        }
+        pos += (16 + nameLength + 3) & ~size_t{3};
+    }
+    return data;
+}
+
+void OpenixExt4::parseEntries(const uint8_t *data, const size_t length, std::vector<Ext4Entry> &entries) const {
+    const bool fileType = (incompat_ & EXT4_FEATURE_INCOMPAT_FILETYPE) != 0;
+
+    for (size_t pos = 0; pos + 8 <= length;) {
+        size_t recordLength = getLE16(data + pos + 4);
+        if (recordLength == 0 || recordLength == 65535) {
+            // 64 KiB blocks store a record spanning the whole block this way
+            recordLength = length - pos;
+        }
+        if (recordLength < 8 || pos + recordLength > length) {
+            break;
+        }
+
+        const auto inode = getLE32(data + pos);
+        const size_t nameLength = fileType ? data[pos + 6] : getLE16(data + pos + 6);
+        if (inode != 0 && nameLength != 0 && 8 + nameLength <= recordLength) {
+            Ext4Entry entry;
+            entry.name.assign(reinterpret_cast<const char *>(data + pos + 8), nameLength);
+            entry.inode = inode;
+            entry.fileType = fileType ? data[pos + 7] : 0;
+            entries.push_back(std::move(entry));
+        }
+        pos += recordLength;
+    }
+}
+
+std::vector<Ext4Entry> OpenixExt4::readDirectory(const Ext4Inode &directory) const {
+    std::vector<Ext4Entry> entries;
+
+    if (directory.flags & EXT4_INLINE_DATA_FL) {
+        // Inline directories start with the parent's inode number instead of "." and ".."
+        const auto data = inlineData(directory);
+        if (data.size() < 4) {
+            return entries;
+        }
+        entries.push_back({"..", getLE32(data.data()), 2});
+        const auto head = std::min<size_t>(data.size(), EXT4_I_BLOCK_SIZE);
+        parseEntries(data.data() + 4, head - 4, entries);
+        parseEntries(data.data() + head, data.size() - head, entries);
+        return entries;
+    }
+
+    const uint64_t blocks = (directory.size + blockSize_ - 1) / blockSize_;
+    for (const auto &run: mapBlocks(directory)) {
+        for (uint64_t i = 0; i < run.count && run.logical + i < blocks; ++i) {
+            const auto block = readBlock(run.physical + i);
+            parseEntries(block->data(), block->size(), entries);
+        }
+    }
+    return entries;
+}
+
+std::optional<uint32_t> OpenixExt4::lookup(const Ext4Inode &directory, const std::string &name) const {
+    if (dirIndex_ && (directory.flags & EXT4_INDEX_FL) && !(directory.flags & EXT4_INLINE_DATA_FL)) {
+        bool indexed = true;
+        const auto runs = mapBlocks(directory);
+        const auto inode = lookupHashed(runs, name, indexed);
+        if (indexed) {
+            return inode;
+        }
+    }
+
+    for (const auto &entry: readDirectory(directory)) {
+        if (entry.name == name) {
+            return entry.inode;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<uint32_t> OpenixExt4::lookupHashed(const std::vector<Run> &runs, const std::string &name,
+                                                 bool &indexed) const {
+    indexed = false;
+    const auto rootBlock = physicalBlock(runs, 0);
+    if (!rootBlock) {
+        return std::nullopt;
+    }
+
+    // dx_root: "." and ".." entries, then the root info and the first index entries
+    const auto root = readBlock(*rootBlock);
+    const uint8_t *info = root->data() + 0x18;
+    int version = info[4];
+    const auto infoLength = info[5];
+    const auto levels = info[6];
+    if (infoLength != 8) {
+        return std::nullopt;
+    }
+    if (levels >= (incompat_ & EXT4_FEATURE_INCOMPAT_LARGEDIR ? EXT4_HTREE_LEVEL : EXT4_HTREE_LEVEL_COMPAT)) {
+        throw std::runtime_error("Unsupported directory index depth: " + std::to_string(levels + 1) + " levels");
+    }
+    if (unsignedHash_ && version <= DX_HASH_TEA) {
+        version += DX_HASH_LEGACY_UNSIGNED;
+    }
+
+    uint32_t hash;
+    if (!nameHash(name, version, hash)) {
+        return std::nullopt;
+    }
+
+    auto node = root;
+    size_t offset = 0x18 + infoLength;
+    for (int level = 0;; ++level) {
+        const uint8_t *table = node->data() + offset;
+        const auto limit = getLE16(table);
+        const auto count = getLE16(table + 2);
+        if (count == 0 || count > limit || offset + static_cast<size_t>(count) * 8 > node->size()) {
+            return std::nullopt;
+        }
+
+        // Last index entry whose hash is not above ours; entry 0 covers everything below entry 1
+        const auto entryHash = [table](const size_t i) { return getLE32(table + i * 8); };
+        const auto entryBlock = [table](const size_t i) { return getLE32(table + i * 8 + 4) & 0x0FFFFFFF; };
+        size_t low = 1;
+        size_t high = count;
+        while (low < high) {
+            const auto middle = low + (high - low) / 2;
+            if (entryHash(middle) > hash) {
+                high = middle;
+            } else {
+                low = middle + 1;
+            }
+        }
+        size_t at = low - 1;
+
+        if (level < levels) {
+            const auto child = physicalBlock(runs, entryBlock(at));
+            if (!child) {
+                return std::nullopt;
+            }
+            node = readBlock(*child);
+            offset = 8; // Behind the empty directory entry that hides the node from old readers
+            continue;
+        }
+
+        // Names with equal hashes may continue in the following leaves, marked by the low hash bit
+        while (true) {
+            const auto leaf = physicalBlock(runs, entryBlock(at));
+            if (!leaf) {
+                return std::nullopt;
+            }
+            const auto block = readBlock(*leaf);
+            std::vector<Ext4Entry> entries;
+            parseEntries(block->data(), block->size(), entries);
+            for (const auto &entry: entries) {
+                if (entry.name == name) {
+                    indexed = true;
+                    return entry.inode;
+                }
+            }
+
+            if (at + 1 >= count) {
+                // The collision chain may cross into the next index node: scan instead
+                return std::nullopt;
+            }
+            const auto nextHash = entryHash(++at);
+            if ((nextHash & 1) == 0 || (nextHash & ~1U) != hash) {
+                indexed = true;
+                return std::nullopt;
+            }
+        }
+    }
+}
+
+bool OpenixExt4::nameHash(const std::string &name, const int version, uint32_t &hash) const {
+    uint32_t buf[4] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476};
+    if (hashSeed_[0] || hashSeed_[1] || hashSeed_[2] || hashSeed_[3]) {
+        std::memcpy(buf, hashSeed_, sizeof(buf));
+    }
+
+    const bool isUnsigned = version >= DX_HASH_LEGACY_UNSIGNED;
+    switch (version) {
+        case DX_HASH_LEGACY:
+        case DX_HASH_LEGACY_UNSIGNED:
+            hash = legacyHash(name, isUnsigned);
+            break;
+        case DX_HASH_HALF_MD4:
+        case DX_HASH_HALF_MD4_UNSIGNED:
+            for (size_t pos = 0; pos < name.size(); pos += 32) {
+                uint32_t in[8];
+                stringToHashBuffer(name.data() + pos, name.size() - pos, in, 8, isUnsigned);
+                halfMd4Transform(buf, in);
+            }
+            hash = buf[1];
+            break;
+        case DX_HASH_TEA:
+        case DX_HASH_TEA_UNSIGNED:
+            for (size_t pos = 0; pos < name.size(); pos += 16) {
+                uint32_t in[4];
+                stringToHashBuffer(name.data() + pos, name.size() - pos, in, 4, isUnsigned);
+                teaTransform(buf, in);
+            }
+            hash = buf[0];
+            break;
+        default:
+            // SipHash for casefolded or encrypted directories needs keys this reader does not have
+            return false;
+    }
+
+    hash &= ~1U;
+    if (hash == 0x7FFFFFFFU << 1) {
+        hash = (0x7FFFFFFFU - 1) << 1;
+    }
+    return true;
+}
+
+void OpenixExt4::addRun(std::vector<Run> &runs, const uint64_t logical, const uint64_t physical, const uint64_t count,
+                        const bool initialized) {
+    if (!runs.empty()) {
+        auto &last = runs.back();
+        if (last.logical + last.count == logical && last.physical + last.count == physical &&
+            last.initialized == initialized) {
+            last.count += count;
+            return;
+        }
+    }
+    runs.push_back({logical, physical, count, initialized});
+}
+
+std::optional<uint64_t> OpenixExt4::physicalBlock(const std::vector<Run> &runs, const uint64_t logical) {
+    for (const auto &run: runs) {
+        if (logical >= run.logical && logical < run.logical + run.count) {
+            return run.physical + (logical - run.logical);
+        }
+    }
+    return std::nullopt;
+}
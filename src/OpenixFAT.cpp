@@ -0,0 +1,406 @@
+/**
+ * @file OpenixFAT.cpp
+ * @brief Implementation of OpenixFAT class methods
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <memory>
+#include <stdexcept>
+
+#include "OpenixFAT.hpp"
+
+using namespace OpenixIMG;
+
+namespace {
+    constexpr size_t FAT_DIR_ENTRY_SIZE = 32;
+    constexpr uint8_t FAT_ATTR_VOLUME_ID = 0x08;
+    constexpr uint8_t FAT_ATTR_LONG_NAME = 0x0F;
+    constexpr uint8_t FAT_DELETED = 0xE5;
+
+    uint16_t getLE16(const uint8_t *in) {
+        return static_cast<uint16_t>(in[0] | in[1] << 8);
+    }
+
+    uint32_t getLE32(const uint8_t *in) {
+        return static_cast<uint32_t>(in[0]) | static_cast<uint32_t>(in[1]) << 8 |
+               static_cast<uint32_t>(in[2]) << 16 | static_cast<uint32_t>(in[3]) << 24;
+    }
+
+    bool powerOfTwo(const uint32_t value) {
+        return value != 0 && (value & (value - 1)) == 0;
+    }
+
+    void appendUtf8(std::string &out, const uint32_t code) {
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xC0 | code >> 6);
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            out += static_cast<char>(0xE0 | code >> 12);
+            out += static_cast<char>(0x80 | (code >> 6 & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | code >> 18);
+            out += static_cast<char>(0x80 | (code >> 12 & 0x3F));
+            out += static_cast<char>(0x80 | (code >> 6 & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+
+    // Long names are stored as UTF-16, terminated by 0x0000 and padded with 0xFFFF
+    std::string utf16ToUtf8(const std::vector<uint16_t> &units) {
+        std::string out;
+        for (size_t i = 0; i < units.size() && units[i] != 0; ++i) {
+            uint32_t code = units[i];
+            if (code >= 0xD800 && code < 0xDC00 && i + 1 < units.size() && units[i + 1] >= 0xDC00 &&
+                units[i + 1] < 0xE000) {
+                code = 0x10000 + ((code - 0xD800) << 10) + (units[++i] - 0xDC00);
+            }
+            appendUtf8(out, code);
+        }
+        return out;
+    }
+
+    // Checksum of the 11-byte short name that ties long name entries to their short entry
+    uint8_t shortNameChecksum(const uint8_t *name) {
+        uint8_t sum = 0;
+        for (int i = 0; i < 11; ++i) {
+            sum = static_cast<uint8_t>(((sum & 1) << 7) + (sum >> 1) + name[i]);
+        }
+        return sum;
+    }
+
+    std::string decodeShortName(const uint8_t *entry) {
+        // Windows NT marks all-lowercase base names and extensions with these flags
+        const bool lowerBase = (entry[12] & 0x08) != 0;
+        const bool lowerExt = (entry[12] & 0x10) != 0;
+
+        std::string base;
+        for (int i = 0; i < 8; ++i) {
+            auto c = static_cast<char>(i == 0 && entry[0] == 0x05 ? FAT_DELETED : entry[i]);
+            base += lowerBase ? static_cast<char>(std::tolower(static_cast<unsigned char>(c))) : c;
+        }
+        std::string ext;
+        for (int i = 8; i < 11; ++i) {
+            const auto c = static_cast<char>(entry[i]);
+            ext += lowerExt ? static_cast<char>(std::tolower(static_cast<unsigned char>(c))) : c;
+        }
+        base.erase(base.find_last_not_of(' ') + 1);
+        ext.erase(ext.find_last_not_of(' ') + 1);
+        return ext.empty() ? base : base + "." + ext;
+    }
+
+    bool sameName(const std::string &a, const std::string &b) {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](const char x, const char y) {
+            return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+        });
+    }
+
+    std::vector<std::string> splitPath(const std::string &path) {
+        std::vector<std::string> parts;
+        std::string part;
+        for (const auto c: path) {
+            if (c == '/' || c == '\\') {
+                if (!part.empty()) {
+                    parts.push_back(part);
+                }
+                part.clear();
+            } else {
+                part += c;
+            }
+        }
+        if (!part.empty()) {
+            parts.push_back(part);
+        }
+        return parts;
+    }
+}
+
+bool FatEntry::isDirectory() const {
+    return (attributes & 0x10) != 0;
+}
+
+OpenixFAT::OpenixFAT(RangeReader reader) : reader_(std::move(reader)) {
+    uint8_t boot[512];
+    readExact(0, boot, sizeof(boot));
+    if (boot[510] != 0x55 || boot[511] != 0xAA) {
+        throw std::runtime_error("Not a FAT volume: missing boot sector signature");
+    }
+
+    const uint32_t bytesPerSector = getLE16(boot + 11);
+    const uint32_t sectorsPerCluster = boot[13];
+    const uint32_t reservedSectors = getLE16(boot + 14);
+    const uint32_t fatCount = boot[16];
+    rootEntries_ = getLE16(boot + 17);
+    const uint32_t totalSectors = getLE16(boot + 19) != 0 ? getLE16(boot + 19) : getLE32(boot + 32);
+    const uint32_t fatSectors = getLE16(boot + 22) != 0 ? getLE16(boot + 22) : getLE32(boot + 36);
+
+    if (bytesPerSector < 512 || bytesPerSector > 4096 || !powerOfTwo(bytesPerSector) ||
+        !powerOfTwo(sectorsPerCluster) || reservedSectors == 0 || fatCount == 0 || fatSectors == 0) {
+        throw std::runtime_error("Not a FAT volume: invalid BIOS parameter block");
+    }
+
+    const uint32_t rootSectors = (rootEntries_ * FAT_DIR_ENTRY_SIZE + bytesPerSector - 1) / bytesPerSector;
+    const uint64_t firstDataSector = reservedSectors + static_cast<uint64_t>(fatCount) * fatSectors + rootSectors;
+    if (firstDataSector >= totalSectors) {
+        throw std::runtime_error("Not a FAT volume: no data area");
+    }
+
+    clusterSize_ = bytesPerSector * sectorsPerCluster;
+    clusterCount_ = static_cast<uint32_t>((totalSectors - firstDataSector) / sectorsPerCluster);
+    rootOffset_ = (reservedSectors + static_cast<uint64_t>(fatCount) * fatSectors) * bytesPerSector;
+    dataOffset_ = firstDataSector * bytesPerSector;
+
+    // The cluster count alone decides the variant, whatever the boot sector claims
+    if (clusterCount_ < 4085) {
+        type_ = FatType::FAT12;
+    } else if (clusterCount_ < 65525) {
+        type_ = FatType::FAT16;
+    } else {
+        type_ = FatType::FAT32;
+        rootCluster_ = getLE32(boot + 44);
+    }
+
+    // Only the part of the FAT that describes existing clusters is loaded
+    const uint64_t entries = static_cast<uint64_t>(clusterCount_) + 2;
+    const uint64_t neededBytes = type_ == FatType::FAT12
+                                     ? (entries * 3 + 1) / 2
+                                     : entries * (type_ == FatType::FAT16 ? 2 : 4);
+    fat_.resize(static_cast<size_t>(std::min<uint64_t>(neededBytes, static_cast<uint64_t>(fatSectors) * bytesPerSector)));
+    readExact(static_cast<uint64_t>(reservedSectors) * bytesPerSector, fat_.data(), fat_.size());
+}
+
+OpenixFAT::OpenixFAT(const OpenixIMGFile &image, const size_t index)
+    : OpenixFAT([&image, index, file = std::make_shared<OpenixFileIO>(image.getImageFilePath())](
+                     const uint64_t offset, void *data, const size_t length) {
+        return image.readEntryRange(*file, index, offset, data, length);
+    }) {
+}
+
+FatType OpenixFAT::type() const {
+    return type_;
+}
+
+std::optional<FatEntry> OpenixFAT::find(const std::string &path) const {
+    FatEntry current;
+    current.name = "/";
+    current.attributes = 0x10;
+
+    for (const auto &part: splitPath(path)) {
+        if (!current.isDirectory()) {
+            return std::nullopt;
+        }
+        const auto entries = readDirectory(current.firstCluster);
+        const auto match = std::find_if(entries.begin(), entries.end(), [&part](const FatEntry &entry) {
+            return sameName(entry.name, part) || sameName(entry.shortName, part);
+        });
+        if (match == entries.end()) {
+            return std::nullopt;
+        }
+        current = *match;
+    }
+    return current;
+}
+
+std::vector<FatEntry> OpenixFAT::list(const std::string &path) const {
+    const auto entry = find(path);
+    if (!entry) {
+        throw std::runtime_error("No such file or directory: " + path);
+    }
+    if (!entry->isDirectory()) {
+        throw std::runtime_error("Not a directory: " + path);
+    }
+    return readDirectory(entry->firstCluster);
+}
+
+uint64_t OpenixFAT::extract(const FatEntry &entry, const OpenixIMGFile::ChunkSink &sink) const {
+    if (entry.size == 0) {
+        return 0;
+    }
+
+    const uint64_t clusters = (static_cast<uint64_t>(entry.size) + clusterSize_ - 1) / clusterSize_;
+    const auto runs = clusterRuns(entry.firstCluster, clusters);
+
+    // Contiguous runs are read in pieces of at most IO_BUFFER_SIZE to bound memory use
+    const auto piece = std::max<uint64_t>(clusterSize_, IO_BUFFER_SIZE / clusterSize_ * clusterSize_);
+    std::vector<uint8_t> buffer(static_cast<size_t>(std::min<uint64_t>(piece, clusters * clusterSize_)));
+
+    uint64_t delivered = 0;
+    for (const auto &[first, count]: runs) {
+        uint64_t offset = clusterOffset(first);
+        uint64_t remaining = std::min<uint64_t>(static_cast<uint64_t>(count) * clusterSize_, entry.size - delivered);
+        while (remaining > 0) {
+            const auto length = static_cast<size_t>(std::min<uint64_t>(remaining, buffer.size()));
+            readExact(offset, buffer.data(), length);
+            sink(buffer.data(), length);
+            offset += length;
+            remaining -= length;
+            delivered += length;
+        }
+    }
+
+    if (delivered != entry.size) {
+        throw std::runtime_error("Cluster chain of " + entry.name + " is shorter than the file");
+    }
+    return delivered;
+}
+
+std::vector<uint8_t> OpenixFAT::readFile(const std::string &path) const {
+    const auto entry = find(path);
+    if (!entry) {
+        throw std::runtime_error("No such file or directory: " + path);
+    }
+    if (entry->isDirectory()) {
+        throw std::runtime_error("Is a directory: " + path);
+    }
+
+    std::vector<uint8_t> data;
+    data.reserve(entry->size);
+    extract(*entry, [&data](const uint8_t *chunk, const size_t length) {
+        data.insert(data.end(), chunk, chunk + length);
+    });
+    return data;
+}
+
+void OpenixFAT::readExact(const uint64_t offset, void *data, const size_t length) const {
+    if (reader_(offset, data, length) != length) {
+        throw std::runtime_error("FAT volume truncated at offset " + std::to_string(offset));
+    }
+}
+
+uint32_t OpenixFAT::nextCluster(const uint32_t cluster) const {
+    uint32_t next;
+    uint32_t endOfChain;
+    switch (type_) {
+        case FatType::FAT12: {
+            const size_t offset = cluster + cluster / 2;
+            if (offset + 1 >= fat_.size()) {
+                return 0;
+            }
+            const auto pair = getLE16(fat_.data() + offset);
+            next = cluster & 1 ? pair >> 4 : pair & 0x0FFF;
+            endOfChain = 0x0FF7;
+            break;
+        }
+        case FatType::FAT16:
+            if (cluster * size_t{2} + 1 >= fat_.size()) {
+                return 0;
+            }
+            next = getLE16(fat_.data() + cluster * size_t{2});
+            endOfChain = 0xFFF7;
+            break;
+        default:
+            if (cluster * size_t{4} + 3 >= fat_.size()) {
+                return 0;
+            }
+            next = getLE32(fat_.data() + cluster * size_t{4}) & 0x0FFFFFFF;
+            endOfChain = 0x0FFFFFF7;
+            break;
+    }
+
+    // Free, reserved, bad and end-of-chain markers all end the chain
+    if (next < 2 || next >= endOfChain || next >= clusterCount_ + 2) {
+        return 0;
+    }
+    return next;
+}
+
+std::vector<std::pair<uint32_t, uint32_t> > OpenixFAT::clusterRuns(uint32_t first, uint64_t maxClusters) const {
+    std::vector<std::pair<uint32_t, uint32_t> > runs;
+    if (first < 2 || first >= clusterCount_ + 2) {
+        return runs;
+    }
+
+    // A chain never visits more clusters than exist, which also stops corrupted loops
+    maxClusters = std::min<uint64_t>(maxClusters, clusterCount_);
+    for (uint32_t cluster = first; cluster != 0 && maxClusters > 0; cluster = nextCluster(cluster), --maxClusters) {
+        if (!runs.empty() && runs.back().first + runs.back().second == cluster) {
+            ++runs.back().second;
+        } else {
+            runs.emplace_back(cluster, 1);
+        }
+    }
+    return runs;
+}
+
+std::vector<FatEntry> OpenixFAT::readDirectory(const uint32_t firstCluster) const {
+    std::vector<uint8_t> raw;
+    if (firstCluster == 0 && type_ != FatType::FAT32) {
+        raw.resize(static_cast<size_t>(rootEntries_) * FAT_DIR_ENTRY_SIZE);
+        readExact(rootOffset_, raw.data(), raw.size());
+    } else {
+        for (const auto &[first, count]: clusterRuns(firstCluster == 0 ? rootCluster_ : firstCluster, UINT64_MAX)) {
+            const auto start = raw.size();
+            raw.resize(start + static_cast<size_t>(count) * clusterSize_);
+            readExact(clusterOffset(first), raw.data() + start, raw.size() - start);
+        }
+    }
+
+    std::vector<FatEntry> entries;
+    std::vector<uint16_t> longName;
+    int longChecksum = -1;
+
+    for (size_t pos = 0; pos + FAT_DIR_ENTRY_SIZE <= raw.size(); pos += FAT_DIR_ENTRY_SIZE) {
+        const uint8_t *entry = raw.data() + pos;
+        if (entry[0] == 0x00) {
+            break;
+        }
+        if (entry[0] == FAT_DELETED) {
+            longName.clear();
+            continue;
+        }
+
+        const uint8_t attributes = entry[11];
+        if ((attributes & 0x3F) == FAT_ATTR_LONG_NAME) {
+            // Long name parts come last part first, each holding 13 UTF-16 units
+            const auto sequence = entry[0] & 0x1F;
+            if (entry[0] & 0x40 || longChecksum != entry[13]) {
+                longName.assign(static_cast<size_t>(sequence) * 13, 0xFFFF);
+                longChecksum = entry[13];
+            }
+            if (sequence == 0 || static_cast<size_t>(sequence) * 13 > longName.size()) {
+                longName.clear();
+                continue;
+            }
+
+            static constexpr int offsets[13] = {1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30};
+            const auto base = static_cast<size_t>(sequence - 1) * 13;
+            for (size_t i = 0; i < 13; ++i) {
+                longName[base + i] = getLE16(entry + offsets[i]);
+            }
+            continue;
+        }
+
+        if (attributes & FAT_ATTR_VOLUME_ID) {
+            longName.clear();
+            continue;
+        }
+
+        FatEntry decoded;
+        decoded.shortName = decodeShortName(entry);
+        decoded.attributes = attributes;
+        decoded.firstCluster = type_ == FatType::FAT32
+                                   ? static_cast<uint32_t>(getLE16(entry + 20)) << 16 | getLE16(entry + 26)
+                                   : getLE16(entry + 26);
+        decoded.size = decoded.isDirectory() ? 0 : getLE32(entry + 28);
+
+        // A long name only belongs to the short entry whose checksum it carries
+        const bool hasLongName = !longName.empty() && longChecksum == shortNameChecksum(entry);
+        decoded.name = hasLongName ? utf16ToUtf8(longName) : decoded.shortName;
+        longName.clear();
+        longChecksum = -1;
+
+        if (decoded.shortName != "." && decoded.shortName != "..") {
+            entries.push_back(std::move(decoded));
+        }
+    }
+
+    return entries;
+}
+
+uint64_t OpenixFAT::clusterOffset(const uint32_t cluster) const {
+    return dataOffset_ + static_cast<uint64_t>(cluster - 2) * clusterSize_;
+}
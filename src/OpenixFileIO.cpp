@@ -0,0 +1,287 @@
+/**
+ * @file OpenixFileIO.cpp
+ * @brief Implementation of OpenixFileIO class methods
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#include <stdexcept>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifdef _WIN32
+#include <io.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <climits>
+#endif
+
+#include "OpenixFileIO.hpp"
+
+using namespace OpenixIMG;
+
+OpenixFileIO::OpenixFileIO(const std::string &path, const Mode mode) : fd_(-1), path_(path) {
+#ifdef _WIN32
+    // _open has no unbuffered mode, so DIRECT handles stay buffered
+    if (mode == Mode::WRITE) {
+        fd_ = _open(path.c_str(), _O_RDWR | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+    } else if (mode == Mode::UPDATE || mode == Mode::DIRECT) {
+        fd_ = _open(path.c_str(), _O_RDWR | _O_CREAT | _O_BINARY, _S_IREAD | _S_IWRITE);
+    } else {
+        fd_ = _open(path.c_str(), _O_RDONLY | _O_BINARY);
+    }
+#else
+    if (mode == Mode::WRITE) {
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    } else if (mode == Mode::UPDATE) {
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    } else if (mode == Mode::DIRECT) {
+#ifdef O_DIRECT
+        // File systems such as tmpfs refuse O_DIRECT; fall back to buffered I/O there
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC | O_DIRECT, 0644);
+        direct_ = fd_ >= 0;
+        if (fd_ < 0 && errno == EINVAL) {
+            fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        }
+#else
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+#ifdef F_NOCACHE
+        direct_ = fd_ >= 0 && ::fcntl(fd_, F_NOCACHE, 1) == 0;
+#endif
+#endif
+    } else {
+        fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    }
+#endif
+    if (fd_ < 0) {
+        throw std::runtime_error("Error: unable to open " + path + "!");
+    }
+}
+
+OpenixFileIO::~OpenixFileIO() {
+    if (fd_ >= 0) {
+#ifdef _WIN32
+        _close(fd_);
+#else
+        ::close(fd_);
+#endif
+    }
+}
+
+size_t OpenixFileIO::readAt(uint64_t offset, void *data, const size_t length) const {
+    auto *current = static_cast<uint8_t *>(data);
+    size_t done = 0;
+
+    while (done < length) {
+#ifdef _WIN32
+        OVERLAPPED overlapped{};
+        overlapped.Offset = static_cast<DWORD>(offset & 0xFFFFFFFF);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD chunk = static_cast<DWORD>(std::min<size_t>(length - done, 0x40000000));
+        DWORD got = 0;
+        auto handle = reinterpret_cast<HANDLE>(_get_osfhandle(fd_));
+        if (!ReadFile(handle, current, chunk, &got, &overlapped)) {
+            if (GetLastError() == ERROR_HANDLE_EOF) {
+                break;
+            }
+            throw std::runtime_error("Error: read failed on " + path_);
+        }
+        const auto n = static_cast<size_t>(got);
+#else
+        const auto n = ::pread(fd_, current, length - done, static_cast<off_t>(offset));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("Error: read failed on " + path_ + ": " + std::strerror(errno));
+        }
+#endif
+        if (n == 0) {
+            break;
+        }
+        current += n;
+        done += static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+
+    return done;
+}
+
+size_t OpenixFileIO::readVectorAt(uint64_t offset, const std::vector<Slice> &slices) const {
+#ifdef _WIN32
+    size_t done = 0;
+    for (const auto &slice: slices) {
+        const auto n = readAt(offset, slice.data, slice.length);
+        done += n;
+        offset += n;
+        if (n < slice.length) {
+            break;
+        }
+    }
+    return done;
+#else
+    // Translate slices to iovecs once, then advance through them on short reads
+    std::vector<iovec> iov(slices.size());
+    for (size_t i = 0; i < slices.size(); ++i) {
+        iov[i].iov_base = slices[i].data;
+        iov[i].iov_len = slices[i].length;
+    }
+
+    size_t done = 0;
+    size_t first = 0;
+    while (first < iov.size()) {
+        const auto count = static_cast<int>(std::min<size_t>(iov.size() - first, IOV_MAX));
+        const auto n = ::preadv(fd_, iov.data() + first, count, static_cast<off_t>(offset));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("Error: read failed on " + path_ + ": " + std::strerror(errno));
+        }
+        if (n == 0) {
+            break;
+        }
+
+        done += static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+
+        // Skip fully consumed iovecs and trim a partially consumed one
+        auto remaining = static_cast<size_t>(n);
+        while (first < iov.size() && remaining >= iov[first].iov_len) {
+            remaining -= iov[first].iov_len;
+            ++first;
+        }
+        if (remaining > 0) {
+            iov[first].iov_base = static_cast<uint8_t *>(iov[first].iov_base) + remaining;
+            iov[first].iov_len -= remaining;
+        }
+    }
+
+    return done;
+#endif
+}
+
+void OpenixFileIO::writeAt(uint64_t offset, const void *data, const size_t length) const {
+    const auto *current = static_cast<const uint8_t *>(data);
+    size_t done = 0;
+
+    while (done < length) {
+#ifdef _WIN32
+        OVERLAPPED overlapped{};
+        overlapped.Offset = static_cast<DWORD>(offset & 0xFFFFFFFF);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD chunk = static_cast<DWORD>(std::min<size_t>(length - done, 0x40000000));
+        DWORD put = 0;
+        auto handle = reinterpret_cast<HANDLE>(_get_osfhandle(fd_));
+        if (!WriteFile(handle, current, chunk, &put, &overlapped)) {
+            throw std::runtime_error("Error: write failed on " + path_);
+        }
+        const auto n = static_cast<size_t>(put);
+#else
+        const auto n = ::pwrite(fd_, current, length - done, static_cast<off_t>(offset));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("Error: write failed on " + path_ + ": " + std::strerror(errno));
+        }
+#endif
+        if (n == 0) {
+            throw std::runtime_error("Error: short write on " + path_);
+        }
+        current += n;
+        done += static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+}
+
+uint64_t OpenixFileIO::size() const {
+#ifdef _WIN32
+    const auto length = _filelengthi64(fd_);
+    if (length < 0) {
+        throw std::runtime_error("Error: unable to get size of " + path_);
+    }
+    return static_cast<uint64_t>(length);
+#else
+    struct stat st{};
+    if (::fstat(fd_, &st) != 0) {
+        throw std::runtime_error("Error: unable to get size of " + path_ + ": " + std::strerror(errno));
+    }
+    if (S_ISBLK(st.st_mode)) {
+        const auto end = ::lseek(fd_, 0, SEEK_END);
+        if (end < 0) {
+            throw std::runtime_error("Error: unable to get size of " + path_ + ": " + std::strerror(errno));
+        }
+        return static_cast<uint64_t>(end);
+    }
+    return static_cast<uint64_t>(st.st_size);
+#endif
+}
+
+void OpenixFileIO::resize(const uint64_t length) const {
+#ifdef _WIN32
+    if (_chsize_s(fd_, static_cast<__int64>(length)) != 0) {
+        throw std::runtime_error("Error: unable to resize " + path_);
+    }
+#else
+    if (::ftruncate(fd_, static_cast<off_t>(length)) != 0) {
+        throw std::runtime_error("Error: unable to resize " + path_ + ": " + std::strerror(errno));
+    }
+#endif
+}
+
+void OpenixFileIO::sync() const {
+#ifdef _WIN32
+    if (_commit(fd_) != 0) {
+        throw std::runtime_error("Error: unable to sync " + path_);
+    }
+#else
+    while (::fsync(fd_) != 0) {
+        if (errno != EINTR) {
+            throw std::runtime_error("Error: unable to sync " + path_ + ": " + std::strerror(errno));
+        }
+    }
+#endif
+}
+
+bool OpenixFileIO::writeback(const uint64_t offset, const uint64_t length, const bool wait) const {
+#if defined(__linux__) && defined(SYNC_FILE_RANGE_WRITE)
+    const unsigned flags = wait ? SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER
+                                : SYNC_FILE_RANGE_WRITE;
+    return ::sync_file_range(fd_, static_cast<off_t>(offset), static_cast<off_t>(length), flags) == 0;
+#else
+    (void) offset;
+    (void) length;
+    (void) wait;
+    return false;
+#endif
+}
+
+bool OpenixFileIO::syncFileSystem() const {
+#if defined(__linux__)
+    if (::syncfs(fd_) != 0) {
+        throw std::runtime_error("Error: unable to sync the file system of " + path_ + ": " + std::strerror(errno));
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool OpenixFileIO::evict() const {
+#if defined(POSIX_FADV_DONTNEED)
+    return ::posix_fadvise(fd_, 0, 0, POSIX_FADV_DONTNEED) == 0;
+#else
+    return false;
+#endif
+}
+
+bool OpenixFileIO::isDirect() const {
+    return direct_;
+}
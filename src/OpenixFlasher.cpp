@@ -0,0 +1,253 @@
+/**
+ * @file OpenixFlasher.cpp
+ * @brief Implementation of OpenixFlasher class methods
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "OpenixFlasher.hpp"
+#include "OpenixBuildConfig.hpp"
+#include "OpenixCRC32.hpp"
+#include "OpenixFileIO.hpp"
+#include "OpenixMetrics.hpp"
+#include "OpenixScheduler.hpp"
+
+using namespace OpenixIMG;
+
+namespace {
+    constexpr size_t ALIGNMENT = OpenixFileIO::DIRECT_ALIGNMENT;
+
+    // Whole aligned blocks, so every chunk but the last of an entry can be written directly
+    constexpr size_t FLASH_CHUNK_SIZE = std::max(IO_BUFFER_SIZE / ALIGNMENT * ALIGNMENT, ALIGNMENT);
+
+    /**
+     * @brief Target opened twice: direct for aligned transfers, buffered for the rest
+     */
+    class FlashTarget {
+    public:
+        FlashTarget(const std::string &path, const bool direct)
+            : direct_(path, direct ? OpenixFileIO::Mode::DIRECT : OpenixFileIO::Mode::UPDATE),
+              buffered_(path, OpenixFileIO::Mode::UPDATE) {
+        }
+
+        void write(const uint64_t offset, const uint8_t *data, const size_t length) const {
+            const auto head = directLength(offset, length);
+            if (head > 0) {
+                direct_.writeAt(offset, data, head);
+            }
+            if (head < length) {
+                buffered_.writeAt(offset + head, data + head, length - head);
+            }
+        }
+
+        void read(const uint64_t offset, uint8_t *data, const size_t length) const {
+            const auto head = directLength(offset, length);
+            if ((head > 0 && direct_.readAt(offset, data, head) != head) ||
+                (head < length && buffered_.readAt(offset + head, data + head, length - head) != length - head)) {
+                throw std::runtime_error("Unexpected end of target while verifying at offset " + std::to_string(offset));
+            }
+        }
+
+        // Flushes both handles, then drops cached pages so a read-back comes from the device
+        void sync() const {
+            direct_.sync();
+            buffered_.sync();
+            buffered_.evict();
+        }
+
+    private:
+        [[nodiscard]] size_t directLength(const uint64_t offset, const size_t length) const {
+            return direct_.isDirect() && offset % ALIGNMENT == 0 ? length / ALIGNMENT * ALIGNMENT : 0;
+        }
+
+        OpenixFileIO direct_;
+        OpenixFileIO buffered_;
+    };
+
+    size_t findEntry(const OpenixIMGFile &image, const std::string &filename) {
+        const auto &fileList = image.getFileList();
+        for (size_t index = 0; index < fileList.size(); ++index) {
+            if (fileList[index].filename == filename) {
+                return index;
+            }
+        }
+        return fileList.size();
+    }
+
+    // Reads a written partition back through the buffer and compares its CRC-32 with the one computed while writing
+    void verifyPartition(const OpenixIMGFile &image, const FlashTarget &target, FlashResult &result, uint8_t *buffer) {
+        const auto priority = OpenixScheduler::currentPriority(Priority::BULK);
+        uint32_t crc = 0;
+        for (uint64_t pos = 0; pos < result.length; pos += FLASH_CHUNK_SIZE) {
+            image.checkCancelled();
+            const auto length = static_cast<size_t>(std::min<uint64_t>(FLASH_CHUNK_SIZE, result.length - pos));
+            OpenixScheduler::Task task(priority);
+            task.addBytes(length);
+            target.read(result.offset + pos, buffer, length);
+            crc = OpenixCRC32::compute(buffer, length, crc);
+        }
+        result.verified = crc == result.crc;
+    }
+
+    // Streams one entry through the buffer to the target, then optionally reads it back through the same buffer
+    void flashPartition(const OpenixIMGFile &image, const FlashTarget &target, FlashResult &result, uint8_t *buffer,
+                        const bool verify) {
+        size_t fill = 0;
+        uint64_t written = 0;
+        const auto priority = OpenixScheduler::currentPriority(Priority::BULK);
+        auto flush = [&]() {
+            {
+                OpenixScheduler::Task task(priority);
+                task.addBytes(fill);
+                OpenixMetrics::Timer timer(Metric::WRITE);
+                target.write(result.offset + written, buffer, fill);
+            }
+            result.crc = OpenixCRC32::compute(buffer, fill, result.crc);
+            written += fill;
+            fill = 0;
+        };
+
+        image.readEntryChunks(findEntry(image, result.file), [&](const uint8_t *data, size_t length) {
+            while (length > 0) {
+                const auto n = std::min(length, FLASH_CHUNK_SIZE - fill);
+                std::memcpy(buffer + fill, data, n);
+                fill += n;
+                data += n;
+                length -= n;
+                if (fill == FLASH_CHUNK_SIZE) {
+                    flush();
+                }
+            }
+        }, FLASH_CHUNK_SIZE);
+        if (fill > 0) {
+            flush();
+        }
+        if (written != result.length) {
+            throw std::runtime_error("Short read of " + result.file + " while flashing " + result.partition);
+        }
+        target.sync();
+
+        if (verify) {
+            verifyPartition(image, target, result, buffer);
+        }
+    }
+}
+
+OpenixFlasher::OpenixFlasher(const OpenixIMGFile &image, const OpenixPartition &table)
+    : image_(image), table_(table) {
+}
+
+std::vector<FlashResult> OpenixFlasher::plan(const FlashOptions &options) const {
+    const auto &partitions = table_.getPartitions();
+    // Offsets do not depend on the disk size; without one, a trailing size-0 partition is unbounded
+    auto layout = options.layout;
+    if (layout.diskSectors == 0) {
+        layout.diskSectors = UINT64_MAX / PARTITION_SECTOR_SIZE;
+    }
+    const auto extents = table_.computeLayout(layout);
+
+    for (const auto &name: options.partitions) {
+        if (!table_.isPartitionNameExists(name)) {
+            throw std::runtime_error("No partition named " + name + " in the partition table!");
+        }
+    }
+
+    std::vector<FlashResult> results;
+    const auto &fileList = image_.getFileList();
+    for (size_t i = 0; i < partitions.size(); ++i) {
+        const auto &partition = partitions[i];
+        const bool requested = std::find(options.partitions.begin(), options.partitions.end(), partition.name) !=
+                               options.partitions.end();
+        if (!options.partitions.empty() && !requested) {
+            continue;
+        }
+
+        const auto index = partition.downloadfile.empty() ? fileList.size() : findEntry(image_, partition.downloadfile);
+        if (index == fileList.size()) {
+            if (requested) {
+                throw std::runtime_error("Partition " + partition.name + " has no download file in the image!");
+            }
+            continue;
+        }
+
+        FlashResult result;
+        result.partition = partition.name;
+        result.file = partition.downloadfile;
+        result.offset = extents[i].firstSector * PARTITION_SECTOR_SIZE;
+        result.length = std::min(fileList[index].originalLength, fileList[index].storedLength);
+        if (result.length > extents[i].sectorCount * PARTITION_SECTOR_SIZE) {
+            throw std::runtime_error(result.file + " (" + std::to_string(result.length) + " bytes) does not fit partition " +
+                                     partition.name + " (" +
+                                     std::to_string(extents[i].sectorCount * PARTITION_SECTOR_SIZE) + " bytes)");
+        }
+        results.push_back(std::move(result));
+    }
+    return results;
+}
+
+std::vector<FlashResult> OpenixFlasher::flash(const std::string &target, const FlashOptions &options) const {
+    auto results = plan(options);
+    if (results.empty()) {
+        return results;
+    }
+    const FlashTarget output(target, options.direct);
+
+    std::atomic<size_t> next{0};
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    const auto priority = OpenixScheduler::currentPriority(Priority::BULK);
+    auto worker = [&]() {
+        const OpenixScheduler::PriorityScope scope(priority);
+        // One aligned buffer per worker serves every write and read-back it does
+        std::vector<uint8_t> storage(FLASH_CHUNK_SIZE + ALIGNMENT);
+        auto *buffer = storage.data() + (ALIGNMENT - reinterpret_cast<uintptr_t>(storage.data()) % ALIGNMENT) % ALIGNMENT;
+        for (size_t i = next++; i < results.size() && !failed; i = next++) {
+            try {
+                flashPartition(image_, output, results[i], buffer, options.verify);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                failed = true;
+            }
+        }
+    };
+
+    const unsigned hardware = options.threads > 0 ? options.threads : std::max(1U, std::thread::hardware_concurrency());
+    const size_t threadCount = std::min<size_t>(hardware, results.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < threadCount; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread: threads) {
+        thread.join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return results;
+}
+
+void OpenixFlasher::verify(const std::string &target, std::vector<FlashResult> &results, const bool direct) const {
+    if (results.empty()) {
+        return;
+    }
+    const FlashTarget input(target, direct);
+    std::vector<uint8_t> storage(FLASH_CHUNK_SIZE + ALIGNMENT);
+    auto *buffer = storage.data() + (ALIGNMENT - reinterpret_cast<uintptr_t>(storage.data()) % ALIGNMENT) % ALIGNMENT;
+    for (auto &result: results) {
+        verifyPartition(image_, input, result, buffer);
+    }
+}
@@ -4,23 +4,31 @@
  * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
  */
 
-#include <fstream>
 #include <filesystem>
 #include <cstring>
-#include <iostream>
-#include <ctime>
-#include <iomanip>
 #include <optional>
 
+#include <thread>
+#include <atomic>
+
 #include "OpenixIMGWTY.hpp"
 #include "OpenixIMGFile.hpp"
+#include "OpenixFileIO.hpp"
 #include "OpenixUtils.hpp"
+#include "OpenixMetrics.hpp"
+#include "OpenixScheduler.hpp"
 
 #include <algorithm>
 
 using namespace OpenixIMG;
 namespace fs = std::filesystem;
 
+// Largest hole between two requested entries that is read through rather than split into two reads
+constexpr uint32_t READ_COALESCE_GAP = 64 * 1024;
+
+// Granularity of the parallel decrypt work items (multiple of the 16-byte cipher block)
+constexpr size_t DECRYPT_SLICE_SIZE = 1024 * 1024;
+
 OpenixIMGFile::OpenixIMGFile() : encryptionEnabled_(true),
                                  imageLoaded_(false),
                                  imageSize_(0),
@@ -42,99 +50,136 @@ void OpenixIMGFile::setEncryptionEnabled(const bool enabled) {
     encryptionEnabled_ = enabled;
 }
 
+bool OpenixIMGFile::isEncryptionEnabled() const {
+    return encryptionEnabled_;
+}
+
+void OpenixIMGFile::encryptData(void *data, const size_t length, const CryptoContext context) const {
+    switch (context) {
+        case CryptoContext::HEADER:
+            rc6EncryptInPlace(data, length, headerContext_);
+            break;
+        case CryptoContext::FILE_HEADERS:
+            rc6EncryptInPlace(data, length, fileHeadersContext_);
+            break;
+        case CryptoContext::FILE_CONTENT:
+            rc6EncryptInPlace(data, length, fileContentContext_);
+            break;
+    }
+}
+
+void OpenixIMGFile::decryptData(void *data, const size_t length, const CryptoContext context) const {
+    switch (context) {
+        case CryptoContext::HEADER:
+            rc6DecryptInPlace(data, length, headerContext_);
+            break;
+        case CryptoContext::FILE_HEADERS:
+            rc6DecryptInPlace(data, length, fileHeadersContext_);
+            break;
+        case CryptoContext::FILE_CONTENT:
+            rc6DecryptInPlace(data, length, fileContentContext_);
+            break;
+    }
+}
+
+void OpenixIMGFile::twofishDecryptData(void *data, const size_t length) const {
+    twofishDecryptInPlace(data, length, twofishContext_);
+}
+
 bool OpenixIMGFile::loadImage(const std::string &imageFilePath) {
-    try {
-        // Check if file exists
-        if (!fs::exists(imageFilePath)) {
-            throw std::runtime_error("Error: unable to open " + imageFilePath + "!");
-        }
+    // Check if file exists
+    if (!fs::exists(imageFilePath)) {
+        throw std::runtime_error("Error: unable to open " + imageFilePath + "!");
+    }
 
-        // Get file size
-        imageSize_ = static_cast<ssize_t>(fs::file_size(imageFilePath));
-        if (imageSize_ == 0) {
-            throw std::runtime_error("Error: Invalid file size 0");
-        }
+    // Get file size
+    imageSize_ = static_cast<ssize_t>(fs::file_size(imageFilePath));
+    if (imageSize_ == 0) {
+        throw std::runtime_error("Error: Invalid file size 0");
+    }
+
+    // Store file path
+    imageFilePath_ = imageFilePath;
 
-        // Store file path
-        imageFilePath_ = imageFilePath;
+    // Clear any existing data
+    imageData_.clear();
+    imageData_.reserve(1024); // Reserve space for header
 
-        // Clear any existing data
-        imageData_.clear();
-        imageData_.reserve(1024); // Reserve space for header
+    // Read and parse only the header
+    const OpenixFileIO inFile(imageFilePath);
 
-        // Read and parse only the header
-        std::ifstream inFile(imageFilePath, std::ios::binary);
-        if (!inFile.is_open()) {
-            throw std::runtime_error("Error: unable to open " + imageFilePath + "!");
-        }
+    // Read header (1024 bytes)
+    imageData_.resize(1024);
+    if (inFile.readAt(0, imageData_.data(), 1024) != 1024) {
+        throw std::runtime_error("Error: " + imageFilePath + " is too small for an image header!");
+    }
 
-        // Read header (1024 bytes)
-        imageData_.resize(1024);
-        inFile.read(reinterpret_cast<char *>(imageData_.data()), 1024);
-        inFile.close();
+    // Parse image header
+    imageHeader_ = *reinterpret_cast<ImageHeader *>(imageData_.data());
 
-        // Parse image header
+    // Check for encryption
+    isEncrypted_ = (std::memcmp(imageHeader_.magic.data(), IMAGEWTY_MAGIC, IMAGEWTY_MAGIC_LEN) != 0);
+
+    if (isEncrypted_ && encryptionEnabled_) {
+        // Decrypt header
+        rc6DecryptInPlace(imageData_.data(), 1024, headerContext_);
+        // Update the imageHeader_ with decrypted data
         imageHeader_ = *reinterpret_cast<ImageHeader *>(imageData_.data());
+    }
 
-        // Check for encryption
-        isEncrypted_ = (std::memcmp(imageHeader_.magic.data(), IMAGEWTY_MAGIC, IMAGEWTY_MAGIC_LEN) != 0);
+    // Get number of files
+    uint32_t numFiles = 0;
+    if (imageHeader_.header_version == 0x0300) {
+        numFiles = imageHeader_.v3.num_files;
+    } else {
+        numFiles = imageHeader_.v1.num_files;
+    }
 
-        if (isEncrypted_ && encryptionEnabled_) {
-            // Decrypt header
-            rc6DecryptInPlace(imageData_.data(), 1024, headerContext_);
-            // Update the imageHeader_ with decrypted data
-            imageHeader_ = *reinterpret_cast<ImageHeader *>(imageData_.data());
-        }
+    // A corrupt num_files must not size the table beyond the file
+    if (1024 + uint64_t{numFiles} * 1024 > static_cast<uint64_t>(imageSize_)) {
+        throw std::runtime_error("Error: " + imageFilePath + " is truncated in the file header table!");
+    }
 
-        // Get number of files
-        uint32_t numFiles = 0;
-        if (imageHeader_.header_version == 0x0300) {
-            numFiles = imageHeader_.v3.num_files;
-        } else {
-            numFiles = imageHeader_.v1.num_files;
-        }
+    // Resize imageData_ to hold header and file headers
+    imageData_.resize(1024 + static_cast<size_t>(numFiles) * 1024);
+    
+    // Read file headers
+    if (inFile.readAt(1024, imageData_.data() + 1024, static_cast<size_t>(numFiles) * 1024) !=
+        static_cast<size_t>(numFiles) * 1024) {
+        throw std::runtime_error("Error: " + imageFilePath + " is truncated in the file header table!");
+    }
 
-        // Resize imageData_ to hold header and file headers
-        imageData_.resize(1024 + numFiles * 1024);
-        
-        // Read file headers
-        inFile.open(imageFilePath, std::ios::binary);
-        inFile.seekg(1024);
-        inFile.read(reinterpret_cast<char *>(imageData_.data() + 1024), numFiles * 1024);
-        inFile.close();
-
-        // Decrypt file headers if needed
-        if (isEncrypted_ && encryptionEnabled_) {
-            rc6DecryptInPlace(imageData_.data() + 1024, numFiles * 1024, fileHeadersContext_);
-        }
+    // Decrypt file headers if needed
+    if (isEncrypted_ && encryptionEnabled_) {
+        rc6DecryptInPlace(imageData_.data() + 1024, numFiles * 1024, fileHeadersContext_);
+    }
 
-        // Get image metadata
-        if (imageHeader_.header_version == 0x0300) {
-            hardwareId_ = imageHeader_.v3.hardware_id;
-            firmwareId_ = imageHeader_.v3.firmware_id;
-            pid_ = imageHeader_.v3.pid;
-            vid_ = imageHeader_.v3.vid;
-        } else {
-            hardwareId_ = imageHeader_.v1.hardware_id;
-            firmwareId_ = imageHeader_.v1.firmware_id;
-            pid_ = imageHeader_.v1.pid;
-            vid_ = imageHeader_.v1.vid;
-        }
+    // Get image metadata
+    if (imageHeader_.header_version == 0x0300) {
+        hardwareId_ = imageHeader_.v3.hardware_id;
+        firmwareId_ = imageHeader_.v3.firmware_id;
+        pid_ = imageHeader_.v3.pid;
+        vid_ = imageHeader_.v3.vid;
+    } else {
+        hardwareId_ = imageHeader_.v1.hardware_id;
+        firmwareId_ = imageHeader_.v1.firmware_id;
+        pid_ = imageHeader_.v1.pid;
+        vid_ = imageHeader_.v1.vid;
+    }
 
-        // Load file list
-        loadFileList();
+    // Load file list
+    loadFileList();
 
-        // Mark image as loaded
-        imageLoaded_ = true;
+    updateFingerprint();
 
-        OpenixUtils::log(
-            "Successfully loaded image: " + imageFilePath + " (size: " + std::to_string(imageSize_) + " bytes)");
-        OpenixUtils::log("Found " + std::to_string(fileList_.size()) + " files in image");
+    // Mark image as loaded
+    imageLoaded_ = true;
 
-        return true;
-    } catch (const std::exception &e) {
-        throw std::runtime_error(e.what());
-    }
+    OpenixUtils::log(
+        "Successfully loaded image: " + imageFilePath + " (size: " + std::to_string(imageSize_) + " bytes)");
+    OpenixUtils::log("Found " + std::to_string(fileList_.size()) + " files in image");
+
+    return true;
 }
 
 std::string OpenixIMGFile::getImageFilePath() const {
@@ -305,128 +350,113 @@ void OpenixIMGFile::loadFileList() {
 }
 
 bool OpenixIMGFile::checkFileByFilename(const std::string &filename) const {
-    try {
-        // Check if an image is loaded
-        if (!imageLoaded_) {
-            throw std::runtime_error("No image file loaded!");
-        }
-
-        // Search for the file by filename
-        bool found = false;
-        for (const auto &fileInfo: fileList_) {
-            if (fileInfo.filename == filename) {
-                found = true;
-                OpenixUtils::log("File found: " + filename);
-                break;
-            }
-        }
+    // Check if an image is loaded
+    if (!imageLoaded_) {
+        throw std::runtime_error("No image file loaded!");
+    }
 
-        if (!found) {
-            OpenixUtils::log("File not found: " + filename);
+    // Search for the file by filename
+    bool found = false;
+    for (const auto &fileInfo: fileList_) {
+        if (fileInfo.filename == filename) {
+            found = true;
+            OpenixUtils::log("File found: " + filename);
+            break;
         }
+    }
 
-        return found;
-    } catch (const std::exception &e) {
-        throw std::runtime_error(e.what());
+    if (!found) {
+        OpenixUtils::log("File not found: " + filename);
     }
+
+    return found;
 }
 
 bool OpenixIMGFile::checkFileBySubtype(const std::string &subtype) const {
-    try {
-        // Check if an image is loaded
-        if (!imageLoaded_) {
-            throw std::runtime_error("No image file loaded!");
-        }
-
-        // Search for the file by subtype
-        bool found = false;
-        for (const auto &fileInfo: fileList_) {
-            if (fileInfo.subtype == subtype) {
-                found = true;
-                OpenixUtils::log("File with subtype found: " + subtype);
-                break;
-            }
-        }
+    // Check if an image is loaded
+    if (!imageLoaded_) {
+        throw std::runtime_error("No image file loaded!");
+    }
 
-        if (!found) {
-            OpenixUtils::log("File with subtype not found: " + subtype);
+    // Search for the file by subtype
+    bool found = false;
+    for (const auto &fileInfo: fileList_) {
+        if (fileInfo.subtype == subtype) {
+            found = true;
+            OpenixUtils::log("File with subtype found: " + subtype);
+            break;
         }
+    }
 
-        return found;
-    } catch (const std::exception &e) {
-        throw std::runtime_error(e.what());
+    if (!found) {
+        OpenixUtils::log("File with subtype not found: " + subtype);
     }
+
+    return found;
 }
 
 std::optional<FileHeader> OpenixIMGFile::getFileHeaderByFilename(const std::string &filename) const {
-    try {
-        // Check if an image is loaded
-        if (!imageLoaded_) {
-            throw std::runtime_error("No image file loaded!");
-        }
+    // Check if an image is loaded
+    if (!imageLoaded_) {
+        throw std::runtime_error("No image file loaded!");
+    }
 
-        // Search for the file by filename
-        for (size_t i = 0; i < fileList_.size(); ++i) {
-            if (fileList_[i].filename == filename) {
-                OpenixUtils::log("File header found for: " + filename);
-                // Return a copy of the file header
-                auto *fileHeader = reinterpret_cast<const FileHeader *>(imageData_.data() + 1024 + i * 1024);
-                return *fileHeader;
-            }
+    // Search for the file by filename
+    for (size_t i = 0; i < fileList_.size(); ++i) {
+        if (fileList_[i].filename == filename) {
+            OpenixUtils::log("File header found for: " + filename);
+            // Return a copy of the file header
+            auto *fileHeader = reinterpret_cast<const FileHeader *>(imageData_.data() + 1024 + i * 1024);
+            return *fileHeader;
         }
+    }
 
-        OpenixUtils::log("File header not found for: " + filename);
+    OpenixUtils::log("File header not found for: " + filename);
 
-        return std::nullopt;
-    } catch (const std::exception &e) {
-        throw std::runtime_error(e.what());
-    }
+    return std::nullopt;
 }
 
 std::vector<FileHeader> OpenixIMGFile::getFileHeaderBySubtype(const std::string &subtype) const {
-    try {
-        // Check if an image is loaded
-        if (!imageLoaded_) {
-            throw std::runtime_error("No image file loaded!");
-        }
+    // Check if an image is loaded
+    if (!imageLoaded_) {
+        throw std::runtime_error("No image file loaded!");
+    }
 
-        // Search for files by subtype
-        std::vector<FileHeader> results;
-        for (size_t i = 0; i < fileList_.size(); ++i) {
-            if (fileList_[i].subtype == subtype) {
-                OpenixUtils::log(
-                    "File header found for subtype: " + subtype + " (file: " + fileList_[i].filename + ")");
-                // Add a copy of the file header to results
-                auto *fileHeader = reinterpret_cast<const FileHeader *>(imageData_.data() + 1024 + i * 1024);
-                results.push_back(*fileHeader);
-            }
+    // Search for files by subtype
+    std::vector<FileHeader> results;
+    for (size_t i = 0; i < fileList_.size(); ++i) {
+        if (fileList_[i].subtype == subtype) {
+            OpenixUtils::log(
+                "File header found for subtype: " + subtype + " (file: " + fileList_[i].filename + ")");
+            // Add a copy of the file header to results
+            auto *fileHeader = reinterpret_cast<const FileHeader *>(imageData_.data() + 1024 + i * 1024);
+            results.push_back(*fileHeader);
         }
+    }
 
-        OpenixUtils::log("Found " + std::to_string(results.size()) + " files with subtype: " + subtype);
+    OpenixUtils::log("Found " + std::to_string(results.size()) + " files with subtype: " + subtype);
 
-        return results;
-    } catch (const std::exception &e) {
-        throw std::runtime_error(e.what());
-    }
+    return results;
 }
 
 // Helper method to read file data from disk with optional decryption
 std::vector<uint8_t> OpenixIMGFile::readFileDataFromDisk(uint32_t offset, uint32_t storedLength, uint32_t originalLength) const {
     std::vector<uint8_t> fileData(storedLength);
-    
-    // Open the image file
-    std::ifstream inFile(imageFilePath_, std::ios::binary);
-    if (!inFile.is_open()) {
-        throw std::runtime_error("Error: unable to open " + imageFilePath_ + "!");
-    }
+    OpenixScheduler::Task task(OpenixScheduler::currentPriority(Priority::INTERACTIVE));
+    task.addBytes(storedLength);
     
     // Read the stored data
-    inFile.seekg(offset);
-    inFile.read(reinterpret_cast<char *>(fileData.data()), storedLength);
-    inFile.close();
+    {
+        const OpenixFileIO inFile(imageFilePath_);
+        OpenixMetrics::Timer timer(Metric::READ);
+        if (inFile.readAt(offset, fileData.data(), storedLength) != storedLength) {
+            throw std::runtime_error("Unexpected end of image while reading at offset " + std::to_string(offset));
+        }
+    }
     
     // Decrypt if needed
     if (isEncrypted_ && encryptionEnabled_) {
+        OpenixMetrics::Timer timer(Metric::DECRYPT);
         rc6DecryptInPlace(fileData.data(), storedLength, fileContentContext_);
     }
     
@@ -439,59 +469,353 @@ std::vector<uint8_t> OpenixIMGFile::readFileDataFromDisk(uint32_t offset, uint32
 }
 
 std::optional<std::vector<uint8_t> > OpenixIMGFile::getFileDataByFilename(const std::string &filename) const {
-    try {
-        // Check if an image is loaded
-        if (!imageLoaded_) {
-            throw std::runtime_error("No image file loaded!");
-        }
+    // Check if an image is loaded
+    if (!imageLoaded_) {
+        throw std::runtime_error("No image file loaded!");
+    }
 
-        // Search for the file by filename
-        for (const auto &fileInfo: fileList_) {
-            if (fileInfo.filename == filename) {
-                OpenixUtils::log(
-                    "Extracting data for: " + filename + " (size: " + std::to_string(fileInfo.originalLength) +
-                    " bytes)");
-                
-                // Read file data from disk
-                std::vector<uint8_t> fileData = readFileDataFromDisk(fileInfo.offset, fileInfo.storedLength, fileInfo.originalLength);
+    // Search for the file by filename
+    for (size_t i = 0; i < fileList_.size(); ++i) {
+        if (const auto &fileInfo = fileList_[i]; fileInfo.filename == filename) {
+            OpenixUtils::log(
+                "Extracting data for: " + filename + " (size: " + std::to_string(fileInfo.originalLength) +
+                " bytes)");
+
+            std::vector<uint8_t> fileData;
+            if (usesSharedCache() && sharedCache_->lookup(fingerprint_, static_cast<uint32_t>(i), fileData)) {
                 return fileData;
             }
-        }
 
-        OpenixUtils::log("File data not found for: " + filename);
-        return std::nullopt;
-    } catch (const std::exception &e) {
-        throw std::runtime_error(e.what());
+            // Read file data from disk
+            fileData = readFileDataFromDisk(fileInfo.offset, fileInfo.storedLength, fileInfo.originalLength);
+            if (usesSharedCache()) {
+                sharedCache_->insert(fingerprint_, static_cast<uint32_t>(i), fileData.data(), fileData.size());
+            }
+            return fileData;
+        }
     }
+
+    OpenixUtils::log("File data not found for: " + filename);
+    return std::nullopt;
 }
 
 std::vector<std::pair<std::string, std::vector<uint8_t> > > OpenixIMGFile::getFileDataBySubtype(
     const std::string &subtype) const {
-    try {
-        // Check if an image is loaded
-        if (!imageLoaded_) {
-            throw std::runtime_error("No image file loaded!");
+    // Check if an image is loaded
+    if (!imageLoaded_) {
+        throw std::runtime_error("No image file loaded!");
+    }
+
+    // Search for files by subtype
+    std::vector<size_t> indices;
+    for (size_t i = 0; i < fileList_.size(); ++i) {
+        if (fileList_[i].subtype == subtype) {
+            OpenixUtils::log(
+                "Extracting data for: " + fileList_[i].filename + " (size: " +
+                std::to_string(fileList_[i].originalLength) + " bytes)");
+            indices.push_back(i);
+        }
+    }
+
+    // Read all matching entries in one batch
+    auto fileData = readEntries(indices);
+    std::vector<std::pair<std::string, std::vector<uint8_t> > > results;
+    for (size_t i = 0; i < indices.size(); ++i) {
+        results.emplace_back(fileList_[indices[i]].filename, std::move(fileData[i]));
+    }
+
+    OpenixUtils::log("Found " + std::to_string(results.size()) + " files with subtype: " + subtype);
+    return results;
+}
+
+std::vector<std::vector<uint8_t> > OpenixIMGFile::readEntries(const std::vector<size_t> &indices) const {
+    if (!imageLoaded_) {
+        throw std::runtime_error("No image file loaded!");
+    }
+
+    for (const auto index: indices) {
+        if (index >= fileList_.size()) {
+            throw std::runtime_error("Entry index out of range: " + std::to_string(index));
+        }
+    }
+
+    // Unique entries in on-disk order
+    std::vector<size_t> order(indices);
+    std::sort(order.begin(), order.end(), [this](const size_t a, const size_t b) {
+        return fileList_[a].offset != fileList_[b].offset ? fileList_[a].offset < fileList_[b].offset : a < b;
+    });
+    order.erase(std::unique(order.begin(), order.end()), order.end());
+
+    std::vector<std::vector<uint8_t> > buffers(fileList_.size());
+
+    // Entries another process already decrypted skip the read and the decryption
+    if (usesSharedCache()) {
+        order.erase(std::remove_if(order.begin(), order.end(), [this, &buffers](const size_t index) {
+            return sharedCache_->lookup(fingerprint_, static_cast<uint32_t>(index), buffers[index]);
+        }), order.end());
+    }
+
+    for (const auto index: order) {
+        buffers[index].resize(fileList_[index].storedLength);
+    }
+
+    // Coalesce neighbouring entries into runs served by a single vectored read
+    const auto priority = OpenixScheduler::currentPriority(Priority::INTERACTIVE);
+    const OpenixFileIO file(imageFilePath_);
+    std::vector<uint8_t> gapScratch;
+    size_t readCalls = 0;
+
+    for (size_t runStart = 0; runStart < order.size();) {
+        checkCancelled();
+        const auto &first = fileList_[order[runStart]];
+        std::vector<OpenixFileIO::Slice> slices;
+        uint64_t runOffset = first.offset;
+        uint64_t runEnd = runOffset;
+
+        size_t runStop = runStart;
+        for (; runStop < order.size(); ++runStop) {
+            const auto &info = fileList_[order[runStop]];
+            if (info.offset < runEnd || info.offset - runEnd > READ_COALESCE_GAP) {
+                // Overlapping (shared payload) or too far away: start a new run
+                if (runStop != runStart) {
+                    break;
+                }
+            }
+
+            if (info.offset > runEnd) {
+                // Gaps never exceed READ_COALESCE_GAP; sizing the scratch once keeps earlier gap slices valid
+                const auto gap = static_cast<size_t>(info.offset - runEnd);
+                if (gapScratch.empty()) {
+                    gapScratch.resize(READ_COALESCE_GAP);
+                }
+                slices.push_back({gapScratch.data(), gap});
+            }
+            slices.push_back({buffers[order[runStop]].data(), info.storedLength});
+            runEnd = static_cast<uint64_t>(info.offset) + info.storedLength;
+        }
+
+        size_t got;
+        {
+            OpenixScheduler::Task task(priority);
+            task.addBytes(runEnd - runOffset);
+            OpenixMetrics::Timer timer(Metric::READ);
+            got = file.readVectorAt(runOffset, slices);
+        }
+        if (got != runEnd - runOffset) {
+            throw std::runtime_error("Unexpected end of image while reading " + first.filename);
         }
+        ++readCalls;
+        runStart = runStop;
+    }
 
-        // Search for files by subtype
-        std::vector<std::pair<std::string, std::vector<uint8_t> > > results;
-        for (const auto &fileInfo: fileList_) {
-            if (fileInfo.subtype == subtype) {
-                OpenixUtils::log(
-                    "Extracting data for: " + fileInfo.filename + " (size: " + std::to_string(fileInfo.originalLength) +
-                    " bytes)");
-                
-                // Read file data from disk
-                std::vector<uint8_t> fileData = readFileDataFromDisk(fileInfo.offset, fileInfo.storedLength, fileInfo.originalLength);
-                results.emplace_back(fileInfo.filename, std::move(fileData));
+    OpenixUtils::log("Read " + std::to_string(order.size()) + " entries using " + std::to_string(readCalls) +
+                     " vectored reads");
+
+    // Decrypt in parallel, splitting large entries into block-aligned slices
+    if (isEncrypted_ && encryptionEnabled_) {
+        std::vector<std::pair<uint8_t *, size_t> > work;
+        for (const auto index: order) {
+            auto &buffer = buffers[index];
+            for (size_t pos = 0; pos < buffer.size(); pos += DECRYPT_SLICE_SIZE) {
+                work.emplace_back(buffer.data() + pos, std::min(DECRYPT_SLICE_SIZE, buffer.size() - pos));
             }
         }
 
-        OpenixUtils::log("Found " + std::to_string(results.size()) + " files with subtype: " + subtype);
-        return results;
-    } catch (const std::exception &e) {
-        throw std::runtime_error(e.what());
+        // Workers stop taking slices once cancelled; the check after joining throws
+        std::atomic<size_t> next{0};
+        auto worker = [&]() {
+            for (size_t i = next++; i < work.size() && !(cancellation_ && cancellation_->isCancelled()); i = next++) {
+                OpenixScheduler::Task task(priority);
+                task.addBytes(work[i].second);
+                OpenixMetrics::Timer timer(Metric::DECRYPT);
+                rc6DecryptInPlace(work[i].first, work[i].second, fileContentContext_);
+            }
+        };
+
+        const size_t threadCount = std::min<size_t>(std::max(1U, std::thread::hardware_concurrency()), work.size());
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < threadCount; ++i) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (auto &thread: threads) {
+            thread.join();
+        }
+        checkCancelled();
     }
+
+    for (const auto index: order) {
+        if (fileList_[index].originalLength < buffers[index].size()) {
+            buffers[index].resize(fileList_[index].originalLength);
+        }
+        if (usesSharedCache()) {
+            sharedCache_->insert(fingerprint_, static_cast<uint32_t>(index), buffers[index].data(),
+                                 buffers[index].size());
+        }
+    }
+
+    // Return results in request order, copying only for duplicated indices
+    std::vector<size_t> remaining(fileList_.size(), 0);
+    for (const auto index: indices) {
+        ++remaining[index];
+    }
+
+    std::vector<std::vector<uint8_t> > results;
+    results.reserve(indices.size());
+    for (const auto index: indices) {
+        if (--remaining[index] == 0) {
+            results.push_back(std::move(buffers[index]));
+        } else {
+            results.push_back(buffers[index]);
+        }
+    }
+
+    return results;
+}
+
+uint64_t OpenixIMGFile::readEntryChunks(const size_t index, const ChunkSink &sink, size_t chunkSize) const {
+    if (!imageLoaded_) {
+        throw std::runtime_error("No image file loaded!");
+    }
+    if (index >= fileList_.size()) {
+        throw std::runtime_error("Entry index out of range: " + std::to_string(index));
+    }
+
+    const auto &info = fileList_[index];
+    const uint64_t length = std::min(info.originalLength, info.storedLength);
+    const bool decrypt = isEncrypted_ && encryptionEnabled_;
+
+    // Cipher blocks never straddle chunks: payloads start on 512-byte boundaries
+    chunkSize = std::max<size_t>(chunkSize & ~size_t{15}, 16);
+    std::vector<uint8_t> buffer(static_cast<size_t>(std::min<uint64_t>(chunkSize, info.storedLength)));
+    const OpenixFileIO file(imageFilePath_);
+
+    // One task per chunk, released before the sink runs, so waiting interactive reads get in between chunks
+    const auto priority = OpenixScheduler::currentPriority(Priority::BULK);
+    uint64_t delivered = 0;
+    while (delivered < length) {
+        checkCancelled();
+        const auto chunk = static_cast<size_t>(std::min<uint64_t>(buffer.size(), info.storedLength - delivered));
+        {
+            OpenixScheduler::Task task(priority);
+            task.addBytes(chunk);
+            size_t got;
+            {
+                OpenixMetrics::Timer timer(Metric::READ);
+                got = file.readAt(info.offset + delivered, buffer.data(), chunk);
+            }
+            if (got != chunk) {
+                throw std::runtime_error("Unexpected end of image while reading " + info.filename);
+            }
+            if (decrypt) {
+                OpenixMetrics::Timer timer(Metric::DECRYPT);
+                rc6DecryptInPlace(buffer.data(), chunk, fileContentContext_);
+            }
+        }
+
+        const auto useful = static_cast<size_t>(std::min<uint64_t>(chunk, length - delivered));
+        sink(buffer.data(), useful);
+        delivered += useful;
+    }
+
+    return delivered;
+}
+
+size_t OpenixIMGFile::readEntryRange(const size_t index, const uint64_t offset, void *data, const size_t length) const {
+    if (!imageLoaded_) {
+        throw std::runtime_error("No image file loaded!");
+    }
+    return readEntryRange(OpenixFileIO(imageFilePath_), index, offset, data, length);
+}
+
+size_t OpenixIMGFile::readEntryRange(const OpenixFileIO &file, const size_t index, const uint64_t offset, void *data,
+                                     const size_t length) const {
+    if (!imageLoaded_) {
+        throw std::runtime_error("No image file loaded!");
+    }
+    if (index >= fileList_.size()) {
+        throw std::runtime_error("Entry index out of range: " + std::to_string(index));
+    }
+
+    const auto &info = fileList_[index];
+    const uint64_t entryLength = std::min(info.originalLength, info.storedLength);
+    if (offset >= entryLength || length == 0) {
+        return 0;
+    }
+    const auto count = static_cast<size_t>(std::min<uint64_t>(length, entryLength - offset));
+
+    // Widen to whole cipher blocks; stored lengths are block multiples, so the end stays inside
+    const uint64_t first = offset & ~uint64_t{15};
+    const uint64_t last = std::min<uint64_t>((offset + count + 15) & ~uint64_t{15}, info.storedLength);
+    std::vector<uint8_t> buffer(static_cast<size_t>(last - first));
+
+    OpenixScheduler::Task task(OpenixScheduler::currentPriority(Priority::INTERACTIVE));
+    task.addBytes(buffer.size());
+    {
+        OpenixMetrics::Timer timer(Metric::READ);
+        if (file.readAt(info.offset + first, buffer.data(), buffer.size()) != buffer.size()) {
+            throw std::runtime_error("Unexpected end of image while reading " + info.filename);
+        }
+    }
+    if (isEncrypted_ && encryptionEnabled_) {
+        OpenixMetrics::Timer timer(Metric::DECRYPT);
+        rc6DecryptInPlace(buffer.data(), buffer.size(), fileContentContext_);
+    }
+
+    std::memcpy(data, buffer.data() + (offset - first), count);
+    return count;
+}
+
+void OpenixIMGFile::writeEntryRange(const size_t index, const uint64_t offset, const void *data, const size_t length) {
+    if (!imageLoaded_) {
+        throw std::runtime_error("No image file loaded!");
+    }
+    if (index >= fileList_.size()) {
+        throw std::runtime_error("Entry index out of range: " + std::to_string(index));
+    }
+
+    const auto &info = fileList_[index];
+    const uint64_t entryLength = std::min(info.originalLength, info.storedLength);
+    if (offset > entryLength || length > entryLength - offset) {
+        throw std::runtime_error("Write of " + std::to_string(length) + " bytes at offset " + std::to_string(offset) +
+                                 " does not fit in " + info.filename);
+    }
+    if (length == 0) {
+        return;
+    }
+
+    // Only the blocks at both ends hold bytes outside the range, but reading the span is one call
+    const uint64_t first = offset & ~uint64_t{15};
+    const uint64_t last = std::min<uint64_t>((offset + length + 15) & ~uint64_t{15}, info.storedLength);
+    std::vector<uint8_t> buffer(static_cast<size_t>(last - first));
+    const bool encrypt = isEncrypted_ && encryptionEnabled_;
+
+    OpenixScheduler::Task task(OpenixScheduler::currentPriority(Priority::INTERACTIVE));
+    task.addBytes(buffer.size());
+    const OpenixFileIO file(imageFilePath_, OpenixFileIO::Mode::UPDATE);
+    {
+        OpenixMetrics::Timer timer(Metric::READ);
+        if (file.readAt(info.offset + first, buffer.data(), buffer.size()) != buffer.size()) {
+            throw std::runtime_error("Unexpected end of image while reading " + info.filename);
+        }
+    }
+    if (encrypt) {
+        OpenixMetrics::Timer timer(Metric::DECRYPT);
+        rc6DecryptInPlace(buffer.data(), buffer.size(), fileContentContext_);
+    }
+
+    std::memcpy(buffer.data() + (offset - first), data, length);
+
+    if (encrypt) {
+        OpenixMetrics::Timer timer(Metric::ENCRYPT);
+        rc6EncryptInPlace(buffer.data(), buffer.size(), fileContentContext_);
+    }
+    {
+        OpenixMetrics::Timer timer(Metric::WRITE);
+        file.writeAt(info.offset + first, buffer.data(), buffer.size());
+    }
+
+    updateFingerprint();
 }
 
 void *OpenixIMGFile::rc6EncryptInPlace(void *data, const size_t length, const RC6 &context) {
@@ -552,3 +876,42 @@ const std::vector<OpenixIMGFile::FileInfo> &OpenixIMGFile::getFileList() const {
 bool OpenixIMGFile::isEncrypted() const {
     return isEncrypted_;
 }
+
+void OpenixIMGFile::setSharedCache(std::shared_ptr<OpenixSharedCache> cache) {
+    sharedCache_ = std::move(cache);
+}
+
+void OpenixIMGFile::setCancellationToken(std::shared_ptr<OpenixCancellationToken> token) {
+    cancellation_ = std::move(token);
+}
+
+void OpenixIMGFile::checkCancelled() const {
+    if (cancellation_) {
+        cancellation_->check();
+    }
+}
+
+uint64_t OpenixIMGFile::getFingerprint() const {
+    return fingerprint_;
+}
+
+bool OpenixIMGFile::usesSharedCache() const {
+    return sharedCache_ && isEncrypted_ && encryptionEnabled_;
+}
+
+void OpenixIMGFile::updateFingerprint() {
+    // FNV-1a over the decrypted header table, then the file size and modification time
+    fingerprint_ = 0xCBF29CE484222325ULL;
+    const auto mix = [this](const uint8_t byte) {
+        fingerprint_ = (fingerprint_ ^ byte) * 0x100000001B3ULL;
+    };
+    for (const auto byte: imageData_) {
+        mix(byte);
+    }
+    const auto modified = static_cast<uint64_t>(fs::last_write_time(imageFilePath_).time_since_epoch().count());
+    for (const auto value: {static_cast<uint64_t>(imageSize_), modified}) {
+        for (int shift = 0; shift < 64; shift += 8) {
+            mix(static_cast<uint8_t>(value >> shift));
+        }
+    }
+}
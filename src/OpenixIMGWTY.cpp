@@ -10,7 +10,7 @@
 
 using namespace OpenixIMG;
 
-ImageHeader::ImageHeader() : v1() {
+ImageHeader::ImageHeader() : v3() {
     std::memcpy(magic.data(), IMAGEWTY_MAGIC, IMAGEWTY_MAGIC_LEN);
     header_version = 0;
     header_size = 0;
@@ -0,0 +1,331 @@
+/**
+ * @file OpenixMetrics.cpp
+ * @brief Implementation of OpenixHistogram, OpenixMetrics and OpenixMetricsExporter
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include "OpenixMetrics.hpp"
+
+using namespace OpenixIMG;
+
+namespace {
+    // Export description of one metric; entries of one family must be adjacent
+    struct MetricInfo {
+        const char *family; // Metric family name
+        const char *labels; // Constant labels of the series, may be empty
+        const char *help; // HELP text of the family
+        double scale; // Divisor from the recorded unit to the exported unit
+        unsigned minExponent; // Smallest exported bucket bound, as a power of two of the recorded unit
+        unsigned maxExponent; // Largest exported bucket bound
+    };
+
+    // Durations: buckets from ~1 us to ~69 s; throughput: from 64 KiB/s to 64 GiB/s
+    constexpr MetricInfo METRIC_INFO[] = {
+        {"openiximg_read_seconds", "", "Latency of positional reads of entry data.", 1e9, 10, 36},
+        {
+            "openiximg_crypt_seconds", "direction=\"decrypt\"", "Latency of encrypting or decrypting entry data.",
+            1e9, 10, 36
+        },
+        {
+            "openiximg_crypt_seconds", "direction=\"encrypt\"", "Latency of encrypting or decrypting entry data.",
+            1e9, 10, 36
+        },
+        {"openiximg_write_seconds", "", "Latency of writing one entry to the output.", 1e9, 10, 36},
+        {"openiximg_pack_stage_seconds", "stage=\"plan\"", "Duration of the packer stages.", 1e9, 10, 36},
+        {"openiximg_pack_stage_seconds", "stage=\"table\"", "Duration of the packer stages.", 1e9, 10, 36},
+        {"openiximg_pack_stage_seconds", "stage=\"payload\"", "Duration of the packer stages.", 1e9, 10, 36},
+        {
+            "openiximg_image_throughput_bytes_per_second", "operation=\"pack\"",
+            "Throughput of complete image operations.", 1, 16, 36
+        },
+        {
+            "openiximg_image_throughput_bytes_per_second", "operation=\"unpack\"",
+            "Throughput of complete image operations.", 1, 16, 36
+        },
+        {
+            "openiximg_schedule_wait_seconds", "class=\"interactive\"",
+            "Time chunk-sized tasks waited for a scheduler slot.", 1e9, 10, 36
+        },
+        {
+            "openiximg_schedule_wait_seconds", "class=\"bulk\"",
+            "Time chunk-sized tasks waited for a scheduler slot.", 1e9, 10, 36
+        },
+        {
+            "openiximg_task_latency_seconds", "class=\"interactive\"",
+            "Queueing plus run time of chunk-sized tasks.", 1e9, 10, 36
+        },
+        {
+            "openiximg_task_latency_seconds", "class=\"bulk\"",
+            "Queueing plus run time of chunk-sized tasks.", 1e9, 10, 36
+        },
+        {
+            "openiximg_task_throughput_bytes_per_second", "class=\"interactive\"",
+            "Throughput of chunk-sized tasks while they hold a slot.", 1, 16, 36
+        },
+        {
+            "openiximg_task_throughput_bytes_per_second", "class=\"bulk\"",
+            "Throughput of chunk-sized tasks while they hold a slot.", 1, 16, 36
+        },
+    };
+
+    static_assert(std::size(METRIC_INFO) == static_cast<size_t>(Metric::COUNT), "metric table out of sync");
+
+    std::atomic<bool> metricsEnabled{false};
+
+    std::array<OpenixHistogram, static_cast<size_t>(Metric::COUNT)> &histograms() {
+        static std::array<OpenixHistogram, static_cast<size_t>(Metric::COUNT)> instance;
+        return instance;
+    }
+
+    unsigned highestBit(const uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+        return 63U - static_cast<unsigned>(__builtin_clzll(value));
+#else
+        unsigned bit = 0;
+        while (value >> (bit + 1)) {
+            ++bit;
+        }
+        return bit;
+#endif
+    }
+
+    std::string formatValue(const double value) {
+        std::ostringstream ss;
+        ss << std::setprecision(9) << value;
+        return ss.str();
+    }
+
+    std::string seriesLabels(const MetricInfo &info, const std::string &extra) {
+        std::string labels = info.labels;
+        if (!extra.empty()) {
+            labels += labels.empty() ? extra : "," + extra;
+        }
+        return labels.empty() ? "" : "{" + labels + "}";
+    }
+}
+
+void OpenixHistogram::record(const uint64_t value) {
+    buckets_[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+}
+
+uint64_t OpenixHistogram::count() const {
+    return count_.load(std::memory_order_relaxed);
+}
+
+uint64_t OpenixHistogram::sum() const {
+    return sum_.load(std::memory_order_relaxed);
+}
+
+uint64_t OpenixHistogram::countAtMost(const uint64_t bound) const {
+    uint64_t total = 0;
+    for (size_t i = 0; i < BUCKET_COUNT && bucketUpperBound(i) <= bound; ++i) {
+        total += buckets_[i].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+uint64_t OpenixHistogram::quantile(const double quantile) const {
+    const auto total = count();
+    if (total == 0) {
+        return 0;
+    }
+
+    const auto rank = static_cast<uint64_t>(std::ceil(std::clamp(quantile, 0.0, 1.0) * static_cast<double>(total)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen >= rank && seen > 0) {
+            return bucketUpperBound(i);
+        }
+    }
+    return bucketUpperBound(BUCKET_COUNT - 1);
+}
+
+void OpenixHistogram::reset() {
+    for (auto &bucket: buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+}
+
+size_t OpenixHistogram::bucketIndex(const uint64_t value) {
+    constexpr uint64_t subBuckets = 1ULL << SUB_BUCKET_BITS;
+
+    // Bucket bounds are inclusive upper bounds, so a value on a bound is classified as the value below it
+    const auto below = value > 0 ? value - 1 : 0;
+    if (below < subBuckets) {
+        return static_cast<size_t>(below);
+    }
+
+    // Octave from the top bit, linear position from the next SUB_BUCKET_BITS bits
+    const auto top = highestBit(below);
+    const auto shift = top - SUB_BUCKET_BITS;
+    return static_cast<size_t>((shift + 1) << SUB_BUCKET_BITS) +
+           static_cast<size_t>((below >> shift) & (subBuckets - 1));
+}
+
+uint64_t OpenixHistogram::bucketUpperBound(const size_t index) {
+    constexpr size_t subBuckets = size_t{1} << SUB_BUCKET_BITS;
+    const auto next = index + 1;
+    if (next < subBuckets) {
+        return next;
+    }
+    if (next >= BUCKET_COUNT) {
+        return UINT64_MAX;
+    }
+
+    const auto shift = static_cast<unsigned>(next >> SUB_BUCKET_BITS) - 1;
+    return static_cast<uint64_t>(subBuckets + (next & (subBuckets - 1))) << shift;
+}
+
+OpenixMetrics::Timer::Timer(const Metric metric) : metric_(metric), active_(isEnabled()) {
+    if (active_) {
+        start_ = std::chrono::steady_clock::now();
+    }
+}
+
+OpenixMetrics::Timer::~Timer() {
+    if (active_) {
+        recordDuration(metric_, std::chrono::steady_clock::now() - start_);
+    }
+}
+
+void OpenixMetrics::setEnabled(const bool enabled) {
+    metricsEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool OpenixMetrics::isEnabled() {
+    return metricsEnabled.load(std::memory_order_relaxed);
+}
+
+void OpenixMetrics::record(const Metric metric, const uint64_t value) {
+    if (isEnabled()) {
+        histograms()[static_cast<size_t>(metric)].record(value);
+    }
+}
+
+void OpenixMetrics::recordDuration(const Metric metric, const std::chrono::steady_clock::duration duration) {
+    const auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    record(metric, nanoseconds > 0 ? static_cast<uint64_t>(nanoseconds) : 0);
+}
+
+void OpenixMetrics::recordThroughput(const Metric metric, const uint64_t bytes,
+                                     const std::chrono::steady_clock::duration duration) {
+    const auto seconds = std::chrono::duration<double>(duration).count();
+    if (seconds > 0) {
+        record(metric, static_cast<uint64_t>(static_cast<double>(bytes) / seconds));
+    }
+}
+
+const OpenixHistogram &OpenixMetrics::histogram(const Metric metric) {
+    return histograms()[static_cast<size_t>(metric)];
+}
+
+void OpenixMetrics::reset() {
+    for (auto &histogram: histograms()) {
+        histogram.reset();
+    }
+}
+
+std::string OpenixMetrics::dumpToString() {
+    std::ostringstream ss;
+    const char *family = nullptr;
+
+    for (size_t i = 0; i < static_cast<size_t>(Metric::COUNT); ++i) {
+        const auto &info = METRIC_INFO[i];
+        const auto &histogram = histograms()[i];
+
+        if (!family || std::strcmp(family, info.family) != 0) {
+            family = info.family;
+            ss << "# HELP " << info.family << " " << info.help << "\n";
+            ss << "# TYPE " << info.family << " histogram\n";
+        }
+
+        // Snapshot the count first: concurrent updates may only make buckets larger
+        const auto count = histogram.count();
+        for (auto exponent = info.minExponent; exponent <= info.maxExponent; ++exponent) {
+            const auto bound = 1ULL << exponent;
+            ss << info.family << "_bucket"
+                    << seriesLabels(info, "le=\"" + formatValue(static_cast<double>(bound) / info.scale) + "\"") << " "
+                    << std::min(histogram.countAtMost(bound), count) << "\n";
+        }
+        ss << info.family << "_bucket" << seriesLabels(info, "le=\"+Inf\"") << " " << count << "\n";
+        ss << info.family << "_sum" << seriesLabels(info, "") << " "
+                << formatValue(static_cast<double>(histogram.sum()) / info.scale) << "\n";
+        ss << info.family << "_count" << seriesLabels(info, "") << " " << count << "\n";
+    }
+
+    return ss.str();
+}
+
+void OpenixMetrics::writeTextfile(const std::string &path) {
+    // node_exporter ignores files not ending in .prom, so the temporary file is never scraped
+    const auto temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to open metrics file: " + temporary);
+        }
+        file << dumpToString();
+        file.close();
+        if (!file) {
+            throw std::runtime_error("Failed to write metrics file: " + temporary);
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        throw std::runtime_error("Failed to replace metrics file: " + path);
+    }
+}
+
+OpenixMetricsExporter::OpenixMetricsExporter(std::string path, const std::chrono::milliseconds interval)
+    : path_(std::move(path)), interval_(interval), stop_(false) {
+    OpenixMetrics::setEnabled(true);
+
+    if (interval_.count() > 0) {
+        thread_ = std::thread([this]() {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while (!wake_.wait_for(lock, interval_, [this]() { return stop_; })) {
+                lock.unlock();
+                exportNow();
+                lock.lock();
+            }
+        });
+    }
+}
+
+OpenixMetricsExporter::~OpenixMetricsExporter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    exportNow();
+}
+
+void OpenixMetricsExporter::exportNow() const {
+    try {
+        OpenixMetrics::writeTextfile(path_);
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "Metrics export failed: %s\n", e.what());
+    }
+}
@@ -4,238 +4,1005 @@
  * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
  */
 
-#include <fstream>
 #include <filesystem>
 #include <cstring>
-#include <iostream>
 #include <ctime>
-#include <iomanip>
 #include <optional>
 #include <algorithm>
+#include <cctype>
 #include <cstdint>
+#include <sstream>
+#include <chrono>
+#include <exception>
+#include <random>
+#include <iomanip>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#elif defined(__APPLE__)
+#include <cstdio>
+#endif
 
 #include "OpenixIMGWTY.hpp"
 #include "OpenixPacker.hpp"
 
 #include "OpenixCFG.hpp"
+#include "OpenixCFGView.hpp"
+#include "OpenixTarReader.hpp"
 #include "OpenixUtils.hpp"
+#include "OpenixMetrics.hpp"
+#include "OpenixPlanner.hpp"
+#include "OpenixSparseWriter.hpp"
+#include "OpenixScheduler.hpp"
 
 using namespace OpenixIMG;
 namespace fs = std::filesystem;
 
+// Payload I/O buffer used while packing (multiple of the 512-byte payload alignment)
+constexpr size_t PACK_BUFFER_SIZE = IO_BUFFER_SIZE;
+
+// Payloads are stored padded to this boundary
+constexpr uint32_t PACK_PAYLOAD_ALIGN = 512;
+
+// Largest image.cfg accepted from a tar stream (it is parsed from memory)
+constexpr uint64_t PACK_MAX_CONFIG_SIZE = 16 * 1024 * 1024;
+
+// Largest boundary payloads can be aligned to
+constexpr uint32_t PACK_MAX_PAYLOAD_ALIGNMENT = 1024 * 1024;
+
+// Entries of at most this size are stored in the metadata region by PayloadLayout::METADATA_FIRST
+constexpr uint64_t PACK_METADATA_MAX_SIZE = 256 * 1024;
+
+// Bytes of an output file handed to write-back at a time with Durability::INCREMENTAL
+constexpr uint64_t WRITEBACK_WINDOW = 8 * 1024 * 1024;
+
+namespace {
+    /**
+     * @brief Removes an output file or directory when its scope is left by an exception
+     *
+     * Cancelled or failed operations leave nothing half-written behind. Declare it before
+     * the handles writing the output, so they are closed when it runs.
+     */
+    class PartialOutputGuard {
+    public:
+        PartialOutputGuard(fs::path path, const bool directory)
+            : path_(std::move(path)), directory_(directory), exceptions_(std::uncaught_exceptions()) {
+        }
+
+        ~PartialOutputGuard() {
+            if (std::uncaught_exceptions() > exceptions_) {
+                // Only ever a regular file for file outputs, whatever -o happened to name
+                std::error_code ec;
+                if (directory_) {
+                    fs::remove_all(path_, ec);
+                } else if (fs::is_regular_file(path_, ec)) {
+                    fs::remove(path_, ec);
+                }
+            }
+        }
+
+        PartialOutputGuard(const PartialOutputGuard &) = delete;
+
+        PartialOutputGuard &operator=(const PartialOutputGuard &) = delete;
+
+    private:
+        fs::path path_;
+        bool directory_;
+        int exceptions_;
+    };
+
+    /**
+     * @brief Streams an output file to the device behind the writer
+     *
+     * Each full window is handed to write-back as soon as it is written, and the writer waits
+     * for the window before it, so at most two windows per file are dirty at any time.
+     */
+    class WritebackWindow {
+    public:
+        WritebackWindow(const OpenixFileIO &file, const bool enabled) : file_(file), enabled_(enabled) {
+        }
+
+        void advance(const uint64_t written) {
+            while (enabled_ && written - issued_ >= WRITEBACK_WINDOW) {
+                file_.writeback(issued_, WRITEBACK_WINDOW, false);
+                if (issued_ >= WRITEBACK_WINDOW) {
+                    file_.writeback(issued_ - WRITEBACK_WINDOW, WRITEBACK_WINDOW, true);
+                }
+                issued_ += WRITEBACK_WINDOW;
+            }
+        }
+
+    private:
+        const OpenixFileIO &file_;
+        bool enabled_;
+        uint64_t issued_ = 0;
+    };
+
+    // Makes the entries of a directory durable; a no-op where directories cannot be opened
+    void syncDirectory(const fs::path &directory) {
+#ifndef _WIN32
+        OpenixFileIO(directory.empty() ? "." : directory.string()).sync();
+#else
+        (void) directory;
+#endif
+    }
+
+    // Syncs every file written below a directory: one syncfs, or an fsync per file where that is missing
+    void syncOutputs(const fs::path &directory, const std::vector<std::string> &files) {
+#ifndef _WIN32
+        if (OpenixFileIO(directory.string()).syncFileSystem()) {
+            return;
+        }
+#endif
+        for (const auto &file: files) {
+            OpenixFileIO(file, OpenixFileIO::Mode::UPDATE).sync();
+        }
+        syncDirectory(directory);
+    }
+
+    uint64_t alignUp(const uint64_t value, const uint64_t alignment) {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    // Entries read before any payload, ahead of the merely small ones in the metadata region
+    constexpr const char *METADATA_ENTRY_PREFIXES[] = {
+        "sys_partition", "sys_config", "sunxi_mbr", "sunxi_gpt", "dlinfo", "boot0", "toc0", "fes1", "u-boot",
+        "toc1", "boot_package", "env",
+    };
+
+    // 0 for well-known metadata, 1 for other small entries, 2 for everything else
+    int metadataRank(const std::string &filename, const uint64_t size) {
+        std::string name = fs::path(filename).filename().string();
+        std::transform(name.begin(), name.end(), name.begin(), [](const unsigned char c) {
+            return static_cast<char>(std::tolower(c));
+        });
+        for (const auto *prefix: METADATA_ENTRY_PREFIXES) {
+            if (name.rfind(prefix, 0) == 0) {
+                return 0;
+            }
+        }
+        return size <= PACK_METADATA_MAX_SIZE ? 1 : 2;
+    }
+
+    // Index of the first FILELIST entry naming the same file as entries[index]
+    template<typename Entry>
+    size_t firstListing(const std::vector<Entry> &entries, const size_t index) {
+        for (size_t i = 0; i < index; ++i) {
+            if (entries[i].filename == entries[index].filename) {
+                return i;
+            }
+        }
+        return index;
+    }
+
+    // Creates an empty hidden directory next to target, on the same file system so renames stay atomic
+    fs::path makeSiblingDirectory(const fs::path &target, const std::string &tag) {
+        static std::mt19937_64 generator{std::random_device{}()};
+        static std::mutex generatorMutex;
+        for (int attempt = 0; attempt < 100; ++attempt) {
+            std::ostringstream name;
+            {
+                std::lock_guard<std::mutex> lock(generatorMutex);
+                name << "." << target.filename().string() << "." << tag << "-" << std::hex << std::setw(16)
+                        << std::setfill('0') << generator();
+            }
+            const auto path = target.parent_path() / name.str();
+            if (fs::create_directory(path)) {
+                return path;
+            }
+        }
+        throw std::runtime_error("Cannot create a directory next to " + target.string() + "!");
+    }
+
+    // Exchanges two existing paths in one step, where the platform supports it
+    bool exchangePaths(const fs::path &from, const fs::path &to) {
+#if defined(__linux__) && defined(SYS_renameat2)
+#ifndef RENAME_EXCHANGE
+        constexpr unsigned RENAME_EXCHANGE = 1U << 1;
+#endif
+        return syscall(SYS_renameat2, AT_FDCWD, from.c_str(), AT_FDCWD, to.c_str(), RENAME_EXCHANGE) == 0;
+#elif defined(__APPLE__)
+        return renamex_np(from.c_str(), to.c_str(), RENAME_SWAP) == 0;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * @brief Put a complete staging directory in the place of target
+     *
+     * @return Path now holding the replaced tree, or an empty path if there was none to keep
+     */
+    fs::path swapIntoPlace(const fs::path &staging, const fs::path &target) {
+        const auto status = fs::symlink_status(target);
+        if (!fs::exists(status)) {
+            fs::rename(staging, target);
+            return {};
+        }
+        if (!fs::is_directory(status)) {
+            fs::remove(target);
+            fs::rename(staging, target);
+            return {};
+        }
+        if (exchangePaths(staging, target)) {
+            return staging;
+        }
+
+        // Without an exchange the target is briefly missing, but never half-written
+        const auto replaced = makeSiblingDirectory(target, "old");
+        fs::rename(target, replaced);
+        try {
+            fs::rename(staging, target);
+        } catch (...) {
+            std::error_code ec;
+            fs::rename(replaced, target, ec);
+            throw;
+        }
+        return replaced;
+    }
+}
+
 OpenixPacker::OpenixPacker(OpenixIMGFile &imgFile) : imgFile_(imgFile) {
 }
 
-OpenixPacker::~OpenixPacker() = default;
+OpenixPacker::~OpenixPacker() {
+    waitForCleanup();
+}
+
+void OpenixPacker::setDurability(const Durability durability) {
+    durability_ = durability;
+}
+
+void OpenixPacker::setPayloadLayout(const PayloadLayout layout) {
+    layout_ = layout;
+}
+
+void OpenixPacker::setPayloadAlignment(const uint32_t alignment) {
+    if (alignment < PACK_PAYLOAD_ALIGN || alignment > PACK_MAX_PAYLOAD_ALIGNMENT || (alignment & (alignment - 1))) {
+        throw std::runtime_error("Payload alignment must be a power of two from " +
+                                 std::to_string(PACK_PAYLOAD_ALIGN) + " to " +
+                                 std::to_string(PACK_MAX_PAYLOAD_ALIGNMENT) + " bytes, not " +
+                                 std::to_string(alignment));
+    }
+    payloadAlignment_ = alignment;
+}
+
+void OpenixPacker::waitForCleanup() const {
+    std::vector<std::thread> cleanups;
+    {
+        std::lock_guard<std::mutex> lock(cleanupMutex_);
+        cleanups.swap(cleanups_);
+    }
+    for (auto &thread: cleanups) {
+        thread.join();
+    }
+}
+
+void OpenixPacker::removeInBackground(const std::string &path) const {
+    std::lock_guard<std::mutex> lock(cleanupMutex_);
+    cleanups_.emplace_back([path]() {
+        std::error_code ec;
+        fs::remove_all(path, ec);
+        if (ec) {
+            OpenixUtils::log("Unable to remove replaced output " + path + ": " + ec.message());
+        }
+    });
+}
 
 bool OpenixPacker::genImageCfgFromFileList(const std::vector<OpenixIMGFile::FileInfo> &fileList,
                                            const std::string &outputDir, const OutputFormat &outputFormat) const {
-    try {
-        // Create OpenixCFG instance to build the configuration
-        OpenixCFG cfg;
-
-        // Create DIR_DEF group
-        const auto dirDefGroup = std::make_shared<Group>("DIR_DEF");
-        const auto inputDirVar = std::make_shared<Variable>("INPUT_DIR", ValueType::STRING);
-        inputDirVar->setString("../");
-        dirDefGroup->addVariable(inputDirVar);
-
-        auto fileListGroup = std::make_shared<Group>("FILELIST");
-        for (const auto &fileInfo: fileList) {
-            auto listItem = std::make_shared<Variable>("", ValueType::LIST_ITEM);
-
-            // Determine filename based on output format
-            std::string filename;
-            if (outputFormat == OutputFormat::UNIMG) {
-                filename = fileInfo.maintype + "_" + fileInfo.subtype;
-            } else {
-                filename = fileInfo.filename;
-                // Remove leading slash if present
-                if (!filename.empty() && filename[0] == '/') {
-                    filename = filename.substr(1);
-                }
+    // Create OpenixCFG instance to build the configuration
+    OpenixCFG cfg;
+
+    // Create DIR_DEF group
+    const auto dirDefGroup = std::make_shared<Group>("DIR_DEF");
+    const auto inputDirVar = std::make_shared<Variable>("INPUT_DIR", ValueType::STRING);
+    inputDirVar->setString("../");
+    dirDefGroup->addVariable(inputDirVar);
+
+    auto fileListGroup = std::make_shared<Group>("FILELIST");
+    for (const auto &fileInfo: fileList) {
+        auto listItem = std::make_shared<Variable>("", ValueType::LIST_ITEM);
+
+        // Determine filename based on output format
+        std::string filename;
+        if (outputFormat == OutputFormat::UNIMG) {
+            filename = fileInfo.maintype + "_" + fileInfo.subtype;
+        } else {
+            filename = fileInfo.filename;
+            // Remove leading slash if present
+            if (!filename.empty() && filename[0] == '/') {
+                filename = filename.substr(1);
             }
+        }
 
-            auto filenameVar = std::make_shared<Variable>("filename", ValueType::STRING);
-            filenameVar->setString(filename);
-            listItem->addItem(filenameVar);
-
-            // Add maintype to list item
-            auto maintypeVar = std::make_shared<Variable>("maintype", ValueType::STRING);
-            maintypeVar->setString(fileInfo.maintype);
-            listItem->addItem(maintypeVar);
-
-            // Add subtype to list item
-            auto subtypeVar = std::make_shared<Variable>("subtype", ValueType::STRING);
-            subtypeVar->setString(fileInfo.subtype);
-            listItem->addItem(subtypeVar);
-
-            // Add list item to FILELIST group
-            fileListGroup->addVariable(listItem);
-        }
-
-        // Create IMAGE_CFG group
-        auto imageCfgGroup = std::make_shared<Group>("IMAGE_CFG");
-
-        // Add basic image configuration
-        auto versionVar = std::make_shared<Variable>("version", ValueType::NUMBER);
-        versionVar->setNumber(1);
-        imageCfgGroup->addVariable(versionVar);
-
-        // Add pid to IMAGE_CFG
-        auto pidVar = std::make_shared<Variable>("pid", ValueType::NUMBER);
-        pidVar->setNumber(imgFile_.getPID());
-        imageCfgGroup->addVariable(pidVar);
-
-        // Add vid to IMAGE_CFG
-        auto vidVar = std::make_shared<Variable>("vid", ValueType::NUMBER);
-        vidVar->setNumber(imgFile_.getVID());
-        imageCfgGroup->addVariable(vidVar);
-
-        // Add hardwareid to IMAGE_CFG
-        auto hardwareidVar = std::make_shared<Variable>("hardwareid", ValueType::NUMBER);
-        hardwareidVar->setNumber(imgFile_.getHardwareId());
-        imageCfgGroup->addVariable(hardwareidVar);
-
-        // Add firmwareid to IMAGE_CFG
-        auto firmwareidVar = std::make_shared<Variable>("firmwareid", ValueType::NUMBER);
-        firmwareidVar->setNumber(imgFile_.getFirmwareId());
-        imageCfgGroup->addVariable(firmwareidVar);
-
-        // Add imagename to IMAGE_CFG
-        auto imagenameVar = std::make_shared<Variable>("imagename", ValueType::REFERENCE);
-        imagenameVar->setReference(imgFile_.getImageFilePath());
-        imageCfgGroup->addVariable(imagenameVar);
-
-        // Add filelist to IMAGE_CFG
-        auto filelistVar = std::make_shared<Variable>("filelist", ValueType::REFERENCE);
-        filelistVar->setReference("FILELIST");
-        imageCfgGroup->addVariable(filelistVar);
-
-        // Add groups to OpenixCFG instance
-        cfg.addGroup(dirDefGroup);
-        cfg.addGroup(fileListGroup);
-        cfg.addGroup(imageCfgGroup);
-
-        // Open image.cfg for writing
-        std::string configPath = outputDir + "/image.cfg";
-        std::ofstream configFile(configPath);
-        if (!configFile.is_open()) {
-            std::cerr << "Error: unable to create configuration file " << configPath << "!" << std::endl;
-            return false;
-        }
-
-        // Write header information to config file
-        time_t now = time(nullptr);
-        tm *timeinfo = localtime(&now);
-        char timeStr[256];
-        strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", timeinfo);
-
-        configFile << ";/**************************************************************************/\n";
-        configFile << "; " << timeStr << "\n";
-        configFile << "; generated by OpenixIMG\n";
-        configFile << "; " << imgFile_.getImageFilePath() << "\n";
-        configFile << ";/**************************************************************************/\n";
-
-        // Use dumpToString() to get configuration content and write to file
-        std::string configContent = cfg.dumpToString();
-        configFile << configContent;
-
-        configFile.close();
-
-        return true;
-    } catch (const std::exception &e) {
-        std::cerr << "Error generating image configuration: " << e.what() << std::endl;
-        return false;
+        auto filenameVar = std::make_shared<Variable>("filename", ValueType::STRING);
+        filenameVar->setString(filename);
+        listItem->addItem(filenameVar);
+
+        // Add maintype to list item
+        auto maintypeVar = std::make_shared<Variable>("maintype", ValueType::STRING);
+        maintypeVar->setString(fileInfo.maintype);
+        listItem->addItem(maintypeVar);
+
+        // Add subtype to list item
+        auto subtypeVar = std::make_shared<Variable>("subtype", ValueType::STRING);
+        subtypeVar->setString(fileInfo.subtype);
+        listItem->addItem(subtypeVar);
+
+        // Add list item to FILELIST group
+        fileListGroup->addVariable(listItem);
     }
+
+    // Create IMAGE_CFG group
+    auto imageCfgGroup = std::make_shared<Group>("IMAGE_CFG");
+
+    // Add basic image configuration
+    auto versionVar = std::make_shared<Variable>("version", ValueType::NUMBER);
+    versionVar->setNumber(1);
+    imageCfgGroup->addVariable(versionVar);
+
+    // Add pid to IMAGE_CFG
+    auto pidVar = std::make_shared<Variable>("pid", ValueType::NUMBER);
+    pidVar->setNumber(imgFile_.getPID());
+    imageCfgGroup->addVariable(pidVar);
+
+    // Add vid to IMAGE_CFG
+    auto vidVar = std::make_shared<Variable>("vid", ValueType::NUMBER);
+    vidVar->setNumber(imgFile_.getVID());
+    imageCfgGroup->addVariable(vidVar);
+
+    // Add hardwareid to IMAGE_CFG
+    auto hardwareidVar = std::make_shared<Variable>("hardwareid", ValueType::NUMBER);
+    hardwareidVar->setNumber(imgFile_.getHardwareId());
+    imageCfgGroup->addVariable(hardwareidVar);
+
+    // Add firmwareid to IMAGE_CFG
+    auto firmwareidVar = std::make_shared<Variable>("firmwareid", ValueType::NUMBER);
+    firmwareidVar->setNumber(imgFile_.getFirmwareId());
+    imageCfgGroup->addVariable(firmwareidVar);
+
+    // Add imagename to IMAGE_CFG
+    auto imagenameVar = std::make_shared<Variable>("imagename", ValueType::REFERENCE);
+    imagenameVar->setReference(imgFile_.getImageFilePath());
+    imageCfgGroup->addVariable(imagenameVar);
+
+    // Add filelist to IMAGE_CFG
+    auto filelistVar = std::make_shared<Variable>("filelist", ValueType::REFERENCE);
+    filelistVar->setReference("FILELIST");
+    imageCfgGroup->addVariable(filelistVar);
+
+    // Add groups to OpenixCFG instance
+    cfg.addGroup(dirDefGroup);
+    cfg.addGroup(fileListGroup);
+    cfg.addGroup(imageCfgGroup);
+
+    // Header comment, then the configuration itself
+    time_t now = time(nullptr);
+    tm *timeinfo = localtime(&now);
+    char timeStr[256];
+    strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", timeinfo);
+
+    std::string configContent = ";/**************************************************************************/\n";
+    configContent += "; " + std::string(timeStr) + "\n";
+    configContent += "; generated by OpenixIMG\n";
+    configContent += "; " + imgFile_.getImageFilePath() + "\n";
+    configContent += ";/**************************************************************************/\n";
+    configContent += cfg.dumpToString();
+
+    const OpenixFileIO configFile(outputDir + "/image.cfg", OpenixFileIO::Mode::WRITE);
+    configFile.writeAt(0, configContent.data(), configContent.size());
+
+    return true;
 }
 
-bool OpenixPacker::unpackImage(const std::string &outputDir, const OutputFormat &outputFormat) const {
-    try {
-        // Check if image is loaded
-        if (!imgFile_.isImageLoaded()) {
-            throw std::runtime_error("No image file loaded!");
-        }
+bool OpenixPacker::unpackImage(const std::string &outputDir, const OutputFormat &outputFormat,
+                               const SparseOptions &sparse, const ReplaceMode replace) const {
+    // Check if image is loaded
+    if (!imgFile_.isImageLoaded()) {
+        throw std::runtime_error("No image file loaded!");
+    }
 
-        OpenixUtils::log("Unpacking image to " + outputDir);
-        OpenixUtils::log(
-            "Output format: " + std::string(outputFormat == OutputFormat::UNIMG ? "UNIMG" : "IMGREPACKER"));
+    OpenixUtils::log("Unpacking image to " + outputDir);
+    OpenixUtils::log(
+        "Output format: " + std::string(outputFormat == OutputFormat::UNIMG ? "UNIMG" : "IMGREPACKER"));
 
+    // A swapped unpack writes to a sibling and leaves the existing tree alone until it is complete
+    auto target = fs::path(outputDir).lexically_normal();
+    if (!target.has_filename()) {
+        target = target.parent_path();
+    }
+    std::string workDir = outputDir;
+    if (replace == ReplaceMode::SWAP) {
+        if (target.has_parent_path()) {
+            fs::create_directories(target.parent_path());
+        }
+        workDir = makeSiblingDirectory(target, "unpack").string();
+    } else {
         // Recreate output directory if it exists
-        if (fs::exists(outputDir)) {
-            if (!fs::remove_all(outputDir)) {
-                std::cerr << "Error: unable to remove existing output directory " << outputDir << "!" << std::endl;
-                return false;
-            }
+        if (fs::exists(outputDir) && !fs::remove_all(outputDir)) {
+            throw std::runtime_error("Unable to remove existing output directory " + outputDir + "!");
         }
 
         // Create output directory
         if (!fs::create_directories(outputDir)) {
             throw std::runtime_error("Cannot create output directory: " + outputDir + "!");
         }
+    }
+    const PartialOutputGuard guard(workDir, true);
+
+    // Extract all files from the image
+    const auto &fileList = imgFile_.getFileList();
+    const auto started = std::chrono::steady_clock::now();
+    uint64_t bytesWritten = 0;
+    std::vector<std::string> written;
+
+    for (size_t index = 0; index < fileList.size(); ++index) {
+        const auto &fileInfo = fileList[index];
+        const auto contName = OutputFormat::UNIMG == outputFormat
+                                  ? fileInfo.maintype + "_" + fileInfo.subtype
+                                  : fileInfo.filename;
+
+        if (isSparseEntry(sparse, fileInfo.filename, contName)) {
+            // Streamed straight into the sparse writer, never held in memory as a whole
+            const auto sparsePath = workDir + "/" + contName + ".simg";
+            OpenixUtils::log("Extracting " + fileInfo.filename + " as sparse image " + sparsePath);
+
+            written.push_back(sparsePath);
+            OpenixSparseWriter writer(sparsePath, OpenixSparseWriter::DEFAULT_BLOCK_SIZE, sparse.zeroAsDontCare);
+            OpenixMetrics::Timer timer(Metric::WRITE);
+            bytesWritten += imgFile_.readEntryChunks(index, [&writer](const uint8_t *data, const size_t length) {
+                OpenixScheduler::Task task(OpenixScheduler::currentPriority(Priority::BULK));
+                task.addBytes(length);
+                writer.write(data, length);
+            });
+            writer.finish();
+            continue;
+        }
 
-        // Extract all files from the image
-        const auto &fileList = imgFile_.getFileList();
-        bool allSuccess = true;
+        if (OutputFormat::UNIMG == outputFormat) {
+            OpenixUtils::log("Extracting: " + fileInfo.maintype + " " + fileInfo.subtype);
+        } else {
+            OpenixUtils::log("Extracting " + fileInfo.filename);
+        }
 
-        for (const auto &fileInfo: fileList) {
-            if (OutputFormat::UNIMG == outputFormat) {
-                // UNIMG format output
-                OpenixUtils::log("Extracting: " + fileInfo.maintype + " " + fileInfo.subtype);
+        // Streamed through one IO_BUFFER_SIZE chunk at a time, whatever the size of the entry
+        const auto outFilePath = workDir + "/" + contName;
+        written.push_back(outFilePath);
+        const OpenixFileIO outFile(outFilePath, OpenixFileIO::Mode::WRITE);
+        WritebackWindow window(outFile, durability_ == Durability::INCREMENTAL);
+        OpenixMetrics::Timer timer(Metric::WRITE);
+        uint64_t position = 0;
+        imgFile_.readEntryChunks(index, [&outFile, &window, &position](const uint8_t *data, const size_t length) {
+            OpenixScheduler::Task task(OpenixScheduler::currentPriority(Priority::BULK));
+            task.addBytes(length);
+            outFile.writeAt(position, data, length);
+            position += length;
+            window.advance(position);
+        });
+        bytesWritten += position;
+    }
 
-                // Get file data from memory
-                auto fileDataOpt = imgFile_.getFileDataByFilename(fileInfo.filename);
-                if (!fileDataOpt) {
-                    throw std::runtime_error("Error extracting file data: " + fileInfo.filename);
-                }
+    // The entries reach the device before image.cfg names them, and image.cfg before the swap publishes them
+    const bool durable = durability_ != Durability::NONE;
+    if (durable) {
+        syncOutputs(workDir, written);
+    }
+    if (!genImageCfgFromFileList(fileList, workDir, outputFormat)) {
+        throw std::runtime_error("Failed to generate image configuration files!");
+    }
+    if (durable) {
+        OpenixFileIO(workDir + "/image.cfg", OpenixFileIO::Mode::UPDATE).sync();
+        syncDirectory(workDir);
+    }
+    if (replace == ReplaceMode::SWAP) {
+        const auto replaced = swapIntoPlace(workDir, target);
+        if (durable) {
+            syncDirectory(target.parent_path());
+        }
+        if (!replaced.empty()) {
+            removeInBackground(replaced.string());
+        }
+    }
+    OpenixMetrics::recordThroughput(Metric::UNPACK_THROUGHPUT, bytesWritten,
+                                    std::chrono::steady_clock::now() - started);
+    OpenixUtils::log("Successfully unpacked " + std::to_string(fileList.size()) + " files to " + outputDir);
 
-                const auto &fileData = *fileDataOpt;
+    return true;
+}
 
-                // Create header and content filenames
-                std::string hdrFilename = fileInfo.maintype + "_" + fileInfo.subtype + ".hdr";
-                std::string contFilename = fileInfo.maintype + "_" + fileInfo.subtype;
+std::vector<OpenixPacker::PackEntry> OpenixPacker::collectPackEntries(const ImageCfgView &view) {
+    if (view.fileList.empty()) {
+        throw std::runtime_error("No files listed in " + view.fileListName);
+    }
 
-                // Write content file
-                std::string contPath = outputDir + std::string("/").append(contFilename);
-                std::ofstream contFile(contPath, std::ios::binary);
-                if (!contFile.is_open()) {
-                    throw std::runtime_error("Unable to create content file: " + contPath);
-                }
-                contFile.write(reinterpret_cast<const char *>(fileData.data()),
-                               static_cast<std::streamsize>(fileData.size()));
-                contFile.close();
-            } else if (OutputFormat::IMGREPACKER == outputFormat) {
-                // IMGREPACKER format output
-                OpenixUtils::log("Extracting " + fileInfo.filename);
-
-                // Get file data from memory
-                auto fileDataOpt = imgFile_.getFileDataByFilename(fileInfo.filename);
-                if (!fileDataOpt) {
-                    throw std::runtime_error("Error extracting file data: " + fileInfo.filename);
-                }
+    std::vector<PackEntry> entries;
+    entries.reserve(view.fileList.size());
+    for (const auto &file: view.fileList) {
+        PackEntry entry;
+        entry.filename = file.filename;
+        entry.maintype = file.maintype;
+        entry.subtype = file.subtype;
+
+        // Stored names never carry a leading slash
+        while (!entry.filename.empty() && entry.filename[0] == '/') {
+            entry.filename.erase(0, 1);
+        }
 
-                const auto &fileData = *fileDataOpt;
+        if (entry.filename.empty()) {
+            throw std::runtime_error("File list entry without filename in " + view.fileListName);
+        }
+        entries.push_back(std::move(entry));
+    }
 
-                // Write file data to output directory
-                std::string outFilePath = outputDir + std::string("/").append(fileInfo.filename);
-                std::ofstream outFile(outFilePath, std::ios::binary);
-                if (!outFile.is_open()) {
-                    throw std::runtime_error("Unable to create file: " + outFilePath);
-                }
+    return entries;
+}
 
-                outFile.write(reinterpret_cast<const char *>(fileData.data()),
-                              static_cast<std::streamsize>(fileData.size()));
-                outFile.close();
+uint64_t OpenixPacker::layoutPayloads(std::vector<PackEntry> &entries, const std::string &inputDir,
+                                      const PayloadLayout layout, const uint32_t alignment) {
+    std::vector<size_t> order;
+    for (size_t index = 0; index < entries.size(); ++index) {
+        auto &entry = entries[index];
+        if (firstListing(entries, index) != index) {
+            continue;
+        }
+        const auto path = fs::path(inputDir) / entry.filename;
+        if (!fs::is_regular_file(path)) {
+            throw std::runtime_error("Missing input file: " + path.string());
+        }
+        const auto size = fs::file_size(path);
+        if (size > UINT32_MAX - PACK_PAYLOAD_ALIGN) {
+            throw std::runtime_error("Input file too large for IMAGEWTY: " + path.string());
+        }
+        entry.length = static_cast<uint32_t>(size);
+        order.push_back(index);
+    }
+
+    // Stable, so each region keeps the file list order
+    if (layout == PayloadLayout::METADATA_FIRST) {
+        std::stable_sort(order.begin(), order.end(), [&entries](const size_t a, const size_t b) {
+            return metadataRank(entries[a].filename, entries[a].length) <
+                   metadataRank(entries[b].filename, entries[b].length);
+        });
+    }
+
+    uint64_t cursor = IMAGEWTY_FILEHDR_LEN + entries.size() * IMAGEWTY_FILEHDR_LEN;
+    for (const auto index: order) {
+        auto &entry = entries[index];
+        cursor = alignUp(cursor, alignment);
+        entry.offset = static_cast<uint32_t>(cursor);
+        cursor += (uint64_t{entry.length} + PACK_PAYLOAD_ALIGN - 1) & ~uint64_t{PACK_PAYLOAD_ALIGN - 1};
+        if (cursor > UINT32_MAX) {
+            throw std::runtime_error("Image exceeds the 4 GiB IMAGEWTY limit");
+        }
+    }
+
+    // Every entry naming a file shares the region of its first listing, as in packImageFromTar
+    for (size_t index = 0; index < entries.size(); ++index) {
+        const auto &first = entries[firstListing(entries, index)];
+        entries[index].length = first.length;
+        entries[index].offset = first.offset;
+    }
+    return cursor;
+}
+
+bool OpenixPacker::isSparseEntry(const SparseOptions &sparse, const std::string &filename,
+                                 const std::string &outputName) {
+    const auto stem = fs::path(filename).stem().string();
+    return std::any_of(sparse.entries.begin(), sparse.entries.end(), [&](const std::string &name) {
+        return name == filename || name == outputName || name == stem;
+    });
+}
+
+bool OpenixPacker::shouldEncrypt(const ImageCfgView &view) const {
+    return imgFile_.isEncryptionEnabled() && view.encrypt.value_or(1) != 0;
+}
+
+void OpenixPacker::writeImageTable(const OpenixFileIO &out, const ImageCfgView &view,
+                                   const std::vector<PackEntry> &entries, const uint32_t imageSize,
+                                   const bool encrypt) const {
+    const auto numFiles = static_cast<uint32_t>(entries.size());
+    std::vector<uint8_t> table(IMAGEWTY_FILEHDR_LEN + numFiles * IMAGEWTY_FILEHDR_LEN, 0);
+
+    ImageHeader header;
+    header.initialize(view.version.value_or(IMAGEWTY_VERSION), view.pid.value_or(0), view.vid.value_or(0),
+                      view.hardwareId.value_or(0), view.firmwareId.value_or(0), numFiles);
+    header.image_size = imageSize;
+    std::memcpy(table.data(), &header, sizeof(header));
+
+    for (uint32_t i = 0; i < numFiles; ++i) {
+        FileHeader fileHeader;
+        fileHeader.initialize(entries[i].filename, entries[i].maintype, entries[i].subtype, entries[i].length,
+                              entries[i].offset);
+        std::memcpy(table.data() + IMAGEWTY_FILEHDR_LEN * (i + 1), &fileHeader, sizeof(fileHeader));
+    }
+
+    if (encrypt) {
+        imgFile_.encryptData(table.data(), IMAGEWTY_FILEHDR_LEN, OpenixIMGFile::CryptoContext::HEADER);
+        imgFile_.encryptData(table.data() + IMAGEWTY_FILEHDR_LEN, numFiles * IMAGEWTY_FILEHDR_LEN,
+                             OpenixIMGFile::CryptoContext::FILE_HEADERS);
+    }
+
+    out.writeAt(0, table.data(), table.size());
+}
+
+uint32_t OpenixPacker::writePayload(const OpenixFileIO &out, uint64_t offset, const uint64_t length,
+                                    const std::function<size_t(uint8_t *, size_t)> &source, const bool encrypt,
+                                    const std::function<void(uint64_t)> &progress) const {
+    if (length > UINT32_MAX - PACK_PAYLOAD_ALIGN) {
+        throw std::runtime_error("Payload too large for IMAGEWTY: " + std::to_string(length) + " bytes");
+    }
+
+    const auto storedLength = static_cast<uint32_t>((length + PACK_PAYLOAD_ALIGN - 1) & ~uint64_t{
+                                                        PACK_PAYLOAD_ALIGN - 1
+                                                    });
+    std::vector<uint8_t> buffer(PACK_BUFFER_SIZE);
+
+    // Time spent per stage, summed over the chunks of this entry
+    const bool measure = OpenixMetrics::isEnabled();
+    std::chrono::steady_clock::duration encryptTime{0};
+    std::chrono::steady_clock::duration writeTime{0};
+
+    // Each chunk is one scheduler task: fill, encrypt and write
+    const auto priority = OpenixScheduler::currentPriority(Priority::BULK);
+    uint64_t written = 0;
+    while (written < storedLength) {
+        imgFile_.checkCancelled();
+        const auto chunk = static_cast<size_t>(std::min<uint64_t>(PACK_BUFFER_SIZE, storedLength - written));
+        OpenixScheduler::Task task(priority);
+        task.addBytes(chunk);
+        size_t filled = 0;
+
+        // Fill the chunk from the source, zero padding past the payload end
+        while (written + filled < length && filled < chunk) {
+            const auto want = static_cast<size_t>(std::min<uint64_t>(chunk - filled, length - written - filled));
+            const auto got = source(buffer.data() + filled, want);
+            if (got == 0) {
+                throw std::runtime_error("Unexpected end of payload data");
+            }
+            filled += got;
+        }
+        std::memset(buffer.data() + filled, 0, chunk - filled);
+
+        auto mark = measure ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+        if (encrypt) {
+            imgFile_.encryptData(buffer.data(), chunk, OpenixIMGFile::CryptoContext::FILE_CONTENT);
+            if (measure) {
+                const auto now = std::chrono::steady_clock::now();
+                encryptTime += now - mark;
+                mark = now;
+            }
+        }
+
+        out.writeAt(offset + written, buffer.data(), chunk);
+        if (measure) {
+            writeTime += std::chrono::steady_clock::now() - mark;
+        }
+        written += chunk;
+        if (progress) {
+            progress(offset + written);
+        }
+    }
+
+    if (encrypt) {
+        OpenixMetrics::recordDuration(Metric::ENCRYPT, encryptTime);
+    }
+    OpenixMetrics::recordDuration(Metric::WRITE, writeTime);
+
+    return storedLength;
+}
+
+bool OpenixPacker::packImage(const std::string &configPath, const std::string &outputFile) const {
+    const auto started = std::chrono::steady_clock::now();
+    OpenixCFG cfg;
+    if (!cfg.loadFromFile(configPath)) {
+        throw std::runtime_error("Failed to load image configuration: " + configPath);
+    }
+
+    const auto view = ImageCfgView::resolve(cfg);
+    auto entries = collectPackEntries(view);
+    const auto inputDir = fs::path(configPath).parent_path();
+    const bool encrypt = shouldEncrypt(view);
+
+    OpenixUtils::log("Packing " + std::to_string(entries.size()) + " files from " + inputDir.string() + " to " +
+                     outputFile + (encrypt ? " (encrypted)" : ""));
+
+    // Plan the payload regions: all sizes are known up front
+    const auto cursor = layoutPayloads(entries, inputDir.string(), layout_, payloadAlignment_);
+
+    OpenixMetrics::recordDuration(Metric::PACK_PLAN, std::chrono::steady_clock::now() - started);
+
+    const PartialOutputGuard guard(outputFile, false);
+    const OpenixFileIO out(outputFile, OpenixFileIO::Mode::WRITE);
+
+    // Written in offset order, so the image grows sequentially whatever the layout
+    std::vector<PackEntry *> byOffset;
+    for (size_t index = 0; index < entries.size(); ++index) {
+        if (firstListing(entries, index) == index) {
+            byOffset.push_back(&entries[index]);
+        }
+    }
+    std::sort(byOffset.begin(), byOffset.end(), [](const PackEntry *a, const PackEntry *b) {
+        return a->offset < b->offset;
+    });
+
+    WritebackWindow window(out, durability_ == Durability::INCREMENTAL);
+    const auto advance = [&window](const uint64_t written) {
+        window.advance(written);
+    };
+    const auto payloadStarted = std::chrono::steady_clock::now();
+    for (auto *entryPointer: byOffset) {
+        auto &entry = *entryPointer;
+        OpenixUtils::log("Packing " + entry.filename + " (size: " + std::to_string(entry.length) + " bytes)");
+
+        const OpenixFileIO in((inputDir / entry.filename).string());
+        uint64_t position = 0;
+        writePayload(out, entry.offset, entry.length, [&](uint8_t *data, const size_t length) {
+            const auto got = in.readAt(position, data, length);
+            position += got;
+            return got;
+        }, encrypt, advance);
+        entry.present = true;
+    }
+    OpenixMetrics::recordDuration(Metric::PACK_PAYLOAD, std::chrono::steady_clock::now() - payloadStarted);
+
+    // The payloads reach the device before the table that points at them
+    if (durability_ != Durability::NONE) {
+        out.sync();
+    }
+    {
+        OpenixMetrics::Timer timer(Metric::PACK_TABLE);
+        writeImageTable(out, view, entries, static_cast<uint32_t>(cursor), encrypt);
+    }
+
+    if (durability_ != Durability::NONE) {
+        out.sync();
+    }
+
+    OpenixMetrics::recordThroughput(Metric::PACK_THROUGHPUT, cursor, std::chrono::steady_clock::now() - started);
+    OpenixUtils::log("Successfully packed " + std::to_string(entries.size()) + " files to " + outputFile);
+    return true;
+}
+
+bool OpenixPacker::packImageFromTar(std::istream &tarStream, const std::string &configPath,
+                                    const std::string &outputFile) const {
+    const auto started = std::chrono::steady_clock::now();
+    OpenixCFG cfg;
+    ImageCfgView view;
+    std::vector<PackEntry> entries;
+    bool configLoaded = false;
+    bool encrypt = false;
+
+    if (!configPath.empty()) {
+        if (!cfg.loadFromFile(configPath)) {
+            throw std::runtime_error("Failed to load image configuration: " + configPath);
+        }
+        view = ImageCfgView::resolve(cfg);
+        entries = collectPackEntries(view);
+        encrypt = shouldEncrypt(view);
+        configLoaded = true;
+        OpenixMetrics::recordDuration(Metric::PACK_PLAN, std::chrono::steady_clock::now() - started);
+    }
+
+    const PartialOutputGuard guard(outputFile, false);
+    const OpenixFileIO out(outputFile, OpenixFileIO::Mode::WRITE);
+    OpenixTarReader tar(tarStream);
+    WritebackWindow window(out, durability_ == Durability::INCREMENTAL);
+    const auto advance = [&window](const uint64_t written) {
+        window.advance(written);
+    };
+    const auto payloadStarted = std::chrono::steady_clock::now();
+    OpenixTarReader::Member member;
+    uint64_t cursor = 0;
+
+    while (tar.next(member)) {
+        imgFile_.checkCancelled();
+        if (fs::path(member.name).filename() == "image.cfg") {
+            if (configLoaded) {
+                OpenixUtils::log("Ignoring " + member.name + " from stream, configuration already loaded");
+                continue;
+            }
+            if (member.size > PACK_MAX_CONFIG_SIZE) {
+                throw std::runtime_error(member.name + " in tar stream is too large");
             }
+
+            std::string text(static_cast<size_t>(member.size), '\0');
+            tar.read(reinterpret_cast<uint8_t *>(text.data()), text.size());
+            std::istringstream stream(text);
+            if (!cfg.loadFromStream(stream)) {
+                throw std::runtime_error("Failed to parse " + member.name + " from tar stream");
+            }
+            view = ImageCfgView::resolve(cfg);
+            entries = collectPackEntries(view);
+            encrypt = shouldEncrypt(view);
+            configLoaded = true;
+            OpenixMetrics::recordDuration(Metric::PACK_PLAN, std::chrono::steady_clock::now() - started);
+            continue;
+        }
+
+        if (!configLoaded) {
+            throw std::runtime_error("image.cfg must precede payload members in the tar stream (found " +
+                                     member.name + " first)");
+        }
+
+        if (cursor == 0) {
+            cursor = IMAGEWTY_FILEHDR_LEN + entries.size() * IMAGEWTY_FILEHDR_LEN;
+        }
+
+        // All table entries naming this file share one payload region
+        const auto listed = std::find_if(entries.begin(), entries.end(), [&member](const PackEntry &entry) {
+            return entry.filename == member.name;
+        });
+        if (listed == entries.end()) {
+            OpenixUtils::log("Skipping " + member.name + ": not listed in image configuration");
+            continue;
+        }
+
+        // A second copy would leave the first payload behind as dead space in the image
+        if (listed->present) {
+            throw std::runtime_error("Duplicate member in tar stream: " + member.name);
+        }
+
+        OpenixUtils::log("Packing " + member.name + " (size: " + std::to_string(member.size) + " bytes)");
+        cursor = alignUp(cursor, payloadAlignment_);
+        if (cursor > UINT32_MAX) {
+            throw std::runtime_error("Image exceeds the 4 GiB IMAGEWTY limit");
+        }
+        const auto stored = writePayload(out, cursor, member.size, [&tar](uint8_t *data, const size_t length) {
+            return tar.read(data, length);
+        }, encrypt, advance);
+
+        for (auto &entry: entries) {
+            if (entry.filename == member.name) {
+                entry.length = static_cast<uint32_t>(member.size);
+                entry.offset = static_cast<uint32_t>(cursor);
+                entry.present = true;
+            }
+        }
+
+        cursor += stored;
+        if (cursor > UINT32_MAX) {
+            throw std::runtime_error("Image exceeds the 4 GiB IMAGEWTY limit");
         }
+    }
+
+    if (!configLoaded) {
+        throw std::runtime_error("No image.cfg given and none found in the tar stream");
+    }
 
-        if (!genImageCfgFromFileList(fileList, outputDir, outputFormat)) {
-            throw std::runtime_error("Failed to generate image configuration files!");
+    for (const auto &entry: entries) {
+        if (!entry.present) {
+            throw std::runtime_error("Missing input file in tar stream: " + entry.filename);
         }
-        OpenixUtils::log("Successfully unpacked " + std::to_string(fileList.size()) + " files to " + outputDir);
+    }
+
+    OpenixMetrics::recordDuration(Metric::PACK_PAYLOAD, std::chrono::steady_clock::now() - payloadStarted);
+
+    // The payloads reach the device before the table that points at them
+    if (durability_ != Durability::NONE) {
+        out.sync();
+    }
+    {
+        OpenixMetrics::Timer timer(Metric::PACK_TABLE);
+        writeImageTable(out, view, entries, static_cast<uint32_t>(cursor), encrypt);
+    }
+
+    if (durability_ != Durability::NONE) {
+        out.sync();
+    }
+
+    OpenixMetrics::recordThroughput(Metric::PACK_THROUGHPUT, cursor, std::chrono::steady_clock::now() - started);
+    OpenixUtils::log("Successfully packed " + std::to_string(entries.size()) + " files to " + outputFile);
+    return true;
+}
 
-        return allSuccess;
-    } catch (const std::exception &) {
-        throw;
+OperationPlan OpenixPacker::planUnpack(const OutputFormat &outputFormat) const {
+    if (!imgFile_.isImageLoaded()) {
+        throw std::runtime_error("No image file loaded!");
     }
+
+    const auto &fileList = imgFile_.getFileList();
+    const bool decrypt = imgFile_.isEncrypted() && imgFile_.isEncryptionEnabled();
+
+    OperationPlan plan;
+    plan.operation = "unpack";
+    plan.source = imgFile_.getImageFilePath();
+    plan.encrypted = decrypt;
+
+    // Already done by loadImage, but part of the cost of the job: image header, then file headers
+    PlanStep headers;
+    headers.name = "headers";
+    headers.readBytes = IMAGEWTY_FILEHDR_LEN + fileList.size() * IMAGEWTY_FILEHDR_LEN;
+    headers.readOps = 2;
+    headers.decryptBytes = decrypt ? headers.readBytes : 0;
+    headers.bufferBytes = headers.readBytes;
+    plan.steps.push_back(headers);
+
+    // Mirrors unpackImage: each entry is streamed through one IO_BUFFER_SIZE buffer
+    for (const auto &fileInfo: fileList) {
+        const uint64_t length = std::min(fileInfo.originalLength, fileInfo.storedLength);
+        PlanStep step;
+        step.name = outputFormat == OutputFormat::UNIMG ? fileInfo.maintype + "_" + fileInfo.subtype : fileInfo.filename;
+        step.readBytes = fileInfo.storedLength;
+        step.readOps = (length + IO_BUFFER_SIZE - 1) / IO_BUFFER_SIZE;
+        step.decryptBytes = decrypt ? fileInfo.storedLength : 0;
+        step.writeBytes = length;
+        step.writeOps = step.readOps;
+        step.bufferBytes = std::min<uint64_t>(fileInfo.storedLength, IO_BUFFER_SIZE);
+        plan.steps.push_back(step);
+    }
+
+    // The generated image.cfg is a few KiB; only its write call is significant
+    PlanStep config;
+    config.name = "image.cfg";
+    config.writeOps = 1;
+    plan.steps.push_back(config);
+
+    return plan;
+}
+
+OperationPlan OpenixPacker::planPack(const std::string &configPath) const {
+    OpenixCFG cfg;
+    if (!cfg.loadFromFile(configPath)) {
+        throw std::runtime_error("Failed to load image configuration: " + configPath);
+    }
+
+    const auto view = ImageCfgView::resolve(cfg);
+    auto entries = collectPackEntries(view);
+    const bool encrypt = shouldEncrypt(view);
+    layoutPayloads(entries, fs::path(configPath).parent_path().string(), layout_, payloadAlignment_);
+
+    OperationPlan plan;
+    plan.operation = "pack";
+    plan.source = configPath;
+    plan.encrypted = encrypt;
+
+    PlanStep config;
+    config.name = "image.cfg";
+    config.readBytes = fs::file_size(configPath);
+    config.readOps = 1;
+    config.bufferBytes = config.readBytes;
+    plan.steps.push_back(config);
+
+    // Mirrors writeImageTable: the whole table is built in memory and written at once
+    PlanStep table;
+    table.name = "table";
+    table.writeBytes = IMAGEWTY_FILEHDR_LEN + entries.size() * IMAGEWTY_FILEHDR_LEN;
+    table.writeOps = 1;
+    table.encryptBytes = encrypt ? table.writeBytes : 0;
+    table.bufferBytes = table.writeBytes;
+    plan.steps.push_back(table);
+
+    // Mirrors packImage: each file once, in offset order
+    std::vector<const PackEntry *> regions;
+    for (size_t index = 0; index < entries.size(); ++index) {
+        if (firstListing(entries, index) == index) {
+            regions.push_back(&entries[index]);
+        }
+    }
+    std::sort(regions.begin(), regions.end(), [](const PackEntry *a, const PackEntry *b) {
+        return a->offset < b->offset;
+    });
+
+    // Mirrors writePayload: one read and one write per buffer, padding is written but not read. A region also
+    // accounts for the alignment gap before it, so the steps add up to the image layoutPayloads describes.
+    uint64_t end = table.writeBytes;
+    for (const auto *entry: regions) {
+        const uint64_t stored = (uint64_t{entry->length} + PACK_PAYLOAD_ALIGN - 1) & ~uint64_t{PACK_PAYLOAD_ALIGN - 1};
+
+        PlanStep step;
+        step.name = entry->filename;
+        step.readBytes = entry->length;
+        step.readOps = (entry->length + PACK_BUFFER_SIZE - 1) / PACK_BUFFER_SIZE;
+        step.writeBytes = entry->offset + stored - end;
+        step.writeOps = (stored + PACK_BUFFER_SIZE - 1) / PACK_BUFFER_SIZE;
+        step.encryptBytes = encrypt ? stored : 0;
+        step.bufferBytes = std::min<uint64_t>(PACK_BUFFER_SIZE, stored);
+        plan.steps.push_back(step);
+        end = entry->offset + stored;
+    }
+
+    return plan;
 }
@@ -8,12 +8,66 @@
 #include <cctype>
 #include <sstream>
 #include <algorithm>
-#include <iostream>
+#include <iomanip>
+#include <stdexcept>
+#include <cstdio>
+#include <cstring>
 
 #include "OpenixPartition.hpp"
+#include "OpenixFileIO.hpp"
+#include "OpenixCRC32.hpp"
+#include "OpenixSparseWriter.hpp"
 
 using namespace OpenixIMG;
 
+namespace {
+    constexpr uint32_t GPT_ENTRY_COUNT = 128; // Minimum entry array size required by the UEFI spec
+    constexpr uint32_t GPT_ENTRY_SIZE = 128;
+    constexpr uint32_t GPT_HEADER_SIZE = 92;
+    constexpr uint64_t GPT_ENTRY_SECTORS = GPT_ENTRY_COUNT * GPT_ENTRY_SIZE / PARTITION_SECTOR_SIZE;
+    constexpr uint64_t GPT_PRIMARY_SECTORS = 2 + GPT_ENTRY_SECTORS; // Protective MBR, header, entries
+    constexpr uint64_t GPT_BACKUP_SECTORS = 1 + GPT_ENTRY_SECTORS; // Entries, header
+    constexpr uint64_t GPT_ATTRIBUTE_READ_ONLY = 1ULL << 60;
+    constexpr size_t GPT_NAME_LENGTH = 36; // UTF-16 code units
+
+    // Microsoft basic data, the type Allwinner's own GPT conversion assigns to every partition
+    constexpr uint8_t GPT_BASIC_DATA_GUID[16] = {
+        0xA2, 0xA0, 0xD0, 0xEB, 0xE5, 0xB9, 0x33, 0x44, 0x87, 0xC0, 0x68, 0xB6, 0xB7, 0x26, 0x99, 0xC7
+    };
+
+    void putLE16(uint8_t *out, const uint16_t value) {
+        out[0] = static_cast<uint8_t>(value);
+        out[1] = static_cast<uint8_t>(value >> 8);
+    }
+
+    void putLE32(uint8_t *out, const uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            out[i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+    }
+
+    void putLE64(uint8_t *out, const uint64_t value) {
+        for (int i = 0; i < 8; ++i) {
+            out[i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+    }
+
+    uint64_t splitMix64(uint64_t &state) {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    // Random-looking (version 4) GUID drawn from a deterministic generator
+    void makeGuid(uint64_t &state, uint8_t *out) {
+        putLE64(out, splitMix64(state));
+        putLE64(out + 8, splitMix64(state));
+        out[7] = static_cast<uint8_t>((out[7] & 0x0F) | 0x40);
+        out[8] = static_cast<uint8_t>((out[8] & 0x3F) | 0x80);
+    }
+}
+
 OpenixPartition::OpenixPartition() : mbrSize(0) {
 }
 
@@ -195,7 +249,7 @@ std::string OpenixPartition::dumpToString() const {
 }
 
 void OpenixPartition::dump() const {
-    std::cout << dumpToString() << std::endl;
+    std::printf("%s\n", dumpToString().c_str());
 }
 
 std::string OpenixPartition::dumpToJson() const {
@@ -371,3 +425,183 @@ uint64_t OpenixPartition::parseNumber(const std::string &line, size_t &pos) {
 
     return result;
 }
+
+std::vector<PartitionExtent> OpenixPartition::computeLayout(const GptOptions &options) const {
+    const uint64_t start = options.logicalOffset + static_cast<uint64_t>(mbrSize) * 1024 / PARTITION_SECTOR_SIZE;
+    if (start < GPT_PRIMARY_SECTORS) {
+        throw std::runtime_error("Partition area starts inside the primary GPT");
+    }
+
+    std::vector<PartitionExtent> layout;
+    layout.reserve(partitions.size());
+    uint64_t next = start;
+
+    for (size_t i = 0; i < partitions.size(); ++i) {
+        const auto &partition = partitions[i];
+        uint64_t count = partition.size;
+
+        if (count == 0) {
+            if (i + 1 != partitions.size()) {
+                throw std::runtime_error("Only the last partition may have size 0: " + partition.name);
+            }
+            if (options.diskSectors == 0) {
+                throw std::runtime_error("Partition " + partition.name + " takes the rest of the disk; a disk size is required");
+            }
+            const auto lastUsable = options.diskSectors - GPT_BACKUP_SECTORS - 1;
+            if (options.diskSectors <= GPT_BACKUP_SECTORS || next > lastUsable) {
+                throw std::runtime_error("No space left on disk for partition " + partition.name);
+            }
+            count = lastUsable + 1 - next;
+        }
+
+        layout.push_back({partition.name, next, count});
+        next += count;
+    }
+
+    if (options.diskSectors != 0 && next + GPT_BACKUP_SECTORS > options.diskSectors) {
+        throw std::runtime_error("Partitions do not fit on a disk of " + std::to_string(options.diskSectors) +
+                                 " sectors");
+    }
+
+    return layout;
+}
+
+uint64_t OpenixPartition::buildGpt(const GptOptions &options, std::vector<uint8_t> &head,
+                                   std::vector<uint8_t> &tail) const {
+    if (partitions.size() > GPT_ENTRY_COUNT) {
+        throw std::runtime_error("Too many partitions for a GPT: " + std::to_string(partitions.size()));
+    }
+
+    const auto layout = computeLayout(options);
+    uint64_t diskSectors = options.diskSectors;
+    if (diskSectors == 0) {
+        const auto end = layout.empty()
+                             ? options.logicalOffset + static_cast<uint64_t>(mbrSize) * 1024 / PARTITION_SECTOR_SIZE
+                             : layout.back().firstSector + layout.back().sectorCount;
+        diskSectors = end + GPT_BACKUP_SECTORS;
+    }
+    const uint64_t lastLba = diskSectors - 1;
+
+    // GUIDs derive from the table itself, so the same input always produces the same disk
+    uint32_t seed = OpenixCRC32::compute(&mbrSize, sizeof(mbrSize));
+    for (const auto &extent: layout) {
+        seed = OpenixCRC32::compute(extent.name.data(), extent.name.size(), seed);
+        seed = OpenixCRC32::compute(&extent.sectorCount, sizeof(extent.sectorCount), seed);
+    }
+    uint64_t state = seed;
+    uint8_t diskGuid[16];
+    makeGuid(state, diskGuid);
+
+    // Partition entry array
+    std::vector<uint8_t> entries(GPT_ENTRY_COUNT * GPT_ENTRY_SIZE, 0);
+    for (size_t i = 0; i < layout.size(); ++i) {
+        uint8_t *entry = entries.data() + i * GPT_ENTRY_SIZE;
+        std::memcpy(entry, GPT_BASIC_DATA_GUID, sizeof(GPT_BASIC_DATA_GUID));
+        makeGuid(state, entry + 16);
+        putLE64(entry + 32, layout[i].firstSector);
+        putLE64(entry + 40, layout[i].firstSector + layout[i].sectorCount - 1);
+        putLE64(entry + 48, partitions[i].ro ? GPT_ATTRIBUTE_READ_ONLY : 0);
+
+        const auto &name = partitions[i].name;
+        for (size_t c = 0; c < name.size() && c < GPT_NAME_LENGTH; ++c) {
+            putLE16(entry + 56 + c * 2, static_cast<uint8_t>(name[c]));
+        }
+    }
+    const uint32_t entriesCrc = OpenixCRC32::compute(entries.data(), entries.size());
+
+    auto buildHeader = [&](const uint64_t myLba, const uint64_t alternateLba, const uint64_t entriesLba) {
+        std::vector<uint8_t> header(PARTITION_SECTOR_SIZE, 0);
+        std::memcpy(header.data(), "EFI PART", 8);
+        putLE32(header.data() + 8, 0x00010000);
+        putLE32(header.data() + 12, GPT_HEADER_SIZE);
+        putLE64(header.data() + 24, myLba);
+        putLE64(header.data() + 32, alternateLba);
+        putLE64(header.data() + 40, GPT_PRIMARY_SECTORS);
+        putLE64(header.data() + 48, lastLba - GPT_BACKUP_SECTORS);
+        std::memcpy(header.data() + 56, diskGuid, sizeof(diskGuid));
+        putLE64(header.data() + 72, entriesLba);
+        putLE32(header.data() + 80, GPT_ENTRY_COUNT);
+        putLE32(header.data() + 84, GPT_ENTRY_SIZE);
+        putLE32(header.data() + 88, entriesCrc);
+        putLE32(header.data() + 16, OpenixCRC32::compute(header.data(), GPT_HEADER_SIZE));
+        return header;
+    };
+
+    // Protective MBR with a single 0xEE partition covering the disk
+    std::vector<uint8_t> mbr(PARTITION_SECTOR_SIZE, 0);
+    uint8_t *record = mbr.data() + 446;
+    record[1] = 0x00;
+    record[2] = 0x02;
+    record[3] = 0x00;
+    record[4] = 0xEE;
+    record[5] = 0xFF;
+    record[6] = 0xFF;
+    record[7] = 0xFF;
+    putLE32(record + 8, 1);
+    putLE32(record + 12, static_cast<uint32_t>(std::min<uint64_t>(lastLba, 0xFFFFFFFF)));
+    mbr[510] = 0x55;
+    mbr[511] = 0xAA;
+
+    const auto primary = buildHeader(1, lastLba, 2);
+    const auto backup = buildHeader(lastLba, 1, lastLba - GPT_ENTRY_SECTORS);
+
+    head = mbr;
+    head.insert(head.end(), primary.begin(), primary.end());
+    head.insert(head.end(), entries.begin(), entries.end());
+    tail = entries;
+    tail.insert(tail.end(), backup.begin(), backup.end());
+
+    return diskSectors;
+}
+
+void OpenixPartition::writeGpt(const OpenixFileIO &image, const GptOptions &options) const {
+    std::vector<uint8_t> head;
+    std::vector<uint8_t> tail;
+    const auto diskSectors = buildGpt(options, head, tail);
+
+    image.resize(diskSectors * PARTITION_SECTOR_SIZE);
+    image.writeAt(0, head.data(), head.size());
+    image.writeAt((diskSectors - GPT_BACKUP_SECTORS) * PARTITION_SECTOR_SIZE, tail.data(), tail.size());
+}
+
+void OpenixPartition::writeGpt(const std::string &imagePath, const GptOptions &options) const {
+    const OpenixFileIO image(imagePath, OpenixFileIO::Mode::UPDATE);
+    writeGpt(image, options);
+}
+
+void OpenixPartition::writeSparseDisk(const std::string &imagePath, const GptOptions &options,
+                                      const PartitionContentSource &source, const bool zeroAsDontCare) const {
+    std::vector<uint8_t> head;
+    std::vector<uint8_t> tail;
+    const auto diskSectors = buildGpt(options, head, tail);
+    const auto layout = computeLayout(options);
+    const auto diskBytes = diskSectors * PARTITION_SECTOR_SIZE;
+
+    // Sparse images hold whole blocks: fall back to sector-sized blocks for odd disk sizes
+    const auto blockSize = diskBytes % OpenixSparseWriter::DEFAULT_BLOCK_SIZE == 0
+                               ? OpenixSparseWriter::DEFAULT_BLOCK_SIZE
+                               : static_cast<uint32_t>(PARTITION_SECTOR_SIZE);
+    OpenixSparseWriter writer(imagePath, blockSize, zeroAsDontCare);
+    writer.write(head.data(), head.size());
+
+    for (size_t i = 0; i < layout.size(); ++i) {
+        const auto start = layout[i].firstSector * PARTITION_SECTOR_SIZE;
+        const auto limit = layout[i].sectorCount * PARTITION_SECTOR_SIZE;
+        writer.skip(start - writer.size());
+
+        if (source) {
+            uint64_t written = 0;
+            source(partitions[i], [&](const uint8_t *data, const size_t length) {
+                if (written + length > limit) {
+                    throw std::runtime_error("Contents of partition " + partitions[i].name + " exceed its size");
+                }
+                writer.write(data, length);
+                written += length;
+            });
+        }
+    }
+
+    writer.skip(diskBytes - GPT_BACKUP_SECTORS * PARTITION_SECTOR_SIZE - writer.size());
+    writer.write(tail.data(), tail.size());
+    writer.finish();
+}
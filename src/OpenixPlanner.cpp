@@ -0,0 +1,182 @@
+/**
+ * @file OpenixPlanner.cpp
+ * @brief Implementation of OpenixPlanner class methods
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include "OpenixPlanner.hpp"
+#include "OpenixCFGJson.hpp"
+
+using namespace OpenixIMG;
+
+namespace {
+    constexpr double MEGABYTE = 1000.0 * 1000.0;
+
+    std::string formatBytes(const uint64_t bytes) {
+        static constexpr const char *UNITS[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+        auto value = static_cast<double>(bytes);
+        size_t unit = 0;
+        while (value >= 1024.0 && unit + 1 < std::size(UNITS)) {
+            value /= 1024.0;
+            ++unit;
+        }
+
+        std::ostringstream ss;
+        if (unit == 0) {
+            ss << bytes << " B";
+        } else {
+            ss << std::fixed << std::setprecision(2) << value << " " << UNITS[unit];
+        }
+        return ss.str();
+    }
+
+    std::string formatSeconds(const double seconds) {
+        std::ostringstream ss;
+        ss << std::fixed << std::setprecision(seconds < 10 ? 3 : 1) << seconds;
+        return ss.str();
+    }
+
+    void writeStepJson(std::ostringstream &ss, const PlanStep &step) {
+        ss << "{\"name\":\"" << OpenixCFGJson::escape(step.name) << "\""
+                << ",\"read_bytes\":" << step.readBytes
+                << ",\"write_bytes\":" << step.writeBytes
+                << ",\"decrypt_bytes\":" << step.decryptBytes
+                << ",\"encrypt_bytes\":" << step.encryptBytes
+                << ",\"read_ops\":" << step.readOps
+                << ",\"write_ops\":" << step.writeOps
+                << ",\"buffer_bytes\":" << step.bufferBytes << "}";
+    }
+}
+
+PlanStep OperationPlan::total() const {
+    PlanStep sum;
+    sum.name = "total";
+    for (const auto &step: steps) {
+        sum.readBytes += step.readBytes;
+        sum.writeBytes += step.writeBytes;
+        sum.decryptBytes += step.decryptBytes;
+        sum.encryptBytes += step.encryptBytes;
+        sum.readOps += step.readOps;
+        sum.writeOps += step.writeOps;
+        sum.bufferBytes = std::max(sum.bufferBytes, step.bufferBytes);
+    }
+    return sum;
+}
+
+const std::vector<HostClass> &OpenixPlanner::defaultHostClasses() {
+    static const std::vector<HostClass> hosts = {
+        {"desktop-ssd", 520 * MEGABYTE, 480 * MEGABYTE, 180 * MEGABYTE, 100e-6},
+        {"nvme-server", 3000 * MEGABYTE, 2000 * MEGABYTE, 250 * MEGABYTE, 20e-6},
+        {"hdd", 160 * MEGABYTE, 150 * MEGABYTE, 180 * MEGABYTE, 8e-3},
+        {"nfs-1g", 110 * MEGABYTE, 100 * MEGABYTE, 180 * MEGABYTE, 1e-3},
+    };
+    return hosts;
+}
+
+HostClass OpenixPlanner::parseHostClass(const std::string &spec) {
+    std::vector<std::string> fields;
+    std::stringstream ss(spec);
+    for (std::string field; std::getline(ss, field, ':');) {
+        fields.push_back(field);
+    }
+
+    if (fields.size() < 4 || fields.size() > 5 || fields[0].empty()) {
+        throw std::runtime_error("Invalid host class (expected name:read:write:crypt[:latency_us]): " + spec);
+    }
+
+    HostClass host;
+    host.name = fields[0];
+    try {
+        host.readBandwidth = std::stod(fields[1]) * MEGABYTE;
+        host.writeBandwidth = std::stod(fields[2]) * MEGABYTE;
+        host.cryptBandwidth = std::stod(fields[3]) * MEGABYTE;
+        host.opLatency = fields.size() == 5 ? std::stod(fields[4]) * 1e-6 : 0;
+    } catch (const std::logic_error &) {
+        throw std::runtime_error("Invalid number in host class: " + spec);
+    }
+
+    if (host.readBandwidth <= 0 || host.writeBandwidth <= 0 || host.cryptBandwidth <= 0 || host.opLatency < 0) {
+        throw std::runtime_error("Host class bandwidths must be positive: " + spec);
+    }
+    return host;
+}
+
+double OpenixPlanner::estimateSeconds(const OperationPlan &plan, const HostClass &host) {
+    const auto total = plan.total();
+    return static_cast<double>(total.readBytes) / host.readBandwidth +
+           static_cast<double>(total.writeBytes) / host.writeBandwidth +
+           static_cast<double>(total.decryptBytes + total.encryptBytes) / host.cryptBandwidth +
+           static_cast<double>(total.readOps + total.writeOps) * host.opLatency;
+}
+
+std::string OpenixPlanner::dumpToString(const OperationPlan &plan, const std::vector<HostClass> &hosts) {
+    std::ostringstream ss;
+    const auto total = plan.total();
+    const auto *cryptLabel = plan.operation == "pack" ? "Encrypt" : "Decrypt";
+
+    ss << "Plan for " << plan.operation << " of " << plan.source << " (" << plan.steps.size() << " steps, "
+            << (plan.encrypted ? "encrypted" : "not encrypted") << ")" << std::endl;
+    ss << std::left << std::setw(32) << "Step" << std::right << std::setw(14) << "Read" << std::setw(14) << "Write"
+            << std::setw(14) << cryptLabel << std::setw(8) << "Ops" << std::setw(14) << "Buffer" << std::endl;
+
+    const auto row = [&ss](const PlanStep &step) {
+        ss << std::left << std::setw(32) << step.name << std::right
+                << std::setw(14) << formatBytes(step.readBytes)
+                << std::setw(14) << formatBytes(step.writeBytes)
+                << std::setw(14) << formatBytes(step.decryptBytes + step.encryptBytes)
+                << std::setw(8) << step.readOps + step.writeOps
+                << std::setw(14) << formatBytes(step.bufferBytes) << std::endl;
+    };
+    for (const auto &step: plan.steps) {
+        row(step);
+    }
+    row(total);
+
+    ss << std::endl;
+    ss << "Bytes read:      " << total.readBytes << " (" << formatBytes(total.readBytes) << ")" << std::endl;
+    ss << "Bytes written:   " << total.writeBytes << " (" << formatBytes(total.writeBytes) << ")" << std::endl;
+    ss << "Bytes decrypted: " << total.decryptBytes << " (" << formatBytes(total.decryptBytes) << ")" << std::endl;
+    ss << "Bytes encrypted: " << total.encryptBytes << " (" << formatBytes(total.encryptBytes) << ")" << std::endl;
+    ss << "I/O operations:  " << total.readOps << " reads, " << total.writeOps << " writes" << std::endl;
+    ss << "Largest buffer:  " << total.bufferBytes << " (" << formatBytes(total.bufferBytes) << ")" << std::endl;
+
+    if (!hosts.empty()) {
+        ss << std::endl << "Estimated time:" << std::endl;
+        for (const auto &host: hosts) {
+            ss << "  " << std::left << std::setw(16) << host.name << formatSeconds(estimateSeconds(plan, host)) << " s"
+                    << std::endl;
+        }
+    }
+
+    return ss.str();
+}
+
+std::string OpenixPlanner::dumpToJson(const OperationPlan &plan, const std::vector<HostClass> &hosts) {
+    std::ostringstream ss;
+    ss << "{\"operation\":\"" << OpenixCFGJson::escape(plan.operation) << "\""
+            << ",\"source\":\"" << OpenixCFGJson::escape(plan.source) << "\""
+            << ",\"encrypted\":" << (plan.encrypted ? "true" : "false");
+
+    ss << ",\"total\":";
+    writeStepJson(ss, plan.total());
+
+    ss << ",\"estimates\":[";
+    for (size_t i = 0; i < hosts.size(); ++i) {
+        ss << (i ? "," : "") << "{\"host\":\"" << OpenixCFGJson::escape(hosts[i].name) << "\",\"seconds\":"
+                << std::setprecision(6) << estimateSeconds(plan, hosts[i]) << "}";
+    }
+
+    ss << "],\"steps\":[";
+    for (size_t i = 0; i < plan.steps.size(); ++i) {
+        ss << (i ? ",\n" : "\n");
+        writeStepJson(ss, plan.steps[i]);
+    }
+    ss << "]}" << std::endl;
+
+    return ss.str();
+}
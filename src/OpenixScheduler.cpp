@@ -0,0 +1,193 @@
+/**
+ * @file OpenixScheduler.cpp
+ * @brief Implementation of OpenixScheduler class methods
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include "OpenixScheduler.hpp"
+#include "OpenixMetrics.hpp"
+
+using namespace OpenixIMG;
+
+namespace {
+    // One per hardware thread for bulk work, plus the slot kept free for interactive tasks
+    unsigned defaultSlots() {
+        return std::max(1U, std::thread::hardware_concurrency()) + 1;
+    }
+
+    struct SchedulerState {
+        std::mutex mutex; //!< Guards the counters below
+        std::condition_variable interactiveReady; //!< Wakes one waiting interactive task
+        std::condition_variable bulkReady; //!< Wakes one waiting bulk task
+        unsigned slots = defaultSlots(); //!< Tasks allowed at once
+        unsigned running = 0; //!< Tasks holding a slot
+        unsigned waitingInteractive = 0; //!< Interactive tasks waiting for a slot
+
+        [[nodiscard]] bool bulkAdmissible() const {
+            const unsigned bulkSlots = slots > 1 ? slots - 1 : 1;
+            return waitingInteractive == 0 && running < bulkSlots;
+        }
+
+        // Hands a freed slot to an interactive task first; only one waiter is woken per slot
+        void wakeNext() {
+            if (waitingInteractive > 0) {
+                interactiveReady.notify_one();
+            } else if (bulkAdmissible()) {
+                bulkReady.notify_one();
+            }
+        }
+    };
+
+    struct ClassTotals {
+        std::atomic<uint64_t> tasks{0};
+        std::atomic<uint64_t> bytes{0};
+        std::atomic<uint64_t> waitNanoseconds{0};
+        std::atomic<uint64_t> runNanoseconds{0};
+        std::atomic<uint64_t> maxWaitNanoseconds{0};
+    };
+
+    SchedulerState &state() {
+        static SchedulerState instance;
+        return instance;
+    }
+
+    std::array<ClassTotals, 2> &totals() {
+        static std::array<ClassTotals, 2> instance;
+        return instance;
+    }
+
+    thread_local std::optional<Priority> threadPriority;
+
+    uint64_t nanoseconds(const std::chrono::steady_clock::duration duration) {
+        const auto count = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+        return count > 0 ? static_cast<uint64_t>(count) : 0;
+    }
+
+    const char *className(const Priority priority) {
+        return priority == Priority::INTERACTIVE ? "interactive" : "bulk";
+    }
+}
+
+OpenixScheduler::Task::Task(const Priority priority)
+    : priority_(priority), queued_(std::chrono::steady_clock::now()) {
+    auto &scheduler = state();
+    std::unique_lock<std::mutex> lock(scheduler.mutex);
+    if (priority_ == Priority::INTERACTIVE) {
+        ++scheduler.waitingInteractive;
+        scheduler.interactiveReady.wait(lock, [&scheduler]() {
+            return scheduler.running < scheduler.slots;
+        });
+        --scheduler.waitingInteractive;
+    } else {
+        // Bulk work yields to waiting interactive tasks and keeps one slot in reserve for them
+        scheduler.bulkReady.wait(lock, [&scheduler]() {
+            return scheduler.bulkAdmissible();
+        });
+    }
+    ++scheduler.running;
+    scheduler.wakeNext();
+    admitted_ = std::chrono::steady_clock::now();
+}
+
+OpenixScheduler::Task::~Task() {
+    const auto finished = std::chrono::steady_clock::now();
+    {
+        auto &scheduler = state();
+        std::lock_guard<std::mutex> lock(scheduler.mutex);
+        --scheduler.running;
+        scheduler.wakeNext();
+    }
+
+    const auto wait = nanoseconds(admitted_ - queued_);
+    auto &classTotals = totals()[static_cast<size_t>(priority_)];
+    ++classTotals.tasks;
+    classTotals.bytes += bytes_;
+    classTotals.waitNanoseconds += wait;
+    classTotals.runNanoseconds += nanoseconds(finished - admitted_);
+    for (auto peak = classTotals.maxWaitNanoseconds.load();
+         wait > peak && !classTotals.maxWaitNanoseconds.compare_exchange_weak(peak, wait);) {
+    }
+
+    const bool interactive = priority_ == Priority::INTERACTIVE;
+    OpenixMetrics::recordDuration(interactive ? Metric::INTERACTIVE_WAIT : Metric::BULK_WAIT, admitted_ - queued_);
+    OpenixMetrics::recordDuration(interactive ? Metric::INTERACTIVE_LATENCY : Metric::BULK_LATENCY, finished - queued_);
+    if (bytes_ > 0) {
+        OpenixMetrics::recordThroughput(interactive ? Metric::INTERACTIVE_THROUGHPUT : Metric::BULK_THROUGHPUT, bytes_,
+                                        finished - admitted_);
+    }
+}
+
+void OpenixScheduler::Task::addBytes(const uint64_t bytes) {
+    bytes_ += bytes;
+}
+
+OpenixScheduler::PriorityScope::PriorityScope(const Priority priority) : previous_(threadPriority) {
+    threadPriority = priority;
+}
+
+OpenixScheduler::PriorityScope::~PriorityScope() {
+    threadPriority = previous_;
+}
+
+Priority OpenixScheduler::currentPriority(const Priority fallback) {
+    return threadPriority.value_or(fallback);
+}
+
+void OpenixScheduler::setSlots(const unsigned slots) {
+    auto &scheduler = state();
+    std::lock_guard<std::mutex> lock(scheduler.mutex);
+    scheduler.slots = slots > 0 ? slots : defaultSlots();
+    scheduler.interactiveReady.notify_all();
+    scheduler.bulkReady.notify_all();
+}
+
+unsigned OpenixScheduler::slots() {
+    auto &scheduler = state();
+    std::lock_guard<std::mutex> lock(scheduler.mutex);
+    return scheduler.slots;
+}
+
+SchedulerStats OpenixScheduler::stats(const Priority priority) {
+    const auto &classTotals = totals()[static_cast<size_t>(priority)];
+    SchedulerStats result;
+    result.tasks = classTotals.tasks.load();
+    result.bytes = classTotals.bytes.load();
+    result.waitNanoseconds = classTotals.waitNanoseconds.load();
+    result.runNanoseconds = classTotals.runNanoseconds.load();
+    result.maxWaitNanoseconds = classTotals.maxWaitNanoseconds.load();
+    return result;
+}
+
+void OpenixScheduler::resetStats() {
+    for (auto &classTotals: totals()) {
+        classTotals.tasks = 0;
+        classTotals.bytes = 0;
+        classTotals.waitNanoseconds = 0;
+        classTotals.runNanoseconds = 0;
+        classTotals.maxWaitNanoseconds = 0;
+    }
+}
+
+std::string OpenixScheduler::dumpToString() {
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(3);
+    for (const auto priority: {Priority::INTERACTIVE, Priority::BULK}) {
+        const auto result = stats(priority);
+        const double runSeconds = static_cast<double>(result.runNanoseconds) / 1e9;
+        const double meanWait = result.tasks ? static_cast<double>(result.waitNanoseconds) / 1e6 / result.tasks : 0;
+        ss << std::left << std::setw(12) << className(priority) << result.tasks << " tasks, " << result.bytes
+                << " bytes, " << (runSeconds > 0 ? static_cast<double>(result.bytes) / runSeconds / 1e6 : 0)
+                << " MB/s, wait mean " << meanWait << " ms, max "
+                << static_cast<double>(result.maxWaitNanoseconds) / 1e6 << " ms\n";
+    }
+    return ss.str();
+}
@@ -0,0 +1,329 @@
+/**
+ * @file OpenixSharedCache.cpp
+ * @brief Implementation of OpenixSharedCache class methods
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "OpenixSharedCache.hpp"
+
+using namespace OpenixIMG;
+
+namespace {
+    // "OXSC" followed by the layout version; bump the version whenever Segment changes
+    constexpr uint32_t SHARED_CACHE_MAGIC = 0x4353584F;
+    constexpr uint32_t SHARED_CACHE_VERSION = 1;
+
+    // Number of entries the segment can describe, independent of its size
+    constexpr uint32_t SHARED_CACHE_SLOTS = 1024;
+
+    // Entry data is placed on cache-line boundaries
+    constexpr uint64_t SHARED_CACHE_ALIGN = 64;
+
+    // How long to wait for another process to finish initializing a new segment
+    constexpr auto SHARED_CACHE_INIT_TIMEOUT = std::chrono::seconds(2);
+
+    struct Slot {
+        uint64_t fingerprint; // Image fingerprint, valid when used is set
+        uint64_t offset; // Offset of the data in the data area
+        uint64_t length; // Length of the data
+        uint64_t lastUse; // Segment clock value of the last lookup or insertion
+        uint32_t index; // Entry index
+        uint32_t used; // Non-zero once the data is complete
+    };
+
+    uint64_t alignUp(const uint64_t value) {
+        return (value + SHARED_CACHE_ALIGN - 1) & ~(SHARED_CACHE_ALIGN - 1);
+    }
+}
+
+struct OpenixSharedCache::Segment {
+    uint32_t magic; // SHARED_CACHE_MAGIC once initialized
+    uint32_t version; // SHARED_CACHE_VERSION
+    uint64_t dataOffset; // Offset of the data area from the segment start
+    uint64_t dataSize; // Size of the data area
+#ifndef _WIN32
+    pthread_mutex_t mutex; // Guards everything below
+#endif
+    uint64_t clock; // Incremented on every access, orders slots for LRU eviction
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t insertions;
+    uint64_t evictions;
+    Slot slots[SHARED_CACHE_SLOTS];
+
+    [[nodiscard]] uint8_t *data() {
+        return reinterpret_cast<uint8_t *>(this) + dataOffset;
+    }
+
+    Slot *find(const uint64_t fingerprint, const uint32_t index) {
+        for (auto &slot: slots) {
+            if (slot.used && slot.fingerprint == fingerprint && slot.index == index) {
+                return &slot;
+            }
+        }
+        return nullptr;
+    }
+};
+
+#ifndef _WIN32
+
+class OpenixSharedCache::Lock {
+public:
+    explicit Lock(Segment *segment) : segment_(segment) {
+        const auto result = pthread_mutex_lock(&segment_->mutex);
+#ifdef __linux__
+        if (result == EOWNERDEAD) {
+            // Slots are only published once complete, so the protected state is consistent
+            pthread_mutex_consistent(&segment_->mutex);
+            return;
+        }
+#endif
+        if (result != 0) {
+            throw std::runtime_error(std::string("Failed to lock shared cache: ") + std::strerror(result));
+        }
+    }
+
+    ~Lock() {
+        pthread_mutex_unlock(&segment_->mutex);
+    }
+
+    Lock(const Lock &) = delete;
+
+    Lock &operator=(const Lock &) = delete;
+
+private:
+    Segment *segment_;
+};
+
+OpenixSharedCache::OpenixSharedCache(const std::string &name, const uint64_t capacity) : segment_(nullptr),
+    mappedSize_(0) {
+    const auto dataOffset = alignUp(sizeof(Segment));
+    if (capacity == 0) {
+        throw std::runtime_error("Shared cache capacity must not be zero");
+    }
+
+    bool created = true;
+    int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0 && errno == EEXIST) {
+        created = false;
+        fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+    }
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open shared cache " + name + ": " + std::strerror(errno));
+    }
+
+    if (created) {
+        mappedSize_ = static_cast<size_t>(dataOffset + alignUp(capacity));
+        if (::ftruncate(fd, static_cast<off_t>(mappedSize_)) != 0) {
+            const auto error = errno;
+            ::close(fd);
+            ::shm_unlink(name.c_str());
+            throw std::runtime_error("Failed to size shared cache " + name + ": " + std::strerror(error));
+        }
+    } else {
+        // The creator sizes the segment right after creating it
+        const auto deadline = std::chrono::steady_clock::now() + SHARED_CACHE_INIT_TIMEOUT;
+        struct stat st{};
+        while (::fstat(fd, &st) == 0 && static_cast<uint64_t>(st.st_size) <= dataOffset &&
+               std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (static_cast<uint64_t>(st.st_size) <= dataOffset) {
+            ::close(fd);
+            throw std::runtime_error("Shared cache " + name + " was never initialized");
+        }
+        mappedSize_ = static_cast<size_t>(st.st_size);
+    }
+
+    void *mapping = ::mmap(nullptr, mappedSize_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("Failed to map shared cache " + name + ": " + std::strerror(errno));
+    }
+    segment_ = static_cast<Segment *>(mapping);
+
+    if (created) {
+        // The fresh segment is zero-filled: only the header and the mutex need setting up
+        segment_->version = SHARED_CACHE_VERSION;
+        segment_->dataOffset = dataOffset;
+        segment_->dataSize = mappedSize_ - dataOffset;
+
+        pthread_mutexattr_t attributes;
+        pthread_mutexattr_init(&attributes);
+        pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+#ifdef __linux__
+        pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+#endif
+        pthread_mutex_init(&segment_->mutex, &attributes);
+        pthread_mutexattr_destroy(&attributes);
+
+        // Publishing the magic last tells other processes the segment is ready
+        __atomic_store_n(&segment_->magic, SHARED_CACHE_MAGIC, __ATOMIC_RELEASE);
+        return;
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + SHARED_CACHE_INIT_TIMEOUT;
+    while (__atomic_load_n(&segment_->magic, __ATOMIC_ACQUIRE) != SHARED_CACHE_MAGIC &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (__atomic_load_n(&segment_->magic, __ATOMIC_ACQUIRE) != SHARED_CACHE_MAGIC ||
+        segment_->version != SHARED_CACHE_VERSION || segment_->dataOffset != dataOffset ||
+        segment_->dataOffset + segment_->dataSize > mappedSize_) {
+        ::munmap(segment_, mappedSize_);
+        throw std::runtime_error("Shared cache " + name + " has an incompatible layout");
+    }
+}
+
+OpenixSharedCache::~OpenixSharedCache() {
+    if (segment_) {
+        ::munmap(segment_, mappedSize_);
+    }
+}
+
+bool OpenixSharedCache::lookup(const uint64_t fingerprint, const uint32_t index, std::vector<uint8_t> &data) const {
+    Lock lock(segment_);
+    auto *slot = segment_->find(fingerprint, index);
+    if (!slot) {
+        ++segment_->misses;
+        return false;
+    }
+
+    ++segment_->hits;
+    slot->lastUse = ++segment_->clock;
+    data.resize(static_cast<size_t>(slot->length));
+    std::memcpy(data.data(), segment_->data() + slot->offset, data.size());
+    return true;
+}
+
+bool OpenixSharedCache::insert(const uint64_t fingerprint, const uint32_t index, const void *data,
+                               const size_t length) {
+    const auto needed = alignUp(std::max<uint64_t>(length, 1));
+    if (needed > segment_->dataSize) {
+        return false;
+    }
+
+    Lock lock(segment_);
+    if (auto *slot = segment_->find(fingerprint, index)) {
+        slot->lastUse = ++segment_->clock;
+        return true;
+    }
+
+    while (true) {
+        // Live extents in data-area order, to find the first gap that fits
+        std::vector<Slot *> live;
+        Slot *freeSlot = nullptr;
+        for (auto &slot: segment_->slots) {
+            if (slot.used) {
+                live.push_back(&slot);
+            } else if (!freeSlot) {
+                freeSlot = &slot;
+            }
+        }
+        std::sort(live.begin(), live.end(), [](const Slot *a, const Slot *b) { return a->offset < b->offset; });
+
+        std::optional<uint64_t> offset;
+        uint64_t cursor = 0;
+        for (const auto *slot: live) {
+            if (slot->offset - cursor >= needed) {
+                break;
+            }
+            cursor = alignUp(slot->offset + slot->length);
+        }
+        if (cursor + needed <= segment_->dataSize) {
+            offset = cursor;
+        }
+
+        if (freeSlot && offset) {
+            std::memcpy(segment_->data() + *offset, data, length);
+            freeSlot->fingerprint = fingerprint;
+            freeSlot->index = index;
+            freeSlot->offset = *offset;
+            freeSlot->length = length;
+            freeSlot->lastUse = ++segment_->clock;
+            freeSlot->used = 1;
+            ++segment_->insertions;
+            return true;
+        }
+
+        // No room: drop the least recently used entry and try again
+        const auto victim = std::min_element(live.begin(), live.end(), [](const Slot *a, const Slot *b) {
+            return a->lastUse < b->lastUse;
+        });
+        (*victim)->used = 0;
+        ++segment_->evictions;
+    }
+}
+
+uint64_t OpenixSharedCache::capacity() const {
+    return segment_->dataSize;
+}
+
+SharedCacheStats OpenixSharedCache::stats() const {
+    Lock lock(segment_);
+    SharedCacheStats stats;
+    stats.hits = segment_->hits;
+    stats.misses = segment_->misses;
+    stats.insertions = segment_->insertions;
+    stats.evictions = segment_->evictions;
+    for (const auto &slot: segment_->slots) {
+        if (slot.used) {
+            ++stats.entries;
+            stats.usedBytes += slot.length;
+        }
+    }
+    return stats;
+}
+
+bool OpenixSharedCache::unlink(const std::string &name) {
+    return ::shm_unlink(name.c_str()) == 0;
+}
+
+#else
+
+class OpenixSharedCache::Lock {
+};
+
+OpenixSharedCache::OpenixSharedCache(const std::string &name, uint64_t) : segment_(nullptr), mappedSize_(0) {
+    throw std::runtime_error("Shared cache " + name + " is not supported on this platform");
+}
+
+OpenixSharedCache::~OpenixSharedCache() = default;
+
+bool OpenixSharedCache::lookup(uint64_t, uint32_t, std::vector<uint8_t> &) const {
+    return false;
+}
+
+bool OpenixSharedCache::insert(uint64_t, uint32_t, const void *, size_t) {
+    return false;
+}
+
+uint64_t OpenixSharedCache::capacity() const {
+    return 0;
+}
+
+SharedCacheStats OpenixSharedCache::stats() const {
+    return {};
+}
+
+bool OpenixSharedCache::unlink(const std::string &) {
+    return false;
+}
+
+#endif
@@ -0,0 +1,245 @@
+/**
+ * @file OpenixSparseWriter.cpp
+ * @brief Implementation of OpenixSparseWriter class methods
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "OpenixSparseWriter.hpp"
+
+using namespace OpenixIMG;
+
+namespace {
+    constexpr uint32_t SPARSE_MAGIC = 0xED26FF3A;
+    constexpr uint16_t SPARSE_FILE_HEADER_SIZE = 28;
+    constexpr uint16_t SPARSE_CHUNK_HEADER_SIZE = 12;
+
+    void putLE16(uint8_t *out, const uint16_t value) {
+        out[0] = static_cast<uint8_t>(value);
+        out[1] = static_cast<uint8_t>(value >> 8);
+    }
+
+    void putLE32(uint8_t *out, const uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            out[i] = static_cast<uint8_t>(value >> (i * 8));
+        }
+    }
+
+    // Check whether a block repeats its first 32-bit word. The inner loop folds 64 bytes into
+    // one word without branches, which compilers turn into SIMD compares; the outer loop
+    // exits at the first differing 64 bytes, so typical RAW blocks are rejected early.
+    bool uniformBlock(const uint8_t *block, const size_t size, uint32_t &value) {
+        std::memcpy(&value, block, sizeof(value));
+        const uint64_t pattern = value | static_cast<uint64_t>(value) << 32;
+
+        size_t pos = 0;
+        for (; pos + 64 <= size; pos += 64) {
+            uint64_t words[8];
+            std::memcpy(words, block + pos, sizeof(words));
+            uint64_t diff = 0;
+            for (const auto word: words) {
+                diff |= word ^ pattern;
+            }
+            if (diff != 0) {
+                return false;
+            }
+        }
+        for (; pos < size; pos += 4) {
+            uint32_t word;
+            std::memcpy(&word, block + pos, sizeof(word));
+            if (word != value) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+OpenixSparseWriter::OpenixSparseWriter(const std::string &path, const uint32_t blockSize, const bool zeroAsDontCare)
+    : file_(path, OpenixFileIO::Mode::WRITE), blockSize_(blockSize), zeroAsDontCare_(zeroAsDontCare),
+      writeOffset_(SPARSE_FILE_HEADER_SIZE) {
+    if (blockSize_ == 0 || blockSize_ % 4 != 0) {
+        throw std::runtime_error("Sparse block size must be a non-zero multiple of 4: " + std::to_string(blockSize));
+    }
+    pending_.reserve(blockSize_);
+}
+
+void OpenixSparseWriter::write(const void *data, size_t length) {
+    auto *current = static_cast<const uint8_t *>(data);
+
+    if (!pending_.empty()) {
+        const auto take = std::min<size_t>(length, blockSize_ - pending_.size());
+        pending_.insert(pending_.end(), current, current + take);
+        current += take;
+        length -= take;
+        if (pending_.size() < blockSize_) {
+            return;
+        }
+        addBlocks(pending_.data(), 1);
+        pending_.clear();
+    }
+
+    const auto blocks = length / blockSize_;
+    if (blocks > 0) {
+        addBlocks(current, blocks);
+        current += blocks * blockSize_;
+        length -= blocks * blockSize_;
+    }
+
+    pending_.assign(current, current + length);
+}
+
+void OpenixSparseWriter::skip(uint64_t length) {
+    if (!pending_.empty()) {
+        const auto take = static_cast<size_t>(std::min<uint64_t>(length, blockSize_ - pending_.size()));
+        pending_.resize(pending_.size() + take, 0);
+        length -= take;
+        if (pending_.size() < blockSize_) {
+            return;
+        }
+        addBlocks(pending_.data(), 1);
+        pending_.clear();
+    }
+
+    if (const auto blocks = length / blockSize_; blocks > 0) {
+        appendRun(ChunkType::DONT_CARE, 0, nullptr, blocks);
+    }
+    pending_.assign(static_cast<size_t>(length % blockSize_), 0);
+}
+
+void OpenixSparseWriter::finish() {
+    if (finished_) {
+        return;
+    }
+
+    if (!pending_.empty()) {
+        pending_.resize(blockSize_, 0);
+        addBlocks(pending_.data(), 1);
+        pending_.clear();
+    }
+    closeChunk();
+
+    if (totalBlocks_ > UINT32_MAX) {
+        throw std::runtime_error("Sparse image too large: " + std::to_string(totalBlocks_) + " blocks");
+    }
+
+    uint8_t header[SPARSE_FILE_HEADER_SIZE] = {};
+    putLE32(header, SPARSE_MAGIC);
+    putLE16(header + 4, 1); // Major version
+    putLE16(header + 6, 0); // Minor version
+    putLE16(header + 8, SPARSE_FILE_HEADER_SIZE);
+    putLE16(header + 10, SPARSE_CHUNK_HEADER_SIZE);
+    putLE32(header + 12, blockSize_);
+    putLE32(header + 16, static_cast<uint32_t>(totalBlocks_));
+    putLE32(header + 20, totalChunks_);
+    putLE32(header + 24, 0); // No image checksum
+    file_.writeAt(0, header, sizeof(header));
+
+    finished_ = true;
+}
+
+uint64_t OpenixSparseWriter::size() const {
+    return totalBlocks_ * blockSize_ + pending_.size();
+}
+
+uint32_t OpenixSparseWriter::chunkCount() const {
+    return totalChunks_ + (chunkOpen_ ? 1 : 0);
+}
+
+void OpenixSparseWriter::addBlocks(const uint8_t *data, const uint64_t blocks) {
+    // Group consecutive blocks of the same kind into one run
+    const uint8_t *runStart = data;
+    uint64_t runBlocks = 0;
+    ChunkType runType = ChunkType::RAW;
+    uint32_t runFill = 0;
+
+    for (uint64_t i = 0; i < blocks; ++i) {
+        const uint8_t *block = data + i * blockSize_;
+        uint32_t fill = 0;
+        auto type = ChunkType::RAW;
+        if (uniformBlock(block, blockSize_, fill)) {
+            type = fill == 0 && zeroAsDontCare_ ? ChunkType::DONT_CARE : ChunkType::FILL;
+        }
+
+        if (runBlocks > 0 && (type != runType || (type == ChunkType::FILL && fill != runFill))) {
+            appendRun(runType, runFill, runStart, runBlocks);
+            runBlocks = 0;
+        }
+        if (runBlocks == 0) {
+            runStart = block;
+            runType = type;
+            runFill = fill;
+        }
+        ++runBlocks;
+    }
+
+    if (runBlocks > 0) {
+        appendRun(runType, runFill, runStart, runBlocks);
+    }
+}
+
+void OpenixSparseWriter::appendRun(const ChunkType type, const uint32_t fillValue, const uint8_t *data,
+                                   uint64_t blocks) {
+    // RAW chunks record their byte size in 32 bits, the others only their block count
+    const uint64_t maxBlocks = type == ChunkType::RAW
+                                   ? (UINT32_MAX - SPARSE_CHUNK_HEADER_SIZE) / blockSize_
+                                   : UINT32_MAX;
+
+    while (blocks > 0) {
+        if (!chunkOpen_ || chunkType_ != type || (type == ChunkType::FILL && chunkFill_ != fillValue) ||
+            chunkBlocks_ == maxBlocks) {
+            closeChunk();
+
+            chunkOpen_ = true;
+            chunkType_ = type;
+            chunkFill_ = fillValue;
+            chunkBlocks_ = 0;
+            chunkOffset_ = writeOffset_;
+            writeOffset_ += SPARSE_CHUNK_HEADER_SIZE;
+
+            if (type == ChunkType::FILL) {
+                uint8_t fill[4];
+                putLE32(fill, fillValue);
+                file_.writeAt(writeOffset_, fill, sizeof(fill));
+                writeOffset_ += sizeof(fill);
+            }
+        }
+
+        const auto count = std::min(blocks, maxBlocks - chunkBlocks_);
+        if (type == ChunkType::RAW) {
+            const auto bytes = static_cast<size_t>(count * blockSize_);
+            file_.writeAt(writeOffset_, data, bytes);
+            writeOffset_ += bytes;
+            data += bytes;
+        }
+
+        chunkBlocks_ += count;
+        totalBlocks_ += count;
+        blocks -= count;
+    }
+}
+
+void OpenixSparseWriter::closeChunk() {
+    if (!chunkOpen_) {
+        return;
+    }
+
+    uint32_t totalSize = SPARSE_CHUNK_HEADER_SIZE;
+    if (chunkType_ == ChunkType::RAW) {
+        totalSize += static_cast<uint32_t>(chunkBlocks_ * blockSize_);
+    } else if (chunkType_ == ChunkType::FILL) {
+        totalSize += 4;
+    }
+
+    uint8_t header[SPARSE_CHUNK_HEADER_SIZE] = {};
+    putLE16(header, static_cast<uint16_t>(chunkType_));
+    putLE32(header + 4, static_cast<uint32_t>(chunkBlocks_));
+    putLE32(header + 8, totalSize);
+    file_.writeAt(chunkOffset_, header, sizeof(header));
+
+    ++totalChunks_;
+    chunkOpen_ = false;
+}
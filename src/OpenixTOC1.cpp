@@ -0,0 +1,175 @@
+/**
+ * @file OpenixTOC1.cpp
+ * @brief Implementation of OpenixTOC1 class methods
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#include "OpenixTOC1.hpp"
+
+using namespace OpenixIMG;
+
+namespace {
+    constexpr uint32_t TOC1_MAGIC = 0x89119800;
+    constexpr uint32_t TOC1_HEAD_END = 0x3B45494D; // "MIE;"
+    constexpr uint32_t TOC1_ITEM_END = 0x3B454949; // "IIE;"
+    constexpr uint32_t TOC1_STAMP = 0x5F0A6C39;
+
+    constexpr size_t TOC1_HEAD_SIZE = 64;
+    constexpr size_t TOC1_ITEM_SIZE = 368;
+    constexpr size_t TOC1_ITEM_NAME_SIZE = 64;
+
+    // Far more than any real package; bounds the item table read for corrupt headers
+    constexpr uint32_t TOC1_MAX_ITEMS = 256;
+
+    // Checksum offset within the u-boot and eGON boot headers
+    constexpr uint32_t BOOT_HEAD_CHECKSUM = 12;
+
+    constexpr size_t TOC1_READ_CHUNK = IO_BUFFER_SIZE;
+
+    uint32_t getLE32(const uint8_t *in) {
+        return static_cast<uint32_t>(in[0]) | static_cast<uint32_t>(in[1]) << 8 |
+               static_cast<uint32_t>(in[2]) << 16 | static_cast<uint32_t>(in[3]) << 24;
+    }
+}
+
+OpenixTOC1::OpenixTOC1(RangeReader reader) : reader_(std::move(reader)) {
+    uint8_t head[TOC1_HEAD_SIZE];
+    readExact(0, head, sizeof(head));
+    if (getLE32(head + 16) != TOC1_MAGIC || getLE32(head + 60) != TOC1_HEAD_END) {
+        throw std::runtime_error("Not a TOC1 package: bad header magic");
+    }
+
+    storedChecksum_ = getLE32(head + 20);
+    const auto itemCount = getLE32(head + 32);
+    validLength_ = getLE32(head + 36);
+    if (itemCount > TOC1_MAX_ITEMS || TOC1_HEAD_SIZE + itemCount * TOC1_ITEM_SIZE > validLength_) {
+        throw std::runtime_error("Corrupt TOC1 package: " + std::to_string(itemCount) + " items in " +
+                                 std::to_string(validLength_) + " bytes");
+    }
+
+    std::vector<uint8_t> table(itemCount * TOC1_ITEM_SIZE);
+    readExact(TOC1_HEAD_SIZE, table.data(), table.size());
+
+    for (uint32_t i = 0; i < itemCount; ++i) {
+        const uint8_t *raw = table.data() + i * TOC1_ITEM_SIZE;
+        if (getLE32(raw + TOC1_ITEM_SIZE - 4) != TOC1_ITEM_END) {
+            throw std::runtime_error("Corrupt TOC1 item " + std::to_string(i) + ": bad end marker");
+        }
+
+        Toc1Item item;
+        const auto *name = reinterpret_cast<const char *>(raw);
+        item.name.assign(name, strnlen(name, TOC1_ITEM_NAME_SIZE));
+        item.offset = getLE32(raw + 64);
+        item.length = getLE32(raw + 68);
+        item.encrypt = getLE32(raw + 72);
+        item.type = getLE32(raw + 76);
+        item.runAddress = getLE32(raw + 80);
+        item.index = getLE32(raw + 84);
+        if (static_cast<uint64_t>(item.offset) + item.length > validLength_) {
+            throw std::runtime_error("Corrupt TOC1 item " + item.name + ": data outside the package");
+        }
+        items_.push_back(std::move(item));
+    }
+}
+
+OpenixTOC1::OpenixTOC1(const OpenixIMGFile &image, const size_t index)
+    : OpenixTOC1([&image, index, file = std::make_shared<OpenixFileIO>(image.getImageFilePath())](
+                     const uint64_t offset, void *data, const size_t length) {
+        return image.readEntryRange(*file, index, offset, data, length);
+    }) {
+}
+
+const std::vector<Toc1Item> &OpenixTOC1::items() const {
+    return items_;
+}
+
+std::optional<Toc1Item> OpenixTOC1::find(const std::string &name) const {
+    const auto match = std::find_if(items_.begin(), items_.end(), [&name](const Toc1Item &item) {
+        return item.name == name;
+    });
+    if (match == items_.end()) {
+        return std::nullopt;
+    }
+    return *match;
+}
+
+uint32_t OpenixTOC1::validLength() const {
+    return validLength_;
+}
+
+uint64_t OpenixTOC1::extract(const Toc1Item &item, const OpenixIMGFile::ChunkSink &sink) const {
+    std::vector<uint8_t> buffer(std::min<size_t>(TOC1_READ_CHUNK, std::max<uint32_t>(item.length, 1)));
+    uint64_t delivered = 0;
+    while (delivered < item.length) {
+        const auto piece = static_cast<size_t>(std::min<uint64_t>(item.length - delivered, buffer.size()));
+        readExact(item.offset + delivered, buffer.data(), piece);
+        sink(buffer.data(), piece);
+        delivered += piece;
+    }
+    return delivered;
+}
+
+Toc1Checksum OpenixTOC1::verifyPackage() const {
+    Toc1Checksum result;
+    result.present = true;
+    result.stored = storedChecksum_;
+    result.computed = checksum(0, validLength_, 20);
+    result.valid = result.computed == result.stored;
+    return result;
+}
+
+Toc1Checksum OpenixTOC1::verifyItem(const Toc1Item &item) const {
+    Toc1Checksum result;
+    if (item.length < 32) {
+        return result;
+    }
+
+    uint8_t head[32];
+    readExact(item.offset, head, sizeof(head));
+
+    // u-boot: jump, "uboot", checksum, align size, length; eGON: jump, "eGON.BT0", checksum, length
+    uint32_t length;
+    if (std::memcmp(head + 4, "uboot", 5) == 0) {
+        length = getLE32(head + 20);
+    } else if (std::memcmp(head + 4, "eGON.", 5) == 0) {
+        length = getLE32(head + 16);
+    } else {
+        return result;
+    }
+    if (length < 32 || length > item.length || length % 4 != 0) {
+        return result;
+    }
+
+    result.present = true;
+    result.stored = getLE32(head + BOOT_HEAD_CHECKSUM);
+    result.computed = checksum(item.offset, length, BOOT_HEAD_CHECKSUM);
+    result.valid = result.computed == result.stored;
+    return result;
+}
+
+void OpenixTOC1::readExact(const uint64_t offset, void *data, const size_t length) const {
+    if (reader_(offset, data, length) != length) {
+        throw std::runtime_error("TOC1 package truncated at offset " + std::to_string(offset));
+    }
+}
+
+uint32_t OpenixTOC1::checksum(const uint64_t offset, const uint32_t length, const uint32_t checksumOffset) const {
+    std::vector<uint8_t> buffer(std::min<size_t>(TOC1_READ_CHUNK, length));
+    uint32_t sum = 0;
+
+    // Chunks are word multiples, so word boundaries are the same in every chunk
+    for (uint32_t done = 0; done + 4 <= length;) {
+        const auto piece = static_cast<uint32_t>(std::min<size_t>((length - done) & ~3U, buffer.size()));
+        readExact(offset + done, buffer.data(), piece);
+        for (uint32_t pos = 0; pos < piece; pos += 4) {
+            sum += done + pos == checksumOffset ? TOC1_STAMP : getLE32(buffer.data() + pos);
+        }
+        done += piece;
+    }
+    return sum;
+}
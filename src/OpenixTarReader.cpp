@@ -0,0 +1,208 @@
+/**
+ * @file OpenixTarReader.cpp
+ * @brief Implementation of OpenixTarReader class methods
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+
+#include "OpenixTarReader.hpp"
+
+using namespace OpenixIMG;
+
+// Tar archives are a sequence of 512-byte records
+constexpr size_t TAR_BLOCK_SIZE = 512;
+
+// Upper bound for long-name and PAX records, which are buffered in memory
+constexpr uint64_t TAR_MAX_META_SIZE = 1024 * 1024;
+
+OpenixTarReader::OpenixTarReader(std::istream &stream) : stream_(stream), remaining_(0), padding_(0) {
+}
+
+bool OpenixTarReader::next(Member &member) {
+    // Finish the previous member
+    skip(remaining_ + padding_);
+    remaining_ = 0;
+    padding_ = 0;
+
+    std::string longName;
+    std::string paxPath;
+    uint64_t paxSize = 0;
+    bool hasPaxSize = false;
+
+    while (true) {
+        std::array<char, TAR_BLOCK_SIZE> header{};
+        stream_.read(header.data(), TAR_BLOCK_SIZE);
+        if (stream_.gcount() == 0) {
+            return false;
+        }
+        if (static_cast<size_t>(stream_.gcount()) != TAR_BLOCK_SIZE) {
+            throw std::runtime_error("Truncated tar header");
+        }
+
+        // A zero block marks the end of the archive
+        if (std::all_of(header.begin(), header.end(), [](const char c) { return c == 0; })) {
+            return false;
+        }
+
+        // Verify the header checksum (computed with the checksum field as spaces)
+        uint32_t checksum = 0;
+        for (size_t i = 0; i < TAR_BLOCK_SIZE; ++i) {
+            checksum += (i >= 148 && i < 156) ? ' ' : static_cast<uint8_t>(header[i]);
+        }
+        if (checksum != parseNumber(header.data() + 148, 8)) {
+            throw std::runtime_error("Invalid tar header checksum");
+        }
+
+        // A PAX size belongs to the member after the extended header, never to another metadata record
+        const char type = header[156];
+        const bool metadata = type == 'L' || type == 'K' || type == 'x' || type == 'g';
+        const uint64_t size = hasPaxSize && !metadata ? paxSize : parseNumber(header.data() + 124, 12);
+        remaining_ = size;
+        padding_ = (TAR_BLOCK_SIZE - size % TAR_BLOCK_SIZE) % TAR_BLOCK_SIZE;
+        if (!metadata) {
+            hasPaxSize = false;
+        }
+
+        if (type == 'L') {
+            // GNU long name for the following member
+            longName = readAll();
+            longName = longName.c_str();
+            continue;
+        }
+
+        if (type == 'x') {
+            // PAX extended header: "<len> <key>=<value>\n" records
+            const auto records = readAll();
+            size_t pos = 0;
+            while (pos < records.size()) {
+                const auto space = records.find(' ', pos);
+                if (space == std::string::npos) {
+                    break;
+                }
+                const auto length = std::stoul(records.substr(pos, space - pos));
+                if (length == 0 || pos + length > records.size()) {
+                    break;
+                }
+                const auto record = records.substr(space + 1, pos + length - space - 2);
+                if (const auto eq = record.find('='); eq != std::string::npos) {
+                    const auto key = record.substr(0, eq);
+                    if (key == "path") {
+                        paxPath = record.substr(eq + 1);
+                    } else if (key == "size") {
+                        paxSize = std::stoull(record.substr(eq + 1));
+                        hasPaxSize = true;
+                    }
+                }
+                pos += length;
+            }
+            continue;
+        }
+
+        if (type == 'K' || type == 'g') {
+            // GNU long link names and PAX global headers do not affect the next member's name or size
+            skip(remaining_ + padding_);
+            remaining_ = 0;
+            padding_ = 0;
+            continue;
+        }
+
+        if (type != '0' && type != '\0' && type != '7') {
+            // Directories, links, devices and global headers carry no payload for us
+            skip(remaining_ + padding_);
+            remaining_ = 0;
+            padding_ = 0;
+            longName.clear();
+            paxPath.clear();
+            continue;
+        }
+
+        std::string name;
+        if (!paxPath.empty()) {
+            name = paxPath;
+        } else if (!longName.empty()) {
+            name = longName;
+        } else {
+            name.assign(header.data(), strnlen(header.data(), 100));
+            // ustar prefix field
+            if (std::memcmp(header.data() + 257, "ustar", 5) == 0 && header[345] != 0) {
+                name = std::string(header.data() + 345, strnlen(header.data() + 345, 155)) + "/" + name;
+            }
+        }
+
+        while (name.compare(0, 2, "./") == 0) {
+            name.erase(0, 2);
+        }
+        while (!name.empty() && name[0] == '/') {
+            name.erase(0, 1);
+        }
+
+        member.name = name;
+        member.size = size;
+        return true;
+    }
+}
+
+size_t OpenixTarReader::read(uint8_t *data, const size_t length) {
+    const auto toRead = static_cast<size_t>(std::min<uint64_t>(length, remaining_));
+    if (toRead == 0) {
+        return 0;
+    }
+
+    stream_.read(reinterpret_cast<char *>(data), static_cast<std::streamsize>(toRead));
+    if (static_cast<size_t>(stream_.gcount()) != toRead) {
+        throw std::runtime_error("Truncated tar member data");
+    }
+
+    remaining_ -= toRead;
+    return toRead;
+}
+
+void OpenixTarReader::skip(uint64_t length) {
+    std::array<char, TAR_BLOCK_SIZE * 16> scratch{};
+    while (length > 0) {
+        const auto chunk = static_cast<std::streamsize>(std::min<uint64_t>(length, scratch.size()));
+        stream_.read(scratch.data(), chunk);
+        if (stream_.gcount() != chunk) {
+            throw std::runtime_error("Truncated tar stream");
+        }
+        length -= static_cast<uint64_t>(chunk);
+    }
+}
+
+std::string OpenixTarReader::readAll() {
+    if (remaining_ > TAR_MAX_META_SIZE) {
+        throw std::runtime_error("Tar metadata record too large");
+    }
+
+    std::string data(static_cast<size_t>(remaining_), '\0');
+    read(reinterpret_cast<uint8_t *>(data.data()), data.size());
+    skip(padding_);
+    padding_ = 0;
+    return data;
+}
+
+uint64_t OpenixTarReader::parseNumber(const char *field, const size_t length) {
+    // GNU base-256 encoding for values that do not fit the octal field
+    if (static_cast<uint8_t>(field[0]) & 0x80) {
+        uint64_t value = static_cast<uint8_t>(field[0]) & 0x7F;
+        for (size_t i = 1; i < length; ++i) {
+            value = (value << 8) | static_cast<uint8_t>(field[i]);
+        }
+        return value;
+    }
+
+    uint64_t value = 0;
+    size_t pos = 0;
+    while (pos < length && (field[pos] == ' ' || field[pos] == '\0')) {
+        ++pos;
+    }
+    while (pos < length && field[pos] >= '0' && field[pos] <= '7') {
+        value = value * 8 + static_cast<uint64_t>(field[pos] - '0');
+        ++pos;
+    }
+    return value;
+}
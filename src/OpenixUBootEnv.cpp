@@ -0,0 +1,195 @@
+/**
+ * @file OpenixUBootEnv.cpp
+ * @brief Implementation of OpenixUBootEnv class methods
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "OpenixUBootEnv.hpp"
+#include "OpenixCRC32.hpp"
+
+using namespace OpenixIMG;
+
+namespace {
+    constexpr size_t ENV_CRC_SIZE = 4;
+
+    // Differences closer than one cipher block are written together, so no block is re-encrypted twice
+    constexpr size_t ENV_WRITE_MERGE_GAP = 16;
+
+    std::vector<uint8_t> readWholeEntry(const OpenixIMGFile &image, const size_t index) {
+        std::vector<uint8_t> data;
+        image.readEntryChunks(index, [&data](const uint8_t *chunk, const size_t length) {
+            data.insert(data.end(), chunk, chunk + length);
+        });
+        return data;
+    }
+}
+
+OpenixUBootEnv::OpenixUBootEnv(std::vector<uint8_t> image) : image_(std::move(image)) {
+    if (image_.size() <= ENV_CRC_SIZE + 1) {
+        throw std::runtime_error("Not a u-boot environment: only " + std::to_string(image_.size()) + " bytes");
+    }
+    if (crcMatches(ENV_CRC_SIZE)) {
+        dataOffset_ = ENV_CRC_SIZE;
+    } else if (crcMatches(ENV_CRC_SIZE + 1)) {
+        dataOffset_ = ENV_CRC_SIZE + 1;
+    } else {
+        throw std::runtime_error("Not a u-boot environment: CRC mismatch");
+    }
+
+    // Strings without '=' are skipped, as u-boot does when importing
+    usedEnd_ = image_.size();
+    for (size_t pos = dataOffset_; pos < image_.size();) {
+        const auto begin = image_.begin() + static_cast<std::ptrdiff_t>(pos);
+        const auto end = std::find(begin, image_.end(), 0);
+        if (begin == end) {
+            usedEnd_ = pos + 1;
+            break;
+        }
+        const std::string entry(begin, end);
+        if (const auto equals = entry.find('='); equals != std::string::npos && equals > 0) {
+            variables_.emplace_back(entry.substr(0, equals), entry.substr(equals + 1));
+        }
+        pos += entry.size() + 1;
+    }
+    padding_ = usedEnd_ < image_.size() ? image_[usedEnd_] : 0;
+}
+
+OpenixUBootEnv::OpenixUBootEnv(const OpenixIMGFile &image, const size_t index)
+    : OpenixUBootEnv(readWholeEntry(image, index)) {
+}
+
+bool OpenixUBootEnv::isRedundant() const {
+    return dataOffset_ > ENV_CRC_SIZE;
+}
+
+size_t OpenixUBootEnv::size() const {
+    return image_.size();
+}
+
+const std::vector<std::pair<std::string, std::string> > &OpenixUBootEnv::variables() const {
+    return variables_;
+}
+
+std::optional<std::string> OpenixUBootEnv::get(const std::string &name) const {
+    for (const auto &[key, value]: variables_) {
+        if (key == name) {
+            return value;
+        }
+    }
+    return std::nullopt;
+}
+
+void OpenixUBootEnv::set(const std::string &name, const std::string &value) {
+    if (name.empty() || name.find_first_of(std::string("=\0", 2)) != std::string::npos) {
+        throw std::runtime_error("Invalid environment variable name: " + name);
+    }
+    if (value.find('\0') != std::string::npos) {
+        throw std::runtime_error("Value of " + name + " contains a NUL byte");
+    }
+
+    for (auto &[key, current]: variables_) {
+        if (key == name) {
+            current = value;
+            return;
+        }
+    }
+    variables_.emplace_back(name, value);
+}
+
+bool OpenixUBootEnv::remove(const std::string &name) {
+    const auto match = std::find_if(variables_.begin(), variables_.end(), [&name](const auto &variable) {
+        return variable.first == name;
+    });
+    if (match == variables_.end()) {
+        return false;
+    }
+    variables_.erase(match);
+    return true;
+}
+
+std::vector<uint8_t> OpenixUBootEnv::serialize() const {
+    const auto required = contentLength();
+    const auto available = image_.size() - dataOffset_;
+    if (required > available) {
+        throw std::runtime_error("Environment needs " + std::to_string(required) + " bytes, only " +
+                                 std::to_string(available) + " available");
+    }
+
+    std::vector<uint8_t> out(image_);
+    auto *cursor = out.data() + dataOffset_;
+    for (const auto &[name, value]: variables_) {
+        std::memcpy(cursor, name.data(), name.size());
+        cursor += name.size();
+        *cursor++ = '=';
+        std::memcpy(cursor, value.data(), value.size());
+        cursor += value.size();
+        *cursor++ = 0;
+    }
+    *cursor++ = 0;
+
+    // Pad over what the loaded variables occupied beyond the new end
+    const auto newEnd = static_cast<size_t>(cursor - out.data());
+    if (newEnd < usedEnd_) {
+        std::fill(out.begin() + static_cast<std::ptrdiff_t>(newEnd),
+                  out.begin() + static_cast<std::ptrdiff_t>(usedEnd_), padding_);
+    }
+
+    const uint32_t crc = OpenixCRC32::compute(out.data() + dataOffset_, out.size() - dataOffset_);
+    for (size_t i = 0; i < ENV_CRC_SIZE; ++i) {
+        out[i] = static_cast<uint8_t>(crc >> (i * 8));
+    }
+    return out;
+}
+
+uint64_t OpenixUBootEnv::commit(const RangeWriter &writer) {
+    auto next = serialize();
+
+    uint64_t written = 0;
+    for (size_t pos = 0; pos < next.size();) {
+        if (next[pos] == image_[pos]) {
+            ++pos;
+            continue;
+        }
+
+        // Extend the span until ENV_WRITE_MERGE_GAP equal bytes in a row
+        size_t end = pos + 1;
+        for (size_t equal = 0; end < next.size() && equal < ENV_WRITE_MERGE_GAP; ++end) {
+            equal = next[end] == image_[end] ? equal + 1 : 0;
+        }
+        while (next[end - 1] == image_[end - 1]) {
+            --end;
+        }
+
+        writer(pos, next.data() + pos, end - pos);
+        written += end - pos;
+        pos = end;
+    }
+
+    usedEnd_ = dataOffset_ + contentLength();
+    image_ = std::move(next);
+    return written;
+}
+
+uint64_t OpenixUBootEnv::commit(OpenixIMGFile &image, const size_t index) {
+    return commit([&image, index](const uint64_t offset, const void *data, const size_t length) {
+        image.writeEntryRange(index, offset, data, length);
+    });
+}
+
+bool OpenixUBootEnv::crcMatches(const size_t dataOffset) const {
+    const uint32_t stored = static_cast<uint32_t>(image_[0]) | static_cast<uint32_t>(image_[1]) << 8 |
+                            static_cast<uint32_t>(image_[2]) << 16 | static_cast<uint32_t>(image_[3]) << 24;
+    return OpenixCRC32::compute(image_.data() + dataOffset, image_.size() - dataOffset) == stored;
+}
+
+size_t OpenixUBootEnv::contentLength() const {
+    size_t length = 1;
+    for (const auto &[name, value]: variables_) {
+        length += name.size() + value.size() + 2;
+    }
+    return length;
+}
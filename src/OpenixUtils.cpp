@@ -1,5 +1,5 @@
 #include "OpenixUtils.hpp"
-#include <iostream>
+#include <cstdio>
 using namespace OpenixIMG;
 
 // Initialize static member
@@ -15,6 +15,8 @@ bool OpenixUtils::isVerboseEnabled() {
 
 void OpenixUtils::log(const std::string &message) {
     if (verboseEnabled_) {
-        std::cout << message << std::endl;
+        std::fwrite(message.data(), 1, message.size(), stdout);
+        std::fputc('\n', stdout);
+        std::fflush(stdout);
     }
 }
@@ -0,0 +1,275 @@
+/**
+ * @file OpenixValidator.cpp
+ * @brief Implementation of OpenixValidator class methods
+ * @author YuzukiTsuru <gloomyghost@gloomyghost.com>
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <sstream>
+#include <thread>
+#include <unordered_set>
+
+#include "OpenixValidator.hpp"
+#include "OpenixCFGJson.hpp"
+#include "OpenixFileIO.hpp"
+#include "OpenixIMGFile.hpp"
+#include "OpenixIMGWTY.hpp"
+
+using namespace OpenixIMG;
+namespace fs = std::filesystem;
+
+// More entries than any real image has; larger counts mean a corrupt or foreign header
+constexpr uint32_t VALIDATE_MAX_FILES = 4096;
+
+// header_size of the two known header versions
+constexpr uint32_t HEADER_SIZE_V1 = 0x50;
+constexpr uint32_t HEADER_SIZE_V3 = 0x60;
+
+namespace {
+    // Only used for its header keys, so one instance serves every thread
+    const OpenixIMGFile &cipher() {
+        static const OpenixIMGFile instance;
+        return instance;
+    }
+
+    struct Region {
+        uint64_t begin;
+        uint64_t end;
+        std::string entry;
+    };
+
+    std::string hex(const uint64_t value) {
+        std::ostringstream ss;
+        ss << "0x" << std::hex << value;
+        return ss.str();
+    }
+
+    void checkEntries(ValidationReport &report, const std::vector<uint8_t> &table, const uint64_t tableEnd) {
+        const bool v3 = report.headerVersion == 0x0300;
+        std::unordered_set<std::string> names;
+        std::vector<Region> regions;
+        regions.reserve(report.numFiles);
+
+        for (uint32_t i = 0; i < report.numFiles; ++i) {
+            FileHeader header;
+            std::memcpy(&header, table.data() + static_cast<size_t>(i) * IMAGEWTY_FILEHDR_LEN, sizeof(header));
+            const auto &filename = v3 ? header.v3.filename : header.v1.filename;
+            const uint64_t stored = v3 ? header.v3.stored_length : header.v1.stored_length;
+            const uint64_t original = v3 ? header.v3.original_length : header.v1.original_length;
+            const uint64_t offset = v3 ? header.v3.offset : header.v1.offset;
+
+            const auto nameLength = strnlen(filename.data(), filename.size());
+            const std::string name(filename.data(), nameLength);
+            const auto entry = name.empty() ? "#" + std::to_string(i) : name;
+            if (name.empty()) {
+                report.errors.push_back({entry, "empty file name"});
+            } else if (!names.insert(name).second) {
+                report.errors.push_back({entry, "duplicate file name"});
+            }
+            if (nameLength == filename.size()) {
+                report.errors.push_back({entry, "file name is not terminated"});
+            }
+            if (original > stored) {
+                report.errors.push_back({
+                    entry, "original_length " + std::to_string(original) + " exceeds stored_length " +
+                           std::to_string(stored)
+                });
+            }
+
+            const auto end = offset + stored;
+            if (offset < tableEnd) {
+                report.errors.push_back({
+                    entry, "payload at " + hex(offset) + " lies inside the header table, which ends at " + hex(tableEnd)
+                });
+            } else if (end > report.fileSize) {
+                report.errors.push_back({
+                    entry, "payload [" + hex(offset) + ", " + hex(end) + ") extends past the end of the file at " +
+                           hex(report.fileSize)
+                });
+            } else if (stored > 0) {
+                regions.push_back({offset, end, entry});
+            }
+        }
+
+        // Sorted sweep: a payload starting before the furthest end so far overlaps its owner
+        std::sort(regions.begin(), regions.end(), [](const Region &a, const Region &b) {
+            return a.begin != b.begin ? a.begin < b.begin : a.end < b.end;
+        });
+        uint64_t covered = tableEnd;
+        const std::string *owner = nullptr;
+        for (const auto &region: regions) {
+            if (region.begin < covered) {
+                report.errors.push_back({region.entry, "payload overlaps " + *owner});
+            } else if (region.begin > covered) {
+                report.gaps.push_back({covered, region.begin - covered});
+            }
+            if (region.end > covered) {
+                covered = region.end;
+                owner = &region.entry;
+            }
+        }
+        if (report.fileSize > covered) {
+            report.gaps.push_back({covered, report.fileSize - covered});
+        }
+    }
+}
+
+bool ValidationReport::valid() const {
+    return errors.empty();
+}
+
+uint64_t ValidationReport::gapBytes() const {
+    uint64_t total = 0;
+    for (const auto &gap: gaps) {
+        total += gap.length;
+    }
+    return total;
+}
+
+ValidationReport OpenixValidator::validate(const std::string &path) {
+    ValidationReport report;
+    report.path = path;
+
+    std::error_code ec;
+    report.fileSize = fs::file_size(path, ec);
+    if (ec) {
+        report.errors.push_back({"", "cannot read file: " + ec.message()});
+        return report;
+    }
+    if (report.fileSize < IMAGEWTY_FILEHDR_LEN) {
+        report.errors.push_back({"", "file is smaller than an image header"});
+        return report;
+    }
+
+    try {
+        const OpenixFileIO file(path);
+        std::vector<uint8_t> header(IMAGEWTY_FILEHDR_LEN);
+        if (file.readAt(0, header.data(), header.size()) != header.size()) {
+            report.errors.push_back({"", "short read of the image header"});
+            return report;
+        }
+        report.encrypted = std::memcmp(header.data(), IMAGEWTY_MAGIC, IMAGEWTY_MAGIC_LEN) != 0;
+        if (report.encrypted) {
+            cipher().decryptData(header.data(), header.size(), OpenixIMGFile::CryptoContext::HEADER);
+            if (std::memcmp(header.data(), IMAGEWTY_MAGIC, IMAGEWTY_MAGIC_LEN) != 0) {
+                report.errors.push_back({"", "no IMAGEWTY magic, plain or encrypted"});
+                return report;
+            }
+        }
+
+        ImageHeader imageHeader;
+        std::memcpy(&imageHeader, header.data(), sizeof(imageHeader));
+        report.headerVersion = imageHeader.header_version;
+        if (imageHeader.header_version == 0x0100 || imageHeader.header_version == 0x0300) {
+            const auto expected = imageHeader.header_version == 0x0300 ? HEADER_SIZE_V3 : HEADER_SIZE_V1;
+            if (imageHeader.header_size != expected) {
+                report.errors.push_back({
+                    "", "header_size " + hex(imageHeader.header_size) + " does not match header_version " +
+                        hex(imageHeader.header_version) + " (expected " + hex(expected) + ")"
+                });
+            }
+        } else {
+            report.errors.push_back({"", "unknown header_version " + hex(imageHeader.header_version)});
+            return report;
+        }
+
+        report.numFiles = imageHeader.header_version == 0x0300 ? imageHeader.v3.num_files : imageHeader.v1.num_files;
+        const uint64_t tableEnd = IMAGEWTY_FILEHDR_LEN + uint64_t{report.numFiles} * IMAGEWTY_FILEHDR_LEN;
+        if (report.numFiles == 0 || report.numFiles > VALIDATE_MAX_FILES) {
+            report.errors.push_back({"", "implausible num_files " + std::to_string(report.numFiles)});
+            return report;
+        }
+        if (tableEnd > report.fileSize) {
+            report.errors.push_back({
+                "", "header table of " + std::to_string(report.numFiles) + " entries ends at " + hex(tableEnd) +
+                    ", past the end of the file at " + hex(report.fileSize)
+            });
+            return report;
+        }
+
+        std::vector<uint8_t> table(static_cast<size_t>(tableEnd - IMAGEWTY_FILEHDR_LEN));
+        if (file.readAt(IMAGEWTY_FILEHDR_LEN, table.data(), table.size()) != table.size()) {
+            report.errors.push_back({"", "short read of the header table"});
+            return report;
+        }
+        if (report.encrypted) {
+            cipher().decryptData(table.data(), table.size(), OpenixIMGFile::CryptoContext::FILE_HEADERS);
+        }
+        checkEntries(report, table, tableEnd);
+    } catch (const std::exception &e) {
+        report.errors.push_back({"", e.what()});
+    }
+    return report;
+}
+
+std::vector<ValidationReport> OpenixValidator::validateAll(const std::vector<std::string> &paths,
+                                                           const unsigned threads) {
+    std::vector<ValidationReport> reports(paths.size());
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i = next++; i < paths.size(); i = next++) {
+            reports[i] = validate(paths[i]);
+        }
+    };
+
+    const unsigned hardware = threads > 0 ? threads : std::max(1U, std::thread::hardware_concurrency());
+    const size_t threadCount = std::min<size_t>(hardware, paths.size());
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < threadCount; ++i) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread: pool) {
+        thread.join();
+    }
+    return reports;
+}
+
+std::string OpenixValidator::dumpToString(const std::vector<ValidationReport> &reports) {
+    std::ostringstream ss;
+    for (const auto &report: reports) {
+        ss << report.path << ": " << (report.valid() ? "valid" : "INVALID");
+        if (report.headerVersion != 0) {
+            ss << ", version " << hex(report.headerVersion) << (report.encrypted ? ", encrypted" : ", plain")
+                    << ", " << report.numFiles << " entries";
+        }
+        ss << ", " << report.gaps.size() << " gaps (" << report.gapBytes() << " bytes)" << std::endl;
+        for (const auto &error: report.errors) {
+            ss << "  error: " << (error.entry.empty() ? "" : error.entry + ": ") << error.message << std::endl;
+        }
+        for (const auto &gap: report.gaps) {
+            ss << "  gap: " << hex(gap.offset) << " +" << gap.length << std::endl;
+        }
+    }
+    return ss.str();
+}
+
+std::string OpenixValidator::dumpToJson(const std::vector<ValidationReport> &reports) {
+    std::ostringstream ss;
+    ss << "[";
+    for (size_t i = 0; i < reports.size(); ++i) {
+        const auto &report = reports[i];
+        ss << (i ? ",\n" : "\n") << "{\"path\":\"" << OpenixCFGJson::escape(report.path) << "\""
+                << ",\"valid\":" << (report.valid() ? "true" : "false")
+                << ",\"file_size\":" << report.fileSize
+                << ",\"encrypted\":" << (report.encrypted ? "true" : "false")
+                << ",\"header_version\":" << report.headerVersion
+                << ",\"num_files\":" << report.numFiles
+                << ",\"errors\":[";
+        for (size_t j = 0; j < report.errors.size(); ++j) {
+            ss << (j ? "," : "") << "{\"entry\":\"" << OpenixCFGJson::escape(report.errors[j].entry)
+                    << "\",\"message\":\"" << OpenixCFGJson::escape(report.errors[j].message) << "\"}";
+        }
+        ss << "],\"gap_bytes\":" << report.gapBytes() << ",\"gaps\":[";
+        for (size_t j = 0; j < report.gaps.size(); ++j) {
+            ss << (j ? "," : "") << "{\"offset\":" << report.gaps[j].offset << ",\"length\":" << report.gaps[j].length
+                    << "}";
+        }
+        ss << "]}";
+    }
+    ss << "\n]" << std::endl;
+    return ss.str();
+}
@@ -0,0 +1,68 @@
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+#include "OpenixBench.hpp"
+
+namespace fs = std::filesystem;
+
+int main() {
+    const auto root = fs::temp_directory_path() / "openiximg_bench_test";
+    fs::remove_all(root);
+    fs::create_directories(root);
+
+    int result = 0;
+    try {
+        // A small run: every measurement still happens, just on little data
+        OpenixIMG::BenchOptions options;
+        options.directory = root.string();
+        options.ioSize = 2 * 1024 * 1024;
+        options.imageSize = 512 * 1024;
+        options.threadCounts = {2};
+        options.cryptDuration = std::chrono::milliseconds(20);
+        const auto report = OpenixIMG::OpenixBench::run(options);
+
+        // Single-thread results are added to the requested ones, for each of the three kernels
+        if (report.directory != root.string() || report.hardwareThreads == 0 || report.crypt.size() != 6) {
+            std::cerr << "Bench report has " << report.crypt.size() << " cipher results!" << std::endl;
+            result = 1;
+        }
+        for (const auto &crypt: report.crypt) {
+            if (crypt.kernel.empty() || crypt.threads == 0 || crypt.bytesPerSecond <= 0) {
+                std::cerr << "Cipher result " << crypt.kernel << " with " << crypt.threads << " threads is empty!"
+                        << std::endl;
+                result = 1;
+            }
+        }
+        if (report.writeBandwidth <= 0 || report.readBandwidth <= 0 || report.packRate <= 0 ||
+            report.unpackRate <= 0 || report.score() <= 0) {
+            std::cerr << "Bench report has empty rates!" << std::endl;
+            result = 1;
+        }
+
+        const auto json = OpenixIMG::OpenixBench::dumpToJson(report);
+        for (const auto *key: {"\"score\":", "\"rc6-decrypt\"", "\"write_bytes_per_second\":",
+                               "\"read_bytes_per_second\":", "\"pack_bytes_per_second\":",
+                               "\"unpack_bytes_per_second\":"}) {
+            if (json.find(key) == std::string::npos) {
+                std::cerr << "Bench JSON lacks " << key << std::endl;
+                result = 1;
+            }
+        }
+
+        // The scratch directory is gone once the run returns
+        if (!fs::is_empty(root)) {
+            std::cerr << "Bench left scratch files behind!" << std::endl;
+            result = 1;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        result = 1;
+    }
+
+    fs::remove_all(root);
+    if (result == 0) {
+        std::cout << "OpenixBench test completed." << std::endl;
+    }
+    return result;
+}
@@ -0,0 +1,132 @@
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "OpenixCFG.hpp"
+#include "OpenixCFGDiff.hpp"
+
+int main() {
+    // Old and new configuration differ in formatting, ordering and a few values
+    std::istringstream oldStream(
+        "[IMAGE_CFG]\n"
+        "version = 0x100234\n"
+        "pid = 0x1234\n"
+        "filelist = FILELIST\n"
+        "[FILELIST]\n"
+        "{filename = \"boot.fex\", maintype = \"12345678\", subtype = \"BOOT\",},\n"
+        "{filename = \"env.fex\", maintype = \"12345678\", subtype = \"ENV\",},\n"
+        "[partition]\n"
+        "name = boot\n"
+        "size = 100\n"
+        "[partition]\n"
+        "name = rootfs\n"
+        "size = 200\n");
+    std::istringstream newStream(
+        "; reordered and reformatted\n"
+        "[FILELIST]\n"
+        "{subtype = \"ENV\", filename = \"env.fex\", maintype = \"12345678\",},\n"
+        "{filename = \"boot.fex\", maintype = \"12345678\", subtype = \"BOOT2\",},\n"
+        "{filename = \"dtb.fex\", maintype = \"12345678\", subtype = \"DTB\",},\n"
+        "[IMAGE_CFG]\n"
+        "pid     =   4660\n"
+        "version = 0x100235\n"
+        "[partition]\n"
+        "name = rootfs\n"
+        "size = 200\n"
+        "[partition]\n"
+        "name = boot\n"
+        "size = 150\n");
+
+    OpenixCFG oldCfg;
+    OpenixCFG newCfg;
+    if (!oldCfg.loadFromStream(oldStream) || !newCfg.loadFromStream(newStream)) {
+        std::cerr << "Failed to load test configurations!" << std::endl;
+        return 1;
+    }
+
+    const auto changes = OpenixIMG::OpenixCFGDiff::diff(oldCfg, newCfg);
+    std::cout << OpenixIMG::OpenixCFGDiff::dumpToString(changes);
+
+    // Expected: boot.fex item changed, dtb.fex item added, version changed,
+    // filelist removed, boot partition size changed
+    size_t itemChanged = 0, itemAdded = 0, varChanged = 0, varRemoved = 0;
+    for (const auto &change: changes) {
+        switch (change.type) {
+            case OpenixIMG::CfgChangeType::ITEM_CHANGED:
+                ++itemChanged;
+                break;
+            case OpenixIMG::CfgChangeType::ITEM_ADDED:
+                ++itemAdded;
+                break;
+            case OpenixIMG::CfgChangeType::VARIABLE_CHANGED:
+                ++varChanged;
+                break;
+            case OpenixIMG::CfgChangeType::VARIABLE_REMOVED:
+                ++varRemoved;
+                break;
+            default:
+                std::cerr << "Unexpected change in group " << change.group << std::endl;
+                return 1;
+        }
+    }
+
+    if (changes.size() != 5 || itemChanged != 1 || itemAdded != 1 || varChanged != 2 || varRemoved != 1) {
+        std::cerr << "Unexpected changeset (" << changes.size() << " changes)" << std::endl;
+        return 1;
+    }
+
+    // Identical configurations produce an empty changeset
+    if (!OpenixIMG::OpenixCFGDiff::diff(newCfg, newCfg).empty()) {
+        std::cerr << "Self diff is not empty!" << std::endl;
+        return 1;
+    }
+
+    // Removing a group lists its variables the same way adding it does
+    std::istringstream extraStream("[extra]\nsize = 1\n{filename = \"a.fex\",},\n{subtype = \"B\",},\n");
+    OpenixCFG extraCfg;
+    if (!extraCfg.loadFromStream(extraStream)) {
+        std::cerr << "Failed to load the extra configuration!" << std::endl;
+        return 1;
+    }
+    const auto grown = OpenixIMG::OpenixCFGDiff::diff(OpenixCFG(), extraCfg);
+    const auto shrunk = OpenixIMG::OpenixCFGDiff::diff(extraCfg, OpenixCFG());
+    bool symmetric = grown.size() == 4 && shrunk.size() == grown.size() &&
+                     grown[0].type == OpenixIMG::CfgChangeType::GROUP_ADDED &&
+                     shrunk[0].type == OpenixIMG::CfgChangeType::GROUP_REMOVED;
+    for (size_t i = 1; symmetric && i < grown.size(); ++i) {
+        const bool item = grown[i].type == OpenixIMG::CfgChangeType::ITEM_ADDED;
+        symmetric = shrunk[i].type == (item ? OpenixIMG::CfgChangeType::ITEM_REMOVED
+                                            : OpenixIMG::CfgChangeType::VARIABLE_REMOVED) &&
+                    shrunk[i].key == grown[i].key && shrunk[i].oldValue == grown[i].newValue;
+    }
+    std::cout << OpenixIMG::OpenixCFGDiff::dumpToString(shrunk);
+    if (!symmetric || grown[2].key != "{a.fex}" || grown[3].key != "{B}") {
+        std::cerr << "Added and removed groups are not listed symmetrically!" << std::endl;
+        return 1;
+    }
+
+    // A file that does not parse is reported as failed instead of compared as empty
+    namespace fs = std::filesystem;
+    const auto root = fs::temp_directory_path() / "openiximg_cfg_diff_test";
+    fs::remove_all(root);
+    fs::create_directories(root / "old");
+    fs::create_directories(root / "new");
+    std::ofstream(root / "old" / "image.cfg") << "[IMAGE_CFG]\nversion = 0x100234\n";
+    std::ofstream(root / "new" / "image.cfg") << "; comments only, no groups\n";
+    std::ofstream(root / "old" / "sys_config.fex") << "[product]\nversion = 1\n";
+    std::ofstream(root / "new" / "sys_config.fex") << "[product]\n!broken\n";
+    std::ofstream(root / "old" / "same.cfg") << "[a]\nb = 1\n";
+    std::ofstream(root / "new" / "same.cfg") << "[a]\nb   =   1\n";
+    const auto files = OpenixIMG::OpenixCFGDiff::diffDirectories((root / "old").string(), (root / "new").string());
+    fs::remove_all(root);
+    if (files.size() != 2 || files[0].path != "image.cfg" || files[1].path != "sys_config.fex" ||
+        files[0].status != OpenixIMG::CfgFileDiff::Status::FAILED ||
+        files[1].status != OpenixIMG::CfgFileDiff::Status::FAILED || files[0].error.empty()) {
+        std::cerr << "Unparsable files were not reported as failed!" << std::endl;
+        return 1;
+    }
+
+    std::cout << "OpenixCFGDiff test completed." << std::endl;
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "OpenixCFG.hpp"
+#include "OpenixCFGJson.hpp"
+
+namespace {
+    std::shared_ptr<Group> makeGroup(const std::string &name, const std::string &text, const size_t filler) {
+        auto group = std::make_shared<Group>(name);
+        auto value = std::make_shared<Variable>("text", ValueType::STRING);
+        value->setString(text);
+        group->addVariable(value);
+        auto number = std::make_shared<Variable>("number", ValueType::NUMBER);
+        number->setNumber(4294967295U);
+        group->addVariable(number);
+        for (size_t i = 0; i < filler; ++i) {
+            auto item = std::make_shared<Variable>("", ValueType::LIST_ITEM);
+            auto field = std::make_shared<Variable>("filename", ValueType::STRING);
+            field->setString("file" + std::to_string(i) + ".fex");
+            item->addItem(field);
+            group->addVariable(item);
+        }
+        return group;
+    }
+}
+
+int main() {
+    using OpenixIMG::OpenixCFGJson;
+
+    // Escaping: JSON specials, control characters, valid UTF-8 kept, invalid bytes as Latin-1 code points
+    const struct {
+        std::string input;
+        std::string expected;
+    } cases[] = {
+        {"plain", "plain"},
+        {"quote\" backslash\\ slash/", "quote\\\" backslash\\\\ slash/"},
+        {"\b\f\n\r\t", "\\b\\f\\n\\r\\t"},
+        {std::string("\x01\x1f\x7f", 3), "\\u0001\\u001f\x7f"},
+        {std::string("nul\0byte", 8), "nul\\u0000byte"},
+        {"\xC3\xA9 \xE4\xB8\xAD \xF0\x9F\x98\x80", "\xC3\xA9 \xE4\xB8\xAD \xF0\x9F\x98\x80"},
+        {"\xB0", "\\u00b0"},
+        {"\xC0\x80", "\\u00c0\\u0080"},
+        {"\xED\xA0\x80", "\\u00ed\\u00a0\\u0080"},
+        {"\xE4\xB8", "\\u00e4\\u00b8"},
+        {"\xF5\x80\x80\x80", "\\u00f5\\u0080\\u0080\\u0080"},
+        {"\xB9\xFA", "\\u00b9\\u00fa"},
+    };
+    for (const auto &c: cases) {
+        if (const auto escaped = OpenixCFGJson::escape(c.input); escaped != c.expected) {
+            std::cerr << "Escaping produced " << escaped << ", expected " << c.expected << std::endl;
+            return 1;
+        }
+    }
+
+    OpenixCFG cfg;
+    cfg.addGroup(makeGroup("first", "two\nlines", 0));
+    cfg.addGroup(makeGroup("second", "tab\there", 1));
+    cfg.addGroup(makeGroup("large", "bigger than the output buffer", 1000));
+
+    // NDJSON: one object per line, each line ending a sink chunk; the large group spans several chunks
+    OpenixIMG::CfgJsonOptions options;
+    options.mode = OpenixIMG::JsonMode::NDJSON;
+    std::vector<std::string> chunks;
+    OpenixCFGJson::write(cfg, [&chunks](const std::string_view chunk) {
+        chunks.emplace_back(chunk);
+    }, options);
+
+    std::string output;
+    for (const auto &chunk: chunks) {
+        output += chunk;
+    }
+    std::vector<std::string> lines;
+    for (size_t start = 0, end; (end = output.find('\n', start)) != std::string::npos; start = end + 1) {
+        lines.push_back(output.substr(start, end - start));
+    }
+    if (lines.size() != 3 || output.back() != '\n' || chunks[0] != lines[0] + "\n" || chunks[1] != lines[1] + "\n" ||
+        chunks.size() < 4 || chunks.back().back() != '\n') {
+        std::cerr << "NDJSON output is not framed one group per line!" << std::endl;
+        return 1;
+    }
+    if (lines[0] != R"({"name":"first","variables":[{"name":"text","type":"string","value":"two\nlines"},)"
+                    R"({"name":"number","type":"number","value":4294967295}]})") {
+        std::cerr << "Unexpected NDJSON line: " << lines[0] << std::endl;
+        return 1;
+    }
+    for (const auto &line: lines) {
+        if (line.front() != '{' || line.back() != '}') {
+            std::cerr << "NDJSON line is not a single object!" << std::endl;
+            return 1;
+        }
+    }
+
+    // Document mode wraps the selected groups in one array
+    options.mode = OpenixIMG::JsonMode::DOCUMENT;
+    options.groups = {"second"};
+    const auto document = OpenixCFGJson::dumpToString(cfg, options);
+    if (document != "[" + lines[1] + "]\n") {
+        std::cerr << "Unexpected document: " << document << std::endl;
+        return 1;
+    }
+    options.groups = {"missing"};
+    if (OpenixCFGJson::dumpToString(cfg, options) != "[]\n") {
+        std::cerr << "Empty selection is not an empty array!" << std::endl;
+        return 1;
+    }
+
+    std::cout << "OpenixCFGJson test completed." << std::endl;
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "OpenixCFG.hpp"
+#include "OpenixCFGDiff.hpp"
+#include "OpenixCFGOverlay.hpp"
+
+namespace {
+    std::shared_ptr<OpenixCFG> parse(const std::string &text) {
+        std::istringstream stream(text);
+        auto cfg = std::make_shared<OpenixCFG>();
+        if (!cfg->loadFromStream(stream)) {
+            throw std::runtime_error("Failed to parse test configuration");
+        }
+        return cfg;
+    }
+
+    const char *BASE =
+            "[IMAGE_CFG]\nversion = 0x100234\npid = 0x1234\nvid = 0x8743\nimagename = \"base.img\"\n"
+            "[FILELIST]\n{filename = \"boot.fex\", maintype = \"12345678\", subtype = \"BOOT\",},\n"
+            "{filename = \"env.fex\", maintype = \"12345678\", subtype = \"ENV\",},\n"
+            "[partition]\nname = boot\nsize = 100\n"
+            "[partition]\nname = rootfs\nsize = 200\n"
+            "[board]\nuart = 0\n";
+
+    const char *VARIANT =
+            "[IMAGE_CFG]\nversion = 0x100234\npid = 0x5678\nvid = 0x8743\nimagename = \"variant.img\"\n"
+            "[FILELIST]\n{filename = \"boot.fex\", maintype = \"12345678\", subtype = \"BOOT\",},\n"
+            "{filename = \"dtb.fex\", maintype = \"12345678\", subtype = \"DTB\",},\n"
+            "[partition]\nname = boot\nsize = 150\n"
+            "[partition]\nname = rootfs\nsize = 200\n"
+            "[extra]\nfeature = 1\n";
+}
+
+int main() {
+    using OpenixIMG::OpenixCFGDiff;
+    using OpenixIMG::OpenixCFGOverlay;
+
+    try {
+        const std::shared_ptr<const OpenixCFG> base = parse(BASE);
+        const auto baseText = base->dumpToString();
+
+        // Copy-on-write: changes stay in the overlay, the shared base and other overlays do not see them
+        OpenixCFGOverlay first(base);
+        OpenixCFGOverlay second(base);
+        first.setNumber("IMAGE_CFG", "pid", 0x1111);
+        first.setString("IMAGE_CFG", "imagename", "first.img");
+        first.removeVariable("IMAGE_CFG", "vid");
+        first.removeGroup("board");
+        first.setNumber("extra", "feature", 1);
+        second.setNumber("IMAGE_CFG", "pid", 0x2222);
+
+        if (first.getNumber("pid", "IMAGE_CFG") != 0x1111U || second.getNumber("pid", "IMAGE_CFG") != 0x2222U ||
+            base->getNumber("pid", "IMAGE_CFG") != 0x1234U) {
+            std::cerr << "Overlay values leaked between variants or into the base!" << std::endl;
+            return 1;
+        }
+        if (first.findVariable("vid", "IMAGE_CFG") || !second.findVariable("vid", "IMAGE_CFG") ||
+            first.hasGroup("board") || !second.hasGroup("board") || second.hasGroup("extra")) {
+            std::cerr << "Removed or added entries leaked between variants!" << std::endl;
+            return 1;
+        }
+
+        // Three IMAGE_CFG keys, the hidden group, and the new group with its variable
+        if (first.getNumber("version", "IMAGE_CFG") != 0x100234U || first.deltaSize() != 6) {
+            std::cerr << "Unchanged values do not fall through to the base!" << std::endl;
+            return 1;
+        }
+        const auto materialized = first.materialize();
+        if (base->dumpToString() != baseText || materialized->getString("imagename", "IMAGE_CFG") != "first.img") {
+            std::cerr << "Materializing modified the base!" << std::endl;
+            return 1;
+        }
+
+        // Materialized configurations are indexed like parsed ones; addGroup alone does not index
+        if (!materialized->findVariable("feature") || materialized->findVariable("vid") ||
+            materialized->findVariable("pid")->getNumber() != 0x1111) {
+            std::cerr << "Materialized configuration is not indexed like a parsed one!" << std::endl;
+            return 1;
+        }
+        OpenixCFG assembled;
+        assembled.addGroup(std::make_shared<Group>(*base->findGroup("board")));
+        if (assembled.findVariable("uart")) {
+            std::cerr << "addGroup changed the global variable index!" << std::endl;
+            return 1;
+        }
+
+        // Materialize-then-diff round trip against a fully parsed variant
+        const auto variant = parse(VARIANT);
+        const auto overlay = OpenixCFGOverlay::fromVariant(base, *variant);
+        const auto rebuilt = overlay.materialize();
+        if (!OpenixCFGDiff::diff(*variant, *rebuilt).empty() || rebuilt->dumpToString() != variant->dumpToString()) {
+            std::cerr << "Materialized variant differs from the parsed variant!" << std::endl;
+            std::cerr << OpenixCFGDiff::dumpToString(OpenixCFGDiff::diff(*variant, *rebuilt));
+            return 1;
+        }
+        const auto expected = OpenixCFGDiff::dumpToString(OpenixCFGDiff::diff(*base, *variant));
+        if (OpenixCFGDiff::dumpToString(overlay.diff()) != expected) {
+            std::cerr << "Overlay diff differs from the diff of the parsed configurations!" << std::endl;
+            return 1;
+        }
+        const auto again = OpenixCFGOverlay::fromVariant(base, *rebuilt);
+        if (again.materialize()->dumpToString() != rebuilt->dumpToString() ||
+            OpenixCFGDiff::dumpToString(again.diff()) != expected) {
+            std::cerr << "Overlay of a materialized variant does not round-trip!" << std::endl;
+            return 1;
+        }
+        std::cout << OpenixCFGDiff::dumpToString(overlay.diff());
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::cout << "OpenixCFGOverlay test completed." << std::endl;
+    return 0;
+}
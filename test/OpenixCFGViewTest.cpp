@@ -0,0 +1,85 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "OpenixCFGView.hpp"
+
+using OpenixIMG::ImageCfgView;
+
+int main() {
+    namespace detail = OpenixIMG::detail;
+
+    // Every known name resolves to its own key
+    for (size_t i = 0; i < detail::CFG_VIEW_NAMES.size(); ++i) {
+        if (ImageCfgView::lookup(detail::CFG_VIEW_NAMES[i]) != static_cast<ImageCfgView::Key>(i)) {
+            std::cerr << "Known name " << detail::CFG_VIEW_NAMES[i] << " did not resolve!" << std::endl;
+            return 1;
+        }
+    }
+
+    // Misses: near misses, other case, and names that land in an occupied slot
+    size_t collisions = 0;
+    for (const std::string name: {"", "PID", "versio", "versionx", "Filelist", "maintype", "subtype"}) {
+        if (ImageCfgView::lookup(name) != ImageCfgView::Key::COUNT) {
+            std::cerr << "Unknown name \"" << name << "\" resolved to a key!" << std::endl;
+            return 1;
+        }
+    }
+    for (int i = 0; i < 1000; ++i) {
+        const auto name = "key" + std::to_string(i);
+        const auto slot = detail::cfgViewHash(name, detail::CFG_VIEW_SEED) & (detail::CFG_VIEW_TABLE_SIZE - 1);
+        if (detail::CFG_VIEW_TABLE[slot] == ImageCfgView::Key::COUNT) {
+            continue;
+        }
+        ++collisions;
+        if (ImageCfgView::lookup(name) != ImageCfgView::Key::COUNT) {
+            std::cerr << "Colliding name " << name << " resolved to a key!" << std::endl;
+            return 1;
+        }
+    }
+    if (collisions == 0) {
+        std::cerr << "No colliding names were tried!" << std::endl;
+        return 1;
+    }
+
+    // Resolution of a whole configuration, with the file list in a differently named group
+    std::istringstream stream(
+        "[DIR_DEF]\nINPUT_DIR = \"../\"\n\n"
+        "[FILELIST]\n{ filename = \"ignored.fex\", maintype = \"COMMON\", subtype = \"IGNORED_FEX00000\", },\n\n"
+        "[MYLIST]\n{ filename = \"boot.fex\", maintype = \"12345678\", subtype = \"BOOT_FEX00000000\", },\n"
+        "{ filename = \"rootfs.fex\", maintype = \"RFSFAT16\", subtype = \"ROOTFS_FEX000000\", },\n\n"
+        "[IMAGE_CFG]\nversion = 0x100234\npid = 0x1234\nvid = 0x8743\nhardwareid = 0x100\n"
+        "firmwareid = 0x200\nunknown = 7\nimagename = \"test.img\"\nfilelist = MYLIST\nencrypt = 0\n");
+    OpenixCFG cfg;
+    if (!cfg.loadFromStream(stream)) {
+        std::cerr << "Failed to parse the test configuration!" << std::endl;
+        return 1;
+    }
+    const auto view = ImageCfgView::resolve(cfg);
+    if (view.version != 0x100234U || view.pid != 0x1234U || view.vid != 0x8743U || view.hardwareId != 0x100U ||
+        view.firmwareId != 0x200U || view.encrypt != 0U || view.imageName != "test.img") {
+        std::cerr << "Scalar fields were not resolved!" << std::endl;
+        return 1;
+    }
+    if (view.fileListName != "MYLIST" || view.fileList.size() != 2 || view.fileList[0].filename != "boot.fex" ||
+        view.fileList[1].maintype != "RFSFAT16" || view.fileList[1].subtype != "ROOTFS_FEX000000") {
+        std::cerr << "File list was not taken from the referenced group!" << std::endl;
+        return 1;
+    }
+
+    // Fields that are missing stay unset
+    std::istringstream sparse("[IMAGE_CFG]\nversion = 0x100234\n");
+    OpenixCFG sparseCfg;
+    if (!sparseCfg.loadFromStream(sparse)) {
+        std::cerr << "Failed to parse the sparse configuration!" << std::endl;
+        return 1;
+    }
+    const auto sparseView = ImageCfgView::resolve(sparseCfg);
+    if (sparseView.pid || sparseView.encrypt || !sparseView.fileList.empty() || sparseView.fileListName != "FILELIST") {
+        std::cerr << "Missing fields were not left unset!" << std::endl;
+        return 1;
+    }
+
+    std::cout << "OpenixCFGView test completed." << std::endl;
+    return 0;
+}
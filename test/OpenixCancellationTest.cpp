@@ -0,0 +1,115 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "OpenixCancellation.hpp"
+#include "OpenixIMGFile.hpp"
+#include "OpenixPacker.hpp"
+#include "OpenixTestImage.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr size_t ENTRY_SIZE = 3 * 1024 * 1024 + 100;
+
+    // Packs a single-entry image with an optional token; returns the reason it was cancelled, if any
+    bool pack(const fs::path &root, const std::shared_ptr<OpenixIMG::OpenixCancellationToken> &token,
+              OpenixIMG::OperationCancelled::Reason *reason) {
+        OpenixIMG::OpenixIMGFile imgFile;
+        imgFile.setCancellationToken(token);
+        const OpenixIMG::OpenixPacker packer(imgFile);
+        try {
+            return packer.packImage((root / "input" / "image.cfg").string(), (root / "test.img").string());
+        } catch (const OpenixIMG::OperationCancelled &e) {
+            *reason = e.reason();
+            return false;
+        }
+    }
+
+    bool unpack(const fs::path &root, const std::shared_ptr<OpenixIMG::OpenixCancellationToken> &token,
+                OpenixIMG::OperationCancelled::Reason *reason) {
+        OpenixIMG::OpenixIMGFile imgFile((root / "test.img").string());
+        imgFile.setCancellationToken(token);
+        const OpenixIMG::OpenixPacker packer(imgFile);
+        try {
+            return packer.unpackImage((root / "output").string(), OpenixIMG::OutputFormat::IMGREPACKER);
+        } catch (const OpenixIMG::OperationCancelled &e) {
+            *reason = e.reason();
+            return false;
+        }
+    }
+}
+
+int main() {
+    const auto root = fs::temp_directory_path() / "openiximg_cancellation_test";
+    fs::remove_all(root);
+
+    int result = 0;
+    try {
+        OpenixTest::writeInput(root, {{"rootfs.fex", std::vector<char>(ENTRY_SIZE, 0x5A), "RFSFAT16"}});
+
+        auto reason = OpenixIMG::OperationCancelled::Reason::CANCELLED;
+
+        // A cancelled pack leaves no image behind
+        auto cancelled = std::make_shared<OpenixIMG::OpenixCancellationToken>();
+        cancelled->cancel();
+        if (pack(root, cancelled, &reason) || fs::exists(root / "test.img")) {
+            std::cerr << "Cancelled pack left an image behind!" << std::endl;
+            result = 1;
+        }
+
+        // A token that is never triggered changes nothing
+        auto idle = std::make_shared<OpenixIMG::OpenixCancellationToken>();
+        idle->setTimeout(std::chrono::hours(1));
+        if (!pack(root, idle, &reason) || fs::file_size(root / "test.img") < ENTRY_SIZE) {
+            std::cerr << "Pack with an idle token failed!" << std::endl;
+            result = 1;
+        }
+
+        // A passed deadline stops the unpack and removes the output directory
+        auto expired = std::make_shared<OpenixIMG::OpenixCancellationToken>();
+        expired->setDeadline(std::chrono::steady_clock::now());
+        reason = OpenixIMG::OperationCancelled::Reason::CANCELLED;
+        if (unpack(root, expired, &reason) || reason != OpenixIMG::OperationCancelled::Reason::DEADLINE) {
+            std::cerr << "Expired deadline did not stop the unpack!" << std::endl;
+            result = 1;
+        }
+        if (fs::exists(root / "output")) {
+            std::cerr << "Cancelled unpack left its output behind!" << std::endl;
+            result = 1;
+        }
+
+        // Cancelling another token does not affect this one
+        if (!unpack(root, idle, &reason) || fs::file_size(root / "output" / "rootfs.fex") != ENTRY_SIZE) {
+            std::cerr << "Unpack with an idle token failed!" << std::endl;
+            result = 1;
+        }
+
+        // Reads fail once the token is cancelled, however they are issued
+        OpenixIMG::OpenixIMGFile imgFile((root / "test.img").string());
+        imgFile.setCancellationToken(cancelled);
+        bool threw = false;
+        try {
+            (void) imgFile.readEntries({0});
+        } catch (const OpenixIMG::OperationCancelled &) {
+            threw = true;
+        }
+        if (!threw) {
+            std::cerr << "Batched read ignored the cancelled token!" << std::endl;
+            result = 1;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        result = 1;
+    }
+
+    fs::remove_all(root);
+    if (result == 0) {
+        std::cout << "OpenixCancellation test completed." << std::endl;
+    }
+    return result;
+}
@@ -0,0 +1,410 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "OpenixExt4.hpp"
+#include "OpenixTestImage.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr uint32_t BLOCK = 1024;
+    constexpr uint32_t INODE_SIZE = 256;
+    constexpr uint32_t INODES = 32;
+    constexpr uint32_t INODE_TABLE = 3;
+
+    constexpr uint32_t INCOMPAT_FILETYPE = 0x0002;
+    constexpr uint32_t INCOMPAT_EXTENTS = 0x0040;
+    constexpr uint32_t INCOMPAT_LARGEDIR = 0x4000;
+    constexpr uint32_t INCOMPAT_INLINE_DATA = 0x8000;
+
+    constexpr uint32_t INDEX_FL = 0x00001000;
+    constexpr uint32_t EXTENTS_FL = 0x00080000;
+    constexpr uint32_t INLINE_DATA_FL = 0x10000000;
+
+    constexpr uint16_t MODE_DIR = 0x41ED;
+    constexpr uint16_t MODE_FILE = 0x81A4;
+
+    // Seed of the directory hash, as a UUID: 01234567-89ab-cdef-0123-456789abcdef
+    constexpr uint8_t HASH_SEED[16] = {
+        0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef, 0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef
+    };
+
+    // Reference hashes from e2fsprogs: debugfs -R "dx_hash -h <version> -s <seed> <name>", versions 0 to 5
+    const struct {
+        const char *name;
+        uint32_t hash[6];
+    } NAMES[] = {
+        {"alpha", {0x59bef7aeU, 0xa9624b60U, 0x106b73d2U, 0x59bef7aeU, 0xa9624b60U, 0x106b73d2U}},
+        {"bravo.txt", {0xc147c0eaU, 0x95567e64U, 0x17f2f6feU, 0xc147c0eaU, 0x95567e64U, 0x17f2f6feU}},
+        {"charlie", {0x62ea4304U, 0xf9ed2618U, 0x4c021fdaU, 0x62ea4304U, 0xf9ed2618U, 0x4c021fdaU}},
+        {"delta", {0x05151382U, 0x93bc86a8U, 0x152fb788U, 0x05151382U, 0x93bc86a8U, 0x152fb788U}},
+        {"caf\xc3\xa9", {0x96ca5a2cU, 0xd6b4ad14U, 0x105842eaU, 0x6dde4230U, 0x3349cea2U, 0x6621f032U}},
+        {"na\xc3\xafve", {0x442f7420U, 0x83e53248U, 0x784c5732U, 0x275d661aU, 0xb2b2195cU, 0x6811c436U}},
+        {"\xe6\x96\x87\xe4\xbb\xb6", {0x20bd1862U, 0x5ba3e12aU, 0x4314c8aeU, 0xa1e6dc64U, 0x0438a7deU, 0x3f9975c4U}},
+        {
+            "a-name-longer-than-thirty-two-bytes-for-md4",
+            {0xb288d2f8U, 0xdc715a4eU, 0x5eec91caU, 0xb288d2f8U, 0xdc715a4eU, 0x5eec91caU}
+        },
+    };
+    constexpr uint32_t FIRST_NAME_INODE = 20;
+
+    std::vector<uint8_t> pattern(const size_t length, const uint8_t seed) {
+        std::vector<uint8_t> data(length);
+        for (size_t i = 0; i < length; ++i) {
+            data[i] = static_cast<uint8_t>(seed + i * 7 + (i >> 8));
+        }
+        return data;
+    }
+
+    /**
+     * @brief In-memory ext4 volume: one block group, 1 KiB blocks, 256-byte inodes
+     */
+    struct Volume {
+        std::vector<uint8_t> data = std::vector<uint8_t>(512 * BLOCK, 0);
+        uint32_t nextBlock = 16;
+
+        void put16(const size_t offset, const uint32_t value) {
+            data[offset] = static_cast<uint8_t>(value);
+            data[offset + 1] = static_cast<uint8_t>(value >> 8);
+        }
+
+        void put32(const size_t offset, const uint32_t value) {
+            put16(offset, value & 0xFFFF);
+            put16(offset + 2, value >> 16);
+        }
+
+        uint32_t allocate(const uint32_t count = 1) {
+            const auto first = nextBlock;
+            nextBlock += count;
+            return first;
+        }
+
+        size_t inode(const uint32_t number) const {
+            return INODE_TABLE * BLOCK + (number - 1) * INODE_SIZE;
+        }
+
+        void setInode(const uint32_t number, const uint16_t mode, const uint32_t size, const uint32_t flags) {
+            const auto at = inode(number);
+            put16(at, mode);
+            put32(at + 4, size);
+            put32(at + 32, flags);
+            put16(at + 128, 32); // i_extra_isize
+        }
+
+        void extentHeader(const size_t at, const uint16_t entries, const uint16_t max, const uint16_t depth) {
+            put16(at, 0xF30A);
+            put16(at + 2, entries);
+            put16(at + 4, max);
+            put16(at + 6, depth);
+        }
+
+        void extent(const size_t at, const uint32_t logical, const uint16_t length, const uint32_t start) {
+            put32(at, logical);
+            put16(at + 4, length);
+            put32(at + 8, start);
+        }
+
+        // A single extent in i_block mapping the blocks of a file or directory
+        void mapContiguous(const uint32_t number, const uint32_t first, const uint16_t count) {
+            extentHeader(inode(number) + 40, 1, 4, 0);
+            extent(inode(number) + 52, 0, count, first);
+        }
+
+        void dirent(const size_t at, const uint32_t number, const uint16_t recordLength, const std::string &name,
+                    const uint8_t type) {
+            put32(at, number);
+            put16(at + 4, recordLength);
+            data[at + 6] = static_cast<uint8_t>(name.size());
+            data[at + 7] = type;
+            std::copy(name.begin(), name.end(), data.begin() + static_cast<std::ptrdiff_t>(at + 8));
+        }
+
+        void write(const uint32_t block, const std::vector<uint8_t> &contents) {
+            std::copy(contents.begin(), contents.end(), data.begin() + block * size_t{BLOCK});
+        }
+    };
+
+    Volume format(const uint32_t incompat, const uint32_t hashFlags) {
+        Volume volume;
+        const size_t super = 1024;
+        volume.put32(super + 0, INODES);
+        volume.put32(super + 4, 512);
+        volume.put32(super + 20, 1); // First data block
+        volume.put32(super + 32, 8192);
+        volume.put32(super + 40, INODES);
+        volume.put16(super + 56, 0xEF53);
+        volume.put32(super + 76, 1); // Dynamic revision
+        volume.put16(super + 88, INODE_SIZE);
+        volume.put32(super + 92, 0x0020); // dir_index
+        volume.put32(super + 96, INCOMPAT_FILETYPE | INCOMPAT_EXTENTS | INCOMPAT_INLINE_DATA | incompat);
+        std::copy(std::begin(HASH_SEED), std::end(HASH_SEED), volume.data.begin() + super + 236);
+        volume.put32(super + 352, hashFlags);
+        volume.put32(2 * BLOCK + 8, INODE_TABLE);
+
+        // Inodes the hashed directory entries point to
+        for (uint32_t i = 0; i < std::size(NAMES); ++i) {
+            volume.setInode(FIRST_NAME_INODE + i, MODE_FILE, 0, 0);
+        }
+        return volume;
+    }
+
+    /**
+     * @brief Hashed directory with one name per leaf, so a wrong hash always lands in the wrong leaf
+     *
+     * Index nodes hold two entries each; levels is the indirect level count of the root. The root
+     * records versions 0 to 2, the superblock flags decide whether they mean versions 3 to 5.
+     */
+    void addHashedDirectory(Volume &volume, const uint32_t number, const int version, const uint8_t levels) {
+        struct Entry {
+            uint32_t hash;
+            uint32_t logical;
+        };
+
+        std::vector<std::pair<uint32_t, size_t> > sorted;
+        for (size_t i = 0; i < std::size(NAMES); ++i) {
+            sorted.emplace_back(NAMES[i].hash[version], i);
+        }
+        std::sort(sorted.begin(), sorted.end());
+
+        // Logical block 0 is the root; leaves follow, then index nodes level by level
+        std::vector<std::vector<uint8_t> > blocks(1, std::vector<uint8_t>(BLOCK, 0));
+        std::vector<Entry> entries;
+        for (const auto &[hash, name]: sorted) {
+            std::vector<uint8_t> leaf(BLOCK, 0);
+            const std::string text = NAMES[name].name;
+            leaf[0] = static_cast<uint8_t>(FIRST_NAME_INODE + name);
+            leaf[4] = BLOCK & 0xFF;
+            leaf[5] = BLOCK >> 8;
+            leaf[6] = static_cast<uint8_t>(text.size());
+            leaf[7] = 1;
+            std::copy(text.begin(), text.end(), leaf.begin() + 8);
+            entries.push_back({hash, static_cast<uint32_t>(blocks.size())});
+            blocks.push_back(leaf);
+        }
+
+        const auto writeTable = [](std::vector<uint8_t> &block, const size_t offset, const uint16_t limit,
+                                   const std::vector<Entry> &table) {
+            block[offset] = static_cast<uint8_t>(limit);
+            block[offset + 2] = static_cast<uint8_t>(table.size());
+            for (size_t i = 0; i < table.size(); ++i) {
+                for (int b = 0; b < 4; ++b) {
+                    if (i > 0) {
+                        block[offset + i * 8 + b] = static_cast<uint8_t>(table[i].hash >> (b * 8));
+                    }
+                    block[offset + i * 8 + 4 + b] = static_cast<uint8_t>(table[i].logical >> (b * 8));
+                }
+            }
+        };
+        for (uint8_t level = 0; level < levels; ++level) {
+            std::vector<Entry> parents;
+            for (size_t i = 0; i < entries.size(); i += 2) {
+                std::vector<uint8_t> node(BLOCK, 0);
+                node[4] = BLOCK & 0xFF; // Empty entry spanning the block hides the node from linear scans
+                node[5] = BLOCK >> 8;
+                const auto end = std::min(i + 2, entries.size());
+                writeTable(node, 8, (BLOCK - 8) / 8,
+                           std::vector<Entry>(entries.begin() + static_cast<std::ptrdiff_t>(i),
+                                              entries.begin() + static_cast<std::ptrdiff_t>(end)));
+                parents.push_back({entries[i].hash, static_cast<uint32_t>(blocks.size())});
+                blocks.push_back(node);
+            }
+            entries = parents;
+        }
+
+        // dx_root: ".", ".." covering the rest of the block, root info, then the top index entries
+        auto &root = blocks[0];
+        const std::vector<uint8_t> dots = {
+            static_cast<uint8_t>(number), 0, 0, 0, 12, 0, 1, 2, '.', 0, 0, 0,
+            2, 0, 0, 0, (BLOCK - 12) & 0xFF, (BLOCK - 12) >> 8, 2, 2, '.', '.', 0, 0,
+            0, 0, 0, 0, static_cast<uint8_t>(version % 3), 8, levels, 0
+        };
+        std::copy(dots.begin(), dots.end(), root.begin());
+        writeTable(root, 0x20, (BLOCK - 0x20) / 8, entries);
+
+        const auto first = volume.allocate(static_cast<uint32_t>(blocks.size()));
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            volume.write(first + static_cast<uint32_t>(i), blocks[i]);
+        }
+        volume.setInode(number, MODE_DIR, static_cast<uint32_t>(blocks.size() * BLOCK), EXTENTS_FL | INDEX_FL);
+        volume.mapContiguous(number, first, static_cast<uint16_t>(blocks.size()));
+    }
+
+    struct Contents {
+        std::vector<uint8_t> extents;
+        std::vector<uint8_t> small;
+        std::vector<uint8_t> inlined;
+    };
+
+    Volume build(const uint32_t incompat, const uint32_t hashFlags, const uint8_t maxLevels, Contents &contents) {
+        auto volume = format(incompat, hashFlags);
+
+        // Depth-1 extent tree: two blocks, a non-adjacent block, a hole and an uninitialized extent
+        const auto leaf = volume.allocate();
+        const auto data = volume.allocate(2);
+        volume.allocate();
+        const auto far = volume.allocate();
+        const auto unwritten = volume.allocate(2);
+        const auto head = pattern(2 * BLOCK, 1);
+        const auto middle = pattern(BLOCK, 2);
+        volume.write(data, head);
+        volume.write(far, middle);
+        volume.write(unwritten, std::vector<uint8_t>(2 * BLOCK, 0xEE));
+        volume.setInode(12, MODE_FILE, 6 * BLOCK - 10, EXTENTS_FL);
+        volume.extentHeader(volume.inode(12) + 40, 1, 4, 1);
+        volume.put32(volume.inode(12) + 52, 0);
+        volume.put32(volume.inode(12) + 56, leaf);
+        volume.extentHeader(leaf * size_t{BLOCK}, 3, (BLOCK - 12) / 12, 0);
+        volume.extent(leaf * size_t{BLOCK} + 12, 0, 2, data);
+        volume.extent(leaf * size_t{BLOCK} + 24, 2, 1, far);
+        volume.extent(leaf * size_t{BLOCK} + 36, 4, 32768 + 2, unwritten);
+        contents.extents = head;
+        contents.extents.insert(contents.extents.end(), middle.begin(), middle.end());
+        contents.extents.resize(6 * BLOCK - 10, 0);
+
+        // Extents in i_block
+        const auto small = volume.allocate();
+        contents.small = pattern(700, 3);
+        volume.write(small, contents.small);
+        volume.setInode(13, MODE_FILE, 700, EXTENTS_FL);
+        volume.mapContiguous(13, small, 1);
+
+        // Inline data: 60 bytes in i_block, the rest in the system.data attribute
+        contents.inlined = pattern(100, 4);
+        volume.setInode(14, MODE_FILE, 100, INLINE_DATA_FL);
+        const auto inlineAt = volume.inode(14);
+        std::copy(contents.inlined.begin(), contents.inlined.begin() + 60, volume.data.begin() + inlineAt + 40);
+        volume.put32(inlineAt + 160, 0xEA020000);
+        volume.data[inlineAt + 164] = 4;
+        volume.data[inlineAt + 165] = 7;
+        volume.put16(inlineAt + 166, 40);
+        volume.put32(inlineAt + 172, 40);
+        std::memcpy(&volume.data[inlineAt + 180], "data", 4);
+        std::copy(contents.inlined.begin() + 60, contents.inlined.end(), volume.data.begin() + inlineAt + 204);
+
+        // Inline directory: parent inode, then entries in the rest of i_block
+        volume.setInode(15, MODE_DIR, 60, INLINE_DATA_FL);
+        volume.put32(volume.inode(15) + 40, 2);
+        volume.dirent(volume.inode(15) + 44, 13, 56, "inner", 1);
+
+        // One hashed directory per hash version, one as deep as the volume allows, one too deep
+        const int versions = hashFlags & 0x2 ? 3 : 0;
+        addHashedDirectory(volume, 16, versions, 0);
+        addHashedDirectory(volume, 17, versions + 1, 1);
+        addHashedDirectory(volume, 18, versions + 2, maxLevels - 1);
+        addHashedDirectory(volume, 19, versions + 1, maxLevels);
+
+        const auto rootBlock = volume.allocate();
+        const auto rootAt = rootBlock * size_t{BLOCK};
+        volume.setInode(2, MODE_DIR, BLOCK, EXTENTS_FL);
+        volume.mapContiguous(2, rootBlock, 1);
+        const struct {
+            const char *name;
+            uint32_t inode;
+            uint8_t type;
+        } rootEntries[] = {
+            {".", 2, 2}, {"..", 2, 2}, {"extents.bin", 12, 1}, {"small.bin", 13, 1}, {"inline.txt", 14, 1},
+            {"inline_dir", 15, 2}, {"legacy", 16, 2}, {"half_md4", 17, 2}, {"tea", 18, 2}, {"too_deep", 19, 2},
+        };
+        size_t pos = 0;
+        for (size_t i = 0; i < std::size(rootEntries); ++i) {
+            const auto last = i + 1 == std::size(rootEntries);
+            volume.dirent(rootAt + pos, rootEntries[i].inode, static_cast<uint16_t>(last ? BLOCK - pos : 24),
+                          rootEntries[i].name, rootEntries[i].type);
+            pos += 24;
+        }
+        return volume;
+    }
+
+    bool check(const OpenixIMG::OpenixExt4 &ext4, const Contents &contents, const int versionOffset,
+               const std::string &label) {
+        if (ext4.readFile("extents.bin") != contents.extents || ext4.readFile("/small.bin") != contents.small ||
+            ext4.readFile("inline.txt") != contents.inlined || ext4.readFile("inline_dir/inner") != contents.small) {
+            std::cerr << label << ": file contents differ" << std::endl;
+            return false;
+        }
+        const auto inner = ext4.list("inline_dir");
+        if (inner.size() != 1 || inner[0].name != "inner" || inner[0].inode != 13) {
+            std::cerr << label << ": inline directory listed wrongly" << std::endl;
+            return false;
+        }
+
+        const char *directories[] = {"legacy", "half_md4", "tea"};
+        for (int version = 0; version < 3; ++version) {
+            for (size_t i = 0; i < std::size(NAMES); ++i) {
+                const auto path = std::string(directories[version]) + "/" + NAMES[i].name;
+                const auto found = ext4.find(path);
+                if (!found || found->number != FIRST_NAME_INODE + i) {
+                    std::cerr << label << ": hashed lookup of " << path << " (hash version "
+                            << version + versionOffset << ") failed" << std::endl;
+                    return false;
+                }
+            }
+            if (ext4.find(std::string(directories[version]) + "/missing") ||
+                ext4.list(directories[version]).size() != std::size(NAMES)) {
+                std::cerr << label << ": hashed directory " << directories[version] << " is wrong" << std::endl;
+                return false;
+            }
+        }
+
+        bool threw = false;
+        try {
+            (void) ext4.find("too_deep/alpha");
+        } catch (const std::runtime_error &) {
+            threw = true;
+        }
+        if (!threw) {
+            std::cerr << label << ": index deeper than the volume allows was not rejected" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    OpenixIMG::OpenixExt4::RangeReader memoryReader(const Volume &volume) {
+        return [&volume](const uint64_t offset, void *data, const size_t length) {
+            const auto start = std::min<uint64_t>(offset, volume.data.size());
+            const auto count = static_cast<size_t>(std::min<uint64_t>(length, volume.data.size() - start));
+            std::memcpy(data, volume.data.data() + start, count);
+            return count;
+        };
+    }
+}
+
+int main() {
+    const auto root = fs::temp_directory_path() / "openiximg_ext4_test";
+    fs::remove_all(root);
+
+    int result = 0;
+    try {
+        // Signed-char hashes with two index levels, unsigned-char hashes with three (largedir)
+        Contents compatContents;
+        Contents largedirContents;
+        const auto compat = build(0, 0x1, 2, compatContents);
+        const auto largedir = build(INCOMPAT_LARGEDIR, 0x2, 3, largedirContents);
+
+        if (!check(OpenixIMG::OpenixExt4(memoryReader(compat)), compatContents, 0, "signed") ||
+            !check(OpenixIMG::OpenixExt4(memoryReader(largedir)), largedirContents, 3, "unsigned largedir")) {
+            result = 1;
+        }
+
+        // Through an encrypted image, with a cache smaller than one lookup's working set
+        OpenixTest::writeInput(root, {{"rootfs.fex", std::vector<char>(largedir.data.begin(), largedir.data.end())}});
+        const auto image = OpenixTest::packInput(root);
+        const OpenixIMG::OpenixIMGFile imgFile(image.string());
+        if (!check(OpenixIMG::OpenixExt4(imgFile, 0, 2), largedirContents, 3, "image")) {
+            result = 1;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        result = 1;
+    }
+
+    fs::remove_all(root);
+    if (result == 0) {
+        std::cout << "OpenixExt4 test completed." << std::endl;
+    }
+    return result;
+}
@@ -0,0 +1,300 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "OpenixFAT.hpp"
+#include "OpenixTestImage.hpp"
+
+namespace fs = std::filesystem;
+using OpenixIMG::FatType;
+
+namespace {
+    constexpr uint32_t SECTOR = 512;
+
+    /**
+     * @brief In-memory FAT volume with just enough of a formatter to place entries and chains
+     */
+    struct Volume {
+        FatType type;
+        uint32_t clusterSize;
+        uint64_t fatOffset;
+        uint64_t rootOffset;
+        uint64_t dataOffset;
+        std::vector<uint8_t> data;
+
+        void put16(const uint64_t offset, const uint32_t value) {
+            data[offset] = static_cast<uint8_t>(value);
+            data[offset + 1] = static_cast<uint8_t>(value >> 8);
+        }
+
+        void put32(const uint64_t offset, const uint32_t value) {
+            put16(offset, value & 0xFFFF);
+            put16(offset + 2, value >> 16);
+        }
+
+        void setFat(const uint32_t cluster, const uint32_t value) {
+            if (type == FatType::FAT12) {
+                const auto offset = fatOffset + cluster + cluster / 2;
+                const uint32_t pair = data[offset] | data[offset + 1] << 8;
+                put16(offset, cluster & 1 ? (pair & 0x000F) | value << 4 : (pair & 0xF000) | (value & 0x0FFF));
+            } else if (type == FatType::FAT16) {
+                put16(fatOffset + cluster * 2, value);
+            } else {
+                put32(fatOffset + cluster * 4, value);
+            }
+        }
+
+        uint64_t clusterOffset(const uint32_t cluster) const {
+            return dataOffset + static_cast<uint64_t>(cluster - 2) * clusterSize;
+        }
+
+        // Links the clusters in the order given and copies the data into them
+        void writeChain(const std::vector<uint32_t> &clusters, const std::vector<uint8_t> &contents) {
+            for (size_t i = 0; i < clusters.size(); ++i) {
+                setFat(clusters[i], i + 1 < clusters.size() ? clusters[i + 1] : 0x0FFFFFFF);
+                const auto begin = std::min<size_t>(i * clusterSize, contents.size());
+                const auto end = std::min<size_t>(begin + clusterSize, contents.size());
+                std::copy(contents.begin() + static_cast<std::ptrdiff_t>(begin),
+                          contents.begin() + static_cast<std::ptrdiff_t>(end),
+                          data.begin() + static_cast<std::ptrdiff_t>(clusterOffset(clusters[i])));
+            }
+        }
+    };
+
+    Volume format(const FatType type) {
+        // Geometries chosen so the cluster count lands in the range of each variant
+        const struct {
+            uint32_t totalSectors, sectorsPerCluster, reserved, rootEntries, fatSectors;
+        } geometry = type == FatType::FAT12
+                         ? decltype(geometry){2880, 2, 1, 224, 9}
+                         : type == FatType::FAT16
+                               ? decltype(geometry){8192, 1, 1, 512, 32}
+                               : decltype(geometry){70000, 1, 32, 0, 548};
+
+        Volume volume{type, SECTOR * geometry.sectorsPerCluster, geometry.reserved * SECTOR, 0, 0, {}};
+        volume.data.resize(static_cast<size_t>(geometry.totalSectors) * SECTOR);
+        volume.rootOffset = volume.fatOffset + 2ULL * geometry.fatSectors * SECTOR;
+        volume.dataOffset = volume.rootOffset + geometry.rootEntries * 32ULL;
+
+        auto &boot = volume.data;
+        boot[0] = 0xEB;
+        volume.put16(11, SECTOR);
+        boot[13] = static_cast<uint8_t>(geometry.sectorsPerCluster);
+        volume.put16(14, geometry.reserved);
+        boot[16] = 2;
+        volume.put16(17, geometry.rootEntries);
+        if (geometry.totalSectors < 0x10000) {
+            volume.put16(19, geometry.totalSectors);
+        } else {
+            volume.put32(32, geometry.totalSectors);
+        }
+        if (type == FatType::FAT32) {
+            volume.put32(36, geometry.fatSectors);
+            volume.put32(44, 2);
+        } else {
+            volume.put16(22, geometry.fatSectors);
+        }
+        boot[510] = 0x55;
+        boot[511] = 0xAA;
+
+        volume.setFat(0, 0x0FFFFFF8);
+        volume.setFat(1, 0x0FFFFFFF);
+        return volume;
+    }
+
+    std::vector<uint8_t> shortName(const std::string &name) {
+        std::vector<uint8_t> out(11, ' ');
+        std::copy(name.begin(), name.end(), out.begin());
+        return out;
+    }
+
+    /**
+     * @brief Builds the 32-byte entries of one directory
+     */
+    struct Directory {
+        std::vector<uint8_t> entries;
+
+        void add(const std::vector<uint8_t> &name, const uint8_t attributes, const uint32_t cluster,
+                 const uint32_t size) {
+            std::vector<uint8_t> entry(32, 0);
+            std::copy(name.begin(), name.end(), entry.begin());
+            entry[11] = attributes;
+            entry[20] = static_cast<uint8_t>(cluster >> 16);
+            entry[21] = static_cast<uint8_t>(cluster >> 24);
+            entry[26] = static_cast<uint8_t>(cluster);
+            entry[27] = static_cast<uint8_t>(cluster >> 8);
+            for (int i = 0; i < 4; ++i) {
+                entry[28 + i] = static_cast<uint8_t>(size >> (i * 8));
+            }
+            entries.insert(entries.end(), entry.begin(), entry.end());
+        }
+
+        // Long name parts, last part first, followed by the short entry they belong to
+        void addLong(const std::string &longName, const std::vector<uint8_t> &name, const uint8_t attributes,
+                     const uint32_t cluster, const uint32_t size) {
+            uint8_t checksum = 0;
+            for (const auto c: name) {
+                checksum = static_cast<uint8_t>(((checksum & 1) << 7) + (checksum >> 1) + c);
+            }
+            std::vector<uint16_t> units(longName.begin(), longName.end());
+            const auto parts = (units.size() + 12) / 13;
+            if (units.size() < parts * 13) {
+                units.push_back(0);
+            }
+            units.resize(parts * 13, 0xFFFF);
+
+            static constexpr int offsets[13] = {1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30};
+            for (auto part = parts; part > 0; --part) {
+                std::vector<uint8_t> entry(32, 0);
+                entry[0] = static_cast<uint8_t>(part | (part == parts ? 0x40 : 0));
+                entry[11] = 0x0F;
+                entry[13] = checksum;
+                for (size_t i = 0; i < 13; ++i) {
+                    entry[offsets[i]] = static_cast<uint8_t>(units[(part - 1) * 13 + i]);
+                    entry[offsets[i] + 1] = static_cast<uint8_t>(units[(part - 1) * 13 + i] >> 8);
+                }
+                entries.insert(entries.end(), entry.begin(), entry.end());
+            }
+            add(name, attributes, cluster, size);
+        }
+    };
+
+    std::vector<uint8_t> pattern(const size_t length, const uint8_t seed) {
+        std::vector<uint8_t> data(length);
+        for (size_t i = 0; i < length; ++i) {
+            data[i] = static_cast<uint8_t>(seed + i * 13 + (i >> 9));
+        }
+        return data;
+    }
+
+    // Same tree on every variant: a long-named file, a fragmented file and a long-named subdirectory
+    struct Tree {
+        std::vector<uint8_t> longFile;
+        std::vector<uint8_t> fragmented;
+        std::vector<uint8_t> nested;
+    };
+
+    Volume build(const FatType type, const Tree &tree) {
+        auto volume = format(type);
+        const auto cluster = volume.clusterSize;
+        volume.writeChain({3, 4}, tree.longFile);
+        volume.writeChain({10, 11, 20, 12, 30}, tree.fragmented);
+        volume.writeChain({40}, tree.nested);
+
+        Directory sub;
+        sub.add(shortName("."), 0x10, 5, 0);
+        sub.add(shortName(".."), 0x10, 0, 0);
+        sub.addLong("nested file.txt", shortName("NESTED~1TXT"), 0x20, 40, static_cast<uint32_t>(tree.nested.size()));
+        volume.writeChain({5}, sub.entries);
+
+        Directory root;
+        root.add(shortName("TESTVOL"), 0x08, 0, 0);
+        root.addLong("A very long file name.bin", shortName("AVERYL~1BIN"), 0x20, 3,
+                     static_cast<uint32_t>(tree.longFile.size()));
+        root.add({0xE5, 'E', 'L', 'E', 'T', 'E', 'D', ' ', 'B', 'I', 'N'}, 0x20, 50, 100);
+        root.add(shortName("FRAG    DAT"), 0x20, 10, static_cast<uint32_t>(tree.fragmented.size()));
+        root.addLong("Sub Directory", shortName("SUBDIR~1   "), 0x10, 5, 0);
+        if (type == FatType::FAT32) {
+            root.entries.resize(cluster, 0);
+            volume.writeChain({2}, root.entries);
+        } else {
+            std::copy(root.entries.begin(), root.entries.end(), volume.data.begin() + volume.rootOffset);
+        }
+        return volume;
+    }
+
+    bool check(const OpenixIMG::OpenixFAT &fat, const FatType type, const Tree &tree, const std::string &label) {
+        std::vector<std::string> names;
+        for (const auto &entry: fat.list("/")) {
+            names.push_back(entry.name);
+        }
+        if (fat.type() != type ||
+            names != std::vector<std::string>{"A very long file name.bin", "FRAG.DAT", "Sub Directory"}) {
+            std::cerr << label << ": root directory listed wrongly" << std::endl;
+            return false;
+        }
+
+        // Long and short names both resolve, ignoring case
+        if (fat.readFile("a VERY long FILE name.BIN") != tree.longFile ||
+            fat.readFile("averyl~1.bin") != tree.longFile || fat.readFile("/frag.dat") != tree.fragmented ||
+            fat.readFile("sub directory/Nested File.txt") != tree.nested ||
+            fat.readFile("SUBDIR~1/NESTED~1.TXT") != tree.nested) {
+            std::cerr << label << ": file contents differ" << std::endl;
+            return false;
+        }
+        const auto sub = fat.list("Sub Directory");
+        if (sub.size() != 1 || sub[0].name != "nested file.txt" || sub[0].shortName != "NESTED~1.TXT" ||
+            fat.find("missing.bin") || fat.find("frag.dat/inside")) {
+            std::cerr << label << ": subdirectory lookup is wrong" << std::endl;
+            return false;
+        }
+
+        bool threw = false;
+        try {
+            (void) fat.list("frag.dat");
+        } catch (const std::runtime_error &) {
+            threw = true;
+        }
+        if (!threw) {
+            std::cerr << label << ": listing a file did not fail" << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
+
+int main() {
+    const auto root = fs::temp_directory_path() / "openiximg_fat_test";
+    fs::remove_all(root);
+
+    int result = 0;
+    try {
+        const FatType types[] = {FatType::FAT12, FatType::FAT16, FatType::FAT32};
+        const char *labels[] = {"FAT12", "FAT16", "FAT32"};
+        std::vector<OpenixTest::TestEntry> entries;
+        std::vector<Tree> trees;
+        for (size_t i = 0; i < 3; ++i) {
+            const auto type = types[i];
+            const auto cluster = type == FatType::FAT12 ? 1024 : 512;
+            trees.push_back({pattern(cluster + 300, 1), pattern(5 * cluster - 100, 2), pattern(77, 3)});
+            const auto volume = build(type, trees[i]);
+            entries.push_back({
+                std::string(labels[i]) + ".fex", std::vector<char>(volume.data.begin(), volume.data.end())
+            });
+
+            // Straight from memory
+            const OpenixIMG::OpenixFAT fat([&volume](const uint64_t offset, void *data, const size_t length) {
+                const auto start = std::min<uint64_t>(offset, volume.data.size());
+                const auto count = static_cast<size_t>(std::min<uint64_t>(length, volume.data.size() - start));
+                std::memcpy(data, volume.data.data() + start, count);
+                return count;
+            });
+            if (!check(fat, type, trees[i], labels[i])) {
+                result = 1;
+            }
+        }
+
+        // Through an encrypted image, one handle per reader
+        OpenixTest::writeInput(root, entries);
+        const auto image = OpenixTest::packInput(root);
+        const OpenixIMG::OpenixIMGFile imgFile(image.string());
+        for (size_t i = 0; i < 3; ++i) {
+            const OpenixIMG::OpenixFAT fat(imgFile, i);
+            if (!check(fat, types[i], trees[i], std::string(labels[i]) + " in image")) {
+                result = 1;
+            }
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        result = 1;
+    }
+
+    fs::remove_all(root);
+    if (result == 0) {
+        std::cout << "OpenixFAT test completed." << std::endl;
+    }
+    return result;
+}
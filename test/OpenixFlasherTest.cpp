@@ -0,0 +1,194 @@
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "OpenixBuildConfig.hpp"
+#include "OpenixCRC32.hpp"
+#include "OpenixFileIO.hpp"
+#include "OpenixFlasher.hpp"
+#include "OpenixTestImage.hpp"
+
+namespace fs = std::filesystem;
+using OpenixIMG::FlashOptions;
+using OpenixIMG::FlashResult;
+using OpenixIMG::OpenixFileIO;
+using OpenixIMG::PARTITION_SECTOR_SIZE;
+
+namespace {
+    constexpr uint64_t LOGICAL_OFFSET = 64;
+    constexpr uint64_t MBR_SECTORS = 16 * 1024 / PARTITION_SECTOR_SIZE;
+    constexpr uint8_t FILLER = 0xA5;
+
+    // rootfs.fex spans several chunks and ends mid-block; boot.fex is smaller than one aligned block
+    constexpr size_t BOOT_SIZE = 3000;
+    constexpr size_t ROOTFS_SIZE = OpenixIMG::IO_BUFFER_SIZE * 2 + 1234;
+    constexpr uint64_t ROOTFS_SECTORS = ROOTFS_SIZE / PARTITION_SECTOR_SIZE + 8;
+
+    // boot starts on a DIRECT_ALIGNMENT boundary; its odd size leaves rootfs unaligned
+    const std::string TABLE = "[mbr]\nsize = 16\n[partition_start]\n"
+            "[partition]\nname = boot\nsize = 25\ndownloadfile = \"boot.fex\"\n"
+            "[partition]\nname = rootfs\nsize = " + std::to_string(ROOTFS_SECTORS) + "\ndownloadfile = \"rootfs.fex\"\n"
+            "[partition]\nname = misc\nsize = 8\n"
+            "[partition]\nname = recovery\nsize = 16\ndownloadfile = \"recovery.fex\"\n";
+
+    std::vector<char> pattern(const size_t size, const unsigned seed) {
+        std::vector<char> data(size);
+        for (size_t i = 0; i < size; ++i) {
+            data[i] = static_cast<char>(i * seed + (i >> 9));
+        }
+        return data;
+    }
+
+    bool throws(const std::function<void()> &action) {
+        try {
+            action();
+        } catch (const std::runtime_error &) {
+            return true;
+        }
+        return false;
+    }
+
+    std::vector<uint8_t> readTarget(const fs::path &target) {
+        const OpenixFileIO file(target.string(), OpenixFileIO::Mode::READ);
+        std::vector<uint8_t> data(file.size());
+        if (file.readAt(0, data.data(), data.size()) != data.size()) {
+            throw std::runtime_error("Short read of the target");
+        }
+        return data;
+    }
+
+    // Checks the results and that the target holds every entry at its offset and the filler everywhere else
+    bool checkTarget(const fs::path &target, const std::vector<FlashResult> &results,
+                     const std::vector<std::vector<char> > &payloads, const uint64_t targetSize, const bool verified) {
+        const uint64_t offsets[] = {
+            (LOGICAL_OFFSET + MBR_SECTORS) * PARTITION_SECTOR_SIZE,
+            (LOGICAL_OFFSET + MBR_SECTORS + 25) * PARTITION_SECTOR_SIZE,
+        };
+        if (results.size() != 2 || results[0].partition != "boot" || results[0].file != "boot.fex" ||
+            results[1].partition != "rootfs" || results[1].file != "rootfs.fex") {
+            std::cerr << "Unexpected partitions were flashed!" << std::endl;
+            return false;
+        }
+
+        const auto data = readTarget(target);
+        if (data.size() != targetSize) {
+            std::cerr << "Target size changed to " << data.size() << " bytes!" << std::endl;
+            return false;
+        }
+        std::vector<bool> covered(data.size(), false);
+        for (size_t i = 0; i < results.size(); ++i) {
+            const auto &result = results[i];
+            const auto &payload = payloads[i];
+            if (result.offset != offsets[i] || result.length != payload.size() || result.verified != verified ||
+                result.crc != OpenixIMG::OpenixCRC32::compute(payload.data(), payload.size())) {
+                std::cerr << result.partition << ": offset " << result.offset << ", length " << result.length
+                        << ", verified " << result.verified << std::endl;
+                return false;
+            }
+            if (std::memcmp(data.data() + result.offset, payload.data(), payload.size()) != 0) {
+                std::cerr << result.partition << " does not hold " << result.file << "!" << std::endl;
+                return false;
+            }
+            std::fill_n(covered.begin() + static_cast<std::ptrdiff_t>(result.offset), payload.size(), true);
+        }
+        for (size_t i = 0; i < data.size(); ++i) {
+            if (!covered[i] && data[i] != FILLER) {
+                std::cerr << "Byte " << i << " outside the partitions was overwritten!" << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main() {
+    int result = 0;
+    const auto root = fs::temp_directory_path() / "openiximg_flasher_test";
+    fs::remove_all(root);
+
+    try {
+        const std::vector<std::vector<char> > payloads = {pattern(BOOT_SIZE, 7), pattern(ROOTFS_SIZE, 13)};
+        OpenixTest::writeInput(root, {{"boot.fex", payloads[0]}, {"rootfs.fex", payloads[1]}});
+        const auto image = OpenixTest::packInput(root);
+
+        OpenixIMG::OpenixIMGFile imgFile(image.string());
+        OpenixIMG::OpenixPartition table;
+        if (!table.parseFromData(reinterpret_cast<const uint8_t *>(TABLE.data()), TABLE.size())) {
+            throw std::runtime_error("Parsing the partition table failed");
+        }
+        const OpenixIMG::OpenixFlasher flasher(imgFile, table);
+
+        // A disk image filled with a marker so stray writes show up
+        const auto target = root / "disk.img";
+        const uint64_t targetSize =
+                (LOGICAL_OFFSET + MBR_SECTORS + 25 + ROOTFS_SECTORS + 8 + 16 + 33) * PARTITION_SECTOR_SIZE;
+        auto resetTarget = [&target, targetSize]() {
+            const OpenixFileIO file(target.string(), OpenixFileIO::Mode::WRITE);
+            const std::vector<uint8_t> filler(targetSize, FILLER);
+            file.writeAt(0, filler.data(), filler.size());
+        };
+
+        FlashOptions options;
+        options.layout.logicalOffset = LOGICAL_OFFSET;
+        options.layout.diskSectors = targetSize / PARTITION_SECTOR_SIZE;
+        for (const unsigned threads: {1U, 0U}) {
+            for (const bool verify: {false, true}) {
+                resetTarget();
+                options.threads = threads;
+                options.verify = verify;
+                if (!checkTarget(target, flasher.flash(target.string(), options), payloads, targetSize, verify)) {
+                    std::cerr << "Flashing with " << threads << " threads, verify " << verify << " failed" << std::endl;
+                    result = 1;
+                }
+            }
+        }
+
+        // Read-back of a corrupted target flags only the partition that changed
+        auto results = flasher.flash(target.string(), options);
+        {
+            const OpenixFileIO file(target.string(), OpenixFileIO::Mode::UPDATE);
+            const uint8_t flipped = static_cast<uint8_t>(payloads[1][5000] ^ 0x40);
+            file.writeAt(results[1].offset + 5000, &flipped, 1);
+        }
+        flasher.verify(target.string(), results);
+        if (!results[0].verified || results[1].verified) {
+            std::cerr << "Corrupted partition was not detected by the read-back!" << std::endl;
+            result = 1;
+        }
+
+        // Planning rejects unknown partitions, missing download files and entries larger than their partition
+        options.partitions = {"rootfs"};
+        const auto planned = flasher.plan(options);
+        if (planned.size() != 1 || planned[0].partition != "rootfs") {
+            std::cerr << "Partition selection was ignored!" << std::endl;
+            result = 1;
+        }
+        auto unknown = options;
+        unknown.partitions = {"system"};
+        auto missing = options;
+        missing.partitions = {"recovery"};
+        const std::string small = "[mbr]\nsize = 16\n[partition_start]\n"
+                "[partition]\nname = rootfs\nsize = 8\ndownloadfile = \"rootfs.fex\"\n";
+        OpenixIMG::OpenixPartition smallTable;
+        (void) smallTable.parseFromData(reinterpret_cast<const uint8_t *>(small.data()), small.size());
+        const OpenixIMG::OpenixFlasher smallFlasher(imgFile, smallTable);
+        if (!throws([&] { (void) flasher.plan(unknown); }) || !throws([&] { (void) flasher.plan(missing); }) ||
+            !throws([&] { (void) smallFlasher.flash((root / "small.img").string(), options); }) ||
+            fs::exists(root / "small.img")) {
+            std::cerr << "Invalid flash plan was accepted!" << std::endl;
+            result = 1;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        result = 1;
+    }
+
+    fs::remove_all(root);
+    if (result == 0) {
+        std::cout << "OpenixFlasher test completed." << std::endl;
+    }
+    return result;
+}
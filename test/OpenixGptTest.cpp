@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "OpenixCRC32.hpp"
+#include "OpenixFileIO.hpp"
+#include "OpenixPartition.hpp"
+
+namespace fs = std::filesystem;
+using OpenixIMG::OpenixFileIO;
+using OpenixIMG::PARTITION_SECTOR_SIZE;
+
+namespace {
+    constexpr uint64_t LOGICAL_OFFSET = 64;
+    constexpr uint64_t DISK_SECTORS = 4096;
+    constexpr uint64_t LAST_LBA = DISK_SECTORS - 1;
+    constexpr uint64_t ENTRY_SECTORS = 32; // 128 entries of 128 bytes
+    constexpr size_t ENTRY_ARRAY_SIZE = 128 * 128;
+
+    // CRC-32 of an entry array of 128 unused entries, as stored by any empty GPT
+    constexpr uint32_t EMPTY_ENTRIES_CRC = 0xAB54D286;
+
+    const std::string TABLE = "[mbr]\nsize = 16\n[partition_start]\n"
+            "[partition]\nname = boot-resource\nsize = 100\ndownloadfile = \"boot-resource.fex\"\n"
+            "[partition]\nname = env\nsize = 32\nro = 1\n"
+            "[partition]\nname = UDISK\nsize = 0\n";
+
+    // Bit-at-a-time reference for the table-driven implementation
+    uint32_t referenceCrc(const uint8_t *data, const size_t length) {
+        uint32_t crc = 0xFFFFFFFF;
+        for (size_t i = 0; i < length; ++i) {
+            crc ^= data[i];
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = crc >> 1 ^ (crc & 1 ? 0xEDB88320 : 0);
+            }
+        }
+        return ~crc;
+    }
+
+    uint64_t le(const uint8_t *data, const size_t bytes) {
+        uint64_t value = 0;
+        for (size_t i = 0; i < bytes; ++i) {
+            value |= static_cast<uint64_t>(data[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    std::string entryName(const uint8_t *entry) {
+        std::string name;
+        for (size_t c = 0; c < 36 && le(entry + 56 + c * 2, 2) != 0; ++c) {
+            name += static_cast<char>(le(entry + 56 + c * 2, 2));
+        }
+        return name;
+    }
+
+    // Checks a GPT header sector: signature, its own CRC and where it says it and its entries are
+    bool checkHeader(const uint8_t *header, const uint64_t myLba, const uint64_t alternateLba,
+                     const uint64_t entriesLba, const uint32_t entriesCrc, const std::string &label) {
+        std::vector<uint8_t> zeroed(header, header + 92);
+        std::memset(zeroed.data() + 16, 0, 4);
+        const auto crc = referenceCrc(zeroed.data(), zeroed.size());
+        if (std::memcmp(header, "EFI PART", 8) != 0 || le(header + 8, 4) != 0x00010000 || le(header + 12, 4) != 92 ||
+            le(header + 16, 4) != crc || le(header + 24, 8) != myLba || le(header + 32, 8) != alternateLba ||
+            le(header + 40, 8) != 34 || le(header + 48, 8) != LAST_LBA - 33 || le(header + 72, 8) != entriesLba ||
+            le(header + 80, 4) != 128 || le(header + 84, 4) != 128 || le(header + 88, 4) != entriesCrc) {
+            std::cerr << label << " GPT header is wrong!" << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
+
+int main() {
+    int result = 0;
+
+    // The entry array CRC of an empty table is a fixed, well-known value
+    const std::vector<uint8_t> empty(ENTRY_ARRAY_SIZE, 0);
+    if (OpenixIMG::OpenixCRC32::compute(empty.data(), empty.size()) != EMPTY_ENTRIES_CRC ||
+        referenceCrc(empty.data(), empty.size()) != EMPTY_ENTRIES_CRC) {
+        std::cerr << "CRC-32 of an empty GPT entry array is wrong!" << std::endl;
+        result = 1;
+    }
+
+    const auto root = fs::temp_directory_path() / "openiximg_gpt_test";
+    fs::remove_all(root);
+    fs::create_directories(root);
+    try {
+        OpenixIMG::OpenixPartition table;
+        if (!table.parseFromData(reinterpret_cast<const uint8_t *>(TABLE.data()), TABLE.size())) {
+            throw std::runtime_error("Parsing the partition table failed");
+        }
+        OpenixIMG::GptOptions options;
+        options.logicalOffset = LOGICAL_OFFSET;
+        options.diskSectors = DISK_SECTORS;
+        const auto path = root / "disk.img";
+        table.writeGpt(path.string(), options);
+
+        const OpenixFileIO file(path.string(), OpenixFileIO::Mode::READ);
+        std::vector<uint8_t> disk(file.size());
+        if (disk.size() != DISK_SECTORS * PARTITION_SECTOR_SIZE ||
+            file.readAt(0, disk.data(), disk.size()) != disk.size()) {
+            throw std::runtime_error("Disk image has the wrong size: " + std::to_string(disk.size()));
+        }
+        auto sector = [&disk](const uint64_t lba) {
+            return disk.data() + lba * PARTITION_SECTOR_SIZE;
+        };
+
+        // Protective MBR: one 0xEE partition from LBA 1 to the end of the disk
+        const uint8_t *record = sector(0) + 446;
+        if (record[4] != 0xEE || le(record + 8, 4) != 1 || le(record + 12, 4) != LAST_LBA || sector(0)[510] != 0x55 ||
+            sector(0)[511] != 0xAA || le(record + 16, 8) != 0 || le(record + 24, 8) != 0) {
+            std::cerr << "Protective MBR is wrong!" << std::endl;
+            result = 1;
+        }
+
+        // Entries: the backup array is a copy of the primary one, and both headers carry its CRC
+        const uint8_t *entries = sector(2);
+        const auto entriesCrc = referenceCrc(entries, ENTRY_ARRAY_SIZE);
+        if (std::memcmp(entries, sector(LAST_LBA - ENTRY_SECTORS), ENTRY_ARRAY_SIZE) != 0) {
+            std::cerr << "Backup entry array differs from the primary one!" << std::endl;
+            result = 1;
+        }
+        if (!checkHeader(sector(1), 1, LAST_LBA, 2, entriesCrc, "Primary") ||
+            !checkHeader(sector(LAST_LBA), LAST_LBA, 1, LAST_LBA - ENTRY_SECTORS, entriesCrc, "Backup") ||
+            std::memcmp(sector(1) + 56, sector(LAST_LBA) + 56, 16) != 0) {
+            result = 1;
+        }
+
+        // Partitions follow the MBR region; UDISK takes what is left before the backup table
+        const uint64_t first = LOGICAL_OFFSET + 16 * 1024 / PARTITION_SECTOR_SIZE;
+        const struct {
+            const char *name;
+            uint64_t firstLba;
+            uint64_t lastLba;
+            bool readOnly;
+        } expected[] = {
+            {"boot-resource", first, first + 99, false},
+            {"env", first + 100, first + 131, true},
+            {"UDISK", first + 132, LAST_LBA - 33, false},
+        };
+        for (size_t i = 0; i < 3; ++i) {
+            const uint8_t *entry = entries + i * 128;
+            if (le(entry, 8) != 0x4433B9E5EBD0A0A2ULL || le(entry + 8, 8) != 0xC79926B7B668C087ULL ||
+                le(entry + 32, 8) != expected[i].firstLba || le(entry + 40, 8) != expected[i].lastLba ||
+                le(entry + 48, 8) != (expected[i].readOnly ? 1ULL << 60 : 0) || entryName(entry) != expected[i].name ||
+                le(entry + 16, 8) == 0) {
+                std::cerr << "GPT entry " << i << " (" << entryName(entry) << ") is wrong!" << std::endl;
+                result = 1;
+            }
+        }
+        if (std::any_of(entries + 3 * 128, entries + ENTRY_ARRAY_SIZE, [](const uint8_t b) { return b != 0; })) {
+            std::cerr << "Unused GPT entries are not zero!" << std::endl;
+            result = 1;
+        }
+
+        // The same table always produces the same disk
+        table.writeGpt((root / "again.img").string(), options);
+        const OpenixFileIO again((root / "again.img").string(), OpenixFileIO::Mode::READ);
+        std::vector<uint8_t> second(again.size());
+        if (again.readAt(0, second.data(), second.size()) != second.size() || second != disk) {
+            std::cerr << "Writing the same GPT twice gave different disks!" << std::endl;
+            result = 1;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        result = 1;
+    }
+
+    fs::remove_all(root);
+    if (result == 0) {
+        std::cout << "OpenixGpt test completed." << std::endl;
+    }
+    return result;
+}
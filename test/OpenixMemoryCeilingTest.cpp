@@ -0,0 +1,134 @@
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <new>
+#include <vector>
+
+#include "OpenixBuildConfig.hpp"
+#include "OpenixFileIO.hpp"
+#include "OpenixIMGFile.hpp"
+#include "OpenixPacker.hpp"
+#include "OpenixTestImage.hpp"
+
+namespace fs = std::filesystem;
+
+// Heap accounting through replaced global allocation functions
+namespace {
+    std::atomic<size_t> liveBytes{0};
+    std::atomic<size_t> peakBytes{0};
+
+    // Keeps the payload 16-byte aligned behind the size header
+    constexpr size_t HEADER_SIZE = 16;
+
+    void resetPeak() {
+        peakBytes = liveBytes.load();
+    }
+}
+
+void *operator new(const size_t size) {
+    auto *block = static_cast<uint8_t *>(std::malloc(size + HEADER_SIZE));
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    *reinterpret_cast<size_t *>(block) = size;
+    const auto live = liveBytes += size;
+    for (auto peak = peakBytes.load(); live > peak && !peakBytes.compare_exchange_weak(peak, live);) {
+    }
+    return block + HEADER_SIZE;
+}
+
+void operator delete(void *pointer) noexcept {
+    if (pointer) {
+        auto *block = static_cast<uint8_t *>(pointer) - HEADER_SIZE;
+        liveBytes -= *reinterpret_cast<size_t *>(block);
+        std::free(block);
+    }
+}
+
+void operator delete(void *pointer, size_t) noexcept {
+    operator delete(pointer);
+}
+
+namespace {
+    constexpr uint64_t ENTRY_SIZE = 48ULL * 1024 * 1024 + 1000;
+
+    uint8_t pattern(const uint64_t offset) {
+        return static_cast<uint8_t>((offset * 2654435761ULL) >> 13);
+    }
+
+    // Built before the measurement starts, so only the unpack counts against the ceiling
+    std::vector<char> payload() {
+        std::vector<char> data(ENTRY_SIZE);
+        for (uint64_t i = 0; i < ENTRY_SIZE; ++i) {
+            data[i] = static_cast<char>(pattern(i));
+        }
+        return data;
+    }
+
+    // Checks the unpacked entry chunk by chunk so the check itself stays small
+    bool matchesPayload(const std::string &path) {
+        const OpenixIMG::OpenixFileIO file(path);
+        if (file.size() != ENTRY_SIZE) {
+            return false;
+        }
+        std::vector<uint8_t> chunk(1024 * 1024);
+        for (uint64_t offset = 0; offset < ENTRY_SIZE; offset += chunk.size()) {
+            const auto length = static_cast<size_t>(std::min<uint64_t>(chunk.size(), ENTRY_SIZE - offset));
+            if (file.readAt(offset, chunk.data(), length) != length) {
+                return false;
+            }
+            for (size_t i = 0; i < length; ++i) {
+                if (chunk[i] != pattern(offset + i)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+}
+
+int main() {
+    const auto root = fs::temp_directory_path() / "openiximg_memory_ceiling_test";
+    fs::remove_all(root);
+
+    int result = 0;
+    try {
+        const auto imagePath = OpenixTest::makePackedImage(root, payload()).string();
+
+        // Only the unpack is measured: it must not hold the entry in memory as a whole
+        const size_t baseline = liveBytes.load();
+        resetPeak();
+        {
+            OpenixIMG::OpenixIMGFile imgFile(imagePath);
+            const OpenixIMG::OpenixPacker packer(imgFile);
+            if (!packer.unpackImage((root / "output").string(), OpenixIMG::OutputFormat::IMGREPACKER)) {
+                std::cerr << "Unpacking the test image failed!" << std::endl;
+                return 1;
+            }
+        }
+        const size_t used = peakBytes.load() - baseline;
+        const size_t ceiling = 2 * OpenixIMG::IO_BUFFER_SIZE + 1024 * 1024;
+
+        std::cout << "Entry size:   " << ENTRY_SIZE << " bytes" << std::endl;
+        std::cout << "I/O buffer:   " << OpenixIMG::IO_BUFFER_SIZE << " bytes" << std::endl;
+        std::cout << "Peak heap:    " << used << " bytes (ceiling " << ceiling << ")" << std::endl;
+
+        if (used > ceiling) {
+            std::cerr << "Unpack exceeded the memory ceiling!" << std::endl;
+            result = 1;
+        } else if (!matchesPayload((root / "output" / "rootfs.fex").string())) {
+            std::cerr << "Unpacked entry does not match the input!" << std::endl;
+            result = 1;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        result = 1;
+    }
+
+    fs::remove_all(root);
+    if (result == 0) {
+        std::cout << "\nOpenixMemoryCeiling test completed." << std::endl;
+    }
+    return result;
+}
@@ -0,0 +1,72 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "OpenixMetrics.hpp"
+
+int main() {
+    using OpenixIMG::OpenixHistogram;
+
+    // Every value must land in the bucket (previous bound, bound] that contains it, within 12.5%;
+    // the first bucket also holds 0
+    for (uint64_t value: {0ULL, 1ULL, 2ULL, 7ULL, 8ULL, 9ULL, 15ULL, 16ULL, 1000ULL, 1024ULL, 123456789ULL, ~0ULL}) {
+        const auto index = OpenixHistogram::bucketIndex(value);
+        const auto upper = OpenixHistogram::bucketUpperBound(index);
+        if (index >= OpenixHistogram::BUCKET_COUNT || upper < value ||
+            (index > 0 && OpenixHistogram::bucketUpperBound(index - 1) >= value) ||
+            (value > 0 && static_cast<double>(upper - value) > static_cast<double>(value) * 0.125)) {
+            std::cerr << "Bad bucket for " << value << ": index " << index << ", upper bound " << upper << std::endl;
+            return 1;
+        }
+    }
+
+    // A value equal to a bound is counted by that bound, as in Prometheus "le" buckets
+    OpenixHistogram bounds;
+    bounds.record(1024);
+    if (bounds.countAtMost(1024) != 1 || bounds.countAtMost(1023) != 0 || bounds.quantile(1.0) != 1024) {
+        std::cerr << "Value on a bucket bound is not counted by that bound!" << std::endl;
+        return 1;
+    }
+
+    // Concurrent updates must not lose counts
+    OpenixHistogram histogram;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&histogram]() {
+            for (uint64_t i = 1; i <= 100000; ++i) {
+                histogram.record(i);
+            }
+        });
+    }
+    for (auto &thread: threads) {
+        thread.join();
+    }
+
+    std::cout << "count: " << histogram.count() << ", p50: " << histogram.quantile(0.5) << ", p99: " <<
+            histogram.quantile(0.99) << std::endl;
+    if (histogram.count() != 400000 || histogram.sum() != 4 * (100000ULL * 100001 / 2) ||
+        histogram.countAtMost(1ULL << 20) != 400000 ||
+        histogram.quantile(0.5) < 50000 || histogram.quantile(0.5) > 56250) {
+        std::cerr << "Unexpected histogram state!" << std::endl;
+        return 1;
+    }
+
+    // The registry renders Prometheus histograms
+    OpenixIMG::OpenixMetrics::setEnabled(true);
+    OpenixIMG::OpenixMetrics::record(OpenixIMG::Metric::READ, 1024);
+    OpenixIMG::OpenixMetrics::record(OpenixIMG::Metric::READ, 1500);
+    const auto text = OpenixIMG::OpenixMetrics::dumpToString();
+    std::cout << text.substr(0, text.find('\n', text.find("_count"))) << std::endl;
+    if (text.find("openiximg_read_seconds_count 2") == std::string::npos) {
+        std::cerr << "Missing read latency histogram!" << std::endl;
+        return 1;
+    }
+    if (text.find("openiximg_read_seconds_bucket{le=\"1.024e-06\"} 1\n") == std::string::npos ||
+        text.find("openiximg_read_seconds_bucket{le=\"2.048e-06\"} 2\n") == std::string::npos) {
+        std::cerr << "Read of exactly 1024 ns is not in the le=\"1.024e-06\" bucket!" << std::endl;
+        return 1;
+    }
+
+    std::cout << "\nOpenixMetrics test completed." << std::endl;
+    return 0;
+}
@@ -71,6 +71,22 @@ int main() {
                 std::dec << std::endl;
     }
 
+    // Test GPT layout: partitions follow the MBR region after the logical offset
+    OpenixIMG::GptOptions gptOptions;
+    gptOptions.diskSectors = 64 * 1024 * 1024 / OpenixIMG::PARTITION_SECTOR_SIZE;
+    const auto layout = partitionParser.computeLayout(gptOptions);
+    std::cout << "\nGPT layout:" << std::endl;
+    for (const auto &extent: layout) {
+        std::cout << "  " << std::left << std::setw(20) << extent.name << extent.firstSector << " +" <<
+                extent.sectorCount << std::endl;
+    }
+    if (layout.size() != partitions.size() ||
+        layout.front().firstSector != OpenixIMG::SUNXI_LOGICAL_OFFSET + mbrSize * 2 ||
+        layout.back().firstSector + layout.back().sectorCount != gptOptions.diskSectors - 33) {
+        std::cerr << "Unexpected GPT layout!" << std::endl;
+        return 1;
+    }
+
     std::cout << "\nOpenixPartition test completed." << std::endl;
     return 0;
 }
@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "OpenixIMGFile.hpp"
+#include "OpenixPacker.hpp"
+#include "OpenixTestImage.hpp"
+
+namespace fs = std::filesystem;
+using OpenixIMG::PayloadLayout;
+
+namespace {
+    std::vector<char> pattern(const size_t size, const char seed) {
+        std::vector<char> data(size);
+        for (size_t i = 0; i < size; ++i) {
+            data[i] = static_cast<char>(seed + i * 3);
+        }
+        return data;
+    }
+
+    // File list order mixes large entries, well-known metadata and other small entries
+    const std::vector<OpenixTest::TestEntry> ENTRIES = {
+        {"rootfs.fex", pattern(400 * 1024, 1)},
+        {"readme.txt", pattern(10 * 1024, 2)},
+        {"boot0_nand.fex", pattern(300 * 1024, 3)},
+        {"kernel.fex", pattern(300 * 1024, 4)},
+        {"sys_partition.fex", pattern(2000, 5)},
+        {"tiny.fex", pattern(100, 6)},
+    };
+
+    // Entry names sorted by where their payloads are stored
+    std::vector<std::string> payloadOrder(const OpenixIMG::OpenixIMGFile &image) {
+        auto files = image.getFileList();
+        std::sort(files.begin(), files.end(), [](const auto &a, const auto &b) {
+            return a.offset < b.offset;
+        });
+        std::vector<std::string> names;
+        for (const auto &file: files) {
+            names.push_back(fs::path(file.filename).filename().string());
+        }
+        return names;
+    }
+
+    // Checks that the payloads do not overlap and that every entry reads back unchanged
+    bool checkPayloads(const OpenixIMG::OpenixIMGFile &image, const std::string &label) {
+        const auto &files = image.getFileList();
+        std::vector<size_t> indices(files.size());
+        for (size_t i = 0; i < indices.size(); ++i) {
+            indices[i] = i;
+        }
+        auto sorted = files;
+        std::sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) {
+            return a.offset < b.offset;
+        });
+        for (size_t i = 1; i < sorted.size(); ++i) {
+            if (uint64_t{sorted[i - 1].offset} + sorted[i - 1].storedLength > sorted[i].offset) {
+                std::cerr << label << ": payloads of " << sorted[i - 1].filename << " and " << sorted[i].filename
+                        << " overlap!" << std::endl;
+                return false;
+            }
+        }
+
+        const auto data = image.readEntries(indices);
+        for (size_t i = 0; i < files.size(); ++i) {
+            const auto name = fs::path(files[i].filename).filename().string();
+            const auto entry = std::find_if(ENTRIES.begin(), ENTRIES.end(), [&name](const auto &e) {
+                return e.filename == name;
+            });
+            if (entry == ENTRIES.end() || std::vector<char>(data[i].begin(), data[i].end()) != entry->data) {
+                std::cerr << label << ": " << name << " does not read back!" << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main() {
+    int result = 0;
+    const auto root = fs::temp_directory_path() / "openiximg_payload_layout_test";
+    fs::remove_all(root);
+
+    try {
+        for (const std::string extraCfg: {"", "encrypt = 0\n"}) {
+            const std::string label = extraCfg.empty() ? "encrypted" : "plain";
+            OpenixTest::writeInput(root, ENTRIES, extraCfg);
+
+            // Table order keeps the file list order
+            const OpenixIMG::OpenixIMGFile table(OpenixTest::packInput(root, "table.img").string());
+            std::vector<std::string> listed;
+            for (const auto &file: table.getFileList()) {
+                listed.push_back(fs::path(file.filename).filename().string());
+            }
+            if (payloadOrder(table) != listed || !checkPayloads(table, label + " table order")) {
+                std::cerr << label << ": table order payloads are not in file list order!" << std::endl;
+                result = 1;
+            }
+
+            // Metadata first: well-known metadata, then small entries, then the rest, each in file list order
+            const auto image = OpenixTest::packInput(root, "metadata.img", [](OpenixIMG::OpenixPacker &packer) {
+                packer.setPayloadLayout(PayloadLayout::METADATA_FIRST);
+            });
+            const OpenixIMG::OpenixIMGFile metadata(image.string());
+            const std::vector<std::string> expected = {
+                "boot0_nand.fex", "sys_partition.fex", "readme.txt", "tiny.fex", "rootfs.fex", "kernel.fex",
+            };
+            const auto order = payloadOrder(metadata);
+            if (order != expected || !checkPayloads(metadata, label + " metadata first")) {
+                std::cerr << label << ": metadata-first payload order is";
+                for (const auto &name: order) {
+                    std::cerr << " " << name;
+                }
+                std::cerr << std::endl;
+                result = 1;
+            }
+
+            // Every payload starts on the configured boundary, in both layouts
+            for (const uint32_t alignment: {512U, 4096U, 64U * 1024, 1024U * 1024}) {
+                for (const auto layout: {PayloadLayout::TABLE_ORDER, PayloadLayout::METADATA_FIRST}) {
+                    const auto aligned = OpenixTest::packInput(root, "aligned.img",
+                                                               [=](OpenixIMG::OpenixPacker &packer) {
+                                                                   packer.setPayloadLayout(layout);
+                                                                   packer.setPayloadAlignment(alignment);
+                                                               });
+                    const OpenixIMG::OpenixIMGFile alignedImage(aligned.string());
+                    const auto caseLabel = label + " " + std::to_string(alignment) + "-byte aligned";
+                    for (const auto &file: alignedImage.getFileList()) {
+                        if (file.offset % alignment != 0) {
+                            std::cerr << caseLabel << ": " << file.filename << " starts at " << file.offset
+                                    << std::endl;
+                            result = 1;
+                        }
+                    }
+                    if (!checkPayloads(alignedImage, caseLabel)) {
+                        result = 1;
+                    }
+                }
+            }
+        }
+
+        // Alignments that are not a power of two from 512 bytes to 1 MiB are rejected
+        OpenixIMG::OpenixIMGFile imgFile;
+        OpenixIMG::OpenixPacker packer(imgFile);
+        for (const uint32_t alignment: {0U, 256U, 1000U, 4097U, 2U * 1024 * 1024}) {
+            bool threw = false;
+            try {
+                packer.setPayloadAlignment(alignment);
+            } catch (const std::runtime_error &) {
+                threw = true;
+            }
+            if (!threw) {
+                std::cerr << "Payload alignment " << alignment << " was accepted!" << std::endl;
+                result = 1;
+            }
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        result = 1;
+    }
+
+    fs::remove_all(root);
+    if (result == 0) {
+        std::cout << "OpenixPayloadLayout test completed." << std::endl;
+    }
+    return result;
+}
@@ -0,0 +1,180 @@
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "OpenixPlanner.hpp"
+#include "OpenixTestImage.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+    bool near(const double actual, const double expected) {
+        return std::fabs(actual - expected) <= 1e-9 * std::fabs(expected);
+    }
+
+    uint64_t roundUp(const uint64_t value, const uint64_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    // Checks a plan against the files it describes; returns false and reports on the first mismatch
+    bool checkPack(const OpenixIMG::OperationPlan &plan, const std::vector<OpenixTest::TestEntry> &entries,
+                   const fs::path &config, const fs::path &image, const bool encrypted) {
+        if (plan.operation != "pack" || plan.encrypted != encrypted || plan.steps.size() != entries.size() + 2 ||
+            plan.steps[0].name != "image.cfg" || plan.steps[0].readBytes != fs::file_size(config) ||
+            plan.steps[1].name != "table" || plan.steps[1].writeBytes != 1024 * (entries.size() + 1)) {
+            std::cerr << "Pack plan does not start with the configuration and the header table!" << std::endl;
+            return false;
+        }
+        for (size_t i = 0; i < entries.size(); ++i) {
+            const auto &step = plan.steps[i + 2];
+            const auto stored = roundUp(entries[i].data.size(), 512);
+            if (step.name != entries[i].filename || step.readBytes != entries[i].data.size() ||
+                step.writeBytes != stored || step.encryptBytes != (encrypted ? stored : 0) ||
+                step.readOps != roundUp(entries[i].data.size(), OpenixIMG::IO_BUFFER_SIZE) / OpenixIMG::IO_BUFFER_SIZE) {
+                std::cerr << "Pack plan step of " << entries[i].filename << " is wrong!" << std::endl;
+                return false;
+            }
+        }
+
+        // Payloads are packed back to back, so the planned writes are the whole image
+        const auto total = plan.total();
+        if (total.writeBytes != fs::file_size(image) || total.encryptBytes != (encrypted ? total.writeBytes : 0)) {
+            std::cerr << "Pack plan writes " << total.writeBytes << " bytes, the image has "
+                    << fs::file_size(image) << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
+
+int main() {
+    using OpenixIMG::OpenixPlanner;
+
+    const auto root = fs::temp_directory_path() / "openiximg_planner_test";
+    fs::remove_all(root);
+
+    int result = 0;
+    try {
+        const std::vector<OpenixTest::TestEntry> entries = {
+            {"boot.fex", std::vector<char>(70000, 'b')},
+            {"env.fex", std::vector<char>(100, 'e')},
+            {"rootfs.fex", std::vector<char>(300000 + 17, 'r'), "RFSFAT16"},
+        };
+
+        for (const bool encrypted: {false, true}) {
+            const auto config = OpenixTest::writeInput(root, entries, encrypted ? "" : "encrypt = 0\n");
+            const auto image = OpenixTest::packInput(root);
+
+            // Pack plan: sizes follow the input files and the image actually written
+            OpenixIMG::OpenixIMGFile unused;
+            const OpenixIMG::OpenixPacker planner(unused);
+            if (!checkPack(planner.planPack(config.string()), entries, config, image, encrypted)) {
+                result = 1;
+            }
+
+            // Unpack plan: reads the stored payloads, writes exactly what unpacking produces
+            OpenixIMG::OpenixIMGFile imgFile(image.string());
+            const OpenixIMG::OpenixPacker packer(imgFile);
+            const auto plan = packer.planUnpack(OpenixIMG::OutputFormat::IMGREPACKER);
+            const auto output = root / "output";
+            if (!packer.unpackImage(output.string(), OpenixIMG::OutputFormat::IMGREPACKER)) {
+                throw std::runtime_error("Unpacking the test image failed!");
+            }
+            if (plan.operation != "unpack" || plan.encrypted != encrypted || plan.steps.size() != entries.size() + 2 ||
+                plan.steps.front().readBytes != 1024 * (entries.size() + 1)) {
+                std::cerr << "Unpack plan does not cover the headers and every entry!" << std::endl;
+                result = 1;
+                continue;
+            }
+            uint64_t stored = 0;
+            for (size_t i = 0; i < entries.size(); ++i) {
+                const auto &step = plan.steps[i + 1];
+                const auto written = fs::file_size(output / entries[i].filename);
+                stored += step.readBytes;
+                if (step.name != entries[i].filename || step.writeBytes != written ||
+                    step.readBytes != roundUp(written, 512) || step.decryptBytes != (encrypted ? step.readBytes : 0)) {
+                    std::cerr << "Unpack plan step of " << entries[i].filename << " is wrong!" << std::endl;
+                    result = 1;
+                }
+            }
+            if (plan.total().readBytes != fs::file_size(image) || stored + plan.steps.front().readBytes !=
+                fs::file_size(image)) {
+                std::cerr << "Unpack plan reads " << plan.total().readBytes << " bytes, the image has "
+                        << fs::file_size(image) << std::endl;
+                result = 1;
+            }
+        }
+
+        // Aligned, reordered payloads and a file listed twice: the plan follows the layout actually packed
+        {
+            auto listed = entries;
+            listed.push_back({"boot.fex", entries[0].data, "BOOTBAK"});
+            const auto config = OpenixTest::writeInput(root, listed);
+            const auto setup = [](OpenixIMG::OpenixPacker &packer) {
+                packer.setPayloadLayout(OpenixIMG::PayloadLayout::METADATA_FIRST);
+                packer.setPayloadAlignment(64 * 1024);
+            };
+            const auto image = OpenixTest::packInput(root, "aligned.img", setup);
+            OpenixIMG::OpenixIMGFile unused;
+            OpenixIMG::OpenixPacker planner(unused);
+            setup(planner);
+            const auto plan = planner.planPack(config.string());
+            const auto total = plan.total();
+            uint64_t stored = 1024 * (listed.size() + 1);
+            for (const auto &entry: entries) {
+                stored += roundUp(entry.data.size(), 512);
+            }
+            if (plan.steps.size() != entries.size() + 2 || plan.steps[2].name != "env.fex" ||
+                total.writeBytes != fs::file_size(image) || total.encryptBytes != stored) {
+                std::cerr << "Aligned pack plan writes " << total.writeBytes << " bytes, the image has "
+                        << fs::file_size(image) << std::endl;
+                result = 1;
+            }
+        }
+
+        // Time model: bytes over bandwidth per kind, plus a fixed cost per call
+        OpenixIMG::OperationPlan plan;
+        plan.steps.resize(2);
+        plan.steps[0].readBytes = 3000000;
+        plan.steps[0].decryptBytes = 1000000;
+        plan.steps[0].readOps = 4;
+        plan.steps[1].writeBytes = 4000000;
+        plan.steps[1].encryptBytes = 1000000;
+        plan.steps[1].writeOps = 6;
+        plan.steps[1].bufferBytes = 4096;
+        const auto host = OpenixPlanner::parseHostClass("test:3:2:1:100");
+        if (host.name != "test" || !near(host.opLatency, 100e-6) || plan.total().bufferBytes != 4096 ||
+            !near(OpenixPlanner::estimateSeconds(plan, host), 1.0 + 2.0 + 2.0 + 10 * 100e-6)) {
+            std::cerr << "Estimate is " << OpenixPlanner::estimateSeconds(plan, host) << " s, expected 5.001 s"
+                    << std::endl;
+            result = 1;
+        }
+        if (!near(OpenixPlanner::estimateSeconds(plan, OpenixPlanner::parseHostClass("fast:6:4:2")), 2.5)) {
+            std::cerr << "Doubling the bandwidths did not halve the estimate!" << std::endl;
+            result = 1;
+        }
+        for (const auto *spec: {"test:1:2", "test:1:2:3:4:5", ":1:2:3", "test:x:2:3", "test:0:2:3", "test:1:2:3:-1"}) {
+            bool threw = false;
+            try {
+                (void) OpenixPlanner::parseHostClass(spec);
+            } catch (const std::runtime_error &) {
+                threw = true;
+            }
+            if (!threw) {
+                std::cerr << "Malformed host class " << spec << " was accepted!" << std::endl;
+                result = 1;
+            }
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        result = 1;
+    }
+
+    fs::remove_all(root);
+    if (result == 0) {
+        std::cout << "OpenixPlanner test completed." << std::endl;
+    }
+    return result;
+}
@@ -0,0 +1,106 @@
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "OpenixMetrics.hpp"
+#include "OpenixTestImage.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+    const char *NAMES[] = {"boot0.fex", "env.fex", "boot.fex", "rootfs.fex"};
+    const size_t SIZES[] = {1000, 70000, 5000, 300000};
+
+    std::vector<char> entryData(const size_t entry) {
+        std::vector<char> data(SIZES[entry]);
+        for (size_t i = 0; i < data.size(); ++i) {
+            data[i] = static_cast<char>((i * 31 + entry * 97) >> 3);
+        }
+        return data;
+    }
+
+    // Reads a shuffled selection with a duplicate; returns the number of vectored reads it took
+    uint64_t readShuffled(const fs::path &image, bool &matches) {
+        OpenixIMG::OpenixMetrics::reset();
+        const OpenixIMG::OpenixIMGFile imgFile(image.string());
+        const std::vector<size_t> indices = {3, 0, 2, 1, 0};
+        const auto entries = imgFile.readEntries(indices);
+
+        matches = entries.size() == indices.size();
+        for (size_t i = 0; matches && i < indices.size(); ++i) {
+            const auto expected = entryData(indices[i]);
+            matches = std::vector<char>(entries[i].begin(), entries[i].end()) == expected;
+        }
+        return OpenixIMG::OpenixMetrics::histogram(OpenixIMG::Metric::READ).count();
+    }
+}
+
+int main() {
+    const auto root = fs::temp_directory_path() / "openiximg_read_entries_test";
+    fs::remove_all(root);
+    OpenixIMG::OpenixMetrics::setEnabled(true);
+
+    int result = 0;
+    try {
+        std::vector<OpenixTest::TestEntry> entries;
+        for (size_t i = 0; i < 4; ++i) {
+            entries.push_back({NAMES[i], entryData(i)});
+        }
+        OpenixTest::writeInput(root, entries);
+
+        // Adjacent payloads, gaps the coalescer bridges and gaps it does not
+        const struct {
+            uint32_t alignment;
+            uint64_t reads;
+            const char *layout;
+        } cases[] = {
+            {512, 1, "adjacent"},
+            {64 * 1024, 1, "gapped"},
+            {1024 * 1024, 4, "far apart"},
+        };
+        for (const auto &c: cases) {
+            const auto image = OpenixTest::packInput(root, "test.img", [&c](OpenixIMG::OpenixPacker &packer) {
+                packer.setPayloadAlignment(c.alignment);
+            });
+            bool matches = false;
+            const auto reads = readShuffled(image, matches);
+            std::cout << c.layout << " payloads: " << reads << " vectored reads" << std::endl;
+            if (!matches) {
+                std::cerr << "Batched read of " << c.layout << " payloads returned wrong data!" << std::endl;
+                result = 1;
+            } else if (reads != c.reads) {
+                std::cerr << "Expected " << c.reads << " vectored reads for " << c.layout << " payloads!" << std::endl;
+                result = 1;
+            }
+        }
+
+        // An image cut short inside the last payload fails instead of returning zeros
+        const auto image = OpenixTest::packInput(root);
+        fs::resize_file(image, fs::file_size(image) - 1000);
+        const OpenixIMG::OpenixIMGFile truncated(image.string());
+        if (truncated.readEntries({0, 1}).size() != 2) {
+            std::cerr << "Entries before the cut could not be read!" << std::endl;
+            result = 1;
+        }
+        bool threw = false;
+        try {
+            (void) truncated.readEntries({2, 3});
+        } catch (const std::runtime_error &) {
+            threw = true;
+        }
+        if (!threw) {
+            std::cerr << "Batched read of a truncated image did not fail!" << std::endl;
+            result = 1;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        result = 1;
+    }
+
+    fs::remove_all(root);
+    if (result == 0) {
+        std::cout << "OpenixReadEntries test completed." << std::endl;
+    }
+    return result;
+}
@@ -0,0 +1,165 @@
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "OpenixScheduler.hpp"
+
+using OpenixIMG::OpenixScheduler;
+using OpenixIMG::Priority;
+
+namespace {
+    constexpr auto HOLD = std::chrono::milliseconds(20);
+    // Long enough for a started thread to be queued on the scheduler
+    constexpr auto SETTLE = std::chrono::milliseconds(200);
+
+    /**
+     * @brief Records the order in which tasks of several threads got their slot
+     */
+    class AdmissionLog {
+    public:
+        std::thread start(const Priority priority, const std::string &name) {
+            return std::thread([this, priority, name]() {
+                const OpenixScheduler::Task task(priority);
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    order_.push_back(name);
+                }
+                std::this_thread::sleep_for(HOLD);
+            });
+        }
+
+        std::vector<std::string> order() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return order_;
+        }
+
+    private:
+        std::mutex mutex_;
+        std::vector<std::string> order_;
+    };
+}
+
+int main() {
+    int result = 0;
+
+    // Scopes nest and restore the class they replaced
+    if (OpenixScheduler::currentPriority(Priority::BULK) != Priority::BULK) {
+        result = 1;
+    }
+    {
+        const OpenixScheduler::PriorityScope outer(Priority::INTERACTIVE);
+        {
+            const OpenixScheduler::PriorityScope inner(Priority::BULK);
+            if (OpenixScheduler::currentPriority(Priority::INTERACTIVE) != Priority::BULK) {
+                result = 1;
+            }
+        }
+        if (OpenixScheduler::currentPriority(Priority::BULK) != Priority::INTERACTIVE) {
+            result = 1;
+        }
+    }
+    if (OpenixScheduler::currentPriority(Priority::INTERACTIVE) != Priority::INTERACTIVE || result != 0) {
+        std::cerr << "Priority scopes did not nest!" << std::endl;
+        result = 1;
+    }
+
+    OpenixScheduler::setSlots(3);
+    if (OpenixScheduler::slots() != 3) {
+        std::cerr << "Slot count was not applied!" << std::endl;
+        result = 1;
+    }
+    OpenixScheduler::setSlots(0);
+    if (OpenixScheduler::slots() < 2) {
+        std::cerr << "Default slot count leaves no slot for interactive tasks!" << std::endl;
+        result = 1;
+    }
+
+    // Per-class counters
+    OpenixScheduler::resetStats();
+    for (int i = 0; i < 3; ++i) {
+        OpenixScheduler::Task task(Priority::INTERACTIVE);
+        task.addBytes(100);
+        task.addBytes(28);
+    }
+    for (int i = 0; i < 5; ++i) {
+        OpenixScheduler::Task task(Priority::BULK);
+        task.addBytes(4096);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    const auto interactive = OpenixScheduler::stats(Priority::INTERACTIVE);
+    const auto bulk = OpenixScheduler::stats(Priority::BULK);
+    if (interactive.tasks != 3 || interactive.bytes != 384 || bulk.tasks != 5 || bulk.bytes != 5 * 4096 ||
+        bulk.runNanoseconds < 10'000'000 || interactive.maxWaitNanoseconds > interactive.waitNanoseconds ||
+        bulk.maxWaitNanoseconds > bulk.waitNanoseconds) {
+        std::cerr << "Counters: interactive " << interactive.tasks << " tasks " << interactive.bytes << " bytes, bulk "
+                << bulk.tasks << " tasks " << bulk.bytes << " bytes " << bulk.runNanoseconds << " ns" << std::endl;
+        result = 1;
+    }
+    const auto summary = OpenixScheduler::dumpToString();
+    if (summary.find("interactive 3 tasks, 384 bytes") == std::string::npos ||
+        summary.find("bulk        5 tasks, 20480 bytes") == std::string::npos) {
+        std::cerr << "Unexpected summary:\n" << summary;
+        result = 1;
+    }
+    OpenixScheduler::resetStats();
+    const auto cleared = OpenixScheduler::stats(Priority::BULK);
+    if (cleared.tasks != 0 || cleared.bytes != 0 || cleared.waitNanoseconds != 0 || cleared.runNanoseconds != 0 ||
+        cleared.maxWaitNanoseconds != 0) {
+        std::cerr << "Counters were not reset!" << std::endl;
+        result = 1;
+    }
+
+    // One slot, held by bulk work: a queued interactive task goes ahead of a bulk task that queued before it
+    OpenixScheduler::setSlots(1);
+    {
+        AdmissionLog log;
+        auto holder = std::make_unique<OpenixScheduler::Task>(Priority::BULK);
+        auto queuedBulk = log.start(Priority::BULK, "bulk");
+        std::this_thread::sleep_for(SETTLE);
+        auto queuedInteractive = log.start(Priority::INTERACTIVE, "interactive");
+        std::this_thread::sleep_for(SETTLE);
+        if (!log.order().empty()) {
+            std::cerr << "A task was admitted while the only slot was held!" << std::endl;
+            result = 1;
+        }
+        holder.reset();
+        queuedBulk.join();
+        queuedInteractive.join();
+        if (log.order() != std::vector<std::string>{"interactive", "bulk"}) {
+            std::cerr << "Interactive task was not admitted ahead of the queued bulk task!" << std::endl;
+            result = 1;
+        }
+        const auto waited = OpenixScheduler::stats(Priority::BULK);
+        if (waited.tasks != 2 || waited.maxWaitNanoseconds < 2 * std::chrono::nanoseconds(SETTLE).count()) {
+            std::cerr << "Bulk wait of " << waited.maxWaitNanoseconds << " ns was not recorded!" << std::endl;
+            result = 1;
+        }
+    }
+
+    // Two slots: bulk work leaves one free, so an interactive task runs while a second bulk task waits
+    OpenixScheduler::setSlots(2);
+    {
+        AdmissionLog log;
+        auto holder = std::make_unique<OpenixScheduler::Task>(Priority::BULK);
+        auto queuedBulk = log.start(Priority::BULK, "bulk");
+        std::this_thread::sleep_for(SETTLE);
+        auto interactiveTask = log.start(Priority::INTERACTIVE, "interactive");
+        interactiveTask.join();
+        if (log.order() != std::vector<std::string>{"interactive"}) {
+            std::cerr << "Reserved slot was not kept for the interactive task!" << std::endl;
+            result = 1;
+        }
+        holder.reset();
+        queuedBulk.join();
+    }
+    OpenixScheduler::setSlots(0);
+
+    if (result == 0) {
+        std::cout << "OpenixScheduler test completed." << std::endl;
+    }
+    return result;
+}
@@ -0,0 +1,75 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "OpenixSharedCache.hpp"
+
+int main() {
+#ifdef _WIN32
+    std::cout << "OpenixSharedCache test skipped: POSIX shared memory is not available." << std::endl;
+    return 0;
+#else
+    using OpenixIMG::OpenixSharedCache;
+
+    const auto name = "/openiximg-test-" + std::to_string(getpid());
+    OpenixSharedCache::unlink(name);
+
+    int status = 1;
+    try {
+        // Room for two 400 KiB entries but not three
+        OpenixSharedCache cache(name, 1024 * 1024);
+        std::vector<uint8_t> payload(400 * 1024);
+        for (uint32_t index = 0; index < 3; ++index) {
+            std::fill(payload.begin(), payload.end(), static_cast<uint8_t>(index + 1));
+            if (!cache.insert(42, index, payload.data(), payload.size())) {
+                std::cerr << "Failed to insert entry " << index << std::endl;
+                OpenixSharedCache::unlink(name);
+                return 1;
+            }
+        }
+
+        // The least recently used entry made room for the third one
+        std::vector<uint8_t> data;
+        if (cache.lookup(42, 0, data) || !cache.lookup(42, 2, data) || data.size() != payload.size() ||
+            data.front() != 3 || data.back() != 3) {
+            std::cerr << "Unexpected eviction result!" << std::endl;
+            OpenixSharedCache::unlink(name);
+            return 1;
+        }
+
+        // Another process sees the entries without decrypting anything
+        const auto child = fork();
+        if (child == 0) {
+            OpenixSharedCache other(name, 1);
+            std::vector<uint8_t> shared;
+            _exit(other.lookup(42, 1, shared) && shared.size() == 400 * 1024 && shared[1000] == 2 ? 0 : 1);
+        }
+        if (child < 0 || waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            std::cerr << "Entry not visible from another process!" << std::endl;
+            OpenixSharedCache::unlink(name);
+            return 1;
+        }
+
+        const auto stats = cache.stats();
+        std::cout << "entries: " << stats.entries << ", hits: " << stats.hits << ", misses: " << stats.misses
+                << ", evictions: " << stats.evictions << std::endl;
+        status = stats.entries == 2 && stats.hits == 2 && stats.misses == 1 && stats.evictions == 1 ? 0 : 1;
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+    }
+
+    OpenixSharedCache::unlink(name);
+    if (status != 0) {
+        std::cerr << "Unexpected shared cache statistics!" << std::endl;
+        return 1;
+    }
+
+    std::cout << "\nOpenixSharedCache test completed." << std::endl;
+    return 0;
+#endif
+}
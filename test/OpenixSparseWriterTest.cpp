@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "OpenixSparseWriter.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr uint32_t BLOCK = OpenixIMG::OpenixSparseWriter::DEFAULT_BLOCK_SIZE;
+
+    struct Chunk {
+        uint16_t type;
+        uint32_t blocks;
+    };
+
+    uint32_t getLE(const std::vector<uint8_t> &data, const size_t offset, const size_t bytes) {
+        uint32_t value = 0;
+        for (size_t i = 0; i < bytes; ++i) {
+            value |= static_cast<uint32_t>(data.at(offset + i)) << (i * 8);
+        }
+        return value;
+    }
+
+    void appendRandom(std::vector<uint8_t> &data, const size_t length, uint32_t &seed) {
+        for (size_t i = 0; i < length; ++i) {
+            seed = seed * 1103515245 + 12345;
+            data.push_back(static_cast<uint8_t>(seed >> 16));
+        }
+    }
+
+    // Parses the sparse file the way simg2img does; returns false on any malformed field
+    bool expand(const fs::path &path, std::vector<uint8_t> &expanded, std::vector<Chunk> &chunks) {
+        std::ifstream in(path, std::ios::binary);
+        const std::vector<uint8_t> file{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+        if (file.size() < 28 || getLE(file, 0, 4) != 0xED26FF3A || getLE(file, 4, 2) != 1 || getLE(file, 6, 2) != 0 ||
+            getLE(file, 8, 2) != 28 || getLE(file, 10, 2) != 12 || getLE(file, 12, 4) != BLOCK ||
+            getLE(file, 24, 4) != 0) {
+            std::cerr << "Sparse file header is malformed!" << std::endl;
+            return false;
+        }
+
+        const auto totalBlocks = getLE(file, 16, 4);
+        const auto totalChunks = getLE(file, 20, 4);
+        size_t offset = 28;
+        for (uint32_t i = 0; i < totalChunks; ++i) {
+            const auto type = static_cast<uint16_t>(getLE(file, offset, 2));
+            const auto blocks = getLE(file, offset + 4, 4);
+            const auto totalSize = getLE(file, offset + 8, 4);
+            const auto body = offset + 12;
+            chunks.push_back({type, blocks});
+
+            if (type == 0xCAC1 && totalSize == 12 + uint64_t{blocks} * BLOCK && body + blocks * BLOCK <= file.size()) {
+                expanded.insert(expanded.end(), file.begin() + body, file.begin() + body + blocks * BLOCK);
+            } else if (type == 0xCAC2 && totalSize == 16) {
+                for (uint64_t word = 0; word < uint64_t{blocks} * BLOCK / 4; ++word) {
+                    expanded.insert(expanded.end(), file.begin() + body, file.begin() + body + 4);
+                }
+            } else if (type == 0xCAC3 && totalSize == 12) {
+                expanded.resize(expanded.size() + uint64_t{blocks} * BLOCK, 0);
+            } else {
+                std::cerr << "Chunk " << i << " of type " << std::hex << type << std::dec << " is malformed!"
+                        << std::endl;
+                return false;
+            }
+            offset += totalSize;
+        }
+
+        if (offset != file.size() || expanded.size() != uint64_t{totalBlocks} * BLOCK) {
+            std::cerr << "Chunks do not cover the file or the declared block count!" << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
+
+int main() {
+    const auto root = fs::temp_directory_path() / "openiximg_sparse_writer_test";
+    fs::remove_all(root);
+    fs::create_directories(root);
+
+    // Three random blocks, two blocks of one 32-bit value, two zero blocks, two and a half skipped
+    // blocks, then random data that completes the half block and ends in a partial tail block
+    uint32_t seed = 1;
+    std::vector<uint8_t> head;
+    appendRandom(head, 3 * BLOCK, seed);
+    for (size_t i = 0; i < 2 * BLOCK / 4; ++i) {
+        head.insert(head.end(), {0x78, 0x56, 0x34, 0x12});
+    }
+    head.resize(head.size() + 2 * BLOCK, 0);
+    constexpr uint64_t SKIPPED = 2 * BLOCK + 2000;
+    std::vector<uint8_t> tail;
+    appendRandom(tail, BLOCK + 100, seed);
+
+    std::vector<uint8_t> source = head;
+    source.resize(source.size() + SKIPPED, 0);
+    source.insert(source.end(), tail.begin(), tail.end());
+
+    int result = 0;
+    const struct {
+        bool zeroAsDontCare;
+        std::vector<Chunk> chunks;
+    } cases[] = {
+        {false, {{0xCAC1, 3}, {0xCAC2, 2}, {0xCAC2, 2}, {0xCAC3, 2}, {0xCAC1, 2}}},
+        {true, {{0xCAC1, 3}, {0xCAC2, 2}, {0xCAC3, 4}, {0xCAC1, 2}}},
+    };
+    for (const auto &c: cases) {
+        const auto path = root / (c.zeroAsDontCare ? "dontcare.simg" : "fill.simg");
+        try {
+            OpenixIMG::OpenixSparseWriter writer(path.string(), BLOCK, c.zeroAsDontCare);
+            // Pieces that straddle block boundaries go through the partial-block buffer
+            for (size_t offset = 0; offset < head.size(); offset += 1000) {
+                writer.write(head.data() + offset, std::min<size_t>(1000, head.size() - offset));
+            }
+            writer.skip(SKIPPED);
+            writer.write(tail.data(), tail.size());
+            if (writer.size() != source.size()) {
+                std::cerr << "Writer reports " << writer.size() << " bytes, " << source.size() << " were appended"
+                        << std::endl;
+                result = 1;
+            }
+            writer.finish();
+        } catch (const std::exception &e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            result = 1;
+            continue;
+        }
+
+        std::vector<uint8_t> expanded;
+        std::vector<Chunk> chunks;
+        if (!expand(path, expanded, chunks)) {
+            result = 1;
+            continue;
+        }
+
+        bool sameChunks = chunks.size() == c.chunks.size();
+        for (size_t i = 0; sameChunks && i < chunks.size(); ++i) {
+            sameChunks = chunks[i].type == c.chunks[i].type && chunks[i].blocks == c.chunks[i].blocks;
+        }
+        if (!sameChunks) {
+            std::cerr << "Unexpected chunk sequence with zeroAsDontCare=" << c.zeroAsDontCare << ":";
+            for (const auto &chunk: chunks) {
+                std::cerr << " " << std::hex << chunk.type << std::dec << "x" << chunk.blocks;
+            }
+            std::cerr << std::endl;
+            result = 1;
+        }
+
+        // The tail block is padded with zeros to a whole block
+        const auto padding = expanded.size() - std::min(expanded.size(), source.size());
+        if (expanded.size() != (source.size() + BLOCK - 1) / BLOCK * BLOCK ||
+            !std::equal(source.begin(), source.end(), expanded.begin()) ||
+            std::any_of(expanded.end() - static_cast<std::ptrdiff_t>(padding), expanded.end(),
+                        [](const uint8_t byte) { return byte != 0; })) {
+            std::cerr << "Expanded image differs from the source with zeroAsDontCare=" << c.zeroAsDontCare
+                    << std::endl;
+            result = 1;
+        }
+    }
+
+    bool threw = false;
+    try {
+        OpenixIMG::OpenixSparseWriter invalid((root / "invalid.simg").string(), 1022);
+    } catch (const std::runtime_error &) {
+        threw = true;
+    }
+    if (!threw) {
+        std::cerr << "Block size that is not a multiple of 4 was accepted!" << std::endl;
+        result = 1;
+    }
+
+    fs::remove_all(root);
+    if (result == 0) {
+        std::cout << "OpenixSparseWriter test completed." << std::endl;
+    }
+    return result;
+}
@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "OpenixTOC1.hpp"
+
+namespace {
+    void putLE32(std::vector<uint8_t> &data, const size_t offset, const uint32_t value) {
+        for (int i = 0; i < 4; ++i) {
+            data[offset + i] = static_cast<uint8_t>(value >> (i * 8));
+        }
+    }
+
+    uint32_t stampSum(const std::vector<uint8_t> &data, const size_t offset, const size_t length,
+                      const size_t checksumOffset) {
+        uint32_t sum = 0;
+        for (size_t pos = 0; pos + 4 <= length; pos += 4) {
+            uint32_t word;
+            std::memcpy(&word, data.data() + offset + pos, sizeof(word));
+            sum += pos == checksumOffset ? 0x5F0A6C39 : word;
+        }
+        return sum;
+    }
+
+    // Package with a u-boot item carrying a boot header and a plain dtb item
+    std::vector<uint8_t> buildPackage() {
+        std::vector<uint8_t> package(4096);
+        std::memcpy(package.data(), "sunxi-package", 13);
+        putLE32(package, 16, 0x89119800);
+        putLE32(package, 32, 2);
+        putLE32(package, 36, static_cast<uint32_t>(package.size()));
+        putLE32(package, 60, 0x3B45494D);
+
+        const struct {
+            const char *name;
+            uint32_t offset;
+            uint32_t length;
+        } items[] = {{"u-boot", 1024, 1024}, {"dtb", 2048, 700}};
+        for (size_t i = 0; i < 2; ++i) {
+            const size_t base = 64 + i * 368;
+            std::memcpy(package.data() + base, items[i].name, std::strlen(items[i].name));
+            putLE32(package, base + 64, items[i].offset);
+            putLE32(package, base + 68, items[i].length);
+            putLE32(package, base + 80, 0x4A000000);
+            putLE32(package, base + 364, 0x3B454949);
+            for (uint32_t j = 0; j < items[i].length; ++j) {
+                package[items[i].offset + j] = static_cast<uint8_t>(j * 7 + i);
+            }
+        }
+
+        // u-boot header: jump, magic, checksum, align size, length
+        std::memcpy(package.data() + 1024 + 4, "uboot\0\0\0", 8);
+        putLE32(package, 1024 + 20, 1024);
+        putLE32(package, 1024 + 12, stampSum(package, 1024, 1024, 12));
+
+        putLE32(package, 20, stampSum(package, 0, package.size(), 20));
+        return package;
+    }
+}
+
+int main() {
+    auto package = buildPackage();
+    size_t bytesRead = 0;
+    const auto reader = [&package, &bytesRead](const uint64_t offset, void *data, const size_t length) -> size_t {
+        if (offset >= package.size()) {
+            return 0;
+        }
+        const auto count = std::min<size_t>(length, package.size() - offset);
+        std::memcpy(data, package.data() + offset, count);
+        bytesRead += count;
+        return count;
+    };
+
+    try {
+        const OpenixIMG::OpenixTOC1 toc(reader);
+
+        // Opening reads the header and the item table only
+        if (bytesRead != 64 + 2 * 368) {
+            std::cerr << "Unexpected read of " << bytesRead << " bytes while opening!" << std::endl;
+            return 1;
+        }
+
+        for (const auto &item: toc.items()) {
+            std::cout << item.name << " offset " << item.offset << " length " << item.length << std::endl;
+        }
+        const auto dtb = toc.find("dtb");
+        if (toc.items().size() != 2 || !dtb || dtb->length != 700 || toc.find("optee")) {
+            std::cerr << "Unexpected item table!" << std::endl;
+            return 1;
+        }
+
+        std::vector<uint8_t> data;
+        toc.extract(*dtb, [&data](const uint8_t *chunk, const size_t length) {
+            data.insert(data.end(), chunk, chunk + length);
+        });
+        if (data.size() != 700 || std::memcmp(data.data(), package.data() + 2048, data.size()) != 0) {
+            std::cerr << "Extracted dtb does not match!" << std::endl;
+            return 1;
+        }
+
+        const auto uboot = toc.verifyItem(*toc.find("u-boot"));
+        const auto plain = toc.verifyItem(*dtb);
+        if (!uboot.present || !uboot.valid || plain.present || !toc.verifyPackage().valid) {
+            std::cerr << "Checksums of the intact package not accepted!" << std::endl;
+            return 1;
+        }
+
+        // A flipped bit in u-boot breaks both its own checksum and the package checksum
+        package[1500] ^= 0x10;
+        if (toc.verifyItem(*toc.find("u-boot")).valid || toc.verifyPackage().valid) {
+            std::cerr << "Corrupted u-boot not detected!" << std::endl;
+            return 1;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    // A wrong magic is rejected when opening
+    package[16] ^= 0xFF;
+    try {
+        const OpenixIMG::OpenixTOC1 toc(reader);
+        std::cerr << "Invalid package accepted!" << std::endl;
+        return 1;
+    } catch (const std::runtime_error &) {
+    }
+
+    std::cout << "\nOpenixTOC1 test completed." << std::endl;
+    return 0;
+}
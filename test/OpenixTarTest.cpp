@@ -0,0 +1,218 @@
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "OpenixTarReader.hpp"
+#include "OpenixTestImage.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+    // One ustar header block; the size field may differ from the data that follows (PAX overrides it)
+    std::string header(const std::string &name, const uint64_t size, const char type, const std::string &prefix = "") {
+        std::string block(512, '\0');
+        std::memcpy(&block[0], name.data(), std::min<size_t>(name.size(), 100));
+        std::memcpy(&block[100], "0000644", 7);
+        std::memcpy(&block[108], "0000000", 7);
+        std::memcpy(&block[116], "0000000", 7);
+        std::snprintf(&block[124], 12, "%011llo", static_cast<unsigned long long>(size));
+        std::memcpy(&block[136], "00000000000", 11);
+        block[156] = type;
+        std::memcpy(&block[257], "ustar", 6);
+        std::memcpy(&block[263], "00", 2);
+        std::memcpy(&block[345], prefix.data(), std::min<size_t>(prefix.size(), 155));
+
+        unsigned checksum = 8 * ' ';
+        for (size_t i = 0; i < block.size(); ++i) {
+            checksum += i >= 148 && i < 156 ? 0 : static_cast<uint8_t>(block[i]);
+        }
+        std::snprintf(&block[148], 8, "%06o", checksum);
+        block[155] = ' ';
+        return block;
+    }
+
+    std::string padded(const std::string &data) {
+        return data + std::string((512 - data.size() % 512) % 512, '\0');
+    }
+
+    std::string member(const std::string &name, const std::string &data) {
+        return header(name, data.size(), '0') + padded(data);
+    }
+
+    // "<length> <key>=<value>\n", where the length counts itself
+    std::string paxRecord(const std::string &key, const std::string &value) {
+        const auto body = " " + key + "=" + value + "\n";
+        auto length = body.size() + 1;
+        while (std::to_string(length).size() + body.size() != length) {
+            ++length;
+        }
+        return std::to_string(length) + body;
+    }
+
+    std::string endOfArchive() {
+        return std::string(1024, '\0');
+    }
+
+    std::string pattern(const size_t length, const char seed) {
+        std::string data(length, '\0');
+        for (size_t i = 0; i < length; ++i) {
+            data[i] = static_cast<char>(seed + i * 7);
+        }
+        return data;
+    }
+
+    bool expectMember(OpenixIMG::OpenixTarReader &tar, const std::string &name, const std::string &data) {
+        OpenixIMG::OpenixTarReader::Member found;
+        if (!tar.next(found) || found.name != name || found.size != data.size()) {
+            std::cerr << "Expected member " << name << " of " << data.size() << " bytes, got " << found.name
+                    << " of " << found.size << " bytes" << std::endl;
+            return false;
+        }
+        std::string actual(data.size(), '\0');
+        if (tar.read(reinterpret_cast<uint8_t *>(actual.data()), actual.size()) != actual.size() || actual != data) {
+            std::cerr << "Data of member " << name << " does not match!" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    std::string readText(const fs::path &path) {
+        std::ifstream in(path, std::ios::binary);
+        return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    }
+}
+
+int main() {
+    int result = 0;
+
+    // Header formats: ustar with prefix, GNU long names, PAX path and size, skipped directories
+    try {
+        const std::string longName = std::string(120, 'l') + "/long.fex";
+        const std::string paxName = std::string(200, 'p') + "/pax.fex";
+        const auto plain = pattern(1000, 'a');
+        const auto prefixed = pattern(512, 'b');
+        const auto gnu = pattern(700, 'c');
+        const auto pax = pattern(3000, 'd');
+        const auto after = pattern(10, 'e');
+
+        std::string archive;
+        archive += member("./plain.fex", plain);
+        archive += header("dir/", 0, '5');
+        archive += header("file.bin", prefixed.size(), '0', "dir/sub") + padded(prefixed);
+        archive += header("././@LongLink", longName.size() + 1, 'L') + padded(longName + '\0');
+        archive += member("truncated-name", gnu);
+
+        // The PAX size describes the file member, not the GNU long-name record between them
+        const auto records = paxRecord("path", paxName) + paxRecord("size", std::to_string(pax.size()));
+        archive += header("PaxHeaders/pax", records.size(), 'x') + padded(records);
+        archive += header("././@LongLink", longName.size() + 1, 'L') + padded(longName + '\0');
+        archive += header("pax-short", 0, '0') + padded(pax);
+        archive += member("after.fex", after);
+        archive += endOfArchive();
+
+        std::istringstream stream(archive);
+        OpenixIMG::OpenixTarReader tar(stream);
+        OpenixIMG::OpenixTarReader::Member end;
+        if (!expectMember(tar, "plain.fex", plain) || !expectMember(tar, "dir/sub/file.bin", prefixed) ||
+            !expectMember(tar, longName, gnu) || !expectMember(tar, paxName, pax) ||
+            !expectMember(tar, "after.fex", after) || tar.next(end)) {
+            std::cerr << "Tar headers were not read correctly!" << std::endl;
+            result = 1;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        result = 1;
+    }
+
+    const auto root = fs::temp_directory_path() / "openiximg_tar_test";
+    fs::remove_all(root);
+    try {
+        const std::vector<OpenixTest::TestEntry> entries = {
+            {"boot.fex", std::vector<char>(70000, 'b')},
+            {"rootfs.fex", std::vector<char>(300000 + 17, 'r'), "RFSFAT16"},
+        };
+        const auto config = readText(OpenixTest::writeInput(root, entries));
+        const auto reference = OpenixTest::packInput(root, "reference.img");
+
+        // tar -> image round trip, with image.cfg taken from the stream
+        std::string archive = member("image.cfg", config);
+        for (const auto &entry: entries) {
+            archive += member(entry.filename, std::string(entry.data.begin(), entry.data.end()));
+        }
+        {
+            std::istringstream stream(archive + endOfArchive());
+            OpenixIMG::OpenixIMGFile imgFile;
+            const OpenixIMG::OpenixPacker packer(imgFile);
+            if (!packer.packImageFromTar(stream, "", (root / "tar.img").string())) {
+                std::cerr << "Packing from a tar stream failed!" << std::endl;
+                result = 1;
+            }
+        }
+        if (readText(root / "tar.img") != readText(reference)) {
+            std::cerr << "Image packed from tar differs from the image packed from a directory!" << std::endl;
+            result = 1;
+        }
+        const OpenixIMG::OpenixIMGFile packed((root / "tar.img").string());
+        const auto data = packed.readEntries({0, 1});
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (std::vector<char>(data[i].begin(), data[i].end()) != entries[i].data) {
+                std::cerr << "Entry " << entries[i].filename << " of the tar image does not match!" << std::endl;
+                result = 1;
+            }
+        }
+
+        // A member repeated in the stream is rejected and leaves no image behind
+        bool threw = false;
+        try {
+            std::istringstream stream(archive + member("boot.fex", "second copy") + endOfArchive());
+            OpenixIMG::OpenixIMGFile imgFile;
+            const OpenixIMG::OpenixPacker packer(imgFile);
+            (void) packer.packImageFromTar(stream, "", (root / "duplicate.img").string());
+        } catch (const std::runtime_error &) {
+            threw = true;
+        }
+        if (!threw || fs::exists(root / "duplicate.img")) {
+            std::cerr << "Duplicate tar member was not rejected!" << std::endl;
+            result = 1;
+        }
+
+        // A file listed twice gets one payload region, whether packed from a directory or a stream
+        const std::vector<OpenixTest::TestEntry> shared = {
+            entries[0], {"env.fex", std::vector<char>(3000, 'e')}, {"boot.fex", entries[0].data, "BOOTBAK"},
+        };
+        const auto sharedConfig = readText(OpenixTest::writeInput(root, shared));
+        const auto sharedReference = OpenixTest::packInput(root, "shared.img");
+        {
+            std::istringstream stream(member("image.cfg", sharedConfig) +
+                                      member("boot.fex", std::string(shared[0].data.begin(), shared[0].data.end())) +
+                                      member("env.fex", std::string(shared[1].data.begin(), shared[1].data.end())) +
+                                      endOfArchive());
+            OpenixIMG::OpenixIMGFile imgFile;
+            const OpenixIMG::OpenixPacker packer(imgFile);
+            (void) packer.packImageFromTar(stream, "", (root / "shared-tar.img").string());
+        }
+        const OpenixIMG::OpenixIMGFile sharedImage(sharedReference.string());
+        const auto &files = sharedImage.getFileList();
+        if (readText(root / "shared-tar.img") != readText(sharedReference) || files.size() != 3 ||
+            files[0].offset != files[2].offset || files[1].offset <= files[0].offset ||
+            fs::file_size(sharedReference) != files[1].offset + files[1].storedLength) {
+            std::cerr << "A file listed twice was not packed into one shared region!" << std::endl;
+            result = 1;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        result = 1;
+    }
+
+    fs::remove_all(root);
+    if (result == 0) {
+        std::cout << "OpenixTar test completed." << std::endl;
+    }
+    return result;
+}
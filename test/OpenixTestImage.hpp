@@ -0,0 +1,114 @@
+/**
+ * @file OpenixTestImage.hpp
+ * @brief Shared fixture for tests that need a packed image
+ */
+
+#ifndef OPENIXIMG_OPENIXTESTIMAGE_HPP
+#define OPENIXIMG_OPENIXTESTIMAGE_HPP
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "OpenixIMGFile.hpp"
+#include "OpenixPacker.hpp"
+
+namespace OpenixTest {
+    namespace fs = std::filesystem;
+
+    /**
+     * @struct TestEntry
+     * @brief One file of the image.cfg file list
+     */
+    struct TestEntry {
+        std::string filename; //!< File name in the input directory
+        std::vector<char> data; //!< File contents
+        std::string maintype = "COMMON"; //!< Main type recorded in the file list
+    };
+
+    /**
+     * @brief Adjusts a packer before it packs
+     */
+    using PackerSetup = std::function<void(OpenixIMG::OpenixPacker &packer)>;
+
+    /**
+     * @brief Subtype the way image.cfg files name them: upper-case file name padded with '0' to 16 characters
+     */
+    inline std::string subtypeOf(const std::string &filename) {
+        std::string subtype;
+        for (const char c: filename) {
+            subtype += c == '.' ? '_' : static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        }
+        subtype.resize(std::max<size_t>(subtype.size(), 16), '0');
+        return subtype;
+    }
+
+    /**
+     * @brief Write the entries and an image.cfg listing them to root/input
+     *
+     * @param root Test directory
+     * @param entries Files of the image, in file list order
+     * @param extraCfg Lines appended to the [IMAGE_CFG] section
+     * @return Path of the image.cfg
+     */
+    inline fs::path writeInput(const fs::path &root, const std::vector<TestEntry> &entries,
+                               const std::string &extraCfg = "") {
+        fs::create_directories(root / "input");
+        std::ofstream config(root / "input" / "image.cfg");
+        config << "[DIR_DEF]\nINPUT_DIR = \"../\"\n\n[FILELIST]\n";
+        for (const auto &entry: entries) {
+            std::ofstream file(root / "input" / entry.filename, std::ios::binary);
+            file.write(entry.data.data(), static_cast<std::streamsize>(entry.data.size()));
+            config << "{ filename = \"" << entry.filename << "\", maintype = \"" << entry.maintype
+                    << "\", subtype = \"" << subtypeOf(entry.filename) << "\", },\n";
+        }
+        config << "\n[IMAGE_CFG]\nversion = 0x100234\npid = 0x1234\nvid = 0x8743\nhardwareid = 0x100\n"
+                << "firmwareid = 0x100\nimagename = test.img\nfilelist = FILELIST\n" << extraCfg;
+        return root / "input" / "image.cfg";
+    }
+
+    /**
+     * @brief Pack root/input/image.cfg into an image
+     *
+     * @param root Test directory
+     * @param name Image file name inside root
+     * @param setup Called on the packer before it packs
+     * @return Path of the image
+     * @throws std::runtime_error if packing fails
+     */
+    inline fs::path packInput(const fs::path &root, const std::string &name = "test.img",
+                              const PackerSetup &setup = {}) {
+        OpenixIMG::OpenixIMGFile imgFile;
+        OpenixIMG::OpenixPacker packer(imgFile);
+        if (setup) {
+            setup(packer);
+        }
+        const auto image = root / name;
+        if (!packer.packImage((root / "input" / "image.cfg").string(), image.string())) {
+            throw std::runtime_error("Packing the test image failed!");
+        }
+        return image;
+    }
+
+    /**
+     * @brief Pack root/test.img from a single rootfs.fex entry
+     *
+     * @param root Test directory
+     * @param payload Contents of rootfs.fex
+     * @param extraCfg Lines appended to the [IMAGE_CFG] section
+     * @param setup Called on the packer before it packs
+     * @return Path of the image
+     */
+    inline fs::path makePackedImage(const fs::path &root, const std::vector<char> &payload,
+                                    const std::string &extraCfg = "", const PackerSetup &setup = {}) {
+        writeInput(root, {{"rootfs.fex", payload, "RFSFAT16"}}, extraCfg);
+        return packInput(root, "test.img", setup);
+    }
+} // namespace OpenixTest
+
+#endif // OPENIXIMG_OPENIXTESTIMAGE_HPP
@@ -0,0 +1,229 @@
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "OpenixCRC32.hpp"
+#include "OpenixTestImage.hpp"
+#include "OpenixUBootEnv.hpp"
+
+namespace fs = std::filesystem;
+using OpenixIMG::OpenixCRC32;
+using OpenixIMG::OpenixUBootEnv;
+
+namespace {
+    using Variables = std::vector<std::pair<std::string, std::string> >;
+
+    // Bit-at-a-time reference for the table-driven implementation
+    uint32_t referenceCrc(const uint8_t *data, const size_t length) {
+        uint32_t crc = 0xFFFFFFFF;
+        for (size_t i = 0; i < length; ++i) {
+            crc ^= data[i];
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = crc >> 1 ^ (crc & 1 ? 0xEDB88320 : 0);
+            }
+        }
+        return ~crc;
+    }
+
+    std::vector<uint8_t> makeEnv(const Variables &variables, const size_t size, const bool redundant,
+                                 const uint8_t padding) {
+        std::vector<uint8_t> image(size, padding);
+        const size_t dataOffset = redundant ? 5 : 4;
+        if (redundant) {
+            image[4] = 1; // Active copy flag
+        }
+        size_t pos = dataOffset;
+        for (const auto &[name, value]: variables) {
+            const auto entry = name + "=" + value;
+            std::copy(entry.begin(), entry.end(), image.begin() + static_cast<std::ptrdiff_t>(pos));
+            pos += entry.size();
+            image[pos++] = 0;
+        }
+        image[pos] = 0;
+
+        const auto crc = OpenixCRC32::compute(image.data() + dataOffset, image.size() - dataOffset);
+        for (int i = 0; i < 4; ++i) {
+            image[i] = static_cast<uint8_t>(crc >> (i * 8));
+        }
+        return image;
+    }
+
+    bool throws(const std::function<void()> &action) {
+        try {
+            action();
+        } catch (const std::runtime_error &) {
+            return true;
+        }
+        return false;
+    }
+
+    const Variables VARIABLES = {
+        {"bootdelay", "3"},
+        {"bootcmd", "run setargs_nand boot_normal"},
+        {"console", "ttyS0,115200"},
+        {"loglevel", "8"},
+    };
+
+    // Edits an environment and checks that commit writes only what changed and parses back
+    bool checkEdit(const bool redundant, const uint8_t padding) {
+        const auto label = std::string(redundant ? "redundant" : "single") + (padding ? " 0xFF-padded" : "");
+        const auto original = makeEnv(VARIABLES, 4096, redundant, padding);
+        OpenixUBootEnv env(original);
+        if (env.isRedundant() != redundant || env.size() != original.size() || env.variables() != VARIABLES ||
+            env.get("console") != "ttyS0,115200" || env.get("missing")) {
+            std::cerr << label << ": environment parsed wrongly" << std::endl;
+            return false;
+        }
+
+        // Shorten one value, drop one variable, add one
+        env.set("bootcmd", "run boot_recovery");
+        (void) env.remove("loglevel");
+        env.set("serial", "0123456789");
+        const Variables expected = {
+            {"bootdelay", "3"}, {"bootcmd", "run boot_recovery"}, {"console", "ttyS0,115200"}, {"serial", "0123456789"},
+        };
+
+        auto target = original;
+        uint64_t spans = 0;
+        const auto written = env.commit([&target, &spans](const uint64_t offset, const void *data,
+                                                          const size_t length) {
+            std::memcpy(target.data() + offset, data, length);
+            ++spans;
+        });
+        if (target != env.serialize() || written == 0 || written >= 200 || spans == 0) {
+            std::cerr << label << ": commit wrote " << written << " bytes in " << spans << " spans" << std::endl;
+            return false;
+        }
+
+        const OpenixUBootEnv reparsed(target);
+        if (reparsed.isRedundant() != redundant || reparsed.variables() != expected ||
+            (redundant && target[4] != 1) || target.back() != padding) {
+            std::cerr << label << ": committed environment does not parse back" << std::endl;
+            return false;
+        }
+
+        // Nothing left to write; values that do not fit are rejected without touching the target
+        auto unchanged = target;
+        if (env.commit([](uint64_t, const void *, size_t) {
+            throw std::runtime_error("unexpected write");
+        }) != 0) {
+            return false;
+        }
+        env.set("huge", std::string(5000, 'x'));
+        if (!throws([&env, &unchanged] {
+            env.commit([&unchanged](const uint64_t offset, const void *data, const size_t length) {
+                std::memcpy(unchanged.data() + offset, data, length);
+            });
+        }) || unchanged != target) {
+            std::cerr << label << ": oversized environment was not rejected" << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
+
+int main() {
+    int result = 0;
+
+    // CRC-32 check value, and continuing a checksum across every split of a buffer
+    const std::string check = "123456789";
+    if (OpenixCRC32::compute(check.data(), check.size()) != 0xCBF43926U || OpenixCRC32::compute(nullptr, 0) != 0) {
+        std::cerr << "CRC-32 check value is wrong!" << std::endl;
+        result = 1;
+    }
+    std::vector<uint8_t> buffer(1000);
+    for (size_t i = 0; i < buffer.size(); ++i) {
+        buffer[i] = static_cast<uint8_t>(i * 131 + (i >> 3));
+    }
+    for (size_t length = 0; length <= 64; ++length) {
+        if (OpenixCRC32::compute(buffer.data() + 3, length) != referenceCrc(buffer.data() + 3, length)) {
+            std::cerr << "CRC-32 of " << length << " unaligned bytes differs from the reference!" << std::endl;
+            result = 1;
+        }
+    }
+    const auto whole = OpenixCRC32::compute(buffer.data(), buffer.size());
+    for (const size_t split: {size_t{0}, size_t{1}, size_t{7}, size_t{8}, size_t{13}, size_t{500}, size_t{999}}) {
+        const auto first = OpenixCRC32::compute(buffer.data(), split);
+        if (OpenixCRC32::compute(buffer.data() + split, buffer.size() - split, first) != whole) {
+            std::cerr << "Incremental CRC-32 split at " << split << " differs from one-shot!" << std::endl;
+            result = 1;
+        }
+    }
+
+    for (const bool redundant: {false, true}) {
+        for (const uint8_t padding: {uint8_t{0x00}, uint8_t{0xFF}}) {
+            try {
+                if (!checkEdit(redundant, padding)) {
+                    result = 1;
+                }
+            } catch (const std::exception &e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+                result = 1;
+            }
+        }
+    }
+
+    // Invalid names, and images whose CRC matches neither layout
+    auto corrupt = makeEnv(VARIABLES, 512, false, 0);
+    corrupt[100] ^= 1;
+    OpenixUBootEnv env(makeEnv(VARIABLES, 512, false, 0));
+    if (!throws([&env] { env.set("a=b", "c"); }) || !throws([&env] { env.set("", "c"); }) ||
+        !throws([&env] { env.set("a", std::string("b\0c", 3)); }) ||
+        !throws([&corrupt] { OpenixUBootEnv invalid(corrupt); }) ||
+        !throws([] { OpenixUBootEnv tiny(std::vector<uint8_t>(5, 0)); })) {
+        std::cerr << "Invalid input was accepted!" << std::endl;
+        result = 1;
+    }
+
+    // In place through an encrypted image: both layouts, and the neighbouring entry stays intact
+    const auto root = fs::temp_directory_path() / "openiximg_uboot_env_test";
+    fs::remove_all(root);
+    try {
+        const auto single = makeEnv(VARIABLES, 8192, false, 0);
+        const auto redundant = makeEnv(VARIABLES, 8192, true, 0);
+        const std::vector<char> neighbour(5000, 'n');
+        OpenixTest::writeInput(root, {
+                                   {"env.fex", std::vector<char>(single.begin(), single.end())},
+                                   {"env-redund.fex", std::vector<char>(redundant.begin(), redundant.end())},
+                                   {"boot.fex", neighbour},
+                               });
+        const auto image = OpenixTest::packInput(root);
+        {
+            OpenixIMG::OpenixIMGFile imgFile(image.string());
+            for (size_t index = 0; index < 2; ++index) {
+                OpenixUBootEnv entry(imgFile, index);
+                entry.set("bootdelay", "0");
+                entry.set("entry", std::to_string(index));
+                (void) entry.commit(imgFile, index);
+            }
+        }
+
+        const OpenixIMG::OpenixIMGFile reloaded(image.string());
+        for (size_t index = 0; index < 2; ++index) {
+            const OpenixUBootEnv entry(reloaded, index);
+            if (entry.isRedundant() != (index == 1) || entry.get("bootdelay") != "0" ||
+                entry.get("entry") != std::to_string(index) || entry.get("console") != "ttyS0,115200") {
+                std::cerr << "Environment " << index << " was not written back to the image!" << std::endl;
+                result = 1;
+            }
+        }
+        const auto data = reloaded.readEntries({2});
+        if (std::vector<char>(data[0].begin(), data[0].end()) != neighbour) {
+            std::cerr << "Writing the environment changed another entry!" << std::endl;
+            result = 1;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        result = 1;
+    }
+
+    fs::remove_all(root);
+    if (result == 0) {
+        std::cout << "OpenixUBootEnv test completed." << std::endl;
+    }
+    return result;
+}
@@ -0,0 +1,132 @@
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "OpenixCancellation.hpp"
+#include "OpenixIMGFile.hpp"
+#include "OpenixPacker.hpp"
+#include "OpenixTestImage.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+    // Spans several write-back windows, with a partial one at the end
+    constexpr size_t ENTRY_SIZE = 20 * 1024 * 1024 + 333;
+
+    std::vector<char> payload() {
+        std::vector<char> data(ENTRY_SIZE);
+        for (size_t i = 0; i < data.size(); ++i) {
+            data[i] = static_cast<char>((i * 2654435761ULL) >> 11);
+        }
+        return data;
+    }
+
+    bool sameContents(const fs::path &path, const std::vector<char> &expected) {
+        std::ifstream in(path, std::ios::binary);
+        const std::vector<char> actual((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        return actual == expected;
+    }
+
+    // Hidden staging or replaced trees left next to the output
+    size_t siblings(const fs::path &root) {
+        size_t count = 0;
+        for (const auto &entry: fs::directory_iterator(root)) {
+            count += entry.path().filename().string().rfind(".output.", 0) == 0;
+        }
+        return count;
+    }
+
+    bool unpack(const fs::path &root, const OpenixIMG::Durability durability,
+                const std::shared_ptr<OpenixIMG::OpenixCancellationToken> &token) {
+        OpenixIMG::OpenixIMGFile imgFile((root / "test.img").string());
+        imgFile.setCancellationToken(token);
+        OpenixIMG::OpenixPacker packer(imgFile);
+        packer.setDurability(durability);
+        try {
+            const bool unpacked = packer.unpackImage((root / "output").string(), OpenixIMG::OutputFormat::IMGREPACKER,
+                                                     {}, OpenixIMG::ReplaceMode::SWAP);
+            packer.waitForCleanup();
+            return unpacked;
+        } catch (const OpenixIMG::OperationCancelled &) {
+            return false;
+        }
+    }
+}
+
+int main() {
+    const auto root = fs::temp_directory_path() / "openiximg_unpack_output_test";
+    fs::remove_all(root);
+
+    int result = 0;
+    try {
+        const auto data = payload();
+        OpenixTest::makePackedImage(root, data, "", [](OpenixIMG::OpenixPacker &packer) {
+            packer.setDurability(OpenixIMG::Durability::BARRIER);
+        });
+
+        // Syncing and write-back change when the image reaches the device, never what it contains
+        for (const auto durability: {OpenixIMG::Durability::NONE, OpenixIMG::Durability::INCREMENTAL}) {
+            const auto image = OpenixTest::packInput(root, "durable.img", [durability](OpenixIMG::OpenixPacker &p) {
+                p.setDurability(durability);
+            });
+            std::ifstream in(root / "test.img", std::ios::binary);
+            const std::vector<char> reference((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            if (!sameContents(image, reference)) {
+                std::cerr << "Durability mode changed the packed image!" << std::endl;
+                result = 1;
+            }
+        }
+
+        // A previous extraction to be replaced
+        fs::create_directories(root / "output" / "stale");
+        std::ofstream(root / "output" / "marker") << "old";
+
+        // Each durability mode replaces the tree as a whole and leaves nothing beside it
+        for (const auto durability: {OpenixIMG::Durability::NONE, OpenixIMG::Durability::BARRIER,
+                                     OpenixIMG::Durability::INCREMENTAL}) {
+            const auto idle = std::make_shared<OpenixIMG::OpenixCancellationToken>();
+            if (!unpack(root, durability, idle)) {
+                std::cerr << "Swapped unpack failed!" << std::endl;
+                result = 1;
+            } else if (fs::exists(root / "output" / "marker") || fs::exists(root / "output" / "stale")) {
+                std::cerr << "Swapped unpack kept files of the previous tree!" << std::endl;
+                result = 1;
+            } else if (!sameContents(root / "output" / "rootfs.fex", data) ||
+                       !fs::exists(root / "output" / "image.cfg")) {
+                std::cerr << "Swapped unpack does not match the input!" << std::endl;
+                result = 1;
+            } else if (siblings(root) != 0) {
+                std::cerr << "Swapped unpack left a staging or replaced tree behind!" << std::endl;
+                result = 1;
+            }
+            std::ofstream(root / "output" / "marker") << "old";
+        }
+
+        // A cancelled swap leaves the previous tree exactly as it was
+        const auto cancelled = std::make_shared<OpenixIMG::OpenixCancellationToken>();
+        cancelled->cancel();
+        if (unpack(root, OpenixIMG::Durability::INCREMENTAL, cancelled)) {
+            std::cerr << "Cancelled token did not stop the unpack!" << std::endl;
+            result = 1;
+        } else if (!fs::exists(root / "output" / "marker") || !sameContents(root / "output" / "rootfs.fex", data)) {
+            std::cerr << "Cancelled swap damaged the previous tree!" << std::endl;
+            result = 1;
+        } else if (siblings(root) != 0) {
+            std::cerr << "Cancelled swap left its staging tree behind!" << std::endl;
+            result = 1;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        result = 1;
+    }
+
+    fs::remove_all(root);
+    if (result == 0) {
+        std::cout << "OpenixUnpackOutput test completed." << std::endl;
+    }
+    return result;
+}
@@ -0,0 +1,124 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "OpenixIMGWTY.hpp"
+#include "OpenixTestImage.hpp"
+#include "OpenixValidator.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+    std::vector<char> readFile(const fs::path &path) {
+        std::ifstream in(path, std::ios::binary);
+        return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    }
+
+    void writeFile(const fs::path &path, const std::vector<char> &data) {
+        std::ofstream out(path, std::ios::binary);
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    }
+
+    // Version 1 file header of an entry of an unencrypted image
+    OpenixIMG::FileHeader *fileHeader(std::vector<char> &image, const size_t index) {
+        return reinterpret_cast<OpenixIMG::FileHeader *>(image.data() + OpenixIMG::IMAGEWTY_FILEHDR_LEN * (index + 1));
+    }
+
+    bool hasError(const OpenixIMG::ValidationReport &report, const std::string &entry, const std::string &text) {
+        for (const auto &error: report.errors) {
+            if (error.entry == entry && error.message.find(text) != std::string::npos) {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+int main() {
+    const auto root = fs::temp_directory_path() / "openiximg_validator_test";
+    fs::remove_all(root);
+
+    int result = 0;
+    try {
+        std::vector<OpenixTest::TestEntry> entries;
+        const char *names[] = {"sys_config.fex", "boot.fex", "rootfs.fex"};
+        const size_t sizes[] = {1000, 70000, 300000};
+        for (size_t i = 0; i < 3; ++i) {
+            entries.push_back({names[i], std::vector<char>(sizes[i], static_cast<char>('a' + i))});
+        }
+
+        // One encrypted image and one plain image with 64 KiB aligned payloads
+        OpenixTest::writeInput(root, entries);
+        OpenixTest::packInput(root, "encrypted.img");
+        OpenixTest::writeInput(root, entries, "encrypt = 0\n");
+        OpenixTest::packInput(root, "aligned.img", [](OpenixIMG::OpenixPacker &packer) {
+            packer.setPayloadAlignment(64 * 1024);
+        });
+
+        const auto encrypted = OpenixIMG::OpenixValidator::validate((root / "encrypted.img").string());
+        if (!encrypted.valid() || !encrypted.encrypted || encrypted.numFiles != 3 || !encrypted.gaps.empty()) {
+            std::cerr << "Encrypted image did not validate cleanly!" << std::endl;
+            result = 1;
+        }
+
+        // Alignment padding shows up as gaps, but gaps alone are no error
+        const auto aligned = OpenixIMG::OpenixValidator::validate((root / "aligned.img").string());
+        if (!aligned.valid() || aligned.encrypted || aligned.gaps.size() != 3 || aligned.gapBytes() == 0) {
+            std::cerr << "Aligned image: expected three gaps and no errors!" << std::endl;
+            std::cerr << OpenixIMG::OpenixValidator::dumpToString({aligned});
+            result = 1;
+        }
+
+        // Every corruption is reported in a single pass
+        auto image = readFile(root / "aligned.img");
+        const auto fileSize = static_cast<uint32_t>(image.size());
+        fileHeader(image, 1)->v1.offset = fileHeader(image, 0)->v1.offset + 512;
+        fileHeader(image, 2)->v1.original_length = fileHeader(image, 2)->v1.stored_length + 1;
+        std::memcpy(fileHeader(image, 2)->v1.filename.data(), "boot.fex", 9);
+        writeFile(root / "corrupt.img", image);
+        fileHeader(image, 0)->v1.offset = fileSize - 16;
+        writeFile(root / "truncated.img", image);
+        writeFile(root / "short.img", std::vector<char>(image.begin(), image.begin() + 2048));
+
+        const auto reports = OpenixIMG::OpenixValidator::validateAll({
+            (root / "corrupt.img").string(), (root / "truncated.img").string(), (root / "short.img").string(),
+            (root / "missing.img").string()
+        }, 2);
+        if (reports.size() != 4 || reports[0].path != (root / "corrupt.img").string()) {
+            std::cerr << "Reports are not in input order!" << std::endl;
+            return 1;
+        }
+        if (!hasError(reports[0], "boot.fex", "overlaps sys_config.fex") ||
+            !hasError(reports[0], "boot.fex", "duplicate file name") ||
+            !hasError(reports[0], "boot.fex", "exceeds stored_length")) {
+            std::cerr << "Overlap, duplicate name or length error missing!" << std::endl;
+            std::cerr << OpenixIMG::OpenixValidator::dumpToString({reports[0]});
+            result = 1;
+        }
+        if (!hasError(reports[1], "sys_config.fex", "past the end of the file")) {
+            std::cerr << "Payload beyond the end of the file not reported!" << std::endl;
+            result = 1;
+        }
+        if (!hasError(reports[2], "", "header table") || reports[2].numFiles != 3) {
+            std::cerr << "Truncated header table not reported!" << std::endl;
+            result = 1;
+        }
+        if (reports[3].valid()) {
+            std::cerr << "Missing file reported as valid!" << std::endl;
+            result = 1;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        result = 1;
+    }
+
+    fs::remove_all(root);
+    if (result == 0) {
+        std::cout << "OpenixValidator test completed." << std::endl;
+    }
+    return result;
+}